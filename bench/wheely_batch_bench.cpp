@@ -0,0 +1,81 @@
+// Batch scaling curve: throughput of simulate_batch() on a pinned,
+// NUMA-spread executor for 1..N worker threads.
+//
+// usage: wheely_batch_bench [runs_per_thread] [n_cups] [n_frames]
+
+#include "wheely_batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+wheely::SimulationConfig make_bench_config(std::size_t n_cups,
+                                           std::size_t n_frames,
+                                           std::size_t index) {
+    wheely::SimulationConfig cfg;
+    cfg.n_cups = n_cups;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 2.0;
+    cfg.leak_rate = 0.1;
+    cfg.inflow_rate = 0.9;
+    cfg.inertia = 5.0;
+    cfg.omega0 = 0.5 + 0.01 * static_cast<double>(index);
+    cfg.t_start = 0.0;
+    cfg.t_end = 90.0;
+    cfg.n_frames = n_frames;
+    cfg.steps_per_frame = 6;
+    return cfg;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t runs_per_thread =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    const std::size_t n_cups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+    const std::size_t n_frames =
+        argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2000;
+
+    const auto topology = wheely::CpuTopology::detect();
+    const std::size_t max_threads = topology.cpu_count();
+    std::printf("nodes=%zu cpus=%zu cups=%zu frames=%zu runs/thread=%zu\n",
+                topology.node_cpus.size(), max_threads, n_cups, n_frames,
+                runs_per_thread);
+    std::printf("%8s %10s %12s %9s %11s\n", "threads", "seconds", "runs/s",
+                "speedup", "efficiency");
+
+    double baseline = 0.0;
+    for (std::size_t threads = 1; threads <= max_threads;
+         threads = threads < 4 ? threads + 1 : std::min(max_threads, threads * 2)) {
+        std::vector<wheely::SimulationConfig> configs;
+        for (std::size_t index = 0; index < runs_per_thread * threads; ++index) {
+            configs.push_back(make_bench_config(n_cups, n_frames, index));
+        }
+
+        wheely::ExecutorOptions options;
+        options.n_threads = threads;
+        wheely::BatchExecutor executor(options, topology);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = wheely::simulate_batch(configs, executor);
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        const double rate = static_cast<double>(results.size()) / elapsed.count();
+        if (threads == 1) {
+            baseline = rate;
+        }
+        const double speedup = rate / baseline;
+        std::printf("%8zu %10.3f %12.1f %9.2f %10.0f%%\n", threads,
+                    elapsed.count(), rate, speedup,
+                    100.0 * speedup / static_cast<double>(threads));
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Huge-page gain on big-cup, many-frame runs: times SimulationArena::run()
+// with the arena's storage mapped under each HugePageMode. Every frame
+// writes one value per cup with an n_frames stride, so small pages cost a
+// TLB miss per cup.
+//
+// usage: wheely_hugepage_bench [n_cups] [n_frames] [repeats]
+
+#include "wheely_arena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    wheely::SimulationConfig cfg;
+    cfg.n_cups = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+    cfg.n_frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    const int repeats = argc > 3 ? std::atoi(argv[3]) : 3;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 2.0;
+    cfg.leak_rate = 0.1;
+    cfg.inflow_rate = 0.9;
+    cfg.inertia = 5.0;
+    cfg.omega0 = 1.0;
+    cfg.t_start = 0.0;
+    cfg.t_end = 90.0;
+    cfg.steps_per_frame = 1;
+
+    const double megabytes = static_cast<double>(cfg.n_cups * cfg.n_frames) *
+                             sizeof(double) / (1024.0 * 1024.0);
+    std::printf("cups=%zu frames=%zu masses=%.0f MiB best of %d\n", cfg.n_cups,
+                cfg.n_frames, megabytes, repeats);
+    std::printf("%-12s %10s %14s %9s\n", "mode", "seconds", "frames/s",
+                "vs off");
+
+    const struct {
+        const char *name;
+        wheely::HugePageMode mode;
+    } modes[] = {
+        {"off", wheely::HugePageMode::off},
+        {"transparent", wheely::HugePageMode::transparent},
+        {"explicit", wheely::HugePageMode::explicit_pages},
+    };
+
+    double baseline = 0.0;
+    for (const auto &entry : modes) {
+        wheely::set_huge_page_mode(entry.mode);
+        double best = 1e300;
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            // A fresh arena per repeat, so each timing includes faulting in
+            // the pages, as a one-off simulate() would.
+            wheely::SimulationArena arena;
+            const auto start = std::chrono::steady_clock::now();
+            const wheely::SimulationStatus status = arena.run(cfg);
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+            if (status != wheely::SimulationStatus::ok) {
+                return 1;
+            }
+        }
+        if (baseline == 0.0) {
+            baseline = best;
+        }
+        std::printf("%-12s %10.3f %14.0f %8.2fx\n", entry.name, best,
+                    static_cast<double>(cfg.n_frames) / best, baseline / best);
+    }
+    return 0;
+}
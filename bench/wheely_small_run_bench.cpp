@@ -0,0 +1,85 @@
+// Per-call latency of tiny runs: simulate() (validation exceptions, three
+// result vectors) against simulate_into() (status codes, caller buffers,
+// stack scratch). The 2-frame, 1-step case is almost pure fixed overhead.
+//
+// usage: wheely_small_run_bench [n_cups] [n_frames] [calls]
+
+#include "wheely_simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+template <typename Call>
+double best_ns_per_call(std::size_t calls, const Call &call) {
+    double best = 1e300;
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < calls; ++i) {
+            call();
+        }
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / static_cast<double>(calls));
+    }
+    return best;
+}
+
+void run_case(wheely::SimulationConfig cfg, std::size_t calls) {
+    std::vector<double> times(cfg.n_frames);
+    std::vector<double> theta(cfg.n_frames);
+    std::vector<double> masses(cfg.n_cups * cfg.n_frames);
+    // Stores to a volatile keep the calls from being optimised away.
+    volatile double sink = 0.0;
+
+    const double vector_ns = best_ns_per_call(calls, [&] {
+        const auto result = wheely::simulate(cfg);
+        sink = result.theta.back();
+    });
+    const double into_ns = best_ns_per_call(calls, [&] {
+        const auto status = wheely::simulate_into(
+            cfg, times.data(), theta.data(), masses.data());
+        if (status != wheely::SimulationStatus::ok) {
+            std::abort();
+        }
+        sink = theta.back();
+    });
+
+    std::printf("%6zu %7zu %6zu %14.0f %16.0f %8.2fx\n", cfg.n_cups,
+                cfg.n_frames, cfg.steps_per_frame, vector_ns, into_ns,
+                vector_ns / into_ns);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    wheely::SimulationConfig cfg;
+    cfg.n_cups = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+    cfg.n_frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+    const std::size_t calls =
+        argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20000;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 2.0;
+    cfg.leak_rate = 0.1;
+    cfg.inflow_rate = 0.9;
+    cfg.inertia = 5.0;
+    cfg.omega0 = 1.0;
+    cfg.t_start = 0.0;
+    cfg.t_end = 10.0;
+    cfg.steps_per_frame = 4;
+
+    std::printf("%6s %7s %6s %14s %16s %9s\n", "cups", "frames", "steps",
+                "simulate ns", "simulate_into ns", "speedup");
+    run_case(cfg, calls);
+
+    wheely::SimulationConfig overhead = cfg;
+    overhead.n_frames = 2;
+    overhead.steps_per_frame = 1;
+    run_case(overhead, calls * 20);
+    return 0;
+}
@@ -0,0 +1,70 @@
+"""Thread scaling of wheely_cpp.simulate() called from a Python thread pool.
+
+Same configs and table as wheely_batch_bench, but each run is a separate
+simulate() call from a concurrent.futures thread. On a free-threaded
+(python3.13t) interpreter, runs/s should scale close to linearly with the
+thread count. On a regular build the GIL is released only around the C++ work,
+so converting the results back to numpy still runs one thread at a time.
+
+usage: python bench/wheely_threads_bench.py [runs_per_thread] [n_cups] [n_frames]
+"""
+
+import os
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import wheely_cpp  # type: ignore
+
+
+def make_bench_config(n_cups, n_frames, index):
+    return {
+        "N_CUPS": n_cups,
+        "RADIUS": 1.0,
+        "G": 9.81,
+        "DAMPING": 2.0,
+        "LEAK_RATE": 0.1,
+        "INFLOW_RATE": 0.9,
+        "INERTIA": 5.0,
+        "OMEGA0": 0.5 + 0.01 * index,
+        "T_START": 0.0,
+        "T_END": 90.0,
+        "N_FRAMES": n_frames,
+    }
+
+
+def main(argv):
+    runs_per_thread = int(argv[1]) if len(argv) > 1 else 4
+    n_cups = int(argv[2]) if len(argv) > 2 else 64
+    n_frames = int(argv[3]) if len(argv) > 3 else 2000
+
+    gil = getattr(sys, "_is_gil_enabled", lambda: True)()
+    max_threads = os.cpu_count() or 1
+    print(f"gil={'on' if gil else 'off'} cpus={max_threads} cups={n_cups} "
+          f"frames={n_frames} runs/thread={runs_per_thread}")
+    print(f"{'threads':>8} {'seconds':>10} {'runs/s':>12} {'speedup':>9} "
+          f"{'efficiency':>11}")
+
+    baseline = 0.0
+    threads = 1
+    while True:
+        configs = [make_bench_config(n_cups, n_frames, index)
+                   for index in range(runs_per_thread * threads)]
+        with ThreadPoolExecutor(max_workers=threads) as pool:
+            start = time.perf_counter()
+            results = list(pool.map(lambda cfg: wheely_cpp.simulate(cfg, 6), configs))
+            elapsed = time.perf_counter() - start
+
+        rate = len(results) / elapsed
+        if threads == 1:
+            baseline = rate
+        speedup = rate / baseline
+        print(f"{threads:>8} {elapsed:>10.3f} {rate:>12.1f} {speedup:>9.2f} "
+              f"{100.0 * speedup / threads:>10.0f}%")
+        if threads == max_threads:
+            break
+        threads = threads + 1 if threads < 4 else min(max_threads, threads * 2)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,64 @@
+// Streaming-to-disk overhead: compares compute-only throughput
+// (simulate_streaming with an empty sink) against simulate_to_file().
+//
+// usage: wheely_writer_bench [path] [n_cups] [n_frames] [direct_io]
+
+#include "wheely_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    const std::string path = argc > 1 ? argv[1] : "wheely_writer_bench.bin";
+    wheely::SimulationConfig cfg;
+    cfg.n_cups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+    cfg.n_frames = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200000;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 2.0;
+    cfg.leak_rate = 0.1;
+    cfg.inflow_rate = 0.9;
+    cfg.inertia = 5.0;
+    cfg.omega0 = 1.0;
+    cfg.t_start = 0.0;
+    cfg.t_end = 1000.0;
+    cfg.steps_per_frame = 1;
+
+    wheely::FrameWriterOptions options;
+    options.direct_io = argc > 4 && std::atoi(argv[4]) != 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    double checksum = 0.0;
+    wheely::simulate_streaming(
+        cfg, [&](std::size_t, double, const double *state) { checksum += state[0]; });
+    const std::chrono::duration<double> compute =
+        std::chrono::steady_clock::now() - start;
+
+    const auto write_start = std::chrono::steady_clock::now();
+    wheely::FrameWriter writer(path, cfg.n_cups + 2, options);
+    std::vector<double> record(cfg.n_cups + 2);
+    wheely::simulate_streaming(cfg, [&](std::size_t, double time, const double *state) {
+        record[0] = time;
+        std::copy(state, state + 1, record.begin() + 1);
+        std::copy(state + 2, state + 2 + cfg.n_cups, record.begin() + 2);
+        writer.write(record.data());
+    });
+    writer.close();
+    const std::chrono::duration<double> streamed =
+        std::chrono::steady_clock::now() - write_start;
+
+    const double megabytes =
+        static_cast<double>(writer.bytes_written()) / (1024.0 * 1024.0);
+    std::printf("cups=%zu frames=%zu output=%.0f MiB direct_io=%s (checksum %g)\n",
+                cfg.n_cups, cfg.n_frames, megabytes,
+                writer.direct_io() ? "yes" : "no", checksum);
+    std::printf("compute only   %8.3f s  %10.0f frames/s\n", compute.count(),
+                static_cast<double>(cfg.n_frames) / compute.count());
+    std::printf("with writer    %8.3f s  %10.0f frames/s  (%.3f s stalled on I/O)\n",
+                streamed.count(), static_cast<double>(cfg.n_frames) / streamed.count(),
+                writer.stall_seconds());
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include "wheely_adjoint.h"
+
+#include "wheely_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace wheely {
+namespace {
+
+// C(s + t, s): the most steps s snapshots can reverse when each step is
+// recomputed at most t times. Saturates instead of overflowing.
+std::size_t binomial_reach(std::size_t s, std::size_t t) {
+    const std::size_t limit = std::numeric_limits<std::size_t>::max() / 2;
+    std::size_t value = 1;
+    for (std::size_t i = 1; i <= s; ++i) {
+        // value * (t + i) / i stays integral along the way.
+        if (value > limit / (t + i)) {
+            return limit;
+        }
+        value = value * (t + i) / i;
+    }
+    return value;
+}
+
+// The wheel's vector field f(x; p) with per-cup leak rates, and its
+// vector-Jacobian products. f is simulate()'s own kernel run without leaks,
+// with each cup's leak added afterwards in the kernel's order of
+// operations, so with equal leak rates the forward sweep reproduces
+// simulate() bit for bit. The Jacobian expands sin(theta + a_i) so each
+// product needs one sincos.
+class AdjointModel {
+public:
+    AdjointModel(const SimulationConfig &cfg, std::vector<double> leak_rates)
+        : cfg_(cfg), no_leak_(cfg), kernel_(derivative_kernel(cfg.n_cups)),
+          leak_(std::move(leak_rates)), sin_offset_(cfg.n_cups),
+          cos_offset_(cfg.n_cups) {
+        no_leak_.leak_rate = 0.0;
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            sincos_turn_fraction(cup, cfg.n_cups, sin_offset_[cup],
+                                 cos_offset_[cup]);
+        }
+    }
+
+    std::size_t size() const { return cfg_.n_cups + 2; }
+
+    void derivatives(const double *x, double *f) const {
+        kernel_(x, f, no_leak_);
+        for (std::size_t cup = 0; cup < cfg_.n_cups; ++cup) {
+            f[2 + cup] = -leak_[cup] * x[2 + cup] + f[2 + cup];
+        }
+    }
+
+    // x_bar += (df/dx)^T mu, and the parameter gradients += (df/dp)^T mu.
+    void pull_back(const double *x, const double *mu, double *x_bar,
+                   AdjointGradient &gradient) const {
+        const double *masses = x + 2;
+        const double gr = cfg_.g * cfg_.radius;
+        double sin_theta = 0.0;
+        double cos_theta = 0.0;
+        sincos(x[0], sin_theta, cos_theta);
+        // d(torque)/d(m_i) = sin(theta + a_i); torque_slope = d(torque)/d(theta).
+        const double torque_weight = mu[1] * gr / cfg_.inertia;
+        double mass_cos = 0.0;
+        double mass_sin = 0.0;
+        for (std::size_t cup = 0; cup < cfg_.n_cups; ++cup) {
+            mass_cos += masses[cup] * cos_offset_[cup];
+            mass_sin += masses[cup] * sin_offset_[cup];
+            const double s =
+                sin_theta * cos_offset_[cup] + cos_theta * sin_offset_[cup];
+            x_bar[2 + cup] += torque_weight * s - mu[2 + cup] * leak_[cup];
+            gradient.leak_rates[cup] -= mu[2 + cup] * masses[cup];
+        }
+        for_each_inflow_cup(x[0], cfg_.n_cups, [&](std::size_t cup) {
+            gradient.inflow_rate += mu[2 + cup];
+        });
+        const double torque = sin_theta * mass_cos + cos_theta * mass_sin;
+        const double torque_slope = cos_theta * mass_cos - sin_theta * mass_sin;
+        const double acceleration =
+            (-cfg_.damping * x[1] + gr * torque) / cfg_.inertia;
+        x_bar[0] += torque_weight * torque_slope;
+        x_bar[1] += mu[0] - mu[1] * cfg_.damping / cfg_.inertia;
+        gradient.damping -= mu[1] * x[1] / cfg_.inertia;
+        gradient.inertia -= mu[1] * acceleration / cfg_.inertia;
+    }
+
+private:
+    SimulationConfig cfg_;
+    SimulationConfig no_leak_;
+    DerivativeKernel kernel_;
+    std::vector<double> leak_;
+    std::vector<double> sin_offset_;
+    std::vector<double> cos_offset_;
+};
+
+// Reverses n_steps RK4 steps with binomial checkpointing. States are
+// std::vectors owned by the recursion's frames, so at most one per level
+// is alive, and the levels are bounded by the snapshot budget.
+class AdjointSweep {
+public:
+    AdjointSweep(const SimulationConfig &cfg, const AdjointModel &model,
+                 const FrameLoss &loss, AdjointGradient &gradient)
+        : cfg_(cfg), model_(model), loss_(loss), gradient_(gradient),
+          n_(model.size()), dt_((cfg.t_end - cfg.t_start) /
+                                static_cast<double>(cfg.n_frames - 1) /
+                                static_cast<double>(cfg.steps_per_frame)),
+          n_steps_((cfg.n_frames - 1) * cfg.steps_per_frame),
+          stages_(7 * n_), lambda_(n_, 0.0), next_(n_), pulled_(n_),
+          frame_gradient_(n_) {}
+
+    // Returns dL/dx_0.
+    const std::vector<double> &run(const std::vector<double> &initial,
+                                   std::size_t snapshots) {
+        reverse(initial, 0, n_steps_, snapshots);
+        // Frame 0 is not the end of any step, so it is added last.
+        add_frame_loss(0, initial.data());
+        return lambda_;
+    }
+
+private:
+    // Stage vectors within stages_: k1..k4 and the inputs y2..y4.
+    double *stage(std::size_t index) { return stages_.data() + index * n_; }
+
+    void step(double *x) {
+        double *k1 = stage(0);
+        double *k2 = stage(1);
+        double *k3 = stage(2);
+        double *k4 = stage(3);
+        double *y2 = stage(4);
+        double *y3 = stage(5);
+        double *y4 = stage(6);
+        model_.derivatives(x, k1);
+        for (std::size_t i = 0; i < n_; ++i) {
+            y2[i] = x[i] + 0.5 * dt_ * k1[i];
+        }
+        model_.derivatives(y2, k2);
+        for (std::size_t i = 0; i < n_; ++i) {
+            y3[i] = x[i] + 0.5 * dt_ * k2[i];
+        }
+        model_.derivatives(y3, k3);
+        for (std::size_t i = 0; i < n_; ++i) {
+            y4[i] = x[i] + dt_ * k3[i];
+        }
+        model_.derivatives(y4, k4);
+        for (std::size_t i = 0; i < n_; ++i) {
+            x[i] += dt_ / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+        }
+        ++gradient_.forward_steps;
+    }
+
+    void advance(std::vector<double> &x, std::size_t steps) {
+        for (std::size_t k = 0; k < steps; ++k) {
+            step(x.data());
+        }
+    }
+
+    void add_frame_loss(std::size_t step_index, const double *x) {
+        if (step_index % cfg_.steps_per_frame != 0) {
+            return;
+        }
+        std::fill(frame_gradient_.begin(), frame_gradient_.end(), 0.0);
+        const std::size_t frame = step_index / cfg_.steps_per_frame;
+        gradient_.loss +=
+            loss_(frame, cfg_.t_start + static_cast<double>(step_index) * dt_, x,
+                  frame_gradient_.data());
+        for (std::size_t i = 0; i < n_; ++i) {
+            lambda_[i] += frame_gradient_[i];
+        }
+    }
+
+    // Maps lambda_ = dL/dx_{index+1} to dL/dx_index, given x = x_index.
+    void reverse_step(std::size_t index, const double *x) {
+        std::copy(x, x + n_, next_.begin());
+        step(next_.data());
+        if (index + 1 == n_steps_) {
+            add_frame_loss(n_steps_, next_.data());
+        }
+
+        const double *y2 = stage(4);
+        const double *y3 = stage(5);
+        const double *y4 = stage(6);
+        // Adjoints of k1..k4 reuse the k slots, which are no longer needed.
+        double *k1_bar = stage(0);
+        double *k2_bar = stage(1);
+        double *k3_bar = stage(2);
+        double *k4_bar = stage(3);
+        for (std::size_t i = 0; i < n_; ++i) {
+            k1_bar[i] = dt_ / 6.0 * lambda_[i];
+            k2_bar[i] = dt_ / 3.0 * lambda_[i];
+            k3_bar[i] = dt_ / 3.0 * lambda_[i];
+            k4_bar[i] = dt_ / 6.0 * lambda_[i];
+        }
+
+        pull(y4, k4_bar);
+        for (std::size_t i = 0; i < n_; ++i) {
+            lambda_[i] += pulled_[i];
+            k3_bar[i] += dt_ * pulled_[i];
+        }
+        pull(y3, k3_bar);
+        for (std::size_t i = 0; i < n_; ++i) {
+            lambda_[i] += pulled_[i];
+            k2_bar[i] += 0.5 * dt_ * pulled_[i];
+        }
+        pull(y2, k2_bar);
+        for (std::size_t i = 0; i < n_; ++i) {
+            lambda_[i] += pulled_[i];
+            k1_bar[i] += 0.5 * dt_ * pulled_[i];
+        }
+        pull(x, k1_bar);
+        for (std::size_t i = 0; i < n_; ++i) {
+            lambda_[i] += pulled_[i];
+        }
+
+        if (index > 0) {
+            add_frame_loss(index, x);
+        }
+    }
+
+    void pull(const double *at, const double *mu) {
+        std::fill(pulled_.begin(), pulled_.end(), 0.0);
+        model_.pull_back(at, mu, pulled_.data(), gradient_);
+    }
+
+    // Reverses steps [start, end) given x_start, with `free` more states
+    // allowed to be held.
+    void reverse(const std::vector<double> &x_start, std::size_t start,
+                 std::size_t end, std::size_t free) {
+        const std::size_t n = end - start;
+        if (n == 0) {
+            return;
+        }
+        if (n == 1) {
+            reverse_step(start, x_start.data());
+            return;
+        }
+        if (free == 0) {
+            std::vector<double> x(n_);
+            for (std::size_t index = end; index-- > start;) {
+                x = x_start;
+                advance(x, index - start);
+                reverse_step(index, x.data());
+            }
+            return;
+        }
+        // The fewest recomputations t with C(free + t, free) >= n, and a
+        // split leaving the right part reversible with one snapshot less.
+        std::size_t repetitions = 1;
+        while (binomial_reach(free, repetitions) < n) {
+            ++repetitions;
+        }
+        const std::size_t right =
+            std::min(binomial_reach(free - 1, repetitions), n - 1);
+        const std::size_t middle = end - right;
+        {
+            std::vector<double> x_middle = x_start;
+            advance(x_middle, middle - start);
+            ++live_;
+            gradient_.peak_snapshots = std::max(gradient_.peak_snapshots, live_);
+            reverse(x_middle, middle, end, free - 1);
+            --live_;
+        }
+        reverse(x_start, start, middle, free);
+    }
+
+    const SimulationConfig &cfg_;
+    const AdjointModel &model_;
+    const FrameLoss &loss_;
+    AdjointGradient &gradient_;
+    std::size_t n_;
+    double dt_;
+    std::size_t n_steps_;
+    std::vector<double> stages_;
+    std::vector<double> lambda_;
+    std::vector<double> next_;
+    std::vector<double> pulled_;
+    std::vector<double> frame_gradient_;
+    std::size_t live_ = 0;
+};
+
+}  // namespace
+
+AdjointGradient adjoint_gradient(const SimulationConfig &cfg,
+                                 const CupParameters &cups,
+                                 const FrameLoss &loss,
+                                 const AdjointOptions &options) {
+    validate_config(cfg);
+    auto per_cup = [&](const std::vector<double> &values, double fill,
+                       const char *what) {
+        if (values.empty()) {
+            return std::vector<double>(cfg.n_cups, fill);
+        }
+        if (values.size() != cfg.n_cups) {
+            throw std::invalid_argument(std::string(what) +
+                                        " must be empty or hold n_cups values");
+        }
+        return values;
+    };
+    const AdjointModel model(cfg, per_cup(cups.leak_rates, cfg.leak_rate,
+                                          "leak_rates"));
+    std::vector<double> initial(cfg.n_cups + 2, 0.0);
+    initial[1] = cfg.omega0;
+    const std::vector<double> masses =
+        per_cup(cups.initial_masses, 0.0, "initial_masses");
+    std::copy(masses.begin(), masses.end(), initial.begin() + 2);
+
+    const std::size_t n_steps = (cfg.n_frames - 1) * cfg.steps_per_frame;
+    std::size_t snapshots = options.snapshots;
+    if (snapshots == 0) {
+        // 4 * ceil(log2(steps)).
+        std::size_t bits = 0;
+        while ((std::size_t{1} << bits) < n_steps) {
+            ++bits;
+        }
+        snapshots = std::max<std::size_t>(1, 4 * bits);
+    }
+
+    AdjointGradient gradient;
+    gradient.leak_rates.assign(cfg.n_cups, 0.0);
+    AdjointSweep sweep(cfg, model, loss, gradient);
+    const std::vector<double> &initial_bar = sweep.run(initial, snapshots);
+    gradient.omega0 = initial_bar[1];
+    gradient.initial_masses.assign(initial_bar.begin() + 2, initial_bar.end());
+    return gradient;
+}
+
+}  // namespace wheely
@@ -0,0 +1,75 @@
+#ifndef WHEELY_ADJOINT_H
+#define WHEELY_ADJOINT_H
+
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace wheely {
+
+// Parameters that may vary per cup, on top of a SimulationConfig.
+struct CupParameters {
+    // Leak rate of each cup; empty uses cfg.leak_rate for every cup.
+    std::vector<double> leak_rates;
+    // Mass of each cup at t_start; empty starts them all empty.
+    std::vector<double> initial_masses;
+};
+
+// Called once per output frame, in reverse time order, with the state
+// [theta, omega, m_0 .. m_{n_cups-1}]. Returns that frame's term of the loss
+// and writes its gradient with respect to the state into `gradient`, which
+// arrives zeroed. The state pointer is only valid for the duration of the
+// call.
+using FrameLoss = std::function<double(std::size_t frame, double time,
+                                       const double *state, double *gradient)>;
+
+struct AdjointOptions {
+    // States held at once, besides the initial one. s snapshots and t
+    // recomputations per step cover up to C(s + t, s) steps. 0 uses
+    // 4 * ceil(log2(steps)): memory grows like log(steps), and t is at
+    // most 4 up to 10^6 steps and 5 up to 10^7.
+    std::size_t snapshots = 0;
+};
+
+struct AdjointGradient {
+    // Sum of the FrameLoss terms over all frames.
+    double loss = 0.0;
+    std::vector<double> leak_rates;
+    std::vector<double> initial_masses;
+    double omega0 = 0.0;
+    double damping = 0.0;
+    double inflow_rate = 0.0;
+    double inertia = 0.0;
+    // RK4 steps integrated in total, counting each step's recomputation in
+    // the reverse sweep. The plain forward run is (n_frames - 1) *
+    // steps_per_frame.
+    std::size_t forward_steps = 0;
+    // Most states that were held at once, besides the initial one.
+    std::size_t peak_snapshots = 0;
+};
+
+// Gradient of the trajectory loss with respect to the per-cup leak rates
+// and initial masses, omega0, damping, inflow_rate and inertia, by the
+// discrete adjoint of the RK4 integrator. The forward sweep runs
+// simulate()'s own vector field, and matches it bit for bit when the leak
+// rates are equal. The gradient is exact for the discrete map, up to
+// rounding, with one exception: the inflow window is a step function of
+// theta, so its derivative is taken as zero.
+//
+// Only the states at binomial (Revolve) checkpoints are stored. Each step
+// is recomputed from the nearest one as the reverse sweep reaches it. The
+// cost is a few forward passes and does not depend on how many parameters
+// there are.
+//
+// Throws std::invalid_argument for an invalid cfg, or for per-cup vectors
+// that are neither empty nor n_cups long.
+AdjointGradient adjoint_gradient(const SimulationConfig &cfg,
+                                 const CupParameters &cups,
+                                 const FrameLoss &loss,
+                                 const AdjointOptions &options = AdjointOptions());
+
+}  // namespace wheely
+
+#endif  // WHEELY_ADJOINT_H
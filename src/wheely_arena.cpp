@@ -0,0 +1,61 @@
+#include "wheely_arena.h"
+
+#include <new>
+
+namespace wheely {
+
+SimulationStatus SimulationArena::reserve(const SimulationConfig &cfg) noexcept {
+    const SimulationStatus status = check_config(cfg);
+    if (status != SimulationStatus::ok) {
+        return status;
+    }
+    // Checked in floating point so a run too large for a 32-bit size_t
+    // (wasm32) fails cleanly instead of wrapping around.
+    const double needed_doubles = static_cast<double>(cfg.n_cups + 2) *
+                                  static_cast<double>(cfg.n_frames);
+    if (needed_doubles > static_cast<double>(storage_.max_size())) {
+        return SimulationStatus::out_of_memory;
+    }
+    const std::size_t needed = (cfg.n_cups + 2) * cfg.n_frames;
+    if (needed <= storage_.size()) {
+        return SimulationStatus::ok;
+    }
+    try {
+        // Allocate fresh instead of resizing in place: the old contents are
+        // about to be overwritten, so copying them would be wasted work.
+        LargeBuffer grown(needed);
+        storage_.swap(grown);
+    } catch (const std::bad_alloc &) {
+        return SimulationStatus::out_of_memory;
+    }
+    n_frames_ = 0;
+    n_cups_ = 0;
+    return SimulationStatus::ok;
+}
+
+SimulationStatus SimulationArena::run(const SimulationConfig &cfg) noexcept {
+    n_frames_ = 0;
+    n_cups_ = 0;
+    SimulationStatus status = reserve(cfg);
+    if (status != SimulationStatus::ok) {
+        return status;
+    }
+    double *times = storage_.data();
+    double *theta = times + cfg.n_frames;
+    double *masses = theta + cfg.n_frames;
+    status = simulate_into(cfg, times, theta, masses);
+    if (status == SimulationStatus::ok) {
+        n_frames_ = cfg.n_frames;
+        n_cups_ = cfg.n_cups;
+    }
+    return status;
+}
+
+double SimulationArena::growth_bytes(const SimulationConfig &cfg) const noexcept {
+    const double needed = static_cast<double>(cfg.n_cups + 2) *
+                          static_cast<double>(cfg.n_frames);
+    const double have = static_cast<double>(storage_.size());
+    return needed > have ? (needed - have) * sizeof(double) : 0.0;
+}
+
+}  // namespace wheely
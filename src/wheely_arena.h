@@ -0,0 +1,43 @@
+#ifndef WHEELY_ARENA_H
+#define WHEELY_ARENA_H
+
+#include "wheely_memory.h"
+#include "wheely_simulation.h"
+
+#include <cstddef>
+
+namespace wheely {
+
+// Output storage reused across simulate_into() calls. Storage only grows, so
+// a sequence of runs allocates once for the largest of them, and the
+// buffers (and any views onto them) stay put between runs that fit.
+// Layout: times[n_frames], theta[n_frames], then n_cups * n_frames masses
+// (cup-major), contiguous.
+class SimulationArena {
+public:
+    // Grows storage to hold a run of cfg, discarding the previous run if it
+    // has to grow. Reports failure instead of throwing.
+    SimulationStatus reserve(const SimulationConfig &cfg) noexcept;
+
+    // Runs cfg into the arena. On failure frame_count() is 0.
+    SimulationStatus run(const SimulationConfig &cfg) noexcept;
+
+    // Bytes reserve(cfg) would newly allocate; 0 if cfg already fits.
+    double growth_bytes(const SimulationConfig &cfg) const noexcept;
+
+    std::size_t capacity() const { return storage_.size(); }
+    std::size_t frame_count() const { return n_frames_; }
+    std::size_t cup_count() const { return n_cups_; }
+    const double *times() const { return storage_.data(); }
+    const double *theta() const { return storage_.data() + n_frames_; }
+    const double *masses() const { return storage_.data() + 2 * n_frames_; }
+
+private:
+    LargeBuffer storage_;
+    std::size_t n_frames_ = 0;
+    std::size_t n_cups_ = 0;
+};
+
+}  // namespace wheely
+
+#endif  // WHEELY_ARENA_H
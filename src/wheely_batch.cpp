@@ -0,0 +1,72 @@
+#include "wheely_batch.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace wheely {
+namespace {
+
+void validate_batch(const std::vector<SimulationConfig> &configs) {
+    for (std::size_t index = 0; index < configs.size(); ++index) {
+        try {
+            validate_config(configs[index]);
+        } catch (const std::invalid_argument &error) {
+            throw std::invalid_argument("config " + std::to_string(index) +
+                                        ": " + error.what());
+        }
+    }
+}
+
+}  // namespace
+
+BatchExecutor &default_executor(const BatchOptions &options) {
+    static std::mutex mutex;
+    static std::map<std::pair<std::size_t, bool>, std::unique_ptr<BatchExecutor>>
+        executors;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &executor = executors[{options.n_threads, options.pin_threads}];
+    if (!executor) {
+        ExecutorOptions executor_options;
+        executor_options.n_threads = options.n_threads;
+        executor_options.pin_threads = options.pin_threads;
+        executor = std::make_unique<BatchExecutor>(executor_options);
+    }
+    return *executor;
+}
+
+std::vector<SimulationResult> simulate_batch(
+    const std::vector<SimulationConfig> &configs,
+    const BatchOptions &options) {
+    validate_batch(configs);
+
+    if (options.n_threads == 1 || configs.size() <= 1) {
+        std::vector<SimulationResult> results(configs.size());
+        for (std::size_t index = 0; index < configs.size(); ++index) {
+            results[index] = simulate(configs[index]);
+        }
+        return results;
+    }
+
+    return simulate_batch(configs, default_executor(options));
+}
+
+std::vector<SimulationResult> simulate_batch(
+    const std::vector<SimulationConfig> &configs, BatchExecutor &executor) {
+    validate_batch(configs);
+
+    // Every run writes only its own slot. simulate() allocates the run's
+    // scratch and result buffers on the worker that executes it, so the
+    // pages are first touched on that worker's NUMA node.
+    std::vector<SimulationResult> results(configs.size());
+    executor.parallel_for(configs.size(), [&](std::size_t, std::size_t index) {
+        results[index] = simulate(configs[index]);
+    });
+    return results;
+}
+
+}  // namespace wheely
@@ -0,0 +1,46 @@
+#ifndef WHEELY_BATCH_H
+#define WHEELY_BATCH_H
+
+#include "wheely_executor.h"
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace wheely {
+
+struct BatchOptions {
+    // Worker threads to use; 0 uses every CPU the process may run on.
+    std::size_t n_threads = 0;
+    // Pin workers to CPUs spread across NUMA nodes; see BatchExecutor.
+    bool pin_threads = true;
+};
+
+// The process-wide executor for these options, created on first use and
+// kept until exit. Every BatchOptions entry point runs on it, so repeated
+// calls reuse one pool instead of spawning and pinning threads each time.
+// Callers on different threads share it; their jobs take turns.
+BatchExecutor &default_executor(const BatchOptions &options = BatchOptions());
+
+// Runs simulate() on every config and returns the results in input order.
+//
+// Reproducibility: each run integrates on its own thread with its own scratch
+// buffers, and the per-step arithmetic (including the order of the torque
+// sum) depends only on the run's config. Results are therefore bit-identical
+// to calling simulate() serially, for any n_threads and any scheduling order.
+// Across different builds, configure with WHEELY_REPRODUCIBLE=ON so the
+// compiler cannot contract multiply-adds into FMAs differently per target.
+//
+// All configs are validated before any work starts; the first invalid one
+// throws std::invalid_argument naming its index.
+std::vector<SimulationResult> simulate_batch(
+    const std::vector<SimulationConfig> &configs,
+    const BatchOptions &options = BatchOptions());
+
+// As above, on an existing executor so repeated batches reuse pinned workers.
+std::vector<SimulationResult> simulate_batch(
+    const std::vector<SimulationConfig> &configs, BatchExecutor &executor);
+
+}  // namespace wheely
+
+#endif  // WHEELY_BATCH_H
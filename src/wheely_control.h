@@ -0,0 +1,213 @@
+#ifndef WHEELY_CONTROL_H
+#define WHEELY_CONTROL_H
+
+#include "wheely_simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace wheely {
+
+// What a controller sets for one RK4 substep.
+struct ControlInput {
+    // Replaces SimulationConfig::inflow_rate.
+    double inflow_rate = 0.0;
+    // Torque opposing positive omega; negative values drive the wheel.
+    double brake_torque = 0.0;
+};
+
+// A controller is any type callable as
+//
+//     ControlInput controller(double time, const double *state,
+//                             const SimulationConfig &cfg);
+//
+// with state = [theta, omega, m_0 .. m_{n_cups-1}]. It is called at the start
+// of every RK4 substep, and its input is held through the step's four stages
+// (zero-order hold). Controllers are template parameters, so each call is
+// inlined into the loop instead of going through a function pointer.
+
+// Leaves the wheel alone. simulate_controlled() with it is simulate().
+struct NullController {
+    ControlInput operator()(double, const double *,
+                            const SimulationConfig &cfg) const noexcept {
+        return {cfg.inflow_rate, 0.0};
+    }
+};
+
+// Pyragas delayed feedback on omega: a torque gain * (omega(t - delay) -
+// omega(t)), so brake_torque = gain * (omega(t) - omega(t - delay)). It
+// vanishes on any orbit of period delay, which it tries to stabilize
+// without having to know the orbit. The delay is a whole number of
+// substeps. No torque is applied until that much history exists, and the
+// torque is clamped to +-max_torque.
+class DelayedFeedbackController {
+public:
+    DelayedFeedbackController(double gain, std::size_t delay_steps,
+                              double max_torque =
+                                  std::numeric_limits<double>::infinity())
+        : gain_(gain), max_torque_(max_torque), history_(delay_steps) {
+        if (delay_steps == 0) {
+            throw std::invalid_argument("delay_steps must be positive");
+        }
+        if (!(max_torque >= 0.0)) {
+            throw std::invalid_argument("max_torque must be non-negative");
+        }
+    }
+
+    ControlInput operator()(double, const double *state,
+                            const SimulationConfig &cfg) {
+        const double omega = state[1];
+        double torque = 0.0;
+        if (filled_ == history_.size()) {
+            torque = gain_ * (omega - history_[next_]);
+            torque = std::min(max_torque_, std::max(-max_torque_, torque));
+        } else {
+            ++filled_;
+        }
+        history_[next_] = omega;
+        next_ = next_ + 1 == history_.size() ? 0 : next_ + 1;
+        return {cfg.inflow_rate, torque};
+    }
+
+private:
+    double gain_;
+    double max_torque_;
+    // omega at the last delay_steps calls; next_ is the oldest.
+    std::vector<double> history_;
+    std::size_t next_ = 0;
+    std::size_t filled_ = 0;
+};
+
+// The 1-D return map of successive maxima of |omega|, xi_{n+1} =
+// F(xi_n, inflow_rate), linearized about an unstable fixed point xi*.
+// fixed_point, slope dF/dxi and sensitivity dF/d(inflow_rate) are usually
+// fitted from an uncontrolled run.
+struct OgyParameters {
+    double fixed_point = 0.0;
+    double slope = 0.0;
+    double sensitivity = 0.0;
+    // Only act when |xi_n - xi*| is below this.
+    double window = 0.0;
+    // Largest |change| to inflow_rate; larger corrections are skipped.
+    double max_perturbation = 0.0;
+};
+
+// Ott-Grebogi-Yorke control on the map of |omega| maxima. At each maximum
+// (detected at substep resolution) that falls inside the window, it sets
+// the inflow perturbation that puts the linearized next maximum on the
+// fixed point, delta = -slope * (xi_n - xi*) / sensitivity. That
+// perturbation is held until the next maximum, and it is zero outside the
+// window.
+class OgyController {
+public:
+    explicit OgyController(const OgyParameters &parameters)
+        : parameters_(parameters) {
+        if (parameters.sensitivity == 0.0) {
+            throw std::invalid_argument("sensitivity must be non-zero");
+        }
+    }
+
+    ControlInput operator()(double, const double *state,
+                            const SimulationConfig &cfg) {
+        const double speed = std::abs(state[1]);
+        if (calls_ >= 2 && previous_ > before_ && previous_ >= speed) {
+            ++maxima_;
+            perturbation_ = 0.0;
+            const double offset = previous_ - parameters_.fixed_point;
+            if (std::abs(offset) < parameters_.window) {
+                const double delta =
+                    -parameters_.slope * offset / parameters_.sensitivity;
+                if (std::abs(delta) <= parameters_.max_perturbation) {
+                    perturbation_ = delta;
+                }
+            }
+        }
+        before_ = previous_;
+        previous_ = speed;
+        ++calls_;
+        return {cfg.inflow_rate + perturbation_, 0.0};
+    }
+
+    // Maxima of |omega| seen so far.
+    std::size_t maxima() const { return maxima_; }
+    // The inflow change currently applied.
+    double perturbation() const { return perturbation_; }
+
+private:
+    OgyParameters parameters_;
+    double before_ = 0.0;
+    double previous_ = 0.0;
+    std::size_t calls_ = 0;
+    std::size_t maxima_ = 0;
+    double perturbation_ = 0.0;
+};
+
+// Advances a state by one RK4 substep of cfg under a given control input.
+// With {cfg.inflow_rate, 0} it reproduces simulate()'s step bit for bit.
+class ControlledStepper {
+public:
+    // Throws std::invalid_argument for an invalid cfg.
+    explicit ControlledStepper(const SimulationConfig &cfg);
+
+    std::size_t state_size() const { return cfg_.n_cups + 2; }
+    double dt() const { return dt_; }
+
+    void step(double *state, const ControlInput &input) noexcept;
+
+private:
+    SimulationConfig cfg_;
+    double dt_;
+    DerivativeKernel kernel_;
+    std::vector<double> scratch_;
+};
+
+// Runs the integration of simulate() with controller consulted at every
+// substep, and returns frames laid out like simulate()'s. The controller is
+// taken by reference, so its state after the run can be inspected.
+// NullController goes straight to simulate().
+template <typename Controller>
+SimulationResult simulate_controlled(const SimulationConfig &cfg,
+                                     Controller &controller) {
+    if constexpr (std::is_same_v<std::remove_cv_t<Controller>, NullController>) {
+        return simulate(cfg);
+    } else {
+        ControlledStepper stepper(cfg);
+
+        SimulationResult result;
+        result.times.resize(cfg.n_frames);
+        result.theta.resize(cfg.n_frames);
+        result.masses.resize(cfg.n_cups * cfg.n_frames);
+
+        std::vector<double> state(stepper.state_size(), 0.0);
+        state[1] = cfg.omega0;
+        double current_time = cfg.t_start;
+        for (std::size_t frame = 0; frame < cfg.n_frames; ++frame) {
+            result.times[frame] = current_time;
+            result.theta[frame] = state[0];
+            for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+                result.masses[cup * cfg.n_frames + frame] = state[2 + cup];
+            }
+
+            if (frame + 1 == cfg.n_frames) {
+                break;
+            }
+
+            for (std::size_t step = 0; step < cfg.steps_per_frame; ++step) {
+                const ControlInput input =
+                    controller(current_time, state.data(), cfg);
+                stepper.step(state.data(), input);
+                current_time += stepper.dt();
+            }
+        }
+        return result;
+    }
+}
+
+}  // namespace wheely
+
+#endif  // WHEELY_CONTROL_H
@@ -0,0 +1,91 @@
+#include "wheely_decimate.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace wheely {
+
+DecimatedSeries decimate_min_max(const std::vector<double> &x,
+                                 const std::vector<double> &y, double x_min,
+                                 double x_max, std::size_t pixel_width) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("x and y must have the same length");
+    }
+    if (pixel_width < 1) {
+        throw std::invalid_argument("pixel_width must be positive");
+    }
+
+    DecimatedSeries out;
+    if (x.empty() || !(x_max > x_min)) {
+        return out;
+    }
+
+    std::size_t lo = static_cast<std::size_t>(
+        std::lower_bound(x.begin(), x.end(), x_min) - x.begin());
+    std::size_t hi = static_cast<std::size_t>(
+        std::upper_bound(x.begin(), x.end(), x_max) - x.begin());
+    if (lo > 0) {
+        --lo;
+    }
+    if (hi < x.size()) {
+        ++hi;
+    }
+
+    const auto emit = [&](std::size_t index) {
+        out.x.push_back(x[index]);
+        out.y.push_back(y[index]);
+    };
+
+    if (hi - lo <= 2 * pixel_width) {
+        out.x.assign(x.begin() + lo, x.begin() + hi);
+        out.y.assign(y.begin() + lo, y.begin() + hi);
+        return out;
+    }
+
+    out.x.reserve(2 * pixel_width + 2);
+    out.y.reserve(2 * pixel_width + 2);
+
+    const double scale = static_cast<double>(pixel_width) / (x_max - x_min);
+    std::size_t index = lo;
+    if (x[index] < x_min) {
+        emit(index++);
+    }
+    std::size_t end = hi;
+    const bool trailing = x[end - 1] > x_max;
+    if (trailing) {
+        --end;
+    }
+
+    while (index < end) {
+        const std::size_t bucket = std::min(
+            pixel_width - 1,
+            static_cast<std::size_t>((x[index] - x_min) * scale));
+        std::size_t min_index = index;
+        std::size_t max_index = index;
+        for (++index; index < end; ++index) {
+            const std::size_t next = std::min(
+                pixel_width - 1,
+                static_cast<std::size_t>((x[index] - x_min) * scale));
+            if (next != bucket) {
+                break;
+            }
+            if (y[index] < y[min_index]) {
+                min_index = index;
+            }
+            if (y[index] > y[max_index]) {
+                max_index = index;
+            }
+        }
+        emit(std::min(min_index, max_index));
+        if (min_index != max_index) {
+            emit(std::max(min_index, max_index));
+        }
+    }
+
+    if (trailing) {
+        emit(end);
+    }
+    return out;
+}
+
+}  // namespace wheely
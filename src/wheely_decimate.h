@@ -0,0 +1,26 @@
+#ifndef WHEELY_DECIMATE_H
+#define WHEELY_DECIMATE_H
+
+#include <cstddef>
+#include <vector>
+
+namespace wheely {
+
+struct DecimatedSeries {
+    std::vector<double> x;
+    std::vector<double> y;
+};
+
+// Reduces the samples of (x, y) that fall inside [x_min, x_max] to at most two
+// points (the minimum and maximum of y, in sample order) per horizontal pixel
+// bucket, so a line drawn through the result is visually identical to one
+// drawn through every sample. x must be non-decreasing. The nearest sample on
+// either side of the window is kept so lines run to the plot edges. Windows
+// with no more than 2 * pixel_width samples are returned unchanged.
+DecimatedSeries decimate_min_max(const std::vector<double> &x,
+                                 const std::vector<double> &y, double x_min,
+                                 double x_max, std::size_t pixel_width);
+
+}  // namespace wheely
+
+#endif  // WHEELY_DECIMATE_H
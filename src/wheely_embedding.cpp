@@ -0,0 +1,367 @@
+#include "wheely_embedding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+constexpr std::size_t MAX_HISTOGRAM_BINS = 1024;
+// Queries per parallel_for index in false_nearest_neighbors().
+constexpr std::size_t QUERY_CHUNK = 4096;
+// Passed as the exclusion to search everything.
+constexpr std::size_t NO_EXCLUSION = std::numeric_limits<std::size_t>::max();
+
+double series_deviation(const std::vector<double> &series) {
+    double mean = 0.0;
+    for (double value : series) {
+        mean += value;
+    }
+    mean /= static_cast<double>(series.size());
+    double variance = 0.0;
+    for (double value : series) {
+        variance += (value - mean) * (value - mean);
+    }
+    return std::sqrt(variance / static_cast<double>(series.size()));
+}
+
+// The point count delay_embed() produces.
+std::size_t embedded_count(std::size_t length, std::size_t delay,
+                           std::size_t dimension) {
+    const std::size_t span = (dimension - 1) * delay;
+    return length > span ? length - span : 0;
+}
+
+}  // namespace
+
+std::vector<double> average_mutual_information(const std::vector<double> &series,
+                                               std::size_t max_lag,
+                                               std::size_t bins,
+                                               BatchExecutor &executor) {
+    if (bins < 2 || bins > MAX_HISTOGRAM_BINS) {
+        throw std::invalid_argument("bins must be between 2 and 1024");
+    }
+    if (series.size() <= max_lag) {
+        throw std::invalid_argument("series must be longer than max_lag");
+    }
+
+    const auto [low_it, high_it] = std::minmax_element(series.begin(), series.end());
+    const double low = *low_it;
+    const double width = *high_it - low;
+    std::vector<std::uint16_t> bin_of(series.size(), 0);
+    if (width > 0.0) {
+        const double scale = static_cast<double>(bins) / width;
+        for (std::size_t i = 0; i < series.size(); ++i) {
+            bin_of[i] = static_cast<std::uint16_t>(std::min(
+                bins - 1, static_cast<std::size_t>((series[i] - low) * scale)));
+        }
+    }
+
+    std::vector<double> ami(max_lag + 1, 0.0);
+    std::vector<std::vector<std::uint64_t>> joint(executor.size());
+    executor.parallel_for(max_lag + 1, [&](std::size_t worker, std::size_t lag) {
+        std::vector<std::uint64_t> &counts = joint[worker];
+        counts.assign(bins * bins, 0);
+        const std::size_t pairs = series.size() - lag;
+        for (std::size_t i = 0; i < pairs; ++i) {
+            ++counts[bin_of[i] * bins + bin_of[i + lag]];
+        }
+        std::vector<std::uint64_t> rows(bins, 0);
+        std::vector<std::uint64_t> columns(bins, 0);
+        for (std::size_t a = 0; a < bins; ++a) {
+            for (std::size_t b = 0; b < bins; ++b) {
+                rows[a] += counts[a * bins + b];
+                columns[b] += counts[a * bins + b];
+            }
+        }
+        // sum p_ab log2(p_ab / (p_a p_b)) with p = count / pairs.
+        const double total = static_cast<double>(pairs);
+        double sum = 0.0;
+        for (std::size_t a = 0; a < bins; ++a) {
+            for (std::size_t b = 0; b < bins; ++b) {
+                const std::uint64_t count = counts[a * bins + b];
+                if (count == 0) {
+                    continue;
+                }
+                const double c = static_cast<double>(count);
+                sum += c * std::log2(c * total / (static_cast<double>(rows[a]) *
+                                                  static_cast<double>(columns[b])));
+            }
+        }
+        ami[lag] = sum / total;
+    });
+    return ami;
+}
+
+std::size_t first_minimum_delay(const std::vector<double> &ami) {
+    if (ami.size() < 2) {
+        throw std::invalid_argument("ami must cover at least lags 0 and 1");
+    }
+    for (std::size_t lag = 1; lag + 1 < ami.size(); ++lag) {
+        if (ami[lag] < ami[lag - 1] && ami[lag] <= ami[lag + 1]) {
+            return lag;
+        }
+    }
+    const double threshold = ami[0] * std::exp(-1.0);
+    for (std::size_t lag = 1; lag < ami.size(); ++lag) {
+        if (ami[lag] < threshold) {
+            return lag;
+        }
+    }
+    return ami.size() - 1;
+}
+
+std::vector<double> delay_embed(const std::vector<double> &series,
+                                std::size_t delay, std::size_t dimension) {
+    if (delay == 0 || dimension == 0) {
+        throw std::invalid_argument("delay and dimension must be positive");
+    }
+    const std::size_t n_points = embedded_count(series.size(), delay, dimension);
+    std::vector<double> points(n_points * dimension);
+    for (std::size_t i = 0; i < n_points; ++i) {
+        for (std::size_t k = 0; k < dimension; ++k) {
+            points[i * dimension + k] = series[i + k * delay];
+        }
+    }
+    return points;
+}
+
+KdTree::KdTree(const double *points, std::size_t n_points, std::size_t dimension)
+    : dimension_(dimension) {
+    if (dimension == 0) {
+        throw std::invalid_argument("dimension must be positive");
+    }
+    if (n_points >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("KdTree holds fewer than 2^32 - 1 points");
+    }
+    if (n_points == 0) {
+        return;
+    }
+    std::vector<std::uint32_t> order(n_points);
+    for (std::size_t i = 0; i < n_points; ++i) {
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+    nodes_.reserve(2 * (n_points / LEAF_SIZE + 1));
+    build(order, points, 0, static_cast<std::uint32_t>(n_points));
+
+    coordinates_.resize(n_points * dimension);
+    for (std::size_t k = 0; k < n_points; ++k) {
+        std::copy_n(points + static_cast<std::size_t>(order[k]) * dimension,
+                    dimension, coordinates_.begin() + k * dimension);
+    }
+    indices_ = std::move(order);
+}
+
+std::uint32_t KdTree::build(std::vector<std::uint32_t> &order, const double *points,
+                            std::uint32_t begin, std::uint32_t end) {
+    const auto id = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+    nodes_[id].begin = begin;
+    nodes_[id].end = end;
+    if (end - begin <= LEAF_SIZE) {
+        return id;
+    }
+
+    std::size_t axis = 0;
+    double widest = -1.0;
+    for (std::size_t k = 0; k < dimension_; ++k) {
+        double low = std::numeric_limits<double>::infinity();
+        double high = -low;
+        for (std::uint32_t i = begin; i < end; ++i) {
+            const double value = points[static_cast<std::size_t>(order[i]) * dimension_ + k];
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+        if (high - low > widest) {
+            widest = high - low;
+            axis = k;
+        }
+    }
+
+    const std::uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle,
+                     order.begin() + end,
+                     [&](std::uint32_t a, std::uint32_t b) {
+                         return points[static_cast<std::size_t>(a) * dimension_ + axis] <
+                                points[static_cast<std::size_t>(b) * dimension_ + axis];
+                     });
+    const double split =
+        points[static_cast<std::size_t>(order[middle]) * dimension_ + axis];
+    const std::uint32_t left = build(order, points, begin, middle);
+    const std::uint32_t right = build(order, points, middle, end);
+    nodes_[id].axis = static_cast<std::uint32_t>(axis);
+    nodes_[id].split = split;
+    nodes_[id].left = left;
+    nodes_[id].right = right;
+    return id;
+}
+
+void KdTree::search(std::uint32_t id, const double *query, std::size_t center,
+                    std::size_t exclusion, Neighbor &best) const {
+    const Node &node = nodes_[id];
+    if (node.left == 0) {
+        for (std::uint32_t k = node.begin; k < node.end; ++k) {
+            const std::size_t index = indices_[k];
+            if (exclusion != NO_EXCLUSION &&
+                (index > center ? index - center : center - index) <= exclusion) {
+                continue;
+            }
+            const double *point = coordinates_.data() + std::size_t{k} * dimension_;
+            double d2 = 0.0;
+            for (std::size_t axis = 0; axis < dimension_ && d2 < best.squared_distance;
+                 ++axis) {
+                const double diff = query[axis] - point[axis];
+                d2 += diff * diff;
+            }
+            if (d2 < best.squared_distance) {
+                best.index = index;
+                best.squared_distance = d2;
+            }
+        }
+        return;
+    }
+    const double diff = query[node.axis] - node.split;
+    const std::uint32_t near = diff < 0.0 ? node.left : node.right;
+    const std::uint32_t far = diff < 0.0 ? node.right : node.left;
+    search(near, query, center, exclusion, best);
+    if (diff * diff < best.squared_distance) {
+        search(far, query, center, exclusion, best);
+    }
+}
+
+KdTree::Neighbor KdTree::nearest(const double *query) const {
+    return nearest(query, 0, NO_EXCLUSION);
+}
+
+KdTree::Neighbor KdTree::nearest(const double *query, std::size_t center,
+                                 std::size_t exclusion) const {
+    Neighbor best;
+    best.index = size();
+    best.squared_distance = std::numeric_limits<double>::infinity();
+    if (!nodes_.empty()) {
+        search(0, query, center, exclusion, best);
+    }
+    return best;
+}
+
+std::vector<double> false_nearest_neighbors(const std::vector<double> &series,
+                                            std::size_t delay,
+                                            std::size_t max_dimension,
+                                            double stop_fraction,
+                                            const FalseNeighborOptions &options,
+                                            BatchExecutor &executor) {
+    if (delay == 0 || max_dimension == 0) {
+        throw std::invalid_argument("delay and max_dimension must be positive");
+    }
+    if (series.empty()) {
+        throw std::invalid_argument("series must not be empty");
+    }
+    const std::size_t window =
+        options.theiler_window == 0 ? delay : options.theiler_window;
+    const double ratio2 =
+        options.distance_ratio_tolerance * options.distance_ratio_tolerance;
+    const double size_limit = options.attractor_size_tolerance * series_deviation(series);
+    const double size_limit2 = size_limit * size_limit;
+
+    struct Tally {
+        std::uint64_t false_count = 0;
+        std::uint64_t total = 0;
+    };
+
+    std::vector<double> fractions;
+    for (std::size_t m = 1; m <= max_dimension; ++m) {
+        // Points with an (m + 1)-th coordinate to test against.
+        const std::size_t n_points = embedded_count(series.size(), delay, m + 1);
+        if (n_points < 2) {
+            break;
+        }
+        std::vector<double> points(n_points * m);
+        for (std::size_t i = 0; i < n_points; ++i) {
+            for (std::size_t k = 0; k < m; ++k) {
+                points[i * m + k] = series[i + k * delay];
+            }
+        }
+        const KdTree tree(points.data(), n_points, m);
+
+        std::vector<Tally> tallies(executor.size());
+        const std::size_t n_chunks = (n_points + QUERY_CHUNK - 1) / QUERY_CHUNK;
+        executor.parallel_for(n_chunks, [&](std::size_t worker, std::size_t chunk) {
+            Tally &tally = tallies[worker];
+            const std::size_t end = std::min(n_points, (chunk + 1) * QUERY_CHUNK);
+            for (std::size_t i = chunk * QUERY_CHUNK; i < end; ++i) {
+                const KdTree::Neighbor neighbor =
+                    tree.nearest(points.data() + i * m, i, window);
+                if (neighbor.index == tree.size()) {
+                    continue;
+                }
+                const double extra = series[i + m * delay] -
+                                     series[neighbor.index + m * delay];
+                const double extra2 = extra * extra;
+                ++tally.total;
+                if (extra2 > ratio2 * neighbor.squared_distance ||
+                    neighbor.squared_distance + extra2 > size_limit2) {
+                    ++tally.false_count;
+                }
+            }
+        });
+
+        Tally sum;
+        for (const Tally &tally : tallies) {
+            sum.false_count += tally.false_count;
+            sum.total += tally.total;
+        }
+        fractions.push_back(sum.total == 0 ? 0.0
+                                           : static_cast<double>(sum.false_count) /
+                                                 static_cast<double>(sum.total));
+        if (fractions.back() <= stop_fraction) {
+            break;
+        }
+    }
+    return fractions;
+}
+
+EmbeddingAnalysis analyze_embedding(const std::vector<double> &series,
+                                    const EmbeddingOptions &options,
+                                    BatchExecutor &executor) {
+    EmbeddingAnalysis analysis;
+    analysis.delay = options.delay;
+    if (analysis.delay == 0) {
+        if (options.max_lag == 0) {
+            throw std::invalid_argument("max_lag must be positive to choose the delay");
+        }
+        analysis.mutual_information = average_mutual_information(
+            series, options.max_lag, options.histogram_bins, executor);
+        analysis.delay = first_minimum_delay(analysis.mutual_information);
+    }
+
+    analysis.dimension = options.dimension;
+    if (analysis.dimension == 0) {
+        analysis.false_neighbor_fractions = false_nearest_neighbors(
+            series, analysis.delay, options.max_dimension, options.fnn_threshold,
+            options.false_neighbors, executor);
+        analysis.dimension = options.max_dimension;
+        for (std::size_t m = 0; m < analysis.false_neighbor_fractions.size(); ++m) {
+            if (analysis.false_neighbor_fractions[m] <= options.fnn_threshold) {
+                analysis.dimension = m + 1;
+                break;
+            }
+        }
+    }
+
+    analysis.points = delay_embed(series, analysis.delay, analysis.dimension);
+    analysis.n_points = analysis.points.size() / analysis.dimension;
+    if (analysis.n_points == 0) {
+        throw std::invalid_argument("series is too short for the embedding");
+    }
+    return analysis;
+}
+
+EmbeddingAnalysis analyze_embedding(const std::vector<double> &series,
+                                    const EmbeddingOptions &options,
+                                    const BatchOptions &batch) {
+    return analyze_embedding(series, options, default_executor(batch));
+}
+
+}  // namespace wheely
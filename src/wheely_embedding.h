@@ -0,0 +1,144 @@
+#ifndef WHEELY_EMBEDDING_H
+#define WHEELY_EMBEDDING_H
+
+#include "wheely_batch.h"
+#include "wheely_executor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wheely {
+
+// Average mutual information in bits between x[t] and x[t + lag] for
+// lag = 0..max_lag, from joint histograms with `bins` equal-width bins over
+// the range of the series. Lags run in parallel on executor.
+//
+// Throws std::invalid_argument unless 2 <= bins <= 1024 and the series is
+// longer than max_lag.
+std::vector<double> average_mutual_information(const std::vector<double> &series,
+                                               std::size_t max_lag,
+                                               std::size_t bins,
+                                               BatchExecutor &executor);
+
+// The first local minimum of ami (indexed by lag). If ami never turns back
+// up, the first lag at which it falls below ami[0] / e, else the last lag.
+std::size_t first_minimum_delay(const std::vector<double> &ami);
+
+// The delay vectors (x[i], x[i + delay], .., x[i + (dimension - 1) delay])
+// for every i that fits, row-major.
+std::vector<double> delay_embed(const std::vector<double> &series,
+                                std::size_t delay, std::size_t dimension);
+
+// Static kd-tree for nearest-neighbour queries over a fixed point set. The
+// points are copied in tree order, so each leaf's coordinates are
+// contiguous. Nodes split the widest coordinate at its median.
+class KdTree {
+public:
+    struct Neighbor {
+        // Position of the point in the input; size() if there is none.
+        std::size_t index = 0;
+        double squared_distance = 0.0;
+    };
+
+    // points holds n_points rows of `dimension` coordinates.
+    KdTree(const double *points, std::size_t n_points, std::size_t dimension);
+
+    std::size_t size() const { return indices_.size(); }
+    std::size_t dimension() const { return dimension_; }
+
+    // Nearest point to query by Euclidean distance.
+    Neighbor nearest(const double *query) const;
+
+    // As above, skipping points whose index lies within exclusion of
+    // center, e.g. the query's own temporal neighbours (Theiler window).
+    Neighbor nearest(const double *query, std::size_t center,
+                     std::size_t exclusion) const;
+
+private:
+    static constexpr std::size_t LEAF_SIZE = 8;
+
+    struct Node {
+        std::uint32_t begin = 0;
+        std::uint32_t end = 0;
+        // Children, or 0 for a leaf (the root is never anyone's child).
+        std::uint32_t left = 0;
+        std::uint32_t right = 0;
+        std::uint32_t axis = 0;
+        double split = 0.0;
+    };
+
+    std::uint32_t build(std::vector<std::uint32_t> &order, const double *points,
+                        std::uint32_t begin, std::uint32_t end);
+    void search(std::uint32_t node, const double *query, std::size_t center,
+                std::size_t exclusion, Neighbor &best) const;
+
+    std::size_t dimension_;
+    std::vector<double> coordinates_;
+    std::vector<std::uint32_t> indices_;
+    std::vector<Node> nodes_;
+};
+
+struct FalseNeighborOptions {
+    // Kennel's criteria: the nearest neighbour in m dimensions is false if
+    // adding coordinate m + 1 stretches their distance by more than
+    // distance_ratio_tolerance, or makes it exceed attractor_size_tolerance
+    // standard deviations of the series.
+    double distance_ratio_tolerance = 15.0;
+    double attractor_size_tolerance = 2.0;
+    // Neighbours closer than this many samples in time are skipped; 0 uses
+    // the delay.
+    std::size_t theiler_window = 0;
+};
+
+// Fraction of false nearest neighbours for m = 1..max_dimension (element
+// m - 1), stopping after the first m whose fraction is at most
+// stop_fraction. Each m builds one kd-tree over the points that have an
+// (m + 1)-th coordinate, and queries run in parallel on executor.
+std::vector<double> false_nearest_neighbors(const std::vector<double> &series,
+                                            std::size_t delay,
+                                            std::size_t max_dimension,
+                                            double stop_fraction,
+                                            const FalseNeighborOptions &options,
+                                            BatchExecutor &executor);
+
+struct EmbeddingOptions {
+    // Delay in samples; 0 takes the first minimum of the mutual
+    // information over lags 0..max_lag.
+    std::size_t delay = 0;
+    std::size_t max_lag = 200;
+    std::size_t histogram_bins = 32;
+    // Embedding dimension; 0 takes the smallest m <= max_dimension whose
+    // false-neighbour fraction is at most fnn_threshold, else max_dimension.
+    std::size_t dimension = 0;
+    std::size_t max_dimension = 10;
+    double fnn_threshold = 0.01;
+    FalseNeighborOptions false_neighbors;
+};
+
+struct EmbeddingAnalysis {
+    // Empty when the delay was given.
+    std::vector<double> mutual_information;
+    std::size_t delay = 0;
+    // Empty when the dimension was given.
+    std::vector<double> false_neighbor_fractions;
+    std::size_t dimension = 0;
+    // delay_embed(series, delay, dimension).
+    std::size_t n_points = 0;
+    std::vector<double> points;
+};
+
+// Chooses the delay and dimension as configured and embeds the series.
+// The series should be stationary: use omega, or the differenced theta of
+// an angle sensor, rather than the unwrapped angle itself.
+EmbeddingAnalysis analyze_embedding(const std::vector<double> &series,
+                                    const EmbeddingOptions &options,
+                                    BatchExecutor &executor);
+
+EmbeddingAnalysis analyze_embedding(const std::vector<double> &series,
+                                    const EmbeddingOptions &options = EmbeddingOptions(),
+                                    const BatchOptions &batch = BatchOptions());
+
+}  // namespace wheely
+
+#endif  // WHEELY_EMBEDDING_H
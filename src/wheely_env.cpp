@@ -0,0 +1,149 @@
+#include "wheely_env.h"
+
+#include "wheely_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+// Envs per parallel_for index; fixed so the split is the same for any
+// thread count.
+constexpr std::size_t ENV_CHUNK = 64;
+
+// Uniform on [-1, 1).
+double symmetric_uniform(std::uint64_t &state) {
+    return static_cast<double>(splitmix64(state) >> 11) * 0x1.0p-52 - 1.0;
+}
+
+ExecutorOptions executor_options(const VectorEnvOptions &options) {
+    ExecutorOptions out;
+    out.n_threads = options.n_threads;
+    out.pin_threads = options.pin_threads;
+    return out;
+}
+
+}  // namespace
+
+VectorEnv::VectorEnv(const SimulationConfig &cfg, const VectorEnvOptions &options)
+    : cfg_(cfg), options_(options), executor_(executor_options(options)) {
+    validate_config(cfg);
+    if (options.n_envs == 0) {
+        throw std::invalid_argument("n_envs must be positive");
+    }
+    if (!(options.omega0_spread >= 0.0)) {
+        throw std::invalid_argument("omega0_spread must be non-negative");
+    }
+    if (!(options.max_action >= 0.0)) {
+        throw std::invalid_argument("max_action must be non-negative");
+    }
+
+    steppers_.reserve(executor_.size());
+    for (std::size_t worker = 0; worker < executor_.size(); ++worker) {
+        steppers_.emplace_back(cfg);
+    }
+
+    const std::size_t n = options.n_envs;
+    const std::size_t width = observation_size();
+    states_.resize(n * width);
+    streams_.resize(n);
+    elapsed_.resize(n);
+    observations_.resize(n * width);
+    final_observations_.resize(n * width);
+    rewards_.resize(n);
+    truncated_.resize(n);
+    reset(options.seed);
+}
+
+void VectorEnv::reset(std::uint64_t seed) {
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    for (std::size_t env = 0; env < n_envs(); ++env) {
+        std::uint64_t stream = seed ^ (0xd1b54a32d192ed03ull * (env + 1));
+        streams_[env] = splitmix64(stream);
+    }
+    reset_all();
+}
+
+void VectorEnv::reset() {
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    reset_all();
+}
+
+void VectorEnv::reset_all() {
+    for (std::size_t env = 0; env < n_envs(); ++env) {
+        reset_env(env);
+    }
+    std::fill(rewards_.begin(), rewards_.end(), 0.0);
+    std::fill(truncated_.begin(), truncated_.end(), 0);
+    std::fill(final_observations_.begin(), final_observations_.end(), 0.0);
+}
+
+void VectorEnv::reset_env(std::size_t env) {
+    const std::size_t width = observation_size();
+    double *state = states_.data() + env * width;
+    std::fill(state, state + width, 0.0);
+    state[1] = cfg_.omega0;
+    if (options_.omega0_spread > 0.0) {
+        state[1] += options_.omega0_spread * symmetric_uniform(streams_[env]);
+    }
+    elapsed_[env] = 0;
+    observe(env, observations_.data() + env * width);
+}
+
+void VectorEnv::observe(std::size_t env, double *out) const {
+    const std::size_t width = observation_size();
+    const double *state = states_.data() + env * width;
+    double theta = std::fmod(state[0], TWO_PI);
+    if (theta < 0.0) {
+        theta += TWO_PI;
+    }
+    out[0] = theta;
+    std::copy(state + 1, state + width, out + 1);
+}
+
+void VectorEnv::step(const double *actions) {
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    const std::size_t n = n_envs();
+    const std::size_t width = observation_size();
+    const std::size_t n_chunks = (n + ENV_CHUNK - 1) / ENV_CHUNK;
+    executor_.parallel_for(n_chunks, [this, actions, n, width](std::size_t worker,
+                                                               std::size_t chunk) {
+        ControlledStepper &stepper = steppers_[worker];
+        const std::size_t end = std::min(n, (chunk + 1) * ENV_CHUNK);
+        for (std::size_t env = chunk * ENV_CHUNK; env < end; ++env) {
+            double action = actions[env];
+            ControlInput input{cfg_.inflow_rate, 0.0};
+            if (options_.action == EnvAction::brake_torque) {
+                action = std::min(options_.max_action,
+                                  std::max(-options_.max_action, action));
+                input.brake_torque = action;
+            } else {
+                action = std::min(options_.max_action, std::max(0.0, action));
+                input.inflow_rate = action;
+            }
+
+            double *state = states_.data() + env * width;
+            for (std::size_t substep = 0; substep < cfg_.steps_per_frame;
+                 ++substep) {
+                stepper.step(state, input);
+            }
+
+            const double error = state[1] - options_.target_omega;
+            rewards_[env] = -error * error - options_.action_cost * action * action;
+            double *observation = observations_.data() + env * width;
+            observe(env, observation);
+            if (++elapsed_[env] == episode_steps()) {
+                truncated_[env] = 1;
+                std::copy(observation, observation + width,
+                          final_observations_.data() + env * width);
+                reset_env(env);
+            } else {
+                truncated_[env] = 0;
+            }
+        }
+    });
+}
+
+}  // namespace wheely
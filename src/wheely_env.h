@@ -0,0 +1,105 @@
+#ifndef WHEELY_ENV_H
+#define WHEELY_ENV_H
+
+#include "wheely_control.h"
+#include "wheely_executor.h"
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace wheely {
+
+// What the per-env action scalar sets.
+enum class EnvAction {
+    // Braking torque, clamped to +-max_action.
+    brake_torque,
+    // Inflow rate, clamped to [0, max_action].
+    inflow_rate,
+};
+
+struct VectorEnvOptions {
+    std::size_t n_envs = 1;
+    EnvAction action = EnvAction::brake_torque;
+    double max_action = std::numeric_limits<double>::infinity();
+    // Reward per step: -(omega - target_omega)^2 - action_cost * action^2,
+    // with omega at the end of the step and the action after clamping.
+    double target_omega = 0.0;
+    double action_cost = 0.0;
+    // Each reset draws omega0 uniformly from cfg.omega0 +- omega0_spread.
+    double omega0_spread = 0.0;
+    std::uint64_t seed = 0;
+    // Worker threads; 0 uses every CPU. See BatchExecutor.
+    std::size_t n_threads = 0;
+    bool pin_threads = true;
+};
+
+// Many independent wheels stepped in lockstep, for reinforcement learning.
+//
+// Each env integrates cfg's physics. One step() advances every env by one
+// output frame of cfg, i.e. steps_per_frame RK4 substeps with the action
+// held, so an episode is cfg.n_frames - 1 steps long. An env that finishes
+// its episode is flagged in truncated(), its last observation is kept in
+// final_observations(), and it is reset within the same step.
+//
+// Observations are [theta mod 2 pi, omega, m_0 .. m_{n_cups-1}] per env,
+// row-major. All buffers are allocated once by the constructor and are
+// overwritten in place by step() and reset(), so pointers to them stay
+// valid for the env's lifetime. Envs are split across the executor's
+// workers in fixed chunks, and each env draws from its own random stream,
+// so results do not depend on the thread count. step() and reset() called
+// from several threads are serialized.
+class VectorEnv {
+public:
+    // Throws std::invalid_argument for an invalid cfg, n_envs == 0, or a
+    // negative omega0_spread or max_action.
+    VectorEnv(const SimulationConfig &cfg, const VectorEnvOptions &options);
+
+    std::size_t n_envs() const { return options_.n_envs; }
+    std::size_t observation_size() const { return cfg_.n_cups + 2; }
+    std::size_t episode_steps() const { return cfg_.n_frames - 1; }
+
+    // Resets every env, reseeding the per-env streams from seed.
+    void reset(std::uint64_t seed);
+    // Resets every env, continuing the current streams.
+    void reset();
+
+    // Applies actions[env] to each env and advances them all.
+    void step(const double *actions);
+
+    const double *observations() const { return observations_.data(); }
+    const double *rewards() const { return rewards_.data(); }
+    const std::uint8_t *truncated() const { return truncated_.data(); }
+    const double *final_observations() const {
+        return final_observations_.data();
+    }
+    // Steps taken in the current episode of each env.
+    const std::uint64_t *elapsed_steps() const { return elapsed_.data(); }
+
+private:
+    void reset_all();
+    void reset_env(std::size_t env);
+    void observe(std::size_t env, double *out) const;
+
+    SimulationConfig cfg_;
+    VectorEnvOptions options_;
+    BatchExecutor executor_;
+    std::vector<ControlledStepper> steppers_;
+    // Held for the whole of step() and reset().
+    std::mutex call_mutex_;
+
+    std::vector<double> states_;
+    std::vector<std::uint64_t> streams_;
+    std::vector<std::uint64_t> elapsed_;
+    std::vector<double> observations_;
+    std::vector<double> final_observations_;
+    std::vector<double> rewards_;
+    std::vector<std::uint8_t> truncated_;
+};
+
+}  // namespace wheely
+
+#endif  // WHEELY_ENV_H
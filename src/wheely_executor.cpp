@@ -0,0 +1,298 @@
+#include "wheely_executor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <pthread.h>
+#include <sched.h>
+#define WHEELY_HAVE_AFFINITY 1
+#endif
+
+namespace wheely {
+namespace {
+
+bool read_file(const std::string &path, std::string &out) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::getline(file, out);
+    return true;
+}
+
+CpuTopology fallback_topology() {
+    CpuTopology topology;
+    const unsigned count = std::max(1u, std::thread::hardware_concurrency());
+    topology.node_cpus.emplace_back();
+    for (unsigned cpu = 0; cpu < count; ++cpu) {
+        topology.node_cpus.back().push_back(static_cast<int>(cpu));
+    }
+    return topology;
+}
+
+void pin_current_thread(int cpu) {
+#ifdef WHEELY_HAVE_AFFINITY
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // Best effort: a failed pin only costs locality, not correctness.
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+}  // namespace
+
+std::size_t CpuTopology::cpu_count() const {
+    std::size_t count = 0;
+    for (const auto &cpus : node_cpus) {
+        count += cpus.size();
+    }
+    return count;
+}
+
+std::vector<int> parse_cpu_list(const std::string &text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty() || item == "\n") {
+            continue;
+        }
+        const auto dash = item.find('-');
+        try {
+            const int first = std::stoi(item.substr(0, dash));
+            const int last =
+                dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception &) {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+CpuTopology CpuTopology::detect() {
+#ifdef WHEELY_HAVE_AFFINITY
+    std::string online;
+    if (!read_file("/sys/devices/system/node/online", online)) {
+        return fallback_topology();
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool have_mask =
+        sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    CpuTopology topology;
+    for (int node : parse_cpu_list(online)) {
+        std::string list;
+        if (!read_file("/sys/devices/system/node/node" + std::to_string(node) +
+                           "/cpulist",
+                       list)) {
+            continue;
+        }
+        std::vector<int> cpus;
+        for (int cpu : parse_cpu_list(list)) {
+            if (!have_mask ||
+                (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            topology.node_cpus.push_back(std::move(cpus));
+        }
+    }
+    if (topology.node_cpus.empty()) {
+        return fallback_topology();
+    }
+    return topology;
+#else
+    return fallback_topology();
+#endif
+}
+
+BatchExecutor::BatchExecutor(const ExecutorOptions &options,
+                             const CpuTopology &topology) {
+    const CpuTopology layout =
+        topology.node_cpus.empty() ? fallback_topology() : topology;
+    const std::size_t n_nodes = layout.node_cpus.size();
+    std::size_t n_threads = options.n_threads;
+    if (n_threads == 0) {
+        n_threads = std::max<std::size_t>(1, layout.cpu_count());
+    }
+
+    // Spread workers across nodes so every node's memory bandwidth is used
+    // before any node gets a second worker.
+    workers_.reserve(n_threads);
+    for (std::size_t id = 0; id < n_threads; ++id) {
+        auto worker = std::make_unique<Worker>();
+        worker->node = id % n_nodes;
+        const auto &cpus = layout.node_cpus[worker->node];
+        worker->cpu = options.pin_threads
+                          ? cpus[(id / n_nodes) % cpus.size()]
+                          : -1;
+        workers_.push_back(std::move(worker));
+    }
+
+    // Steal from neighbours on the same node first, then walk the other nodes
+    // in order starting from the next one.
+    for (std::size_t id = 0; id < n_threads; ++id) {
+        auto &order = workers_[id]->steal_order;
+        for (std::size_t hop = 0; hop < n_nodes; ++hop) {
+            const std::size_t node = (workers_[id]->node + hop) % n_nodes;
+            for (std::size_t offset = 1; offset <= n_threads; ++offset) {
+                const std::size_t victim = (id + offset) % n_threads;
+                if (victim != id && workers_[victim]->node == node) {
+                    order.push_back(victim);
+                }
+            }
+        }
+    }
+
+    for (std::size_t id = 0; id < n_threads; ++id) {
+        workers_[id]->thread = std::thread([this, id] { run_worker(id); });
+    }
+}
+
+BatchExecutor::~BatchExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stopping_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto &worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void BatchExecutor::parallel_for(
+    std::size_t n,
+    const std::function<void(std::size_t, std::size_t)> &task) {
+    if (n == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    task_ = &task;
+    failed_.store(false);
+    failure_ = nullptr;
+
+    const std::size_t n_workers = workers_.size();
+    const std::size_t base = n / n_workers;
+    const std::size_t extra = n % n_workers;
+    std::size_t begin = 0;
+    for (std::size_t id = 0; id < n_workers; ++id) {
+        const std::size_t count = base + (id < extra ? 1 : 0);
+        std::lock_guard<std::mutex> range_lock(workers_[id]->mutex);
+        workers_[id]->begin = begin;
+        workers_[id]->end = begin + count;
+        begin += count;
+    }
+
+    busy_ = n_workers;
+    ++generation_;
+    start_cv_.notify_all();
+    done_cv_.wait(lock, [this] { return busy_ == 0; });
+    task_ = nullptr;
+
+    if (failure_) {
+        std::exception_ptr failure = failure_;
+        failure_ = nullptr;
+        std::rethrow_exception(failure);
+    }
+}
+
+void BatchExecutor::run_worker(std::size_t id) {
+    pin_current_thread(workers_[id]->cpu);
+
+    std::size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            start_cv_.wait(lock,
+                           [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        drain(id);
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (--busy_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void BatchExecutor::drain(std::size_t id) {
+    std::size_t index = 0;
+    for (;;) {
+        if (!claim(id, index)) {
+            if (!steal(id)) {
+                return;
+            }
+            continue;
+        }
+        try {
+            (*task_)(id, index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            if (!failure_) {
+                failure_ = std::current_exception();
+            }
+            failed_.store(true);
+        }
+    }
+}
+
+bool BatchExecutor::claim(std::size_t id, std::size_t &index) {
+    Worker &self = *workers_[id];
+    std::lock_guard<std::mutex> lock(self.mutex);
+    if (self.begin >= self.end) {
+        return false;
+    }
+    if (failed_.load()) {
+        self.begin = self.end;
+        return false;
+    }
+    index = self.begin++;
+    return true;
+}
+
+bool BatchExecutor::steal(std::size_t id) {
+    for (std::size_t victim_id : workers_[id]->steal_order) {
+        Worker &victim = *workers_[victim_id];
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            const std::size_t remaining = victim.end - victim.begin;
+            if (remaining == 0) {
+                continue;
+            }
+            end = victim.end;
+            begin = end - (remaining + 1) / 2;
+            victim.end = begin;
+        }
+        Worker &self = *workers_[id];
+        std::lock_guard<std::mutex> lock(self.mutex);
+        self.begin = begin;
+        self.end = end;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace wheely
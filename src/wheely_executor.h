@@ -0,0 +1,102 @@
+#ifndef WHEELY_EXECUTOR_H
+#define WHEELY_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wheely {
+
+// CPUs grouped by NUMA node. Nodes with no usable CPUs are dropped.
+struct CpuTopology {
+    std::vector<std::vector<int>> node_cpus;
+
+    std::size_t cpu_count() const;
+
+    // Reads /sys/devices/system/node on Linux, restricted to the CPUs this
+    // process may run on. Elsewhere, or if sysfs is unavailable, returns a
+    // single node holding hardware_concurrency() CPUs.
+    static CpuTopology detect();
+};
+
+// Parses a sysfs cpulist such as "0-3,8,10-11".
+std::vector<int> parse_cpu_list(const std::string &text);
+
+struct ExecutorOptions {
+    // Worker threads; 0 uses every CPU in the topology.
+    std::size_t n_threads = 0;
+    // Pin each worker to one CPU. Ignored where affinity is unsupported.
+    bool pin_threads = true;
+};
+
+// A persistent pool of workers spread round-robin across NUMA nodes.
+//
+// parallel_for() deals indices out as one contiguous range per worker. Each
+// worker drains its own range from the front; an idle worker steals the back
+// half of a victim's range, trying workers on its own node before crossing to
+// another node. Anything a task allocates is first touched by the worker
+// running it, so per-run scratch and result buffers land on that worker's node.
+class BatchExecutor {
+public:
+    explicit BatchExecutor(const ExecutorOptions &options = ExecutorOptions(),
+                           const CpuTopology &topology = CpuTopology::detect());
+    ~BatchExecutor();
+
+    BatchExecutor(const BatchExecutor &) = delete;
+    BatchExecutor &operator=(const BatchExecutor &) = delete;
+
+    std::size_t size() const { return workers_.size(); }
+    std::size_t node_of(std::size_t worker) const { return workers_[worker]->node; }
+
+    // Calls task(worker, index) once for every index in [0, n) and blocks
+    // until all calls return. If any call throws, remaining unclaimed indices
+    // are skipped and the first exception is rethrown here.
+    //
+    // Calls from different threads are serialized: each waits for the job
+    // before it to finish. Not reentrant: a task must not call parallel_for()
+    // on the executor running it.
+    void parallel_for(
+        std::size_t n,
+        const std::function<void(std::size_t worker, std::size_t index)> &task);
+
+private:
+    struct Worker {
+        std::size_t node = 0;
+        int cpu = -1;
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::vector<std::size_t> steal_order;
+        std::thread thread;
+    };
+
+    void run_worker(std::size_t id);
+    void drain(std::size_t id);
+    bool claim(std::size_t id, std::size_t &index);
+    bool steal(std::size_t id);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    const std::function<void(std::size_t, std::size_t)> *task_ = nullptr;
+
+    // Held for the whole of parallel_for(), so one job runs at a time.
+    std::mutex call_mutex_;
+    std::mutex state_mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    std::size_t generation_ = 0;
+    std::size_t busy_ = 0;
+    bool stopping_ = false;
+    std::atomic<bool> failed_{false};
+    std::exception_ptr failure_;
+};
+
+}  // namespace wheely
+
+#endif  // WHEELY_EXECUTOR_H
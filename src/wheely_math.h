@@ -0,0 +1,234 @@
+#ifndef WHEELY_MATH_H
+#define WHEELY_MATH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// WHEELY_STRICT_FP (set by -DWHEELY_REPRODUCIBLE=ON) promises bit-identical
+// results across native and wasm builds; refuse settings that would quietly
+// break that promise.
+#if defined(WHEELY_STRICT_FP)
+#if defined(__FAST_MATH__)
+#error "WHEELY_STRICT_FP cannot be combined with -ffast-math"
+#endif
+#if defined(__FLT_EVAL_METHOD__) && __FLT_EVAL_METHOD__ != 0
+#error "WHEELY_STRICT_FP needs plain double evaluation (use -msse2 -mfpmath=sse)"
+#endif
+#endif
+
+// In-tree sin/cos for the simulation kernels.
+//
+// Everything here is branch-free straight-line IEEE double arithmetic (no
+// libm, no FMA, no table lookups), so loops over it auto-vectorize and the
+// results are identical on every target that evaluates double expressions
+// as written -- including WebAssembly, as long as the build does not
+// contract a*b+c into FMAs (see WHEELY_REPRODUCIBLE).
+//
+// Accuracy contracts, measured against libm in tests/wheely_math_test.cpp:
+//   TrigAccuracy::ulp1     <= 1 ulp        for |x| <= 2^19 * pi/2 (~8.2e5)
+//   TrigAccuracy::abs1e12  <= 1e-12 (abs)  for |x| <= 2^19 * pi/2
+//   TrigAccuracy::abs1e7   <= 1e-7  (abs)  for |x| <= 2^19 * pi/2
+// Beyond that range the results stay deterministic, and the absolute error
+// grows like |x| * 2^-53, i.e. on the order of the rounding already present
+// in x itself.
+
+namespace wheely {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double TWO_PI = 2.0 * PI;
+
+// SplitMix64: steps `state` and returns the next output. Any 64-bit value is
+// a valid seed, so every seeded stream in the library (envs, samplers,
+// replicas) is one of these.
+inline std::uint64_t splitmix64(std::uint64_t &state) {
+    state += 0x9e3779b97f4a7c15ull;
+    std::uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+enum class TrigAccuracy { ulp1, abs1e12, abs1e7 };
+
+namespace trig_detail {
+
+// pi/2 split into 33-bit chunks so n * PIO2_k is exact for |n| < 2^20, plus
+// the remaining tails (Cody-Waite, as in fdlibm's __ieee754_rem_pio2).
+constexpr double INV_PIO2 = 6.36619772367581382433e-01;
+constexpr double PIO2_1 = 1.57079632673412561417e+00;
+constexpr double PIO2_1T = 6.07710050650619224932e-11;
+constexpr double PIO2_2 = 6.07710050630396597660e-11;
+constexpr double PIO2_2T = 2.02226624879595063154e-21;
+constexpr double PIO2_3 = 2.02226624871116645580e-21;
+constexpr double PIO2_3T = 8.47842766036889956997e-32;
+
+// Adding then subtracting 1.5 * 2^52 rounds to the nearest integer (ties to
+// even) without a libm call, and leaves n mod 2^k in the low mantissa bits.
+constexpr double ROUND_MAGIC = 6755399441055744.0;
+
+// Taylor coefficients of sin and cos, highest order last.
+constexpr double S1 = -1.0 / 6.0;
+constexpr double S2 = 1.0 / 120.0;
+constexpr double S3 = -1.0 / 5040.0;
+constexpr double S4 = 1.0 / 362880.0;
+constexpr double S5 = -1.0 / 39916800.0;
+constexpr double S6 = 1.0 / 6227020800.0;
+constexpr double S7 = -1.0 / 1307674368000.0;
+constexpr double S8 = 1.0 / 355687428096000.0;
+
+constexpr double C1 = 1.0 / 24.0;
+constexpr double C2 = -1.0 / 720.0;
+constexpr double C3 = 1.0 / 40320.0;
+constexpr double C4 = -1.0 / 3628800.0;
+constexpr double C5 = 1.0 / 479001600.0;
+constexpr double C6 = -1.0 / 87178291200.0;
+constexpr double C7 = 1.0 / 20922789888000.0;
+constexpr double C8 = -1.0 / 6402373705728000.0;
+
+// a + b = sum + error exactly (Knuth's branch-free TwoSum).
+constexpr double two_sum(double a, double b, double &error) {
+    const double sum = a + b;
+    const double b_virtual = sum - a;
+    error = (a - (sum - b_virtual)) + (b - b_virtual);
+    return sum;
+}
+
+// x = n * pi/2 + (hi + lo) with |hi + lo| <= ~pi/4 and quadrant = n mod 4.
+struct ReducedAngle {
+    double hi;
+    double lo;
+    unsigned quadrant;
+};
+
+template <TrigAccuracy A>
+inline ReducedAngle reduce_half_pi(double x) {
+    const double shifted = x * INV_PIO2 + ROUND_MAGIC;
+    std::uint64_t bits;
+    std::memcpy(&bits, &shifted, sizeof(bits));
+    const double n = shifted - ROUND_MAGIC;
+
+    ReducedAngle out;
+    out.quadrant = static_cast<unsigned>(bits & 3u);
+    if (A == TrigAccuracy::ulp1) {
+        // Three Cody-Waite stages. n * PIO2_k is exact, and the rounding
+        // error of each subtraction is recovered exactly (two_sum) and
+        // carried in the tail: good to ~150 bits for |n| < 2^20.
+        const double t = x - n * PIO2_1;
+        double error = 0.0;
+        const double r2 = two_sum(t, -(n * PIO2_2), error);
+        double error3 = 0.0;
+        const double r3 = two_sum(r2, -(n * PIO2_3), error3);
+        const double w = n * PIO2_3T - (error + error3);
+        out.hi = r3 - w;
+        out.lo = (r3 - out.hi) - w;
+    } else {
+        out.hi = (x - n * PIO2_1) - n * PIO2_1T;
+        out.lo = 0.0;
+    }
+    return out;
+}
+
+// sin and cos of hi + lo for |hi + lo| <= ~pi/4. The ulp1 kernels follow
+// fdlibm's __kernel_sin/__kernel_cos evaluation scheme.
+template <TrigAccuracy A>
+constexpr double kernel_sin(double x, double y) {
+    const double z = x * x;
+    const double v = z * x;
+    if (A == TrigAccuracy::ulp1) {
+        const double r =
+            S2 + z * (S3 + z * (S4 + z * (S5 + z * (S6 + z * (S7 + z * S8)))));
+        return x - ((z * (0.5 * y - v * r) - y) - v * S1);
+    } else if (A == TrigAccuracy::abs1e12) {
+        return x + v * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+    } else {
+        return x + v * (S1 + z * (S2 + z * (S3 + z * S4)));
+    }
+}
+
+template <TrigAccuracy A>
+constexpr double kernel_cos(double x, double y) {
+    const double z = x * x;
+    const double hz = 0.5 * z;
+    if (A == TrigAccuracy::ulp1) {
+        const double r =
+            z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * (C6 + z * (C7 + z * C8)))))));
+        const double w = 1.0 - hz;
+        return w + (((1.0 - w) - hz) + (z * r - x * y));
+    } else if (A == TrigAccuracy::abs1e12) {
+        return (1.0 - hz) + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * C5))));
+    } else {
+        return (1.0 - hz) + z * z * (C1 + z * (C2 + z * C3));
+    }
+}
+
+// Maps sin/cos of the reduced angle back to quadrant q of the full angle.
+constexpr void apply_quadrant(unsigned q, double s, double c, double &sin_out,
+                              double &cos_out) {
+    const double sin_mag = (q & 1u) ? c : s;
+    const double cos_mag = (q & 1u) ? s : c;
+    sin_out = (q & 2u) ? -sin_mag : sin_mag;
+    cos_out = ((q + 1u) & 2u) ? -cos_mag : cos_mag;
+}
+
+}  // namespace trig_detail
+
+template <TrigAccuracy A = TrigAccuracy::ulp1>
+inline void sincos(double x, double &sin_out, double &cos_out) {
+    const auto reduced = trig_detail::reduce_half_pi<A>(x);
+    trig_detail::apply_quadrant(
+        reduced.quadrant, trig_detail::kernel_sin<A>(reduced.hi, reduced.lo),
+        trig_detail::kernel_cos<A>(reduced.hi, reduced.lo), sin_out, cos_out);
+}
+
+// sin and cos of 2*pi * k / n, usable in constant expressions to build
+// lookup tables at compile time. The quadrant comes from exact integer
+// arithmetic, so only the reduced angle is rounded: within ~1 ulp.
+constexpr void sincos_turn_fraction(std::size_t k, std::size_t n,
+                                    double &sin_out, double &cos_out) {
+    // 4k = q * n + m with |m| <= n / 2, so the angle is q * pi/2 + pi/2 * m/n.
+    const std::size_t k4 = 4 * (k % n);
+    const std::size_t q = (2 * k4 + n) / (2 * n);
+    const double m = static_cast<double>(static_cast<long long>(k4) -
+                                         static_cast<long long>(q * n));
+    const double hi = m * trig_detail::PIO2_1 / static_cast<double>(n);
+    const double lo = m * trig_detail::PIO2_1T / static_cast<double>(n);
+    const double r = hi + lo;
+    trig_detail::apply_quadrant(
+        static_cast<unsigned>(q & 3u),
+        trig_detail::kernel_sin<TrigAccuracy::ulp1>(r, (hi - r) + lo),
+        trig_detail::kernel_cos<TrigAccuracy::ulp1>(r, (hi - r) + lo),
+        sin_out, cos_out);
+}
+
+template <TrigAccuracy A = TrigAccuracy::ulp1>
+inline double sin(double x) {
+    const auto reduced = trig_detail::reduce_half_pi<A>(x);
+    const double value = (reduced.quadrant & 1u)
+                             ? trig_detail::kernel_cos<A>(reduced.hi, reduced.lo)
+                             : trig_detail::kernel_sin<A>(reduced.hi, reduced.lo);
+    return (reduced.quadrant & 2u) ? -value : value;
+}
+
+template <TrigAccuracy A = TrigAccuracy::ulp1>
+inline double cos(double x) {
+    const auto reduced = trig_detail::reduce_half_pi<A>(x);
+    const double value = (reduced.quadrant & 1u)
+                             ? trig_detail::kernel_sin<A>(reduced.hi, reduced.lo)
+                             : trig_detail::kernel_cos<A>(reduced.hi, reduced.lo);
+    return ((reduced.quadrant + 1u) & 2u) ? -value : value;
+}
+
+// True when x lies within `half_width` (<= pi/4) of a multiple of 2*pi, i.e.
+// when the wrapped angle is in [0, half_width) or (2*pi - half_width, 2*pi).
+// Reuses the pi/2 reduction instead of std::fmod.
+inline bool near_zero_mod_two_pi(double x, double half_width) {
+    const auto reduced =
+        trig_detail::reduce_half_pi<TrigAccuracy::abs1e12>(x);
+    const double r = reduced.hi;
+    return reduced.quadrant == 0u && r < half_width && r > -half_width;
+}
+
+}  // namespace wheely
+
+#endif  // WHEELY_MATH_H
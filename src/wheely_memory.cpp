@@ -0,0 +1,114 @@
+#include "wheely_memory.h"
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define WHEELY_HAVE_MMAP 1
+#endif
+
+namespace wheely {
+namespace {
+
+std::atomic<HugePageMode> g_huge_page_mode{HugePageMode::off};
+
+#ifdef WHEELY_HAVE_MMAP
+std::size_t round_up(std::size_t bytes, std::size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+// Bytes actually mapped for a request: whole huge pages for MAP_HUGETLB
+// (and its fallback, so munmap() sees the same length either way), whole
+// base pages otherwise.
+std::size_t mapped_length(std::size_t bytes, HugePageMode mode) {
+    if (mode == HugePageMode::explicit_pages) {
+        return round_up(bytes, HUGE_PAGE_SIZE);
+    }
+    static const std::size_t page_size =
+        static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return round_up(bytes, page_size);
+}
+
+// Anonymous mapping of `length` bytes aligned to HUGE_PAGE_SIZE, so the
+// kernel can back every 2 MiB of it with one huge page.
+void *map_aligned(std::size_t length) {
+    const std::size_t padded = length + HUGE_PAGE_SIZE;
+    void *raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    const auto base = reinterpret_cast<std::uintptr_t>(raw);
+    const std::uintptr_t aligned =
+        (base + HUGE_PAGE_SIZE - 1) & ~(std::uintptr_t{HUGE_PAGE_SIZE} - 1);
+    const std::size_t head = aligned - base;
+    const std::size_t tail = padded - head - length;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (tail > 0) {
+        munmap(reinterpret_cast<void *>(aligned + length), tail);
+    }
+    return reinterpret_cast<void *>(aligned);
+}
+#endif
+
+}  // namespace
+
+void set_huge_page_mode(HugePageMode mode) { g_huge_page_mode.store(mode); }
+
+HugePageMode huge_page_mode() { return g_huge_page_mode.load(); }
+
+void *allocate_large(std::size_t bytes, HugePageMode mode) {
+    if (mode == HugePageMode::off) {
+        return ::operator new(bytes);
+    }
+#ifdef WHEELY_HAVE_MMAP
+    const std::size_t length = mapped_length(bytes, mode);
+
+#ifdef MAP_HUGETLB
+    if (mode == HugePageMode::explicit_pages) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+        flags |= MAP_HUGE_2MB;
+#endif
+        void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (ptr != MAP_FAILED) {
+            return ptr;
+        }
+    }
+#endif
+
+    void *ptr = map_aligned(length);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+    return ptr;
+#else
+    return ::operator new(bytes);
+#endif
+}
+
+void deallocate_large(void *ptr, std::size_t bytes,
+                      HugePageMode mode) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+#ifdef WHEELY_HAVE_MMAP
+    if (mode != HugePageMode::off) {
+        munmap(ptr, mapped_length(bytes, mode));
+        return;
+    }
+#else
+    (void)mode;
+#endif
+    (void)bytes;
+    ::operator delete(ptr);
+}
+
+}  // namespace wheely
@@ -0,0 +1,98 @@
+#ifndef WHEELY_MEMORY_H
+#define WHEELY_MEMORY_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace wheely {
+
+enum class HugePageMode {
+    // Plain operator new, exactly as std::allocator would allocate.
+    off,
+    // madvise(MADV_HUGEPAGE) on 2 MiB-aligned mappings. Only whole 2 MiB
+    // stretches can become huge pages; the tail stays in small pages.
+    transparent,
+    // MAP_HUGETLB from the reserved 2 MiB pool, falling back to
+    // `transparent` when the pool is empty or unsupported.
+    explicit_pages,
+};
+
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20;
+
+// Allocations of at least this many bytes are served by allocate_large().
+constexpr std::size_t LARGE_ALLOCATION_THRESHOLD = HUGE_PAGE_SIZE;
+
+// Process-wide mode picked up by allocators created afterwards; existing
+// buffers keep the pages they were given. Defaults to `off`. Thread-safe.
+void set_huge_page_mode(HugePageMode mode);
+HugePageMode huge_page_mode();
+
+// Allocates at least `bytes` bytes under `mode`. `explicit_pages` rounds up
+// to whole huge pages; the other modes do not. Throws std::bad_alloc on
+// failure. Release with deallocate_large() passing the same bytes and mode.
+void *allocate_large(std::size_t bytes, HugePageMode mode);
+void deallocate_large(void *ptr, std::size_t bytes, HugePageMode mode) noexcept;
+
+// Allocator that routes large requests through allocate_large() under the
+// mode current when it was created, and everything else through operator
+// new. The mode travels with the allocator, so deallocate() always matches
+// allocate() even if set_huge_page_mode() is called in between.
+template <typename T>
+struct LargePageAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    LargePageAllocator() : mode(huge_page_mode()) {}
+    explicit LargePageAllocator(HugePageMode mode) noexcept : mode(mode) {}
+    template <typename U>
+    LargePageAllocator(const LargePageAllocator<U> &other) noexcept
+        : mode(other.mode) {}
+
+    T *allocate(std::size_t n) {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        const std::size_t bytes = n * sizeof(T);
+        if (bytes >= LARGE_ALLOCATION_THRESHOLD) {
+            return static_cast<T *>(allocate_large(bytes, mode));
+        }
+        return static_cast<T *>(::operator new(bytes));
+    }
+
+    void deallocate(T *ptr, std::size_t n) noexcept {
+        const std::size_t bytes = n * sizeof(T);
+        if (bytes >= LARGE_ALLOCATION_THRESHOLD) {
+            deallocate_large(ptr, bytes, mode);
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const LargePageAllocator<U> &other) const noexcept {
+        return mode == other.mode;
+    }
+    template <typename U>
+    bool operator!=(const LargePageAllocator<U> &other) const noexcept {
+        return mode != other.mode;
+    }
+
+    HugePageMode mode;
+};
+
+// Storage that owns large per-frame outputs, such as SimulationArena's.
+// WebAssembly has no page-size control, so the wasm build keeps
+// std::vector<double> (which embind binds directly).
+#ifdef __EMSCRIPTEN__
+using LargeBuffer = std::vector<double>;
+#else
+using LargeBuffer = std::vector<double, LargePageAllocator<double>>;
+#endif
+
+}  // namespace wheely
+
+#endif  // WHEELY_MEMORY_H
@@ -0,0 +1,558 @@
+#include "wheely_modal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+// Relative size below which a singular value or a new orthogonal direction
+// is treated as numerical noise and dropped.
+constexpr double RANK_TOLERANCE = 1e-12;
+
+double dot(const double *x, const double *y, std::size_t n) {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+// One-sided Jacobi: rotates the n columns (each of length n, column-major)
+// of `a` until they are mutually orthogonal. Afterwards column j is
+// sigma_j * u_j, with u_j the left singular vectors of the input.
+void orthogonalize_columns(std::vector<double> &a, std::size_t n) {
+    for (int sweep = 0; sweep < 60; ++sweep) {
+        bool rotated = false;
+        for (std::size_t p = 0; p + 1 < n; ++p) {
+            for (std::size_t q = p + 1; q < n; ++q) {
+                double *x = a.data() + p * n;
+                double *y = a.data() + q * n;
+                const double alpha = dot(x, x, n);
+                const double beta = dot(y, y, n);
+                const double gamma = dot(x, y, n);
+                if (std::abs(gamma) <= 1e-15 * std::sqrt(alpha * beta) ||
+                    gamma == 0.0) {
+                    continue;
+                }
+                rotated = true;
+                const double zeta = (beta - alpha) / (2.0 * gamma);
+                const double t = (zeta >= 0.0 ? 1.0 : -1.0) /
+                                 (std::abs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                const double c = 1.0 / std::sqrt(1.0 + t * t);
+                const double s = c * t;
+                for (std::size_t i = 0; i < n; ++i) {
+                    const double xi = x[i];
+                    const double yi = y[i];
+                    x[i] = c * xi - s * yi;
+                    y[i] = s * xi + c * yi;
+                }
+            }
+        }
+        if (!rotated) {
+            break;
+        }
+    }
+}
+
+// Solves gram * x = b for symmetric positive semi-definite gram (n x n,
+// row-major) by Cholesky, with a small ridge if gram is singular.
+std::vector<double> solve_gram(std::vector<double> gram, std::vector<double> b,
+                               std::size_t n) {
+    double trace = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        trace += gram[i * n + i];
+    }
+    const double ridge = RANK_TOLERANCE * (trace > 0.0 ? trace : 1.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        gram[i * n + i] += ridge;
+    }
+    for (std::size_t j = 0; j < n; ++j) {
+        double diagonal = gram[j * n + j];
+        for (std::size_t k = 0; k < j; ++k) {
+            diagonal -= gram[j * n + k] * gram[j * n + k];
+        }
+        diagonal = std::sqrt(std::max(diagonal, ridge));
+        gram[j * n + j] = diagonal;
+        for (std::size_t i = j + 1; i < n; ++i) {
+            double value = gram[i * n + j];
+            for (std::size_t k = 0; k < j; ++k) {
+                value -= gram[i * n + k] * gram[j * n + k];
+            }
+            gram[i * n + j] = value / diagonal;
+        }
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t k = 0; k < i; ++k) {
+            b[i] -= gram[i * n + k] * b[k];
+        }
+        b[i] /= gram[i * n + i];
+    }
+    for (std::size_t i = n; i-- > 0;) {
+        for (std::size_t k = i + 1; k < n; ++k) {
+            b[i] -= gram[k * n + i] * b[k];
+        }
+        b[i] /= gram[i * n + i];
+    }
+    return b;
+}
+
+// Eigenvalues of a real n x n row-major matrix: reduction to Hessenberg form
+// by stabilized elimination, then the Francis double-shift QR iteration.
+std::vector<std::complex<double>> eigenvalues(std::vector<double> a,
+                                              std::size_t n) {
+    const auto at = [&](std::size_t i, std::size_t j) -> double & {
+        return a[i * n + j];
+    };
+
+    for (std::size_t m = 1; m + 1 < n; ++m) {
+        double x = 0.0;
+        std::size_t pivot = m;
+        for (std::size_t j = m; j < n; ++j) {
+            if (std::abs(at(j, m - 1)) > std::abs(x)) {
+                x = at(j, m - 1);
+                pivot = j;
+            }
+        }
+        if (pivot != m) {
+            for (std::size_t j = m - 1; j < n; ++j) {
+                std::swap(at(pivot, j), at(m, j));
+            }
+            for (std::size_t j = 0; j < n; ++j) {
+                std::swap(at(j, pivot), at(j, m));
+            }
+        }
+        if (x != 0.0) {
+            for (std::size_t i = m + 1; i < n; ++i) {
+                double y = at(i, m - 1);
+                if (y != 0.0) {
+                    y /= x;
+                    at(i, m - 1) = 0.0;
+                    for (std::size_t j = m; j < n; ++j) {
+                        at(i, j) -= y * at(m, j);
+                    }
+                    for (std::size_t j = 0; j < n; ++j) {
+                        at(j, m) += y * at(j, i);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<std::complex<double>> values(n);
+    double norm = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = i > 0 ? i - 1 : 0; j < n; ++j) {
+            norm += std::abs(at(i, j));
+        }
+    }
+
+    // Active block is rows/columns l..nn; indices are signed because nn
+    // steps below zero when the last block deflates.
+    long nn = static_cast<long>(n) - 1;
+    double shift = 0.0;
+    const auto el = [&](long i, long j) -> double & {
+        return at(static_cast<std::size_t>(i), static_cast<std::size_t>(j));
+    };
+    while (nn >= 0) {
+        int iterations = 0;
+        long l = 0;
+        do {
+            for (l = nn; l >= 1; --l) {
+                double s = std::abs(el(l - 1, l - 1)) + std::abs(el(l, l));
+                if (s == 0.0) {
+                    s = norm;
+                }
+                if (std::abs(el(l, l - 1)) + s == s) {
+                    el(l, l - 1) = 0.0;
+                    break;
+                }
+            }
+            double x = el(nn, nn);
+            if (l == nn) {
+                values[static_cast<std::size_t>(nn)] = {x + shift, 0.0};
+                --nn;
+                continue;
+            }
+            double y = el(nn - 1, nn - 1);
+            double w = el(nn, nn - 1) * el(nn - 1, nn);
+            if (l == nn - 1) {
+                const double p = 0.5 * (y - x);
+                const double q = p * p + w;
+                double z = std::sqrt(std::abs(q));
+                x += shift;
+                if (q >= 0.0) {
+                    z = p + (p >= 0.0 ? z : -z);
+                    const double first = x + z;
+                    const double second = z != 0.0 ? x - w / z : first;
+                    values[static_cast<std::size_t>(nn - 1)] = {first, 0.0};
+                    values[static_cast<std::size_t>(nn)] = {second, 0.0};
+                } else {
+                    values[static_cast<std::size_t>(nn - 1)] = {x + p, z};
+                    values[static_cast<std::size_t>(nn)] = {x + p, -z};
+                }
+                nn -= 2;
+                continue;
+            }
+            if (iterations == 60) {
+                throw std::runtime_error("DMD eigenvalues did not converge");
+            }
+            if (iterations == 10 || iterations == 20) {
+                // Exceptional shift.
+                shift += x;
+                for (long i = 0; i <= nn; ++i) {
+                    el(i, i) -= x;
+                }
+                const double s =
+                    std::abs(el(nn, nn - 1)) + std::abs(el(nn - 1, nn - 2));
+                x = y = 0.75 * s;
+                w = -0.4375 * s * s;
+            }
+            ++iterations;
+            long m = nn - 2;
+            double p = 0.0;
+            double q = 0.0;
+            double r = 0.0;
+            double z = 0.0;
+            for (; m >= l; --m) {
+                z = el(m, m);
+                r = x - z;
+                double s = y - z;
+                p = (r * s - w) / el(m + 1, m) + el(m, m + 1);
+                q = el(m + 1, m + 1) - z - r - s;
+                r = el(m + 2, m + 1);
+                s = std::abs(p) + std::abs(q) + std::abs(r);
+                p /= s;
+                q /= s;
+                r /= s;
+                if (m == l) {
+                    break;
+                }
+                const double u = std::abs(el(m, m - 1)) * (std::abs(q) + std::abs(r));
+                const double v = std::abs(p) * (std::abs(el(m - 1, m - 1)) +
+                                                std::abs(z) +
+                                                std::abs(el(m + 1, m + 1)));
+                if (u + v == v) {
+                    break;
+                }
+            }
+            for (long i = m + 2; i <= nn; ++i) {
+                el(i, i - 2) = 0.0;
+                if (i != m + 2) {
+                    el(i, i - 3) = 0.0;
+                }
+            }
+            for (long k = m; k <= nn - 1; ++k) {
+                if (k != m) {
+                    p = el(k, k - 1);
+                    q = el(k + 1, k - 1);
+                    r = k != nn - 1 ? el(k + 2, k - 1) : 0.0;
+                    x = std::abs(p) + std::abs(q) + std::abs(r);
+                    if (x != 0.0) {
+                        p /= x;
+                        q /= x;
+                        r /= x;
+                    }
+                }
+                const double magnitude = std::sqrt(p * p + q * q + r * r);
+                const double s = p >= 0.0 ? magnitude : -magnitude;
+                if (s == 0.0) {
+                    continue;
+                }
+                if (k == m) {
+                    if (l != m) {
+                        el(k, k - 1) = -el(k, k - 1);
+                    }
+                } else {
+                    el(k, k - 1) = -s * x;
+                }
+                p += s;
+                x = p / s;
+                y = q / s;
+                z = r / s;
+                q /= p;
+                r /= p;
+                for (long j = k; j <= nn; ++j) {
+                    p = el(k, j) + q * el(k + 1, j);
+                    if (k != nn - 1) {
+                        p += r * el(k + 2, j);
+                        el(k + 2, j) -= p * z;
+                    }
+                    el(k + 1, j) -= p * y;
+                    el(k, j) -= p * x;
+                }
+                const long last = std::min(nn, k + 3);
+                for (long i = l; i <= last; ++i) {
+                    p = x * el(i, k) + y * el(i, k + 1);
+                    if (k != nn - 1) {
+                        p += z * el(i, k + 2);
+                        el(i, k + 2) -= p * r;
+                    }
+                    el(i, k + 1) -= p * q;
+                    el(i, k) -= p;
+                }
+            }
+        } while (nn >= 0 && l < nn - 1);
+    }
+    return values;
+}
+
+// out = t * in * t^T for t (rows x cols) and in (cols x cols), row-major.
+std::vector<double> rotate_accumulator(const std::vector<double> &in,
+                                       const std::vector<double> &t,
+                                       std::size_t rows, std::size_t cols) {
+    std::vector<double> half(rows * cols, 0.0);
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t k = 0; k < cols; ++k) {
+            const double tik = t[i * cols + k];
+            for (std::size_t j = 0; j < cols; ++j) {
+                half[i * cols + j] += tik * in[k * cols + j];
+            }
+        }
+    }
+    std::vector<double> out(rows * rows, 0.0);
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t j = 0; j < rows; ++j) {
+            out[i * rows + j] = dot(half.data() + i * cols, t.data() + j * cols, cols);
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+StreamingModalDecomposition::StreamingModalDecomposition(
+    std::size_t dimension, const ModalOptions &options)
+    : dimension_(dimension), rank_(options.rank),
+      block_size_(options.block_size == 0 ? options.rank : options.block_size) {
+    if (dimension < 1) {
+        throw std::invalid_argument("dimension must be positive");
+    }
+    if (options.rank < 1) {
+        throw std::invalid_argument("rank must be positive");
+    }
+    block_.resize(block_size_ * dimension_);
+    previous_.resize(dimension_);
+}
+
+void StreamingModalDecomposition::push(const double *snapshot) {
+    std::copy(snapshot, snapshot + dimension_,
+              block_.data() + block_count_ * dimension_);
+    ++block_count_;
+    ++frame_count_;
+    if (block_count_ == block_size_) {
+        update();
+    }
+}
+
+void StreamingModalDecomposition::flush() {
+    if (block_count_ > 0) {
+        update();
+    }
+}
+
+void StreamingModalDecomposition::update() {
+    const std::size_t m = dimension_;
+    const std::size_t r = basis_rank_;
+    const std::size_t b = block_count_;
+
+    // Split the block into its part in the current basis (l, r x b) and
+    // an orthonormal complement (j, b columns) with j * k = the residual.
+    std::vector<double> l(r * b, 0.0);
+    std::vector<double> j(block_.begin(), block_.begin() + b * m);
+    double scale = 0.0;
+    for (std::size_t col = 0; col < b; ++col) {
+        double *h = j.data() + col * m;
+        double norm = std::sqrt(dot(h, h, m));
+        scale = std::max(scale, norm);
+        // Project out the basis, and once more if that removed most of the
+        // vector: a single pass then leaves too much of the basis behind in
+        // floating point ("twice is enough").
+        for (int pass = 0; pass < 2 && r > 0; ++pass) {
+            for (std::size_t mode = 0; mode < r; ++mode) {
+                const double *u = basis_.data() + mode * m;
+                const double coefficient = dot(u, h, m);
+                l[mode * b + col] += coefficient;
+                for (std::size_t i = 0; i < m; ++i) {
+                    h[i] -= coefficient * u[i];
+                }
+            }
+            const double before = norm;
+            norm = std::sqrt(dot(h, h, m));
+            if (norm > 0.5 * before) {
+                break;
+            }
+        }
+    }
+    std::vector<double> k(b * b, 0.0);
+    for (std::size_t col = 0; col < b; ++col) {
+        double *h = j.data() + col * m;
+        double norm = std::sqrt(dot(h, h, m));
+        for (int pass = 0; pass < 2 && col > 0; ++pass) {
+            for (std::size_t prev = 0; prev < col; ++prev) {
+                const double *q = j.data() + prev * m;
+                const double coefficient = dot(q, h, m);
+                k[prev * b + col] += coefficient;
+                for (std::size_t i = 0; i < m; ++i) {
+                    h[i] -= coefficient * q[i];
+                }
+            }
+            const double before = norm;
+            norm = std::sqrt(dot(h, h, m));
+            if (norm > 0.5 * before) {
+                break;
+            }
+        }
+        if (norm > RANK_TOLERANCE * scale) {
+            k[col * b + col] = norm;
+            for (std::size_t i = 0; i < m; ++i) {
+                h[i] /= norm;
+            }
+        } else {
+            std::fill(h, h + m, 0.0);
+        }
+    }
+
+    // Core matrix [[diag(s), l], [0, k]], column-major, and its left
+    // singular vectors.
+    const std::size_t n = r + b;
+    std::vector<double> core(n * n, 0.0);
+    for (std::size_t i = 0; i < r; ++i) {
+        core[i * n + i] = singular_values_[i];
+        for (std::size_t col = 0; col < b; ++col) {
+            core[(r + col) * n + i] = l[i * b + col];
+        }
+    }
+    for (std::size_t row = 0; row < b; ++row) {
+        for (std::size_t col = 0; col < b; ++col) {
+            core[(r + col) * n + r + row] = k[row * b + col];
+        }
+    }
+    orthogonalize_columns(core, n);
+    std::vector<double> sigma(n);
+    for (std::size_t col = 0; col < n; ++col) {
+        sigma[col] = std::sqrt(dot(core.data() + col * n, core.data() + col * n, n));
+    }
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) {
+        return sigma[x] > sigma[y];
+    });
+    std::size_t kept = 0;
+    while (kept < std::min(rank_, n) &&
+           sigma[order[kept]] > RANK_TOLERANCE * sigma[order[0]]) {
+        ++kept;
+    }
+
+    // New basis [basis j] * u_core, and t = u_core[:r]^T mapping old
+    // coefficients to new ones.
+    std::vector<double> basis(kept * m, 0.0);
+    std::vector<double> t(kept * r, 0.0);
+    std::vector<double> singular_values(kept);
+    for (std::size_t mode = 0; mode < kept; ++mode) {
+        const std::size_t col = order[mode];
+        const double *u = core.data() + col * n;
+        const double inverse = 1.0 / sigma[col];
+        double *out = basis.data() + mode * m;
+        for (std::size_t i = 0; i < r; ++i) {
+            const double weight = u[i] * inverse;
+            t[mode * r + i] = weight;
+            const double *source = basis_.data() + i * m;
+            for (std::size_t row = 0; row < m; ++row) {
+                out[row] += weight * source[row];
+            }
+        }
+        for (std::size_t i = 0; i < b; ++i) {
+            const double weight = u[r + i] * inverse;
+            const double *source = j.data() + i * m;
+            for (std::size_t row = 0; row < m; ++row) {
+                out[row] += weight * source[row];
+            }
+        }
+        singular_values[mode] = sigma[col];
+    }
+
+    if (r > 0) {
+        cross_ = rotate_accumulator(cross_, t, kept, r);
+        gram_ = rotate_accumulator(gram_, t, kept, r);
+    } else {
+        cross_.assign(kept * kept, 0.0);
+        gram_.assign(kept * kept, 0.0);
+    }
+    basis_.swap(basis);
+    singular_values_.swap(singular_values);
+    basis_rank_ = kept;
+
+    // Add the new consecutive pairs, projected onto the new basis.
+    std::vector<double> before(kept);
+    std::vector<double> after(kept);
+    const auto project = [&](const double *x, std::vector<double> &a) {
+        for (std::size_t mode = 0; mode < kept; ++mode) {
+            a[mode] = dot(basis_.data() + mode * m, x, m);
+        }
+    };
+    std::size_t first = 0;
+    if (has_previous_) {
+        project(previous_.data(), before);
+    } else {
+        project(block_.data(), before);
+        first = 1;
+    }
+    for (std::size_t col = first; col < b; ++col) {
+        project(block_.data() + col * m, after);
+        for (std::size_t row = 0; row < kept; ++row) {
+            for (std::size_t c = 0; c < kept; ++c) {
+                cross_[row * kept + c] += after[row] * before[c];
+                gram_[row * kept + c] += before[row] * before[c];
+            }
+        }
+        before.swap(after);
+    }
+    std::copy(block_.data() + (b - 1) * m, block_.data() + b * m,
+              previous_.begin());
+    has_previous_ = true;
+    block_count_ = 0;
+}
+
+ModalDecomposition StreamingModalDecomposition::result() {
+    flush();
+    const std::size_t r = basis_rank_;
+
+    ModalDecomposition out;
+    out.dimension = dimension_;
+    out.rank = r;
+    out.frame_count = frame_count_;
+    out.modes = basis_;
+    out.singular_values = singular_values_;
+
+    // A = cross * gram^-1; gram is symmetric, so row i of A solves
+    // gram * x = (row i of cross)^T.
+    out.dmd_operator.assign(r * r, 0.0);
+    for (std::size_t row = 0; row < r; ++row) {
+        std::vector<double> rhs(cross_.begin() + row * r,
+                                cross_.begin() + (row + 1) * r);
+        const auto solved = solve_gram(gram_, rhs, r);
+        std::copy(solved.begin(), solved.end(),
+                  out.dmd_operator.begin() + row * r);
+    }
+    if (r > 0) {
+        out.dmd_eigenvalues = eigenvalues(out.dmd_operator, r);
+    }
+    return out;
+}
+
+ModalDecomposition decompose_cup_masses(const SimulationConfig &cfg,
+                                        const ModalOptions &options) {
+    validate_config(cfg);
+    StreamingModalDecomposition decomposition(cfg.n_cups, options);
+    simulate_streaming(cfg, [&](std::size_t frame, double, const double *state) {
+        if (frame >= options.burn_in_frames) {
+            decomposition.push(state + 2);
+        }
+    });
+    return decomposition.result();
+}
+
+}  // namespace wheely
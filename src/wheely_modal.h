@@ -0,0 +1,99 @@
+#ifndef WHEELY_MODAL_H
+#define WHEELY_MODAL_H
+
+#include "wheely_simulation.h"
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace wheely {
+
+struct ModalOptions {
+    // Modes kept after every update. Each update discards whatever lies
+    // beyond this rank, so keep a few more modes than are needed.
+    std::size_t rank = 16;
+    // Snapshots buffered per update; 0 uses rank. Larger blocks cost more
+    // memory (block_size * dimension doubles) but fewer basis rotations.
+    std::size_t block_size = 0;
+    // Leading frames skipped by decompose_cup_masses(), e.g. a transient.
+    std::size_t burn_in_frames = 0;
+};
+
+struct ModalDecomposition {
+    std::size_t dimension = 0;
+    std::size_t rank = 0;
+    std::size_t frame_count = 0;
+    // POD modes, mode-major: modes[mode * dimension + i], orthonormal.
+    std::vector<double> modes;
+    // Singular values of the snapshot matrix, descending.
+    std::vector<double> singular_values;
+    // rank x rank row-major DMD operator in the POD basis: the coefficients
+    // a = modes^T x of consecutive frames satisfy a_{k+1} ~ A a_k.
+    std::vector<double> dmd_operator;
+    // Eigenvalues of dmd_operator (per-frame multipliers); complex pairs
+    // are adjacent. DMD modes are modes * eig(dmd_operator).
+    std::vector<std::complex<double>> dmd_eigenvalues;
+};
+
+// Rank-truncated incremental SVD (Brand) of a stream of snapshots, with
+// streaming DMD on top. Each full block of snapshots is folded into the
+// basis with one small dense SVD of size (rank + block_size). The DMD
+// accumulators sum_k a_{k+1} a_k^T and sum_k a_k a_k^T are kept in the
+// current basis and rotated along with it. Memory is
+// O(dimension * (rank + block_size)), independent of the number of snapshots.
+class StreamingModalDecomposition {
+public:
+    // Throws std::invalid_argument if dimension or rank is 0.
+    StreamingModalDecomposition(std::size_t dimension,
+                                const ModalOptions &options = ModalOptions());
+
+    // Copies one snapshot of dimension() values.
+    void push(const double *snapshot);
+
+    // Folds any buffered snapshots into the basis.
+    void flush();
+
+    // Flushes, then returns the modes, singular values and DMD operator
+    // and eigenvalues of everything pushed so far.
+    ModalDecomposition result();
+
+    std::size_t dimension() const { return dimension_; }
+    std::size_t frame_count() const { return frame_count_; }
+
+private:
+    void update();
+
+    std::size_t dimension_;
+    std::size_t rank_;
+    std::size_t block_size_;
+    std::size_t frame_count_ = 0;
+
+    // Current basis, mode-major, and its singular values.
+    std::vector<double> basis_;
+    std::vector<double> singular_values_;
+    std::size_t basis_rank_ = 0;
+
+    // Snapshot-major block of pending snapshots.
+    std::vector<double> block_;
+    std::size_t block_count_ = 0;
+
+    // Last snapshot of the previous block, to pair with the next block.
+    std::vector<double> previous_;
+    bool has_previous_ = false;
+
+    // DMD accumulators in the current basis, basis_rank_ x basis_rank_
+    // row-major.
+    std::vector<double> cross_;
+    std::vector<double> gram_;
+};
+
+// Streams the cup masses of every frame of cfg from burn_in_frames on
+// through a StreamingModalDecomposition of dimension n_cups. The masses
+// matrix is never stored.
+ModalDecomposition decompose_cup_masses(const SimulationConfig &cfg,
+                                        const ModalOptions &options = ModalOptions());
+
+}  // namespace wheely
+
+#endif  // WHEELY_MODAL_H
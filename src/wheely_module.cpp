@@ -1,12 +1,31 @@
+#include "wheely_adjoint.h"
+#include "wheely_batch.h"
+#include "wheely_control.h"
+#include "wheely_embedding.h"
+#include "wheely_env.h"
+#include "wheely_modal.h"
 #include "wheely_simulation.h"
+#include "wheely_sobol.h"
+#include "wheely_splitting.h"
+#include "wheely_symbolic.h"
+#include "wheely_ulam.h"
+#include "wheely_writer.h"
 
+#include <pybind11/complex.h>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace py = pybind11;
@@ -72,12 +91,582 @@ py::tuple to_python(const wheely::SimulationResult &result,
 }
 
 py::tuple simulate_impl(const wheely::SimulationConfig &cfg) {
-    return to_python(wheely::simulate(cfg), cfg.n_cups);
+    wheely::SimulationResult result;
+    {
+        py::gil_scoped_release release;
+        result = wheely::simulate(cfg);
+    }
+    return to_python(result, cfg.n_cups);
+}
+
+template <typename Controller>
+py::tuple simulate_controlled_impl(const wheely::SimulationConfig &cfg,
+                                   Controller &controller) {
+    wheely::SimulationResult result;
+    {
+        py::gil_scoped_release release;
+        result = wheely::simulate_controlled(cfg, controller);
+    }
+    return to_python(result, cfg.n_cups);
+}
+
+// wheely::VectorEnv plus the all-false terminations Gym expects; the wheel
+// has no terminal states, only truncation at the episode length.
+struct PyVectorEnv {
+    PyVectorEnv(const wheely::SimulationConfig &cfg,
+                const wheely::VectorEnvOptions &options)
+        : env(cfg, options), terminated(options.n_envs, 0) {}
+
+    wheely::VectorEnv env;
+    std::vector<std::uint8_t> terminated;
+};
+
+// NumPy views onto env buffers. `owner` is the Python env, which the views
+// keep alive; their contents change on every step() and reset().
+py::array_t<double> env_view(const py::handle &owner, const double *data,
+                             std::vector<py::ssize_t> shape) {
+    return py::array_t<double>(shape, data, owner);
+}
+
+py::array env_flags(const py::handle &owner, const std::uint8_t *data,
+                    py::ssize_t n) {
+    return py::array(py::dtype("bool"), {n}, {py::ssize_t{1}}, data, owner);
+}
+
+py::list simulate_batch_impl(const py::list &configs,
+                             std::size_t steps_per_frame,
+                             std::size_t n_threads) {
+    std::vector<wheely::SimulationConfig> cfgs;
+    cfgs.reserve(configs.size());
+    for (const auto &item : configs) {
+        cfgs.push_back(
+            make_config_from_dict(item.cast<py::dict>(), steps_per_frame));
+    }
+
+    wheely::BatchOptions options;
+    options.n_threads = n_threads;
+    std::vector<wheely::SimulationResult> results;
+    {
+        py::gil_scoped_release release;
+        results = wheely::simulate_batch(cfgs, options);
+    }
+
+    py::list out;
+    for (std::size_t index = 0; index < results.size(); ++index) {
+        out.append(to_python(results[index], cfgs[index].n_cups));
+    }
+    return out;
+}
+
+std::uint64_t simulate_to_file_impl(const py::dict &config,
+                                    const std::string &path,
+                                    std::size_t steps_per_frame,
+                                    std::size_t buffer_mb, bool direct_io) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    wheely::FrameWriterOptions options;
+    options.buffer_bytes = buffer_mb << 20;
+    options.direct_io = direct_io;
+
+    py::gil_scoped_release release;
+    return wheely::simulate_to_file(cfg, path, options);
+}
+
+// SimulationConfig objects are plain structs shared by reference with
+// Python. Without a GIL, setting a field on one thread while simulate_into()
+// reads the same object on another would be a data race, so the field
+// accessors and the copy simulate_into() runs from all take this lock.
+std::mutex &config_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+template <typename T>
+void def_config_field(py::class_<wheely::SimulationConfig> &cls,
+                      const char *name, T wheely::SimulationConfig::*field) {
+    cls.def_property(
+        name,
+        [field](const wheely::SimulationConfig &cfg) {
+            std::lock_guard<std::mutex> lock(config_mutex());
+            return cfg.*field;
+        },
+        [field](wheely::SimulationConfig &cfg, T value) {
+            std::lock_guard<std::mutex> lock(config_mutex());
+            cfg.*field = value;
+        });
+}
+
+// Fast path for tiny runs: takes a pre-built SimulationConfig (no dict
+// parsing) and fills caller-owned float64 arrays in place (no result
+// allocation). Errors are raised only after the non-throwing core reports
+// them.
+void simulate_into_impl(const wheely::SimulationConfig &config,
+                        py::array_t<double, py::array::c_style> times,
+                        py::array_t<double, py::array::c_style> theta,
+                        py::array_t<double, py::array::c_style> masses) {
+    wheely::SimulationConfig cfg;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex());
+        cfg = config;
+    }
+    if (times.size() != static_cast<py::ssize_t>(cfg.n_frames) ||
+        theta.size() != static_cast<py::ssize_t>(cfg.n_frames) ||
+        masses.size() != static_cast<py::ssize_t>(cfg.n_cups * cfg.n_frames)) {
+        throw std::invalid_argument(
+            "times and theta need N_FRAMES values, masses N_CUPS * N_FRAMES");
+    }
+    double *times_ptr = times.mutable_data();
+    double *theta_ptr = theta.mutable_data();
+    double *masses_ptr = masses.mutable_data();
+    wheely::SimulationStatus status;
+    {
+        py::gil_scoped_release release;
+        status = wheely::simulate_into(cfg, times_ptr, theta_ptr, masses_ptr);
+    }
+    if (status != wheely::SimulationStatus::ok) {
+        throw std::invalid_argument(wheely::status_message(status));
+    }
+}
+
+py::tuple simulate_lab_bins_impl(const py::dict &config, std::size_t n_bins,
+                                 std::size_t steps_per_frame) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    wheely::LabBinnedResult result;
+    {
+        py::gil_scoped_release release;
+        result = wheely::simulate_lab_bins(cfg, n_bins);
+    }
+    const std::size_t n_frames = result.theta.size();
+
+    py::array_t<double> times_array(n_frames);
+    std::copy(result.times.begin(), result.times.end(),
+              times_array.mutable_data());
+
+    py::array_t<double> theta_array(n_frames);
+    std::copy(result.theta.begin(), result.theta.end(),
+              theta_array.mutable_data());
+
+    py::array_t<double> bins_array({n_bins, n_frames});
+    std::copy(result.bins.begin(), result.bins.end(),
+              bins_array.mutable_data());
+
+    return py::make_tuple(times_array, theta_array, bins_array);
+}
+
+py::dict simulate_events_impl(const py::dict &config,
+                              std::size_t steps_per_frame, bool reversals,
+                              bool maxima, bool minima, bool inflow) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    wheely::EventOptions options;
+    options.omega_reversals = reversals;
+    options.omega_maxima = maxima;
+    options.omega_minima = minima;
+    options.inflow_crossings = inflow;
+
+    std::vector<wheely::SimulationEvent> events;
+    {
+        py::gil_scoped_release release;
+        events = wheely::simulate_events(cfg, options);
+    }
+
+    const auto count = static_cast<py::ssize_t>(events.size());
+    py::array_t<double> time(count);
+    py::array_t<double> theta(count);
+    py::array_t<double> omega(count);
+    py::array_t<std::uint32_t> cup(count);
+    py::array_t<std::uint8_t> kind(count);
+    py::array_t<std::int8_t> direction(count);
+    for (py::ssize_t index = 0; index < count; ++index) {
+        const auto &event = events[static_cast<std::size_t>(index)];
+        time.mutable_data()[index] = event.time;
+        theta.mutable_data()[index] = event.theta;
+        omega.mutable_data()[index] = event.omega;
+        cup.mutable_data()[index] = event.cup;
+        kind.mutable_data()[index] = static_cast<std::uint8_t>(event.kind);
+        direction.mutable_data()[index] = event.direction;
+    }
+
+    py::dict out;
+    out["time"] = time;
+    out["theta"] = theta;
+    out["omega"] = omega;
+    out["cup"] = cup;
+    out["kind"] = kind;
+    out["direction"] = direction;
+    return out;
+}
+
+py::dict analyze_symbolic_impl(const py::dict &config,
+                               std::size_t steps_per_frame,
+                               const std::string &encoding,
+                               std::size_t max_block_length,
+                               bool keep_symbols) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    wheely::SymbolicOptions options;
+    if (encoding == "omega_extrema") {
+        options.encoding = wheely::SymbolEncoding::omega_extrema;
+    } else if (encoding == "omega_sign_per_frame") {
+        options.encoding = wheely::SymbolEncoding::omega_sign_per_frame;
+    } else {
+        throw std::invalid_argument(
+            "encoding must be 'omega_extrema' or 'omega_sign_per_frame'");
+    }
+    options.max_block_length = max_block_length;
+    options.keep_symbols = keep_symbols;
+
+    wheely::SymbolicAnalysis analysis;
+    {
+        py::gil_scoped_release release;
+        analysis = wheely::analyze_symbolic_dynamics(cfg, options);
+    }
+
+    const auto &words = analysis.symbols.words();
+    py::array_t<std::uint64_t> packed(static_cast<py::ssize_t>(words.size()));
+    std::copy(words.begin(), words.end(), packed.mutable_data());
+
+    py::dict out;
+    out["symbols"] = packed;
+    out["symbol_count"] = analysis.symbol_count;
+    out["block_entropies"] = analysis.block_entropies;
+    out["entropy_rate"] = analysis.entropy_rate;
+    return out;
+}
+
+py::array_t<double> sample_trajectory_states_impl(const py::dict &config,
+                                                  std::size_t burn_in_frames,
+                                                  std::size_t steps_per_frame) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    std::vector<double> states;
+    {
+        py::gil_scoped_release release;
+        states = wheely::sample_trajectory_states(cfg, burn_in_frames);
+    }
+    const std::size_t state_size = cfg.n_cups + 2;
+    py::array_t<double> out({states.size() / state_size, state_size});
+    std::copy(states.begin(), states.end(), out.mutable_data());
+    return out;
+}
+
+template <typename T>
+py::array_t<T> to_numpy(const std::vector<T> &values) {
+    py::array_t<T> out(static_cast<py::ssize_t>(values.size()));
+    std::copy(values.begin(), values.end(), out.mutable_data());
+    return out;
+}
+
+py::dict transfer_operator_impl(
+    const py::dict &config,
+    py::array_t<double, py::array::c_style | py::array::forcecast>
+        initial_states,
+    const std::array<double, 3> &lower, const std::array<double, 3> &upper,
+    const std::array<std::size_t, 3> &bins, double flight_time,
+    std::size_t flight_steps, std::size_t n_threads) {
+    // steps_per_frame is replaced by flight_steps for each flight.
+    const auto cfg = make_config_from_dict(config, 1);
+    wheely::LorenzGrid grid;
+    grid.lower = lower;
+    grid.upper = upper;
+    grid.bins = bins;
+    std::vector<double> states(initial_states.data(),
+                               initial_states.data() + initial_states.size());
+
+    wheely::BatchOptions options;
+    options.n_threads = n_threads;
+    wheely::SparseTransitionCounts counts;
+    wheely::TransferAnalysis analysis;
+    {
+        py::gil_scoped_release release;
+        counts = wheely::count_transitions(cfg, grid, states, flight_time,
+                                           flight_steps, options);
+        analysis = wheely::analyze_transfer_operator(counts);
+    }
+
+    py::dict out;
+    out["row_offsets"] = to_numpy(counts.row_offsets);
+    out["columns"] = to_numpy(counts.columns);
+    out["counts"] = to_numpy(counts.counts);
+    out["outside"] = counts.outside;
+    out["invariant_density"] = to_numpy(analysis.invariant_density);
+    out["second_eigenvector"] = to_numpy(analysis.second_eigenvector);
+    out["second_eigenvalue"] = analysis.second_eigenvalue;
+    return out;
+}
+
+py::dict embed_series_impl(
+    py::array_t<double, py::array::c_style | py::array::forcecast> series,
+    std::size_t delay, std::size_t dimension, std::size_t max_lag,
+    std::size_t histogram_bins, std::size_t max_dimension,
+    double fnn_threshold, std::size_t theiler_window, std::size_t n_threads) {
+    std::vector<double> values(series.data(), series.data() + series.size());
+    wheely::EmbeddingOptions options;
+    options.delay = delay;
+    options.dimension = dimension;
+    options.max_lag = max_lag;
+    options.histogram_bins = histogram_bins;
+    options.max_dimension = max_dimension;
+    options.fnn_threshold = fnn_threshold;
+    options.false_neighbors.theiler_window = theiler_window;
+    wheely::BatchOptions batch;
+    batch.n_threads = n_threads;
+
+    wheely::EmbeddingAnalysis analysis;
+    {
+        py::gil_scoped_release release;
+        analysis = wheely::analyze_embedding(values, options, batch);
+    }
+
+    py::array_t<double> points({analysis.n_points, analysis.dimension});
+    std::copy(analysis.points.begin(), analysis.points.end(),
+              points.mutable_data());
+
+    py::dict out;
+    out["mutual_information"] = to_numpy(analysis.mutual_information);
+    out["delay"] = analysis.delay;
+    out["false_neighbor_fractions"] = to_numpy(analysis.false_neighbor_fractions);
+    out["dimension"] = analysis.dimension;
+    out["points"] = points;
+    return out;
+}
+
+py::dict adjoint_gradient_impl(const py::dict &config, const py::function &loss,
+                               std::optional<std::vector<double>> leak_rates,
+                               std::optional<std::vector<double>> initial_masses,
+                               std::size_t snapshots,
+                               std::size_t steps_per_frame) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    wheely::CupParameters cups;
+    if (leak_rates) {
+        cups.leak_rates = std::move(*leak_rates);
+    }
+    if (initial_masses) {
+        cups.initial_masses = std::move(*initial_masses);
+    }
+    wheely::AdjointOptions options;
+    options.snapshots = snapshots;
+
+    const std::size_t state_size = cfg.n_cups + 2;
+    const wheely::FrameLoss frame_loss = [&](std::size_t frame, double time,
+                                             const double *state,
+                                             double *gradient) {
+        py::gil_scoped_acquire acquire;
+        py::array_t<double> state_array(static_cast<py::ssize_t>(state_size));
+        std::copy(state, state + state_size, state_array.mutable_data());
+        const py::tuple out = loss(frame, time, state_array);
+        if (out.size() != 2) {
+            throw std::invalid_argument("loss must return (value, gradient)");
+        }
+        const auto grad = out[1].cast<
+            py::array_t<double, py::array::c_style | py::array::forcecast>>();
+        if (grad.size() != static_cast<py::ssize_t>(state_size)) {
+            throw std::invalid_argument(
+                "loss gradient must hold N_CUPS + 2 values");
+        }
+        std::copy(grad.data(), grad.data() + state_size, gradient);
+        return out[0].cast<double>();
+    };
+
+    wheely::AdjointGradient result;
+    {
+        py::gil_scoped_release release;
+        result = wheely::adjoint_gradient(cfg, cups, frame_loss, options);
+    }
+
+    py::dict out;
+    out["loss"] = result.loss;
+    out["leak_rates"] = to_numpy(result.leak_rates);
+    out["initial_masses"] = to_numpy(result.initial_masses);
+    out["omega0"] = result.omega0;
+    out["damping"] = result.damping;
+    out["inflow_rate"] = result.inflow_rate;
+    out["inertia"] = result.inertia;
+    out["forward_steps"] = result.forward_steps;
+    out["peak_snapshots"] = result.peak_snapshots;
+    return out;
+}
+
+py::dict decompose_cup_masses_impl(const py::dict &config,
+                                   std::size_t rank, std::size_t block_size,
+                                   std::size_t burn_in_frames,
+                                   std::size_t steps_per_frame) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    wheely::ModalOptions options;
+    options.rank = rank;
+    options.block_size = block_size;
+    options.burn_in_frames = burn_in_frames;
+
+    wheely::ModalDecomposition result;
+    {
+        py::gil_scoped_release release;
+        result = wheely::decompose_cup_masses(cfg, options);
+    }
+
+    py::array_t<double> modes({result.rank, result.dimension});
+    std::copy(result.modes.begin(), result.modes.end(), modes.mutable_data());
+    py::array_t<double> dmd_operator({result.rank, result.rank});
+    std::copy(result.dmd_operator.begin(), result.dmd_operator.end(),
+              dmd_operator.mutable_data());
+
+    py::dict out;
+    out["modes"] = modes;
+    out["singular_values"] = to_numpy(result.singular_values);
+    out["dmd_operator"] = dmd_operator;
+    out["dmd_eigenvalues"] = to_numpy(result.dmd_eigenvalues);
+    out["frame_count"] = result.frame_count;
+    return out;
+}
+
+py::dict sobol_indices_to_dict(const wheely::SobolIndices &indices) {
+    py::dict out;
+    out["mean"] = indices.mean;
+    out["variance"] = indices.variance;
+    out["first_order"] = to_numpy(indices.first_order);
+    out["total"] = to_numpy(indices.total);
+    out["first_order_lower"] = to_numpy(indices.first_order_lower);
+    out["first_order_upper"] = to_numpy(indices.first_order_upper);
+    out["total_lower"] = to_numpy(indices.total_lower);
+    out["total_upper"] = to_numpy(indices.total_upper);
+    return out;
+}
+
+py::dict sobol_indices_impl(const py::dict &config, const py::dict &parameters,
+                            std::size_t base_samples,
+                            std::size_t bootstrap_samples, double confidence,
+                            double burn_in_time, std::uint64_t seed,
+                            std::size_t n_threads, std::size_t steps_per_frame) {
+    static const std::array<std::pair<const char *, wheely::ConfigParameter>, 7>
+        names = {{{"RADIUS", wheely::ConfigParameter::radius},
+                  {"G", wheely::ConfigParameter::g},
+                  {"DAMPING", wheely::ConfigParameter::damping},
+                  {"LEAK_RATE", wheely::ConfigParameter::leak_rate},
+                  {"INFLOW_RATE", wheely::ConfigParameter::inflow_rate},
+                  {"INERTIA", wheely::ConfigParameter::inertia},
+                  {"OMEGA0", wheely::ConfigParameter::omega0}}};
+
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    std::vector<wheely::ParameterRange> ranges;
+    py::list order;
+    for (const auto &item : parameters) {
+        const auto name = item.first.cast<std::string>();
+        const auto found =
+            std::find_if(names.begin(), names.end(),
+                         [&](const auto &entry) { return name == entry.first; });
+        if (found == names.end()) {
+            throw std::invalid_argument("Cannot vary parameter: " + name);
+        }
+        const auto bounds = item.second.cast<std::pair<double, double>>();
+        ranges.push_back({found->second, bounds.first, bounds.second});
+        order.append(name);
+    }
+    wheely::SobolOptions options;
+    options.base_samples = base_samples;
+    options.bootstrap_samples = bootstrap_samples;
+    options.confidence = confidence;
+    options.burn_in_time = burn_in_time;
+    options.seed = seed;
+    wheely::BatchOptions batch;
+    batch.n_threads = n_threads;
+
+    wheely::SobolAnalysis analysis;
+    {
+        py::gil_scoped_release release;
+        analysis = wheely::sobol_indices(cfg, ranges, options, batch);
+    }
+
+    py::dict out;
+    out["parameters"] = order;
+    out["mean_abs_omega"] = sobol_indices_to_dict(analysis.mean_abs_omega);
+    out["reversal_rate"] = sobol_indices_to_dict(analysis.reversal_rate);
+    out["evaluations"] = analysis.evaluations;
+    return out;
+}
+
+wheely::DwellOptions make_dwell_options(
+    double inflow_noise, std::optional<std::vector<double>> initial_state,
+    std::uint64_t seed) {
+    wheely::DwellOptions dwell;
+    dwell.inflow_noise = inflow_noise;
+    if (initial_state) {
+        dwell.initial_state = std::move(*initial_state);
+    }
+    dwell.seed = seed;
+    return dwell;
+}
+
+py::array_t<double> sample_dwell_times_impl(
+    const py::dict &config, std::size_t n_runs, double inflow_noise,
+    std::optional<std::vector<double>> initial_state, std::uint64_t seed,
+    std::size_t n_threads, std::size_t steps_per_frame) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    const wheely::DwellOptions dwell =
+        make_dwell_options(inflow_noise, std::move(initial_state), seed);
+    wheely::BatchOptions batch;
+    batch.n_threads = n_threads;
+
+    std::vector<double> dwell_times;
+    {
+        py::gil_scoped_release release;
+        dwell_times = wheely::sample_dwell_times(cfg, dwell, n_runs, batch);
+    }
+    return to_numpy(dwell_times);
+}
+
+py::dict adaptive_multilevel_splitting_impl(
+    const py::dict &config, double inflow_noise,
+    std::optional<std::vector<double>> initial_state, std::size_t replicas,
+    std::size_t kill_count, std::size_t checkpoint_interval, std::uint64_t seed,
+    std::size_t n_threads, std::size_t steps_per_frame) {
+    const auto cfg = make_config_from_dict(config, steps_per_frame);
+    const wheely::DwellOptions dwell =
+        make_dwell_options(inflow_noise, std::move(initial_state), seed);
+    wheely::SplittingOptions options;
+    options.replicas = replicas;
+    options.kill_count = kill_count;
+    options.checkpoint_interval = checkpoint_interval;
+    wheely::BatchOptions batch;
+    batch.n_threads = n_threads;
+
+    wheely::SplittingResult result;
+    {
+        py::gil_scoped_release release;
+        result = wheely::adaptive_multilevel_splitting(cfg, dwell, options, batch);
+    }
+
+    py::dict out;
+    out["probability"] = result.probability;
+    out["dwell_times"] = to_numpy(result.dwell_times);
+    out["tail_probabilities"] = to_numpy(result.tail_probabilities);
+    out["iterations"] = result.iterations;
+    out["survivors"] = result.survivors;
+    out["frames_integrated"] = result.frames_integrated;
+    return out;
+}
+
+py::tuple cup_positions_impl(const std::vector<double> &theta,
+                             std::size_t n_cups, double radius) {
+    wheely::CupPositions positions;
+    {
+        py::gil_scoped_release release;
+        positions = wheely::cup_positions(theta, n_cups, radius);
+    }
+    const std::size_t n_frames = theta.size();
+
+    py::array_t<double> x_array({n_cups, n_frames});
+    std::copy(positions.x.begin(), positions.x.end(), x_array.mutable_data());
+
+    py::array_t<double> y_array({n_cups, n_frames});
+    std::copy(positions.y.begin(), positions.y.end(), y_array.mutable_data());
+
+    return py::make_tuple(x_array, y_array);
 }
 
 }  // namespace
 
-PYBIND11_MODULE(wheely_cpp, m) {
+// The module keeps no mutable state of its own and the core holds its
+// scratch per thread, so it is declared safe for free-threaded (no-GIL)
+// Python. The two objects Python can share between threads are covered
+// separately: VectorEnv serializes its calls, and SimulationConfig fields
+// go through config_mutex(). Every binding drops the GIL around the C++
+// work, which also lets threads run in parallel on regular builds.
+PYBIND11_MODULE(wheely_cpp, m, py::mod_gil_not_used()) {
     m.doc() = "Water wheel simulation powered by C++ and exposed via pybind11";
 
     m.def(
@@ -102,4 +691,681 @@ PYBIND11_MODULE(wheely_cpp, m) {
         "tuple of numpy.ndarray\n"
         "    (times, theta, masses) where times and theta are 1D arrays and\n"
         "    masses is a 2D array with shape (N_CUPS, N_FRAMES).");
+
+    m.def(
+        "simulate_delayed_feedback",
+        [](const py::dict &config, double gain, std::size_t delay_steps,
+           double max_torque, std::size_t steps_per_frame) {
+            wheely::DelayedFeedbackController controller(gain, delay_steps,
+                                                         max_torque);
+            return simulate_controlled_impl(
+                make_config_from_dict(config, steps_per_frame), controller);
+        },
+        py::arg("config"), py::arg("gain"), py::arg("delay_steps"),
+        py::arg("max_torque") = std::numeric_limits<double>::infinity(),
+        py::arg("steps_per_frame") = 4,
+        "Run the simulation under Pyragas delayed feedback on omega.\n\n"
+        "At every integration sub-step a braking torque\n"
+        "gain * (omega(t) - omega(t - delay)) is applied, where delay is\n"
+        "delay_steps sub-steps. The torque is clamped to +-max_torque.\n\n"
+        "Parameters\n"
+        "----------\n"
+        "config : dict\n"
+        "    Simulation parameters, as accepted by simulate().\n"
+        "gain : float\n"
+        "    Feedback gain.\n"
+        "delay_steps : int\n"
+        "    Delay in integration sub-steps.\n"
+        "max_torque : float, optional\n"
+        "    Largest torque magnitude applied.\n"
+        "steps_per_frame : int, optional\n"
+        "    Number of integration sub-steps to take per output frame.\n\n"
+        "Returns\n"
+        "-------\n"
+        "tuple of numpy.ndarray\n"
+        "    (times, theta, masses), as from simulate().");
+
+    m.def(
+        "simulate_ogy",
+        [](const py::dict &config, double fixed_point, double slope,
+           double sensitivity, double window, double max_perturbation,
+           std::size_t steps_per_frame) {
+            wheely::OgyParameters parameters;
+            parameters.fixed_point = fixed_point;
+            parameters.slope = slope;
+            parameters.sensitivity = sensitivity;
+            parameters.window = window;
+            parameters.max_perturbation = max_perturbation;
+            wheely::OgyController controller(parameters);
+            return simulate_controlled_impl(
+                make_config_from_dict(config, steps_per_frame), controller);
+        },
+        py::arg("config"), py::arg("fixed_point"), py::arg("slope"),
+        py::arg("sensitivity"), py::arg("window"),
+        py::arg("max_perturbation"), py::arg("steps_per_frame") = 4,
+        "Run the simulation under OGY control of the inflow rate.\n\n"
+        "The control acts on the return map of successive maxima of\n"
+        "|omega|, linearized about its fixed point xi*:\n"
+        "xi' - xi* = slope * (xi - xi*) + sensitivity * delta, where delta\n"
+        "is the change in INFLOW_RATE. At each maximum within window of\n"
+        "xi*, delta is set so that the next maximum lands on xi*, and it is\n"
+        "held until the following maximum. Corrections larger than\n"
+        "max_perturbation are skipped.\n\n"
+        "Parameters\n"
+        "----------\n"
+        "config : dict\n"
+        "    Simulation parameters, as accepted by simulate().\n"
+        "fixed_point, slope, sensitivity : float\n"
+        "    The linearized return map, e.g. fitted from uncontrolled runs.\n"
+        "window : float\n"
+        "    Largest |xi - xi*| at which control is switched on.\n"
+        "max_perturbation : float\n"
+        "    Largest |delta| applied.\n"
+        "steps_per_frame : int, optional\n"
+        "    Number of integration sub-steps to take per output frame.\n\n"
+        "Returns\n"
+        "-------\n"
+        "tuple of numpy.ndarray\n"
+        "    (times, theta, masses), as from simulate().");
+
+    py::class_<PyVectorEnv>(
+        m, "VectorEnv",
+        "Many independent wheels stepped together, Gym vector-env style.\n\n"
+        "Each step() advances every env by one output frame of the config\n"
+        "(steps_per_frame sub-steps with the action held), so an episode\n"
+        "lasts N_FRAMES - 1 steps. Envs that finish are reset within the\n"
+        "same step. Observations are rows of [theta mod 2 pi, omega,\n"
+        "masses...]. The reward is -(omega - target_omega)**2 -\n"
+        "action_cost * action**2.\n\n"
+        "The arrays returned by reset() and step() are views onto buffers\n"
+        "owned by the env. They are overwritten by the next call, so copy\n"
+        "anything you keep. Calls from several threads are serialized.")
+        .def(py::init([](const py::dict &config, std::size_t n_envs,
+                         std::size_t steps_per_frame, const std::string &action,
+                         double max_action, double target_omega,
+                         double action_cost, double omega0_spread,
+                         std::uint64_t seed, std::size_t n_threads) {
+                 wheely::VectorEnvOptions options;
+                 options.n_envs = n_envs;
+                 if (action == "brake_torque") {
+                     options.action = wheely::EnvAction::brake_torque;
+                 } else if (action == "inflow_rate") {
+                     options.action = wheely::EnvAction::inflow_rate;
+                 } else {
+                     throw std::invalid_argument(
+                         "action must be 'brake_torque' or 'inflow_rate'");
+                 }
+                 options.max_action = max_action;
+                 options.target_omega = target_omega;
+                 options.action_cost = action_cost;
+                 options.omega0_spread = omega0_spread;
+                 options.seed = seed;
+                 options.n_threads = n_threads;
+                 return std::make_unique<PyVectorEnv>(
+                     make_config_from_dict(config, steps_per_frame), options);
+             }),
+             py::arg("config"), py::arg("n_envs"),
+             py::arg("steps_per_frame") = 4,
+             py::arg("action") = "brake_torque",
+             py::arg("max_action") = std::numeric_limits<double>::infinity(),
+             py::arg("target_omega") = 0.0, py::arg("action_cost") = 0.0,
+             py::arg("omega0_spread") = 0.0, py::arg("seed") = 0,
+             py::arg("n_threads") = 0,
+             "Parameters\n"
+             "----------\n"
+             "config : dict\n"
+             "    Simulation parameters, as accepted by simulate().\n"
+             "n_envs : int\n"
+             "    Number of wheels.\n"
+             "steps_per_frame : int, optional\n"
+             "    Integration sub-steps per env step.\n"
+             "action : {'brake_torque', 'inflow_rate'}, optional\n"
+             "    What the action sets: a braking torque clamped to\n"
+             "    +-max_action, or the inflow rate clamped to\n"
+             "    [0, max_action].\n"
+             "max_action : float, optional\n"
+             "    Action bound.\n"
+             "target_omega, action_cost : float, optional\n"
+             "    Reward parameters.\n"
+             "omega0_spread : float, optional\n"
+             "    Each reset draws omega0 uniformly from OMEGA0 +- this.\n"
+             "seed : int, optional\n"
+             "    Seed of the per-env random streams.\n"
+             "n_threads : int, optional\n"
+             "    Worker threads to use; 0 uses every hardware thread.")
+        .def_property_readonly("n_envs",
+                               [](const PyVectorEnv &self) {
+                                   return self.env.n_envs();
+                               })
+        .def_property_readonly("observation_size",
+                               [](const PyVectorEnv &self) {
+                                   return self.env.observation_size();
+                               })
+        .def_property_readonly("episode_steps",
+                               [](const PyVectorEnv &self) {
+                                   return self.env.episode_steps();
+                               })
+        .def(
+            "reset",
+            [](py::object self_object, std::optional<std::uint64_t> seed) {
+                auto &self = self_object.cast<PyVectorEnv &>();
+                {
+                    py::gil_scoped_release release;
+                    if (seed) {
+                        self.env.reset(*seed);
+                    } else {
+                        self.env.reset();
+                    }
+                }
+                const auto n = static_cast<py::ssize_t>(self.env.n_envs());
+                const auto width =
+                    static_cast<py::ssize_t>(self.env.observation_size());
+                return py::make_tuple(
+                    env_view(self_object, self.env.observations(), {n, width}),
+                    py::dict());
+            },
+            py::arg("seed") = py::none(),
+            "Reset every env; returns (observations, infos).")
+        .def(
+            "step",
+            [](py::object self_object,
+               py::array_t<double, py::array::c_style | py::array::forcecast>
+                   actions) {
+                auto &self = self_object.cast<PyVectorEnv &>();
+                if (actions.size() !=
+                    static_cast<py::ssize_t>(self.env.n_envs())) {
+                    throw std::invalid_argument(
+                        "actions must hold one value per env");
+                }
+                {
+                    py::gil_scoped_release release;
+                    self.env.step(actions.data());
+                }
+                const auto n = static_cast<py::ssize_t>(self.env.n_envs());
+                const auto width =
+                    static_cast<py::ssize_t>(self.env.observation_size());
+                py::dict infos;
+                infos["final_observation"] = env_view(
+                    self_object, self.env.final_observations(), {n, width});
+                return py::make_tuple(
+                    env_view(self_object, self.env.observations(), {n, width}),
+                    env_view(self_object, self.env.rewards(), {n}),
+                    env_flags(self_object, self.terminated.data(), n),
+                    env_flags(self_object, self.env.truncated(), n), infos);
+            },
+            py::arg("actions"),
+            "Apply one action per env and advance them all.\n\n"
+            "Returns\n"
+            "-------\n"
+            "tuple\n"
+            "    (observations, rewards, terminated, truncated, infos).\n"
+            "    terminated is always False. infos['final_observation']\n"
+            "    holds, in the rows where truncated is True, the last\n"
+            "    observation before the automatic reset.");
+
+    py::class_<wheely::SimulationConfig> config_class(
+        m, "SimulationConfig",
+        "Pre-parsed simulation parameters. Fields may be set while other\n"
+        "threads run simulate_into() with the same object; each run uses\n"
+        "the values it saw when it started.");
+    config_class.def(
+        py::init([](const py::dict &config, std::size_t steps_per_frame) {
+            return make_config_from_dict(config, steps_per_frame);
+        }),
+        py::arg("config"), py::arg("steps_per_frame") = 4);
+    def_config_field(config_class, "n_cups", &wheely::SimulationConfig::n_cups);
+    def_config_field(config_class, "radius", &wheely::SimulationConfig::radius);
+    def_config_field(config_class, "g", &wheely::SimulationConfig::g);
+    def_config_field(config_class, "damping",
+                     &wheely::SimulationConfig::damping);
+    def_config_field(config_class, "leak_rate",
+                     &wheely::SimulationConfig::leak_rate);
+    def_config_field(config_class, "inflow_rate",
+                     &wheely::SimulationConfig::inflow_rate);
+    def_config_field(config_class, "inertia",
+                     &wheely::SimulationConfig::inertia);
+    def_config_field(config_class, "omega0", &wheely::SimulationConfig::omega0);
+    def_config_field(config_class, "t_start",
+                     &wheely::SimulationConfig::t_start);
+    def_config_field(config_class, "t_end", &wheely::SimulationConfig::t_end);
+    def_config_field(config_class, "n_frames",
+                     &wheely::SimulationConfig::n_frames);
+    def_config_field(config_class, "steps_per_frame",
+                     &wheely::SimulationConfig::steps_per_frame);
+
+    m.def("simulate_into", &simulate_into_impl, py::arg("config"),
+          py::arg("times").noconvert(), py::arg("theta").noconvert(),
+          py::arg("masses").noconvert(),
+          "Run a small simulation into preallocated arrays.\n\n"
+          "Low-overhead variant of simulate() for many tiny runs: the config\n"
+          "is parsed once up front and nothing is allocated per call.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : SimulationConfig\n"
+          "    Built once with SimulationConfig(config_dict, steps_per_frame).\n"
+          "times, theta : numpy.ndarray\n"
+          "    C-contiguous float64 arrays with N_FRAMES elements.\n"
+          "masses : numpy.ndarray\n"
+          "    C-contiguous float64 array of shape (N_CUPS, N_FRAMES).\n\n"
+          "Results are bit-identical to simulate(). Raises ValueError for an\n"
+          "invalid config or wrongly sized arrays.");
+
+    m.def("simulate_batch", &simulate_batch_impl, py::arg("configs"),
+          py::arg("steps_per_frame") = 4, py::arg("n_threads") = 0,
+          "Run several simulations in parallel.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "configs : list of dict\n"
+          "    One configuration dictionary per run, as accepted by simulate().\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n"
+          "n_threads : int, optional\n"
+          "    Worker threads to use; 0 uses every hardware thread.\n\n"
+          "Returns\n"
+          "-------\n"
+          "list of tuple\n"
+          "    One (times, theta, masses) tuple per config, in input order.\n"
+          "    Results are bit-identical to calling simulate() on each config\n"
+          "    in turn, whatever the thread count.");
+
+    m.def("simulate_to_file", &simulate_to_file_impl, py::arg("config"),
+          py::arg("path"), py::arg("steps_per_frame") = 4,
+          py::arg("buffer_mb") = 8, py::arg("direct_io") = false,
+          "Run a simulation and stream every frame to a binary file.\n\n"
+          "A background thread writes one buffer while the integrator fills\n"
+          "the other, so the run only slows down if the disk cannot keep up.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "path : str\n"
+          "    Output file; truncated if it exists.\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n"
+          "buffer_mb : int, optional\n"
+          "    Size of each of the two staging buffers in MiB.\n"
+          "direct_io : bool, optional\n"
+          "    Bypass the page cache with O_DIRECT where supported.\n\n"
+          "Returns\n"
+          "-------\n"
+          "int\n"
+          "    Bytes written. Each frame is N_CUPS + 2 float64 values\n"
+          "    [time, theta, masses...]; load with\n"
+          "    numpy.fromfile(path).reshape(-1, N_CUPS + 2).");
+
+    m.def("simulate_lab_bins", &simulate_lab_bins_impl, py::arg("config"),
+          py::arg("n_bins"), py::arg("steps_per_frame") = 4,
+          "Run a simulation and bin the cup masses by lab-frame angle.\n\n"
+          "The binning happens inside the frame loop, so per-cup masses are\n"
+          "never stored and memory use does not depend on N_CUPS.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "n_bins : int\n"
+          "    Number of equal angular bins. Bin 0 is centred on the top of\n"
+          "    the wheel (the inflow); the rest follow in the direction of\n"
+          "    increasing theta.\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n\n"
+          "Returns\n"
+          "-------\n"
+          "tuple of numpy.ndarray\n"
+          "    (times, theta, bins) where bins has shape (n_bins, N_FRAMES)\n"
+          "    and holds the total water mass in each bin, ready for a\n"
+          "    space-time heatmap.");
+
+    m.attr("EVENT_OMEGA_REVERSAL") =
+        static_cast<int>(wheely::EventKind::omega_reversal);
+    m.attr("EVENT_OMEGA_MAXIMUM") =
+        static_cast<int>(wheely::EventKind::omega_maximum);
+    m.attr("EVENT_OMEGA_MINIMUM") =
+        static_cast<int>(wheely::EventKind::omega_minimum);
+    m.attr("EVENT_INFLOW_ENTRY") =
+        static_cast<int>(wheely::EventKind::inflow_entry);
+    m.attr("EVENT_INFLOW_EXIT") = static_cast<int>(wheely::EventKind::inflow_exit);
+
+    m.def("simulate_events", &simulate_events_impl, py::arg("config"),
+          py::arg("steps_per_frame") = 4, py::arg("reversals") = true,
+          py::arg("maxima") = true, py::arg("minima") = false,
+          py::arg("inflow") = true,
+          "Run a simulation and record discrete events instead of frames.\n\n"
+          "Every RK4 step is checked, and each event is timed on the cubic\n"
+          "Hermite interpolant through the step's end points, so its time\n"
+          "falls inside the step rather than on a step boundary. No frames\n"
+          "are stored: N_FRAMES only sets the number of steps,\n"
+          "(N_FRAMES - 1) * steps_per_frame.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps per frame interval.\n"
+          "reversals, maxima, minima, inflow : bool, optional\n"
+          "    Record sign changes of omega, local maxima and minima of omega\n"
+          "    and cups entering or leaving the inflow window.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict of numpy.ndarray\n"
+          "    Equal-length arrays time, theta, omega, cup, kind and\n"
+          "    direction, in time order. kind is one of the EVENT_*\n"
+          "    constants. direction is the new sign of omega for reversals\n"
+          "    and the sign of omega otherwise; cup is set for inflow events.\n"
+          "    For example, events['direction'][events['kind'] ==\n"
+          "    EVENT_OMEGA_REVERSAL] is the reversal sequence.");
+
+    m.def("analyze_symbolic_dynamics", &analyze_symbolic_impl,
+          py::arg("config"), py::arg("steps_per_frame") = 4,
+          py::arg("encoding") = "omega_extrema",
+          py::arg("max_block_length") = 12, py::arg("keep_symbols") = true,
+          "Encode a run as a binary symbol sequence and estimate its entropy.\n\n"
+          "Symbols are produced and counted while the simulation runs; the\n"
+          "trajectory is never stored.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n"
+          "encoding : str, optional\n"
+          "    'omega_extrema' emits one symbol per swing: 1 at each maximum\n"
+          "    of omega while it is positive, 0 at each minimum while it is\n"
+          "    negative (the Lorenz lobe sequence). 'omega_sign_per_frame'\n"
+          "    emits the sign of omega at every frame.\n"
+          "max_block_length : int, optional\n"
+          "    Longest word length L to count, at most 64.\n"
+          "keep_symbols : bool, optional\n"
+          "    Return the packed symbol string as well as the statistics.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    symbols: uint64 array of packed symbols, least significant bit\n"
+          "    first (numpy.unpackbits(symbols.view(numpy.uint8),\n"
+          "    bitorder='little')[:symbol_count] unpacks them on little-endian\n"
+          "    hosts); symbol_count; block_entropies: H_1..H_L in bits;\n"
+          "    entropy_rate: H_L - H_(L-1) in bits per symbol.");
+
+    m.def("sample_trajectory_states", &sample_trajectory_states_impl,
+          py::arg("config"), py::arg("burn_in_frames"),
+          py::arg("steps_per_frame") = 4,
+          "Full wheel states [theta, omega, masses...] of every frame from\n"
+          "burn_in_frames on, as an array of shape (frames, N_CUPS + 2).\n"
+          "Meant as seeds on the attractor for transfer_operator().");
+
+    m.def("transfer_operator", &transfer_operator_impl, py::arg("config"),
+          py::arg("initial_states"), py::arg("lower"), py::arg("upper"),
+          py::arg("bins"), py::arg("flight_time"), py::arg("flight_steps"),
+          py::arg("n_threads") = 0,
+          "Estimate the Ulam transfer operator on a grid in Lorenz coordinates.\n\n"
+          "Every initial state is integrated for flight_time in parallel,\n"
+          "and the grid cells of its start and end are counted as one\n"
+          "transition. The cells are a regular grid over the box\n"
+          "lower..upper in (omega, y, z), where y and z are the first\n"
+          "Fourier moments of the mass distribution about the top. Cells\n"
+          "are numbered (i_omega * bins[1] + i_y) * bins[2] + i_z.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Physical parameters, as accepted by simulate(). The time\n"
+          "    and frame keys are required but ignored.\n"
+          "initial_states : numpy.ndarray\n"
+          "    Array of shape (n, N_CUPS + 2), e.g. from\n"
+          "    sample_trajectory_states().\n"
+          "lower, upper : sequence of 3 float\n"
+          "    Corners of the grid box.\n"
+          "bins : sequence of 3 int\n"
+          "    Cells along omega, y and z.\n"
+          "flight_time : float\n"
+          "    Length of each trajectory.\n"
+          "flight_steps : int\n"
+          "    RK4 steps per trajectory.\n"
+          "n_threads : int, optional\n"
+          "    Worker threads to use; 0 uses every hardware thread.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    row_offsets, columns, counts: the count matrix in CSR form,\n"
+          "    ready for scipy.sparse.csr_matrix((counts, columns,\n"
+          "    row_offsets)); outside: trajectories that started or ended\n"
+          "    off the grid; invariant_density; second_eigenvector and\n"
+          "    second_eigenvalue of the chain reversibilized with respect to\n"
+          "    the invariant density. The sign of second_eigenvector splits\n"
+          "    the cells into two almost-invariant sets.");
+
+    m.def("embed_series", &embed_series_impl, py::arg("series"),
+          py::arg("delay") = 0, py::arg("dimension") = 0,
+          py::arg("max_lag") = 200, py::arg("histogram_bins") = 32,
+          py::arg("max_dimension") = 10, py::arg("fnn_threshold") = 0.01,
+          py::arg("theiler_window") = 0, py::arg("n_threads") = 0,
+          "Delay-embed a scalar series, choosing delay and dimension.\n\n"
+          "The delay is the first minimum of the average mutual information\n"
+          "between x[t] and x[t + lag]. The dimension is the smallest one\n"
+          "whose fraction of false nearest neighbours (Kennel's criteria,\n"
+          "found with a kd-tree) is at most fnn_threshold. The series should\n"
+          "be stationary: for an angle sensor pass np.gradient(theta, dt)\n"
+          "rather than theta.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "series : numpy.ndarray\n"
+          "    One-dimensional series of evenly spaced samples.\n"
+          "delay : int, optional\n"
+          "    Delay in samples; 0 chooses it from the mutual information.\n"
+          "dimension : int, optional\n"
+          "    Embedding dimension; 0 chooses it by false nearest neighbours.\n"
+          "max_lag : int, optional\n"
+          "    Largest lag of the mutual information.\n"
+          "histogram_bins : int, optional\n"
+          "    Bins per axis of the mutual-information histograms.\n"
+          "max_dimension : int, optional\n"
+          "    Largest dimension tested.\n"
+          "fnn_threshold : float, optional\n"
+          "    False-neighbour fraction accepted as unfolded.\n"
+          "theiler_window : int, optional\n"
+          "    Neighbours closer than this in time are skipped; 0 uses the\n"
+          "    delay.\n"
+          "n_threads : int, optional\n"
+          "    Worker threads to use; 0 uses every hardware thread.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    mutual_information (by lag, empty if delay was given); delay;\n"
+          "    false_neighbor_fractions (element m - 1 for dimension m, empty\n"
+          "    if dimension was given); dimension; points, the\n"
+          "    (n_points, dimension) delay vectors.");
+
+    m.def("adjoint_gradient", &adjoint_gradient_impl, py::arg("config"),
+          py::arg("loss"), py::arg("leak_rates") = py::none(),
+          py::arg("initial_masses") = py::none(), py::arg("snapshots") = 0,
+          py::arg("steps_per_frame") = 4,
+          "Gradient of a trajectory loss by the discrete RK4 adjoint.\n\n"
+          "The loss is a sum of per-frame terms. The gradient covers every\n"
+          "per-cup leak rate and initial mass at the cost of a few forward\n"
+          "runs, storing only O(log steps) states thanks to binomial\n"
+          "checkpointing. The inflow window is a step function of theta,\n"
+          "so its derivative is taken as zero.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "loss : callable\n"
+          "    loss(frame, time, state) -> (value, gradient), with state and\n"
+          "    gradient arrays of [theta, omega, masses...]. Called once per\n"
+          "    frame in reverse time order.\n"
+          "leak_rates, initial_masses : sequence of float, optional\n"
+          "    Per-cup values; by default LEAK_RATE and empty cups.\n"
+          "snapshots : int, optional\n"
+          "    States held at once; 0 uses 4 * ceil(log2(steps)).\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    loss; gradients leak_rates, initial_masses (arrays), omega0,\n"
+          "    damping, inflow_rate, inertia; forward_steps and\n"
+          "    peak_snapshots, describing the cost.");
+
+    m.def("decompose_cup_masses", &decompose_cup_masses_impl,
+          py::arg("config"), py::arg("rank") = 16, py::arg("block_size") = 0,
+          py::arg("burn_in_frames") = 0, py::arg("steps_per_frame") = 4,
+          "Streaming POD and DMD of the cup masses.\n\n"
+          "Frames are folded into a rank-truncated incremental SVD as the\n"
+          "simulation runs, so the (N_CUPS, N_FRAMES) masses matrix is never\n"
+          "stored. Each update discards the energy beyond `rank`, so ask\n"
+          "for a few more modes than you need.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "rank : int, optional\n"
+          "    Number of modes to keep.\n"
+          "block_size : int, optional\n"
+          "    Frames per basis update; 0 uses rank.\n"
+          "burn_in_frames : int, optional\n"
+          "    Leading frames to skip.\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    modes: (rank, N_CUPS) orthonormal POD modes; singular_values;\n"
+          "    dmd_operator: (rank, rank) operator A with a[k+1] ~ A a[k]\n"
+          "    for the mode coefficients a = modes @ masses[:, k];\n"
+          "    dmd_eigenvalues: complex per-frame multipliers of A (the DMD\n"
+          "    modes are modes.T @ eigenvectors of A); frame_count.");
+
+    m.def("sobol_indices", &sobol_indices_impl, py::arg("config"),
+          py::arg("parameters"), py::arg("base_samples") = 1024,
+          py::arg("bootstrap_samples") = 200, py::arg("confidence") = 0.95,
+          py::arg("burn_in_time") = 0.0, py::arg("seed") = 0,
+          py::arg("n_threads") = 0, py::arg("steps_per_frame") = 4,
+          "Global (Sobol) sensitivity of the long-run behaviour.\n\n"
+          "Draws Saltelli's A and B sample matrices and runs the\n"
+          "base_samples * (d + 2) simulations in parallel, keeping only the\n"
+          "mean |omega| and the reversal rate of each. First-order indices\n"
+          "use Saltelli's (2010) estimator and total indices Jansen's, with\n"
+          "bootstrap percentile intervals.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate(); they fix\n"
+          "    everything that is not varied.\n"
+          "parameters : dict\n"
+          "    Maps config keys (RADIUS, G, DAMPING, LEAK_RATE, INFLOW_RATE,\n"
+          "    INERTIA, OMEGA0) to (lower, upper) bounds of a uniform range.\n"
+          "base_samples : int, optional\n"
+          "    Rows N of each sample matrix.\n"
+          "bootstrap_samples : int, optional\n"
+          "    Resamplings for the intervals; 0 skips them.\n"
+          "confidence : float, optional\n"
+          "    Coverage of the intervals.\n"
+          "burn_in_time : float, optional\n"
+          "    Time after T_START that the statistics ignore.\n"
+          "seed : int, optional\n"
+          "    Seed of the sample matrices and the bootstrap.\n"
+          "n_threads : int, optional\n"
+          "    Worker threads to use; 0 uses every hardware thread.\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    parameters, the varied keys in order; mean_abs_omega and\n"
+          "    reversal_rate, each a dict of mean, variance and per-parameter\n"
+          "    arrays first_order, total, first_order_lower,\n"
+          "    first_order_upper, total_lower, total_upper; evaluations.");
+
+    m.def("sample_dwell_times", &sample_dwell_times_impl, py::arg("config"),
+          py::arg("n_runs"), py::arg("inflow_noise") = 0.1,
+          py::arg("initial_state") = py::none(), py::arg("seed") = 0,
+          py::arg("n_threads") = 0, py::arg("steps_per_frame") = 4,
+          "Brute-force dwell times of independent noisy runs.\n\n"
+          "Each run feeds the wheel an inflow of INFLOW_RATE * (1 +\n"
+          "inflow_noise * xi), xi standard normal and redrawn every frame,\n"
+          "and stops at the first frame where omega has the opposite sign to\n"
+          "the initial omega. The reference for\n"
+          "adaptive_multilevel_splitting().\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate(). T_END caps\n"
+          "    the dwell.\n"
+          "n_runs : int\n"
+          "    Number of runs.\n"
+          "inflow_noise : float, optional\n"
+          "    Relative standard deviation of the inflow, redrawn every\n"
+          "    frame.\n"
+          "initial_state : sequence of float, optional\n"
+          "    [theta, omega, masses...] at T_START; by default simulate()'s.\n"
+          "    The dwell is in the direction of its omega.\n"
+          "seed : int, optional\n"
+          "    Seed of the noise.\n"
+          "n_threads : int, optional\n"
+          "    Worker threads to use; 0 uses every hardware thread.\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n\n"
+          "Returns\n"
+          "-------\n"
+          "numpy.ndarray\n"
+          "    Dwell time of each run, in whole frames, at most\n"
+          "    T_END - T_START.");
+
+    m.def("adaptive_multilevel_splitting", &adaptive_multilevel_splitting_impl,
+          py::arg("config"), py::arg("inflow_noise") = 0.1,
+          py::arg("initial_state") = py::none(), py::arg("replicas") = 200,
+          py::arg("kill_count") = 20, py::arg("checkpoint_interval") = 16,
+          py::arg("seed") = 0, py::arg("n_threads") = 0,
+          py::arg("steps_per_frame") = 4,
+          "Probability of an unbroken dwell up to T_END, by splitting.\n\n"
+          "Adaptive multilevel splitting with the dwell so far as the score:\n"
+          "each iteration discards the replicas that reversed earliest and\n"
+          "replaces them with clones of survivors, which go on with noise of\n"
+          "their own. Tails far too thin for sample_dwell_times() stay within\n"
+          "reach, at a cost growing like log(1 / probability).\n\n"
+          "Parameters\n"
+          "----------\n"
+          "config : dict\n"
+          "    Simulation parameters, as accepted by simulate().\n"
+          "inflow_noise : float, optional\n"
+          "    Relative standard deviation of the inflow, redrawn every\n"
+          "    frame.\n"
+          "initial_state : sequence of float, optional\n"
+          "    [theta, omega, masses...] at T_START; by default simulate()'s.\n"
+          "    The dwell is in the direction of its omega.\n"
+          "replicas : int, optional\n"
+          "    Trajectories kept alive at once.\n"
+          "kill_count : int, optional\n"
+          "    Replicas discarded and cloned in parallel per iteration.\n"
+          "checkpoint_interval : int, optional\n"
+          "    Frames between the saved states clones start from.\n"
+          "seed : int, optional\n"
+          "    Seed of the noise and of the cloning.\n"
+          "n_threads : int, optional\n"
+          "    Worker threads to use; 0 uses every hardware thread.\n"
+          "steps_per_frame : int, optional\n"
+          "    Number of integration sub-steps to take per output frame.\n\n"
+          "Returns\n"
+          "-------\n"
+          "dict\n"
+          "    probability; dwell_times and tail_probabilities, the estimated\n"
+          "    probability of a dwell of at least each time; iterations;\n"
+          "    survivors, replicas that reached T_END (0 if the population\n"
+          "    died out); frames_integrated, the cost.");
+
+    m.def("cup_positions", &cup_positions_impl, py::arg("theta"),
+          py::arg("n_cups"), py::arg("radius"),
+          "Compute cup centres for a sequence of wheel angles.\n\n"
+          "Parameters\n"
+          "----------\n"
+          "theta : array_like\n"
+          "    Wheel angle for each frame, e.g. the theta returned by\n"
+          "    simulate().\n"
+          "n_cups : int\n"
+          "    Number of equally spaced cups.\n"
+          "radius : float\n"
+          "    Wheel radius.\n\n"
+          "Returns\n"
+          "-------\n"
+          "tuple of numpy.ndarray\n"
+          "    (x, y), each with shape (n_cups, len(theta)). Accurate to\n"
+          "    about 1e-7 * radius, which is plenty for plotting.");
 }
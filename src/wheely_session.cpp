@@ -0,0 +1,94 @@
+#include "wheely_session.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace wheely {
+
+SimulationSession::SimulationSession(const SimulationConfig &cfg,
+                                     std::size_t checkpoint_interval)
+    : cfg_(cfg), checkpoint_interval_(checkpoint_interval) {
+    if (checkpoint_interval_ < 1) {
+        throw std::invalid_argument("checkpoint_interval must be positive");
+    }
+
+    SimulationCheckpoint cursor = initial_checkpoint(cfg_);
+    std::vector<double> scratch;
+    const double frame_dt =
+        (cfg_.t_end - cfg_.t_start) / static_cast<double>(cfg_.n_frames - 1);
+    const double sub_dt =
+        frame_dt / static_cast<double>(cfg_.steps_per_frame);
+
+    times_.resize(cfg_.n_frames);
+    theta_.resize(cfg_.n_frames);
+    checkpoints_.reserve((cfg_.n_frames + checkpoint_interval_ - 1) /
+                         checkpoint_interval_);
+
+    mass_min_ = std::numeric_limits<double>::infinity();
+    mass_max_ = -std::numeric_limits<double>::infinity();
+    double current_time = cfg_.t_start;
+    for (std::size_t frame = 0; frame < cfg_.n_frames; ++frame) {
+        if (frame % checkpoint_interval_ == 0) {
+            checkpoints_.push_back(cursor);
+        }
+        times_[frame] = current_time;
+        theta_[frame] = cursor.state[0];
+        const auto masses_begin = cursor.state.begin() + 2;
+        const auto bounds = std::minmax_element(masses_begin, cursor.state.end());
+        mass_min_ = std::min(mass_min_, *bounds.first);
+        mass_max_ = std::max(mass_max_, *bounds.second);
+
+        if (frame + 1 < cfg_.n_frames) {
+            advance_frames(cfg_, cursor, 1, scratch);
+            for (std::size_t step = 0; step < cfg_.steps_per_frame; ++step) {
+                current_time += sub_dt;
+            }
+        }
+    }
+}
+
+SimulationResult SimulationSession::frames(std::size_t first,
+                                           std::size_t count) const {
+    SimulationResult result;
+    if (first >= frame_count()) {
+        return result;
+    }
+    count = std::min(count, frame_count() - first);
+
+    SimulationCheckpoint cursor = checkpoints_[first / checkpoint_interval_];
+    std::vector<double> scratch;
+    advance_frames(cfg_, cursor, first - cursor.frame, scratch);
+
+    result.times.assign(times_.begin() + first, times_.begin() + first + count);
+    result.theta.assign(theta_.begin() + first, theta_.begin() + first + count);
+    result.masses.assign(cfg_.n_cups * count, 0.0);
+    for (std::size_t offset = 0; offset < count; ++offset) {
+        if (offset > 0) {
+            advance_frames(cfg_, cursor, 1, scratch);
+        }
+        for (std::size_t cup = 0; cup < cfg_.n_cups; ++cup) {
+            result.masses[cup * count + offset] = cursor.state[2 + cup];
+        }
+    }
+
+    return result;
+}
+
+double estimate_session_bytes(const SimulationConfig &cfg,
+                              std::size_t checkpoint_interval) {
+    if (checkpoint_interval < 1) {
+        throw std::invalid_argument("checkpoint_interval must be positive");
+    }
+    const double frames = static_cast<double>(cfg.n_frames);
+    const double checkpoints = std::ceil(
+        frames / static_cast<double>(checkpoint_interval));
+    const double state_bytes =
+        static_cast<double>((cfg.n_cups + 2) * sizeof(double));
+    return 2.0 * frames * sizeof(double) +
+           checkpoints * (state_bytes + sizeof(SimulationCheckpoint));
+}
+
+}  // namespace wheely
+
@@ -0,0 +1,63 @@
+#ifndef WHEELY_SESSION_H
+#define WHEELY_SESSION_H
+
+#include "wheely_decimate.h"
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace wheely {
+
+// A completed run that keeps only times, theta and periodic checkpoints of
+// the full state. Cup masses for any frame range are recomputed on demand
+// from the nearest preceding checkpoint, so memory stays bounded by
+// n_frames / checkpoint_interval states instead of n_cups * n_frames.
+class SimulationSession {
+public:
+    SimulationSession(const SimulationConfig &cfg,
+                      std::size_t checkpoint_interval);
+
+    std::size_t frame_count() const { return times_.size(); }
+    std::size_t checkpoint_interval() const { return checkpoint_interval_; }
+    // Time span of the run. Frame i sits at t_start + i * (t_end - t_start)
+    // / (frame_count - 1), up to rounding, so callers that only need frame
+    // times for labels do not have to copy times().
+    double t_start() const { return cfg_.t_start; }
+    double t_end() const { return cfg_.t_end; }
+    const std::vector<double> &times() const { return times_; }
+    const std::vector<double> &theta() const { return theta_; }
+    double mass_min() const { return mass_min_; }
+    double mass_max() const { return mass_max_; }
+
+    // Returns frames [first, first + count) clamped to the run length. The
+    // masses of the slice are cup-major, matching simulate().
+    SimulationResult frames(std::size_t first, std::size_t count) const;
+
+    // Min/max decimation of theta(t) over [t_min, t_max] for a plot that is
+    // pixel_width pixels wide; see decimate_min_max().
+    DecimatedSeries theta_decimated(double t_min, double t_max,
+                                    std::size_t pixel_width) const {
+        return decimate_min_max(times_, theta_, t_min, t_max, pixel_width);
+    }
+
+private:
+    SimulationConfig cfg_;
+    std::size_t checkpoint_interval_;
+    std::vector<double> times_;
+    std::vector<double> theta_;
+    std::vector<SimulationCheckpoint> checkpoints_;
+    double mass_min_ = 0.0;
+    double mass_max_ = 0.0;
+};
+
+// Approximate bytes a SimulationSession for cfg holds once constructed:
+// times, theta and the checkpoints. Returned as a double so estimates
+// beyond 4 GiB survive a 32-bit size_t (wasm32), where callers use it to
+// decide between the wasm32 and memory64 builds.
+double estimate_session_bytes(const SimulationConfig &cfg,
+                              std::size_t checkpoint_interval);
+
+}  // namespace wheely
+
+#endif  // WHEELY_SESSION_H
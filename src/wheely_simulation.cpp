@@ -1,132 +1,756 @@
 #include "wheely_simulation.h"
 
+#include "wheely_control.h"
+#include "wheely_math.h"
+
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
 #include <stdexcept>
 
 namespace wheely {
 namespace {
 
-constexpr double PI = 3.14159265358979323846;
-constexpr double TWO_PI = 2.0 * PI;
+// The torque sum is split across a fixed number of partial accumulators that
+// are combined in a fixed tree. The summation order therefore depends only on
+// n_cups, never on the compiler's vector width or on how runs are scheduled
+// across threads, while still giving the compiler independent chains to
+// pipeline.
+constexpr std::size_t TORQUE_LANES = 4;
 
-void validate_config(const SimulationConfig &cfg) {
-    if (cfg.n_cups < 1) {
-        throw std::invalid_argument("n_cups must be positive");
-    }
-    if (cfg.n_frames < 2) {
-        throw std::invalid_argument("n_frames must be at least 2");
-    }
-    if (cfg.t_end <= cfg.t_start) {
-        throw std::invalid_argument("t_end must be greater than t_start");
-    }
-    if (cfg.steps_per_frame < 1) {
-        throw std::invalid_argument("steps_per_frame must be positive");
-    }
-}
+// k1..k4 and the stage input, each state-sized, laid out back to back.
+constexpr std::size_t RK4_SCRATCH_VECTORS = 5;
+
+// Per-run RK4 scratch. Each run owns one, so concurrent runs never share
+// intermediate buffers.
+struct Rk4Workspace {
+    explicit Rk4Workspace(std::size_t size)
+        : scratch(RK4_SCRATCH_VECTORS * size) {}
+
+    std::vector<double> scratch;
+};
 
-std::vector<double> compute_derivatives(const std::vector<double> &state,
-                                        const SimulationConfig &cfg) {
-    std::vector<double> derivatives(state.size());
+void compute_derivatives(const double *state, double *derivatives,
+                         const SimulationConfig &cfg) {
     const double theta = state[0];
     const double omega = state[1];
+    const double *masses = state + 2;
     const double cup_angle_step =
         TWO_PI / static_cast<double>(cfg.n_cups);  // equal spacing
 
-    double torque = 0.0;
-    for (std::size_t i = 0; i < cfg.n_cups; ++i) {
+    double lanes[TORQUE_LANES] = {0.0, 0.0, 0.0, 0.0};
+    std::size_t i = 0;
+    for (; i + TORQUE_LANES <= cfg.n_cups; i += TORQUE_LANES) {
+        for (std::size_t lane = 0; lane < TORQUE_LANES; ++lane) {
+            const double angle =
+                theta + cup_angle_step * static_cast<double>(i + lane);
+            lanes[lane] += masses[i + lane] * wheely::sin(angle);
+        }
+    }
+    for (std::size_t lane = 0; i < cfg.n_cups; ++i, ++lane) {
         const double angle = theta + cup_angle_step * static_cast<double>(i);
-        const double mass = state[2 + i];
-        torque += mass * cfg.g * cfg.radius * std::sin(angle);
+        lanes[lane] += masses[i] * wheely::sin(angle);
     }
+    const double torque =
+        cfg.g * cfg.radius * ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
 
     derivatives[0] = omega;
     derivatives[1] = (-cfg.damping * omega + torque) / cfg.inertia;
 
-    for (std::size_t i = 0; i < cfg.n_cups; ++i) {
-        const double angle = theta + cup_angle_step * static_cast<double>(i);
-        double phi = std::fmod(angle, TWO_PI);
-        if (phi < 0.0) {
-            phi += TWO_PI;
-        }
-        const double mass = state[2 + i];
-        if (phi < 0.1 || phi > TWO_PI - 0.1) {
-            derivatives[2 + i] = cfg.inflow_rate - cfg.leak_rate * mass;
+    for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+        const double angle =
+            theta + cup_angle_step * static_cast<double>(cup);
+        const double mass = masses[cup];
+        if (near_zero_mod_two_pi(angle, INFLOW_HALF_WIDTH)) {
+            derivatives[2 + cup] = cfg.inflow_rate - cfg.leak_rate * mass;
         } else {
-            derivatives[2 + i] = -cfg.leak_rate * mass;
+            derivatives[2 + cup] = -cfg.leak_rate * mass;
         }
     }
+}
+
+// sin/cos of every cup offset 2*pi*i/N, generated at compile time for the
+// cup counts that get a specialized kernel.
+template <std::size_t N>
+struct CupTable {
+    alignas(64) double sin_offset[N];
+    alignas(64) double cos_offset[N];
+};
 
-    return derivatives;
+template <std::size_t N>
+constexpr CupTable<N> make_cup_table() {
+    CupTable<N> table{};
+    for (std::size_t i = 0; i < N; ++i) {
+        sincos_turn_fraction(i, N, table.sin_offset[i], table.cos_offset[i]);
+    }
+    return table;
 }
 
-void rk4_step(std::vector<double> &state, double dt,
-              const SimulationConfig &cfg) {
-    const std::size_t size = state.size();
+template <std::size_t N>
+constexpr CupTable<N> CUP_TABLE = make_cup_table<N>();
+
+// compute_derivatives() for a cup count known at compile time. The torque
+// uses sin(theta + a_i) = sin(theta) cos(a_i) + cos(theta) sin(a_i), so each
+// evaluation needs one sincos instead of N sines, and the inflow window is
+// located directly in units of cup spacing instead of testing every cup.
+template <std::size_t N>
+void compute_derivatives_fixed(const double *state, double *derivatives,
+                               const SimulationConfig &cfg) {
+    constexpr const CupTable<N> &table = CUP_TABLE<N>;
+
+    const double theta = state[0];
+    const double omega = state[1];
+    const double *masses = state + 2;
+
+    double cos_lanes[TORQUE_LANES] = {0.0, 0.0, 0.0, 0.0};
+    double sin_lanes[TORQUE_LANES] = {0.0, 0.0, 0.0, 0.0};
+    std::size_t i = 0;
+    for (; i + TORQUE_LANES <= N; i += TORQUE_LANES) {
+        for (std::size_t lane = 0; lane < TORQUE_LANES; ++lane) {
+            cos_lanes[lane] += masses[i + lane] * table.cos_offset[i + lane];
+            sin_lanes[lane] += masses[i + lane] * table.sin_offset[i + lane];
+        }
+    }
+    for (std::size_t lane = 0; lane < N % TORQUE_LANES; ++lane) {
+        cos_lanes[lane] += masses[i + lane] * table.cos_offset[i + lane];
+        sin_lanes[lane] += masses[i + lane] * table.sin_offset[i + lane];
+    }
+    double sin_theta = 0.0;
+    double cos_theta = 0.0;
+    sincos(theta, sin_theta, cos_theta);
+    const double mass_cos =
+        (cos_lanes[0] + cos_lanes[1]) + (cos_lanes[2] + cos_lanes[3]);
+    const double mass_sin =
+        (sin_lanes[0] + sin_lanes[1]) + (sin_lanes[2] + sin_lanes[3]);
+    const double torque =
+        cfg.g * cfg.radius * (sin_theta * mass_cos + cos_theta * mass_sin);
+
+    derivatives[0] = omega;
+    derivatives[1] = (-cfg.damping * omega + torque) / cfg.inertia;
+
+    for (std::size_t cup = 0; cup < N; ++cup) {
+        derivatives[2 + cup] = -cfg.leak_rate * masses[cup];
+    }
+
+    for_each_inflow_cup(theta, N, [&](std::size_t cup) {
+        derivatives[2 + cup] += cfg.inflow_rate;
+    });
+}
+
+// One RK4 step on `size` doubles at `state`, using RK4_SCRATCH_VECTORS *
+// size doubles of scratch. Touches no other memory and cannot throw.
+// `derivatives` is a DerivativeKernel or a callable with its signature.
+template <typename Derivatives>
+void rk4_step(double *state, std::size_t size, double dt,
+              const SimulationConfig &cfg, const Derivatives &derivatives,
+              double *scratch) noexcept {
     const double half_dt = dt * 0.5;
     const double sixth_dt = dt / 6.0;
+    double *k1 = scratch;
+    double *k2 = k1 + size;
+    double *k3 = k2 + size;
+    double *k4 = k3 + size;
+    double *temp = k4 + size;
 
-    const auto k1 = compute_derivatives(state, cfg);
+    derivatives(state, k1, cfg);
 
-    std::vector<double> temp(size);
     for (std::size_t i = 0; i < size; ++i) {
         temp[i] = state[i] + half_dt * k1[i];
     }
-    const auto k2 = compute_derivatives(temp, cfg);
+    derivatives(temp, k2, cfg);
 
     for (std::size_t i = 0; i < size; ++i) {
         temp[i] = state[i] + half_dt * k2[i];
     }
-    const auto k3 = compute_derivatives(temp, cfg);
+    derivatives(temp, k3, cfg);
 
     for (std::size_t i = 0; i < size; ++i) {
         temp[i] = state[i] + dt * k3[i];
     }
-    const auto k4 = compute_derivatives(temp, cfg);
+    derivatives(temp, k4, cfg);
 
     for (std::size_t i = 0; i < size; ++i) {
         state[i] += sixth_dt * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
     }
 }
 
-}  // namespace
+void rk4_step(std::vector<double> &state, double dt,
+              const SimulationConfig &cfg, Rk4Workspace &work) {
+    rk4_step(state.data(), state.size(), dt, cfg,
+             derivative_kernel(cfg.n_cups), work.scratch.data());
+}
 
-SimulationResult simulate(const SimulationConfig &cfg) {
-    validate_config(cfg);
+double substep_dt(const SimulationConfig &cfg) noexcept {
+    const double total_time = cfg.t_end - cfg.t_start;
+    const double frame_dt =
+        total_time / static_cast<double>(cfg.n_frames - 1);
+    return frame_dt / static_cast<double>(cfg.steps_per_frame);
+}
 
+template <typename Container>
+void fnv1a_doubles(std::uint64_t &hash, const Container &values) {
+    for (double value : values) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        // Hash the bytes least-significant first so the result does not
+        // depend on host endianness.
+        for (int byte = 0; byte < 8; ++byte) {
+            hash ^= (bits >> (8 * byte)) & 0xffu;
+            hash *= 0x100000001b3ull;
+        }
+    }
+}
+
+// The frame loop of simulate(), writing into caller buffers. `work` holds
+// the state followed by the RK4 scratch.
+void integrate_into(const SimulationConfig &cfg, double *work, double *times,
+                    double *theta, double *masses) noexcept {
     const std::size_t state_size = cfg.n_cups + 2;
-    std::vector<double> state(state_size, 0.0);
+    double *state = work;
+    double *scratch = work + state_size;
+    std::fill(state, state + state_size, 0.0);
     state[1] = cfg.omega0;
 
-    const double total_time = cfg.t_end - cfg.t_start;
-    const double frame_dt =
-        total_time / static_cast<double>(cfg.n_frames - 1);
-    const double sub_dt = frame_dt / static_cast<double>(cfg.steps_per_frame);
+    const double sub_dt = substep_dt(cfg);
+    const DerivativeKernel derivatives = derivative_kernel(cfg.n_cups);
+
+    double current_time = cfg.t_start;
+    for (std::size_t frame = 0; frame < cfg.n_frames; ++frame) {
+        times[frame] = current_time;
+        theta[frame] = state[0];
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            masses[cup * cfg.n_frames + frame] = state[2 + cup];
+        }
+
+        if (frame + 1 == cfg.n_frames) {
+            break;
+        }
+
+        for (std::size_t step = 0; step < cfg.steps_per_frame; ++step) {
+            rk4_step(state, state_size, sub_dt, cfg, derivatives, scratch);
+            current_time += sub_dt;
+        }
+    }
+}
+
+// Integrator scratch for runs above SMALL_RUN_MAX_CUPS. Each thread keeps
+// its own, so concurrent callers never share it, and it only grows, so
+// repeat runs on a thread allocate nothing. Returns nullptr if growing fails.
+double *thread_scratch(std::size_t size) noexcept {
+    thread_local std::unique_ptr<double[]> scratch;
+    thread_local std::size_t capacity = 0;
+    if (capacity < size) {
+        std::unique_ptr<double[]> grown(new (std::nothrow) double[size]);
+        if (!grown) {
+            return nullptr;
+        }
+        scratch = std::move(grown);
+        capacity = size;
+    }
+    return scratch.get();
+}
+
+// State at one end of an RK4 step, for event location. omega_rate is the
+// angular acceleration, taken from the k1 stage of the step that starts here.
+struct StepKnot {
+    double time;
+    double theta;
+    double omega;
+    double omega_rate;
+};
+
+// Cubic Hermite interpolant on [0, 1] through (y0, dy0) and (y1, dy1), with
+// the slopes already scaled by the step length.
+struct Hermite {
+    double y0;
+    double dy0;
+    double y1;
+    double dy1;
+
+    double value(double s) const noexcept {
+        const double s2 = s * s;
+        const double s3 = s2 * s;
+        return (2.0 * s3 - 3.0 * s2 + 1.0) * y0 + (s3 - 2.0 * s2 + s) * dy0 +
+               (3.0 * s2 - 2.0 * s3) * y1 + (s3 - s2) * dy1;
+    }
+
+    // d/ds of value().
+    double slope(double s) const noexcept {
+        const double s2 = s * s;
+        return (6.0 * s2 - 6.0 * s) * (y0 - y1) +
+               (3.0 * s2 - 4.0 * s + 1.0) * dy0 + (3.0 * s2 - 2.0 * s) * dy1;
+    }
+};
+
+// Root of f on [lo, hi], given that f(lo) and f(hi) differ in sign (f(hi)
+// may be zero). Bisection to full double resolution; events are rare enough
+// that its cost does not matter.
+template <typename F>
+double bisect(const F &f, double lo, double hi) {
+    const bool lo_positive = f(lo) > 0.0;
+    for (int iteration = 0; iteration < 60 && hi - lo > 0.0; ++iteration) {
+        const double mid = 0.5 * (lo + hi);
+        if ((f(mid) > 0.0) == lo_positive) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+// Finds the events inside one RK4 step from the knots at its two ends.
+class EventScanner {
+public:
+    EventScanner(const SimulationConfig &cfg, const EventOptions &options,
+                 const EventCallback &on_event)
+        : cfg_(cfg), options_(options), on_event_(on_event),
+          cup_angle_step_(TWO_PI / static_cast<double>(cfg.n_cups)) {}
+
+    void scan(const StepKnot &a, const StepKnot &b) {
+        h_ = b.time - a.time;
+        t0_ = a.time;
+        theta_ = {a.theta, h_ * a.omega, b.theta, h_ * b.omega};
+        omega_ = {a.omega, h_ * a.omega_rate, b.omega, h_ * b.omega_rate};
+        step_events_.clear();
+
+        double reversal = -1.0;
+        if ((a.omega > 0.0 && b.omega <= 0.0) ||
+            (a.omega < 0.0 && b.omega >= 0.0)) {
+            reversal = bisect(
+                [this](double s) { return omega_.value(s); }, 0.0, 1.0);
+            if (options_.omega_reversals) {
+                push(reversal, EventKind::omega_reversal, 0,
+                     a.omega > 0.0 ? -1 : 1);
+            }
+        }
+        if (options_.omega_maxima && a.omega_rate > 0.0 &&
+            b.omega_rate <= 0.0) {
+            const double s = bisect(
+                [this](double x) { return omega_.slope(x); }, 0.0, 1.0);
+            push(s, EventKind::omega_maximum, 0, 0);
+        }
+        if (options_.omega_minima && a.omega_rate < 0.0 &&
+            b.omega_rate >= 0.0) {
+            const double s = bisect(
+                [this](double x) { return omega_.slope(x); }, 0.0, 1.0);
+            push(s, EventKind::omega_minimum, 0, 0);
+        }
+        if (options_.inflow_crossings) {
+            // theta is monotonic on either side of a reversal.
+            if (reversal >= 0.0) {
+                scan_inflow(0.0, reversal);
+                scan_inflow(reversal, 1.0);
+            } else {
+                scan_inflow(0.0, 1.0);
+            }
+        }
+
+        std::sort(step_events_.begin(), step_events_.end(),
+                  [](const SimulationEvent &x, const SimulationEvent &y) {
+                      return x.time < y.time;
+                  });
+        for (const SimulationEvent &event : step_events_) {
+            on_event_(event);
+        }
+    }
+
+private:
+    void push(double s, EventKind kind, std::uint32_t cup,
+              std::int8_t direction) {
+        SimulationEvent event;
+        event.time = t0_ + s * h_;
+        event.theta = theta_.value(s);
+        event.omega = omega_.value(s);
+        event.cup = cup;
+        event.kind = kind;
+        event.direction =
+            kind == EventKind::omega_reversal
+                ? direction
+                : static_cast<std::int8_t>(event.omega > 0.0 ? 1
+                                           : event.omega < 0.0 ? -1
+                                                               : 0);
+        step_events_.push_back(event);
+    }
+
+    // Cup k is in the window while theta + k * step lies within
+    // INFLOW_HALF_WIDTH of 0 mod 2*pi, so its edges are crossed where theta
+    // passes j * step -+ INFLOW_HALF_WIDTH with j = -k mod n_cups. theta
+    // is monotonic on [s_lo, s_hi]; each edge value in the half-open range
+    // swept (lo, hi] or [hi, lo) is reported once.
+    void scan_inflow(double s_lo, double s_hi) {
+        const double from = theta_.value(s_lo);
+        const double to = theta_.value(s_hi);
+        if (from == to) {
+            return;
+        }
+        const bool rising = to > from;
+        for (const double edge : {-INFLOW_HALF_WIDTH, INFLOW_HALF_WIDTH}) {
+            const double lo = ((rising ? from : to) - edge) / cup_angle_step_;
+            const double hi = ((rising ? to : from) - edge) / cup_angle_step_;
+            const auto first = static_cast<std::int64_t>(
+                rising ? std::floor(lo) + 1.0 : std::ceil(lo));
+            const auto last = static_cast<std::int64_t>(
+                rising ? std::floor(hi) : std::ceil(hi) - 1.0);
+            // Rising through the lower edge or falling through the upper
+            // one moves the cup into the window.
+            const EventKind kind = (edge < 0.0) == rising
+                                       ? EventKind::inflow_entry
+                                       : EventKind::inflow_exit;
+            const auto n = static_cast<std::int64_t>(cfg_.n_cups);
+            for (std::int64_t j = first; j <= last; ++j) {
+                const double target =
+                    static_cast<double>(j) * cup_angle_step_ + edge;
+                const double s = bisect(
+                    [this, target](double x) {
+                        return theta_.value(x) - target;
+                    },
+                    s_lo, s_hi);
+                push(s, kind, static_cast<std::uint32_t>(((-j) % n + n) % n),
+                     0);
+            }
+        }
+    }
+
+    const SimulationConfig &cfg_;
+    const EventOptions &options_;
+    const EventCallback &on_event_;
+    const double cup_angle_step_;
+    std::vector<SimulationEvent> step_events_;
+    double t0_ = 0.0;
+    double h_ = 0.0;
+    Hermite theta_{};
+    Hermite omega_{};
+};
+
+}  // namespace
+
+// Cup counts common enough in sweeps to deserve a table-driven kernel;
+// everything else takes the generic path.
+DerivativeKernel derivative_kernel(std::size_t n_cups) noexcept {
+    switch (n_cups) {
+    case 4: return compute_derivatives_fixed<4>;
+    case 6: return compute_derivatives_fixed<6>;
+    case 8: return compute_derivatives_fixed<8>;
+    case 12: return compute_derivatives_fixed<12>;
+    case 16: return compute_derivatives_fixed<16>;
+    case 24: return compute_derivatives_fixed<24>;
+    case 32: return compute_derivatives_fixed<32>;
+    case 64: return compute_derivatives_fixed<64>;
+    default: return compute_derivatives;
+    }
+}
+
+const char *status_message(SimulationStatus status) noexcept {
+    switch (status) {
+    case SimulationStatus::ok:
+        return "ok";
+    case SimulationStatus::invalid_n_cups:
+        return "n_cups must be positive";
+    case SimulationStatus::invalid_n_frames:
+        return "n_frames must be at least 2";
+    case SimulationStatus::invalid_time_range:
+        return "t_end must be greater than t_start";
+    case SimulationStatus::invalid_steps_per_frame:
+        return "steps_per_frame must be positive";
+    case SimulationStatus::out_of_memory:
+        return "out of memory";
+    }
+    return "unknown status";
+}
+
+SimulationStatus check_config(const SimulationConfig &cfg) noexcept {
+    if (cfg.n_cups < 1) {
+        return SimulationStatus::invalid_n_cups;
+    }
+    if (cfg.n_frames < 2) {
+        return SimulationStatus::invalid_n_frames;
+    }
+    if (!(cfg.t_end > cfg.t_start)) {
+        return SimulationStatus::invalid_time_range;
+    }
+    if (cfg.steps_per_frame < 1) {
+        return SimulationStatus::invalid_steps_per_frame;
+    }
+    return SimulationStatus::ok;
+}
+
+void validate_config(const SimulationConfig &cfg) {
+    const SimulationStatus status = check_config(cfg);
+    if (status != SimulationStatus::ok) {
+        throw std::invalid_argument(status_message(status));
+    }
+}
+
+SimulationStatus simulate_into(const SimulationConfig &cfg, double *times,
+                               double *theta, double *masses) noexcept {
+    const SimulationStatus status = check_config(cfg);
+    if (status != SimulationStatus::ok) {
+        return status;
+    }
+
+    if (cfg.n_cups <= SMALL_RUN_MAX_CUPS) {
+        double work[(RK4_SCRATCH_VECTORS + 1) * (SMALL_RUN_MAX_CUPS + 2)];
+        integrate_into(cfg, work, times, theta, masses);
+        return SimulationStatus::ok;
+    }
+
+    double *work = thread_scratch((RK4_SCRATCH_VECTORS + 1) * (cfg.n_cups + 2));
+    if (!work) {
+        return SimulationStatus::out_of_memory;
+    }
+    integrate_into(cfg, work, times, theta, masses);
+    return SimulationStatus::ok;
+}
+
+double estimate_peak_bytes(const SimulationConfig &cfg) {
+    const double state_size = static_cast<double>(cfg.n_cups) + 2.0;
+    const double result = state_size * static_cast<double>(cfg.n_frames);
+    const double scratch = cfg.n_cups > SMALL_RUN_MAX_CUPS
+                               ? (RK4_SCRATCH_VECTORS + 1) * state_size
+                               : 0.0;
+    return (result + scratch) * sizeof(double);
+}
+
+SimulationResult simulate(const SimulationConfig &cfg) {
+    validate_config(cfg);
 
     SimulationResult result;
     result.times.resize(cfg.n_frames);
     result.theta.resize(cfg.n_frames);
-    result.masses.assign(cfg.n_cups * cfg.n_frames, 0.0);
+    result.masses.resize(cfg.n_cups * cfg.n_frames);
+
+    // cfg is valid, so the only possible failure is the scratch allocation.
+    if (simulate_into(cfg, result.times.data(), result.theta.data(),
+                      result.masses.data()) != SimulationStatus::ok) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void simulate_streaming(const SimulationConfig &cfg,
+                        const FrameCallback &on_frame) {
+    validate_config(cfg);
+
+    const std::size_t state_size = cfg.n_cups + 2;
+    std::vector<double> state(state_size, 0.0);
+    state[1] = cfg.omega0;
+
+    const double sub_dt = substep_dt(cfg);
+    Rk4Workspace work(state_size);
 
     double current_time = cfg.t_start;
     for (std::size_t frame = 0; frame < cfg.n_frames; ++frame) {
-        result.times[frame] = current_time;
-        result.theta[frame] = state[0];
-        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
-            result.masses[cup * cfg.n_frames + frame] = state[2 + cup];
-        }
+        on_frame(frame, current_time, state.data());
 
         if (frame + 1 == cfg.n_frames) {
             break;
         }
 
         for (std::size_t step = 0; step < cfg.steps_per_frame; ++step) {
-            rk4_step(state, sub_dt, cfg);
+            rk4_step(state, sub_dt, cfg, work);
             current_time += sub_dt;
         }
     }
+}
+
+LabBinnedResult simulate_lab_bins(const SimulationConfig &cfg,
+                                  std::size_t n_bins) {
+    if (n_bins < 1) {
+        throw std::invalid_argument("n_bins must be positive");
+    }
+    validate_config(cfg);
+    if (n_bins > std::numeric_limits<std::size_t>::max() / cfg.n_frames) {
+        throw std::invalid_argument("n_bins * n_frames is too large");
+    }
+
+    LabBinnedResult result;
+    result.times.resize(cfg.n_frames);
+    result.theta.resize(cfg.n_frames);
+    result.bins.assign(n_bins * cfg.n_frames, 0.0);
 
+    const double cup_angle_step = TWO_PI / static_cast<double>(cfg.n_cups);
+    const double bin_scale = static_cast<double>(n_bins) / TWO_PI;
+    const double half_bin = PI / static_cast<double>(n_bins);
+    simulate_streaming(cfg, [&](std::size_t frame, double time,
+                                const double *state) {
+        result.times[frame] = time;
+        result.theta[frame] = state[0];
+
+        // Shift by half a bin so bin 0 is centred on angle 0, reduce once
+        // per frame, then step through the cups with a single wrap each.
+        double angle = std::fmod(state[0] + half_bin, TWO_PI);
+        if (angle < 0.0) {
+            angle += TWO_PI;
+        }
+        double *bins = result.bins.data() + frame;
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            const std::size_t bin = std::min(
+                n_bins - 1, static_cast<std::size_t>(angle * bin_scale));
+            bins[bin * cfg.n_frames] += state[2 + cup];
+            angle += cup_angle_step;
+            if (angle >= TWO_PI) {
+                angle -= TWO_PI;
+            }
+        }
+    });
     return result;
 }
 
+std::vector<SimulationEvent> simulate_events(const SimulationConfig &cfg,
+                                             const EventOptions &options) {
+    std::vector<SimulationEvent> events;
+    simulate_events_streaming(
+        cfg, options,
+        [&events](const SimulationEvent &event) { events.push_back(event); });
+    return events;
+}
+
+void simulate_events_streaming(const SimulationConfig &cfg,
+                               const EventOptions &options,
+                               const EventCallback &on_event) {
+    validate_config(cfg);
+
+    const std::size_t state_size = cfg.n_cups + 2;
+    std::vector<double> state(state_size, 0.0);
+    state[1] = cfg.omega0;
+
+    const double sub_dt = substep_dt(cfg);
+    const DerivativeKernel derivatives = derivative_kernel(cfg.n_cups);
+    Rk4Workspace work(state_size);
+    double *k1 = work.scratch.data();
+
+    EventScanner scanner(cfg, options, on_event);
+
+    // The acceleration at a step's start only becomes known as that step's
+    // k1, so each step is scanned once the following step has run.
+    const std::size_t n_steps = (cfg.n_frames - 1) * cfg.steps_per_frame;
+    StepKnot previous{};
+    double current_time = cfg.t_start;
+    for (std::size_t step = 0; step < n_steps; ++step) {
+        const double theta = state[0];
+        const double omega = state[1];
+        rk4_step(state.data(), state_size, sub_dt, cfg, derivatives, k1);
+        const StepKnot start{current_time, theta, omega, k1[1]};
+        if (step > 0) {
+            scanner.scan(previous, start);
+        }
+        previous = start;
+        current_time += sub_dt;
+    }
+    if (n_steps > 0) {
+        derivatives(state.data(), k1, cfg);
+        scanner.scan(previous, {current_time, state[0], state[1], k1[1]});
+    }
+}
+
+SimulationCheckpoint initial_checkpoint(const SimulationConfig &cfg) {
+    validate_config(cfg);
+
+    SimulationCheckpoint checkpoint;
+    checkpoint.state.assign(cfg.n_cups + 2, 0.0);
+    checkpoint.state[1] = cfg.omega0;
+    return checkpoint;
+}
+
+void advance_frames(const SimulationConfig &cfg,
+                    SimulationCheckpoint &checkpoint, std::size_t n_frames) {
+    std::vector<double> scratch;
+    advance_frames(cfg, checkpoint, n_frames, scratch);
+}
+
+void advance_frames(const SimulationConfig &cfg,
+                    SimulationCheckpoint &checkpoint, std::size_t n_frames,
+                    std::vector<double> &scratch) {
+    const std::size_t state_size = checkpoint.state.size();
+    if (state_size != cfg.n_cups + 2) {
+        throw std::invalid_argument("checkpoint does not match n_cups");
+    }
+    if (scratch.size() < RK4_SCRATCH_VECTORS * state_size) {
+        scratch.resize(RK4_SCRATCH_VECTORS * state_size);
+    }
+
+    const double sub_dt = substep_dt(cfg);
+    const DerivativeKernel derivatives = derivative_kernel(cfg.n_cups);
+    double *state = checkpoint.state.data();
+    for (std::size_t frame = 0; frame < n_frames; ++frame) {
+        for (std::size_t step = 0; step < cfg.steps_per_frame; ++step) {
+            rk4_step(state, state_size, sub_dt, cfg, derivatives,
+                     scratch.data());
+        }
+    }
+    checkpoint.frame += n_frames;
+}
+
+ControlledStepper::ControlledStepper(const SimulationConfig &cfg)
+    : cfg_(cfg), dt_(0.0), kernel_(nullptr) {
+    validate_config(cfg);
+    dt_ = substep_dt(cfg);
+    kernel_ = derivative_kernel(cfg.n_cups);
+    scratch_.resize(RK4_SCRATCH_VECTORS * state_size());
+}
+
+void ControlledStepper::step(double *state,
+                             const ControlInput &input) noexcept {
+    cfg_.inflow_rate = input.inflow_rate;
+    if (input.brake_torque == 0.0) {
+        rk4_step(state, state_size(), dt_, cfg_, kernel_, scratch_.data());
+        return;
+    }
+    const DerivativeKernel kernel = kernel_;
+    const double deceleration = input.brake_torque / cfg_.inertia;
+    rk4_step(state, state_size(), dt_, cfg_,
+             [kernel, deceleration](const double *at, double *derivatives,
+                                    const SimulationConfig &cfg) {
+                 kernel(at, derivatives, cfg);
+                 derivatives[1] -= deceleration;
+             },
+             scratch_.data());
+}
+
+std::string result_fingerprint(const SimulationResult &result) {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    fnv1a_doubles(hash, result.times);
+    fnv1a_doubles(hash, result.theta);
+    fnv1a_doubles(hash, result.masses);
+
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int digit = 15; digit >= 0; --digit) {
+        text[static_cast<std::size_t>(digit)] = DIGITS[hash & 0xfu];
+        hash >>= 4;
+    }
+    return text;
+}
+
+CupPositions cup_positions(const std::vector<double> &theta,
+                           std::size_t n_cups, double radius) {
+    if (n_cups < 1) {
+        throw std::invalid_argument("n_cups must be positive");
+    }
+
+    const std::size_t n_frames = theta.size();
+    const double cup_angle_step = TWO_PI / static_cast<double>(n_cups);
+    CupPositions positions;
+    positions.x.resize(n_cups * n_frames);
+    positions.y.resize(n_cups * n_frames);
+    for (std::size_t cup = 0; cup < n_cups; ++cup) {
+        const double offset = cup_angle_step * static_cast<double>(cup);
+        double *x = positions.x.data() + cup * n_frames;
+        double *y = positions.y.data() + cup * n_frames;
+        for (std::size_t frame = 0; frame < n_frames; ++frame) {
+            double s = 0.0;
+            double c = 0.0;
+            sincos<TrigAccuracy::abs1e7>(theta[frame] + offset, s, c);
+            x[frame] = radius * c;
+            y[frame] = radius * s;
+        }
+    }
+    return positions;
+}
+
 }  // namespace wheely
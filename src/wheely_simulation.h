@@ -1,7 +1,13 @@
 #ifndef WHEELY_SIMULATION_H
 #define WHEELY_SIMULATION_H
 
+#include "wheely_math.h"
+
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
 
 namespace wheely {
@@ -21,14 +27,206 @@ struct SimulationConfig {
     std::size_t steps_per_frame = 0;
 };
 
+// Cups within this angle of the top (theta = 0 mod 2*pi) receive inflow.
+constexpr double INFLOW_HALF_WIDTH = 0.1;
+
+// Calls on_cup(cup) for every cup under the inflow when the wheel is at
+// theta. Cup i sits at theta + i * step, so it is at the top when i is
+// within the window of -theta / step (mod n_cups); the window is located
+// directly in units of cup spacing instead of testing every cup.
+template <typename F>
+inline void for_each_inflow_cup(double theta, std::size_t n_cups, const F &on_cup) {
+    const double cups = static_cast<double>(n_cups);
+    const double steps_per_radian = cups / TWO_PI;
+    const double window = INFLOW_HALF_WIDTH * steps_per_radian;
+    const auto count = static_cast<std::ptrdiff_t>(n_cups);
+    double center = -theta * steps_per_radian;
+    center -= cups * std::floor(center / cups);
+    const auto first = static_cast<std::ptrdiff_t>(std::floor(center - window));
+    const auto last = static_cast<std::ptrdiff_t>(std::ceil(center + window));
+    for (std::ptrdiff_t index = first; index <= last; ++index) {
+        const double distance = static_cast<double>(index) - center;
+        if (distance < window && distance > -window) {
+            on_cup(static_cast<std::size_t>(((index % count) + count) % count));
+        }
+    }
+}
+
 struct SimulationResult {
     std::vector<double> times;
     std::vector<double> theta;
     std::vector<double> masses;
 };
 
+// Integrator state (theta, omega, cup masses) at the start of an output
+// frame. Holding one of these is enough to resume a run bit-for-bit.
+struct SimulationCheckpoint {
+    std::size_t frame = 0;
+    std::vector<double> state;
+};
+
+// Cup centres for a sequence of wheel angles, cup-major like
+// SimulationResult::masses: x[cup * theta.size() + frame].
+struct CupPositions {
+    std::vector<double> x;
+    std::vector<double> y;
+};
+
+// Output of simulate_lab_bins(): the cup masses summed into n_bins fixed
+// lab-frame angular bins, stored bin-major like masses:
+// bins[bin * n_frames + frame].
+struct LabBinnedResult {
+    std::vector<double> times;
+    std::vector<double> theta;
+    std::vector<double> bins;
+};
+
+enum class EventKind : std::uint8_t {
+    // omega changed sign; direction is the sign it changed to.
+    omega_reversal,
+    // Local maximum of omega.
+    omega_maximum,
+    // Local minimum of omega.
+    omega_minimum,
+    // A cup crossed into or out of the inflow window at the top.
+    inflow_entry,
+    inflow_exit,
+};
+
+// One entry of simulate_events(). time lies inside the RK4 step in which the
+// event happened, found on the cubic Hermite interpolant through the step's
+// end points, and theta and omega are interpolated to that time.
+struct SimulationEvent {
+    double time = 0.0;
+    double theta = 0.0;
+    double omega = 0.0;
+    // Cup index for inflow events, 0 otherwise.
+    std::uint32_t cup = 0;
+    EventKind kind = EventKind::omega_reversal;
+    // New sign of omega for reversals, sign of omega for the other kinds.
+    std::int8_t direction = 0;
+};
+
+struct EventOptions {
+    bool omega_reversals = true;
+    bool omega_maxima = true;
+    bool omega_minima = false;
+    bool inflow_crossings = true;
+};
+
+// Called once per event, in time order.
+using EventCallback = std::function<void(const SimulationEvent &event)>;
+
+// Outcome of check_config() and simulate_into().
+enum class SimulationStatus {
+    ok = 0,
+    invalid_n_cups,
+    invalid_n_frames,
+    invalid_time_range,
+    invalid_steps_per_frame,
+    out_of_memory,
+};
+
+// Static description of a status, e.g. "n_frames must be at least 2".
+const char *status_message(SimulationStatus status) noexcept;
+
+// Non-throwing counterpart of validate_config().
+SimulationStatus check_config(const SimulationConfig &cfg) noexcept;
+
+// Throws std::invalid_argument if cfg cannot be simulated.
+void validate_config(const SimulationConfig &cfg);
+
 SimulationResult simulate(const SimulationConfig &cfg);
 
+// The vector field simulate() integrates: writes f(state) for cfg into
+// derivatives, with state = [theta, omega, m_0 .. m_{n_cups-1}].
+using DerivativeKernel = void (*)(const double *state, double *derivatives,
+                                  const SimulationConfig &cfg);
+
+// The kernel simulate() uses for n_cups cups. Common counts get a
+// table-driven one, the rest a generic one.
+DerivativeKernel derivative_kernel(std::size_t n_cups) noexcept;
+
+// Peak heap bytes simulate(cfg) needs: the result plus, above
+// SMALL_RUN_MAX_CUPS, the integrator scratch. A double, so sizes beyond
+// 4 GiB are representable on wasm32; used to grow the wasm heap up front.
+double estimate_peak_bytes(const SimulationConfig &cfg);
+
+// Runs with at most this many cups keep all integrator state on the stack.
+constexpr std::size_t SMALL_RUN_MAX_CUPS = 64;
+
+// Fast path for tiny runs called at high rates. Same integration and
+// bit-identical output as simulate(), written into caller-owned buffers:
+// times and theta hold n_frames values, masses holds n_cups * n_frames
+// (cup-major). Nothing is thrown. Up to SMALL_RUN_MAX_CUPS cups nothing is
+// allocated either; larger runs reuse a per-thread scratch buffer, so only
+// the first run of a new maximum size on a thread allocates. Safe to call
+// from any number of threads at once. Buffers are left untouched unless the
+// status is ok.
+SimulationStatus simulate_into(const SimulationConfig &cfg, double *times,
+                               double *theta, double *masses) noexcept;
+
+// Called once per output frame with the frame index, its time and the full
+// state [theta, omega, m_0 .. m_{n_cups-1}]. The state pointer is only valid
+// for the duration of the call.
+using FrameCallback =
+    std::function<void(std::size_t frame, double time, const double *state)>;
+
+// Runs the same integration as simulate() but hands each frame to on_frame
+// instead of storing it, so memory use is independent of n_frames.
+void simulate_streaming(const SimulationConfig &cfg,
+                        const FrameCallback &on_frame);
+
+// Runs the same integration as simulate() but, instead of per-cup masses in
+// the rotating frame, sums the cup masses into n_bins equal bins of lab-frame
+// angle at every frame. Bin 0 is centred on the top of the wheel (the inflow),
+// and bins follow in the direction of increasing theta, so for n_bins = 4 they
+// are top, side, bottom and the other side. Memory use is
+// (n_bins + 2) * n_frames doubles, independent of n_cups. Throws
+// std::invalid_argument for an invalid cfg or n_bins == 0.
+LabBinnedResult simulate_lab_bins(const SimulationConfig &cfg,
+                                  std::size_t n_bins);
+
+// Runs the same integration as simulate() over the same (n_frames - 1) *
+// steps_per_frame RK4 steps, but stores no frames: only the selected events,
+// in time order. Memory use grows with the number of events, not of steps.
+// Within one step, omega is assumed to change sign at most once and to have at
+// most one maximum; steps short enough for accurate integration satisfy this.
+std::vector<SimulationEvent> simulate_events(const SimulationConfig &cfg,
+                                             const EventOptions &options = {});
+
+// As simulate_events(), but hands each event to on_event instead of storing
+// it, so memory use is constant however many events there are.
+void simulate_events_streaming(const SimulationConfig &cfg,
+                               const EventOptions &options,
+                               const EventCallback &on_event);
+
+// Validates cfg and returns the checkpoint for frame 0.
+SimulationCheckpoint initial_checkpoint(const SimulationConfig &cfg);
+
+// Integrates `checkpoint` forward by n_frames output frames.
+void advance_frames(const SimulationConfig &cfg,
+                    SimulationCheckpoint &checkpoint, std::size_t n_frames);
+
+// As above, with caller-owned RK4 scratch. `scratch` is grown on first use
+// and reused afterwards, so a loop that advances one frame at a time
+// allocates once instead of once per call.
+void advance_frames(const SimulationConfig &cfg,
+                    SimulationCheckpoint &checkpoint, std::size_t n_frames,
+                    std::vector<double> &scratch);
+
+// FNV-1a hash of the IEEE-754 bit patterns of times, theta and masses (in
+// that order), as 16 lowercase hex digits. Any single-bit difference in the
+// output changes it, so equal fingerprints from a native and a wasm build
+// mean bit-identical results.
+std::string result_fingerprint(const SimulationResult &result);
+
+// Positions of n_cups equally spaced cups on a wheel of the given radius for
+// every angle in theta. Accurate to ~1e-7 * radius, which is far below a
+// pixel; meant for renderers, not for feeding back into the integrator.
+CupPositions cup_positions(const std::vector<double> &theta,
+                           std::size_t n_cups, double radius);
+
 }  // namespace wheely
 
 #endif  // WHEELY_SIMULATION_H
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include "wheely_sobol.h"
+
+#include "wheely_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+// Uniform on [0, 1).
+double unit_random(std::uint64_t &state) {
+    return static_cast<double>(splitmix64(state) >> 11) * 0x1.0p-53;
+}
+
+struct IndexSums {
+    double first_order = 0.0;
+    double total = 0.0;
+};
+
+// The two estimators over the rows in `rows` (all rows if empty).
+void estimate(const std::vector<double> &f_a, const std::vector<double> &f_b,
+              const std::vector<double> &f_ab, std::size_t n_parameters,
+              const std::vector<std::size_t> &rows, double &mean,
+              double &variance, std::vector<IndexSums> &indices) {
+    const std::size_t n = f_a.size();
+    const std::size_t count = rows.empty() ? n : rows.size();
+    auto row = [&](std::size_t k) { return rows.empty() ? k : rows[k]; };
+
+    double sum = 0.0;
+    for (std::size_t k = 0; k < count; ++k) {
+        sum += f_a[row(k)] + f_b[row(k)];
+    }
+    mean = sum / static_cast<double>(2 * count);
+    double squares = 0.0;
+    for (std::size_t k = 0; k < count; ++k) {
+        const double da = f_a[row(k)] - mean;
+        const double db = f_b[row(k)] - mean;
+        squares += da * da + db * db;
+    }
+    variance = squares / static_cast<double>(2 * count - 1);
+
+    indices.assign(n_parameters, IndexSums());
+    if (variance <= 0.0) {
+        return;
+    }
+    for (std::size_t i = 0; i < n_parameters; ++i) {
+        const double *ab = f_ab.data() + i * n;
+        double first = 0.0;
+        double total = 0.0;
+        for (std::size_t k = 0; k < count; ++k) {
+            const std::size_t r = row(k);
+            first += f_b[r] * (ab[r] - f_a[r]);
+            total += (f_a[r] - ab[r]) * (f_a[r] - ab[r]);
+        }
+        indices[i].first_order = first / static_cast<double>(count) / variance;
+        indices[i].total = total / static_cast<double>(2 * count) / variance;
+    }
+}
+
+double percentile(std::vector<double> &values, double q) {
+    std::sort(values.begin(), values.end());
+    const double position = q * static_cast<double>(values.size() - 1);
+    const auto lower = static_cast<std::size_t>(std::floor(position));
+    const std::size_t upper = std::min(values.size() - 1, lower + 1);
+    const double weight = position - static_cast<double>(lower);
+    return values[lower] * (1.0 - weight) + values[upper] * weight;
+}
+
+}  // namespace
+
+void set_parameter(SimulationConfig &cfg, ConfigParameter parameter, double value) {
+    switch (parameter) {
+    case ConfigParameter::radius: cfg.radius = value; break;
+    case ConfigParameter::g: cfg.g = value; break;
+    case ConfigParameter::damping: cfg.damping = value; break;
+    case ConfigParameter::leak_rate: cfg.leak_rate = value; break;
+    case ConfigParameter::inflow_rate: cfg.inflow_rate = value; break;
+    case ConfigParameter::inertia: cfg.inertia = value; break;
+    case ConfigParameter::omega0: cfg.omega0 = value; break;
+    }
+}
+
+RunStatistics run_statistics(const SimulationConfig &cfg, double burn_in_time) {
+    validate_config(cfg);
+    const double frame_dt =
+        (cfg.t_end - cfg.t_start) / static_cast<double>(cfg.n_frames - 1);
+    // First frame at or after the burn-in, allowing for rounding in its time.
+    const double first_frame = std::ceil(burn_in_time / frame_dt - 1e-9);
+    if (!(first_frame >= 0.0) ||
+        first_frame + 2.0 > static_cast<double>(cfg.n_frames)) {
+        throw std::invalid_argument(
+            "burn_in_time must leave at least two frames");
+    }
+    const auto first = static_cast<std::size_t>(first_frame);
+
+    double abs_sum = 0.0;
+    std::size_t reversals = 0;
+    double previous = 0.0;
+    double first_time = 0.0;
+    double last_time = 0.0;
+    simulate_streaming(cfg, [&](std::size_t frame, double time,
+                                const double *state) {
+        if (frame < first) {
+            return;
+        }
+        const double omega = state[1];
+        abs_sum += std::abs(omega);
+        if (frame == first) {
+            first_time = time;
+        } else if ((previous < 0.0 && omega > 0.0) ||
+                   (previous > 0.0 && omega < 0.0)) {
+            ++reversals;
+        }
+        // Zero carries the last non-zero sign forward.
+        if (omega != 0.0) {
+            previous = omega;
+        }
+        last_time = time;
+    });
+
+    RunStatistics stats;
+    stats.mean_abs_omega =
+        abs_sum / static_cast<double>(cfg.n_frames - first);
+    stats.reversal_rate = static_cast<double>(reversals) / (last_time - first_time);
+    return stats;
+}
+
+SaltelliDesign saltelli_design(std::size_t n_samples, std::size_t n_parameters,
+                               std::uint64_t seed) {
+    SaltelliDesign design;
+    design.n_samples = n_samples;
+    design.n_parameters = n_parameters;
+    design.a.resize(n_samples * n_parameters);
+    design.b.resize(n_samples * n_parameters);
+    std::uint64_t state = seed;
+    for (std::size_t k = 0; k < n_samples; ++k) {
+        for (std::size_t i = 0; i < n_parameters; ++i) {
+            design.a[k * n_parameters + i] = unit_random(state);
+        }
+        for (std::size_t i = 0; i < n_parameters; ++i) {
+            design.b[k * n_parameters + i] = unit_random(state);
+        }
+    }
+    return design;
+}
+
+SobolIndices estimate_sobol_indices(const std::vector<double> &f_a,
+                                    const std::vector<double> &f_b,
+                                    const std::vector<double> &f_ab,
+                                    std::size_t n_parameters,
+                                    std::size_t bootstrap_samples,
+                                    double confidence, std::uint64_t seed) {
+    const std::size_t n = f_a.size();
+    if (n < 2 || f_b.size() != n || f_ab.size() != n * n_parameters) {
+        throw std::invalid_argument(
+            "f_a and f_b need at least two samples each, and f_ab "
+            "n_parameters times as many");
+    }
+    if (!(confidence > 0.0 && confidence < 1.0)) {
+        throw std::invalid_argument("confidence must lie in (0, 1)");
+    }
+
+    SobolIndices result;
+    std::vector<IndexSums> indices;
+    estimate(f_a, f_b, f_ab, n_parameters, {}, result.mean, result.variance,
+             indices);
+    for (const IndexSums &index : indices) {
+        result.first_order.push_back(index.first_order);
+        result.total.push_back(index.total);
+    }
+    if (bootstrap_samples == 0) {
+        result.first_order_lower = result.first_order_upper = result.first_order;
+        result.total_lower = result.total_upper = result.total;
+        return result;
+    }
+
+    std::vector<std::vector<double>> first(n_parameters);
+    std::vector<std::vector<double>> total(n_parameters);
+    std::vector<std::size_t> rows(n);
+    std::uint64_t state = seed;
+    for (std::size_t sample = 0; sample < bootstrap_samples; ++sample) {
+        for (std::size_t &row : rows) {
+            row = static_cast<std::size_t>(splitmix64(state) % n);
+        }
+        double mean = 0.0;
+        double variance = 0.0;
+        estimate(f_a, f_b, f_ab, n_parameters, rows, mean, variance, indices);
+        for (std::size_t i = 0; i < n_parameters; ++i) {
+            first[i].push_back(indices[i].first_order);
+            total[i].push_back(indices[i].total);
+        }
+    }
+    const double tail = 0.5 * (1.0 - confidence);
+    for (std::size_t i = 0; i < n_parameters; ++i) {
+        result.first_order_lower.push_back(percentile(first[i], tail));
+        result.first_order_upper.push_back(percentile(first[i], 1.0 - tail));
+        result.total_lower.push_back(percentile(total[i], tail));
+        result.total_upper.push_back(percentile(total[i], 1.0 - tail));
+    }
+    return result;
+}
+
+SobolAnalysis sobol_indices(const SimulationConfig &base,
+                            const std::vector<ParameterRange> &ranges,
+                            const SobolOptions &options, BatchExecutor &executor) {
+    if (ranges.empty()) {
+        throw std::invalid_argument("at least one parameter range is needed");
+    }
+    for (const ParameterRange &range : ranges) {
+        if (!(range.upper >= range.lower)) {
+            throw std::invalid_argument("parameter range has upper < lower");
+        }
+    }
+    if (options.base_samples < 2) {
+        throw std::invalid_argument("base_samples must be at least 2");
+    }
+    if (!(options.confidence > 0.0 && options.confidence < 1.0)) {
+        throw std::invalid_argument("confidence must lie in (0, 1)");
+    }
+
+    const std::size_t n = options.base_samples;
+    const std::size_t d = ranges.size();
+    const SaltelliDesign design = saltelli_design(n, d, options.seed);
+
+    // Runs are numbered A (0..n), B (n..2n), then AB_i (n each).
+    const std::size_t evaluations = n * (d + 2);
+    std::vector<RunStatistics> stats(evaluations);
+    executor.parallel_for(evaluations, [&](std::size_t, std::size_t run) {
+        const std::size_t block = run / n;
+        const std::size_t k = run % n;
+        const double *a = design.a.data() + k * d;
+        const double *b = design.b.data() + k * d;
+        SimulationConfig cfg = base;
+        for (std::size_t i = 0; i < d; ++i) {
+            const double *source = block == 1 || block == i + 2 ? b : a;
+            const ParameterRange &range = ranges[i];
+            set_parameter(cfg, range.parameter,
+                          range.lower + (range.upper - range.lower) * source[i]);
+        }
+        stats[run] = run_statistics(cfg, options.burn_in_time);
+    });
+
+    auto analyze = [&](double RunStatistics::*field, std::uint64_t stream) {
+        std::vector<double> f_a(n);
+        std::vector<double> f_b(n);
+        std::vector<double> f_ab(n * d);
+        for (std::size_t k = 0; k < n; ++k) {
+            f_a[k] = stats[k].*field;
+            f_b[k] = stats[n + k].*field;
+        }
+        for (std::size_t i = 0; i < d * n; ++i) {
+            f_ab[i] = stats[2 * n + i].*field;
+        }
+        return estimate_sobol_indices(f_a, f_b, f_ab, d, options.bootstrap_samples,
+                                      options.confidence, options.seed ^ stream);
+    };
+
+    SobolAnalysis analysis;
+    analysis.mean_abs_omega = analyze(&RunStatistics::mean_abs_omega, 0x5b0b01ull);
+    analysis.reversal_rate = analyze(&RunStatistics::reversal_rate, 0x5b0b02ull);
+    analysis.evaluations = evaluations;
+    return analysis;
+}
+
+SobolAnalysis sobol_indices(const SimulationConfig &base,
+                            const std::vector<ParameterRange> &ranges,
+                            const SobolOptions &options, const BatchOptions &batch) {
+    return sobol_indices(base, ranges, options, default_executor(batch));
+}
+
+}  // namespace wheely
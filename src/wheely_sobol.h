@@ -0,0 +1,119 @@
+#ifndef WHEELY_SOBOL_H
+#define WHEELY_SOBOL_H
+
+#include "wheely_batch.h"
+#include "wheely_executor.h"
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wheely {
+
+// The SimulationConfig fields a sensitivity study can vary.
+enum class ConfigParameter {
+    radius,
+    g,
+    damping,
+    leak_rate,
+    inflow_rate,
+    inertia,
+    omega0,
+};
+
+// Sets the field of cfg that parameter names.
+void set_parameter(SimulationConfig &cfg, ConfigParameter parameter, double value);
+
+// A parameter drawn uniformly from [lower, upper].
+struct ParameterRange {
+    ConfigParameter parameter = ConfigParameter::damping;
+    double lower = 0.0;
+    double upper = 0.0;
+};
+
+// Summary statistics of one run, over the frames at or after
+// t_start + burn_in_time.
+struct RunStatistics {
+    double mean_abs_omega = 0.0;
+    // Sign changes of omega between consecutive frames, per unit time.
+    double reversal_rate = 0.0;
+};
+
+// Integrates cfg like simulate() but keeps only the statistics, so memory
+// does not grow with n_frames. Throws std::invalid_argument for an invalid
+// cfg or a burn-in that leaves fewer than two frames.
+RunStatistics run_statistics(const SimulationConfig &cfg, double burn_in_time);
+
+// Saltelli's base samples: two independent n_samples x n_parameters
+// matrices on the unit cube, row-major, from a seeded generator.
+struct SaltelliDesign {
+    std::size_t n_samples = 0;
+    std::size_t n_parameters = 0;
+    std::vector<double> a;
+    std::vector<double> b;
+};
+
+SaltelliDesign saltelli_design(std::size_t n_samples, std::size_t n_parameters,
+                               std::uint64_t seed);
+
+struct SobolIndices {
+    double mean = 0.0;
+    double variance = 0.0;
+    // Per parameter.
+    std::vector<double> first_order;
+    std::vector<double> total;
+    // Bootstrap percentile interval at the requested confidence.
+    std::vector<double> first_order_lower;
+    std::vector<double> first_order_upper;
+    std::vector<double> total_lower;
+    std::vector<double> total_upper;
+};
+
+// First-order indices by Saltelli (2010), (1/N) sum f_B (f_AB_i - f_A) / V,
+// and total indices by Jansen (1999), (1/2N) sum (f_A - f_AB_i)^2 / V, where
+// V is the variance of f_A and f_B together. f_ab holds n_parameters rows
+// of n_samples values, row i for A with column i taken from B. Intervals
+// come from bootstrap_samples resamplings of the N rows, drawn from seed.
+SobolIndices estimate_sobol_indices(const std::vector<double> &f_a,
+                                    const std::vector<double> &f_b,
+                                    const std::vector<double> &f_ab,
+                                    std::size_t n_parameters,
+                                    std::size_t bootstrap_samples,
+                                    double confidence, std::uint64_t seed);
+
+struct SobolOptions {
+    // N; the study runs N * (d + 2) simulations.
+    std::size_t base_samples = 1024;
+    std::size_t bootstrap_samples = 200;
+    double confidence = 0.95;
+    double burn_in_time = 0.0;
+    std::uint64_t seed = 0;
+};
+
+struct SobolAnalysis {
+    SobolIndices mean_abs_omega;
+    SobolIndices reversal_rate;
+    std::size_t evaluations = 0;
+};
+
+// Sobol indices of run_statistics() with respect to the given parameter
+// ranges, every other field coming from base. The runs execute in parallel
+// on executor. Each writes only its own slot, so the result does not
+// depend on the thread count.
+//
+// Throws std::invalid_argument for no ranges, a range with upper < lower,
+// base_samples < 2, or a confidence outside (0, 1). Invalid configs are
+// reported by the run that meets them.
+SobolAnalysis sobol_indices(const SimulationConfig &base,
+                            const std::vector<ParameterRange> &ranges,
+                            const SobolOptions &options, BatchExecutor &executor);
+
+SobolAnalysis sobol_indices(const SimulationConfig &base,
+                            const std::vector<ParameterRange> &ranges,
+                            const SobolOptions &options = SobolOptions(),
+                            const BatchOptions &batch = BatchOptions());
+
+}  // namespace wheely
+
+#endif  // WHEELY_SOBOL_H
@@ -0,0 +1,294 @@
+#include "wheely_splitting.h"
+
+#include "wheely_control.h"
+#include "wheely_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+// Box-Muller; u1 lies in (0, 1] so the logarithm is finite.
+double splitting_normal(std::uint64_t &state) {
+    const double u1 =
+        static_cast<double>((splitmix64(state) >> 11) + 1) * 0x1.0p-53;
+    const double u2 = static_cast<double>(splitmix64(state) >> 11) * 0x1.0p-53;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(TWO_PI * u2);
+}
+
+// One trajectory, and the states it can be cloned from.
+struct Replica {
+    std::size_t frame = 0;
+    // Last frame that still turns the initial way; below frame once the
+    // replica has reversed.
+    std::size_t score = 0;
+    // Noise stream, positioned for the frame after `frame`.
+    std::uint64_t rng = 0;
+    std::vector<double> state;
+    // Saved states, oldest first: the frame, the noise stream there, and
+    // the state (state_size values each).
+    std::vector<std::size_t> saved_frames;
+    std::vector<std::uint64_t> saved_rngs;
+    std::vector<double> saved_states;
+};
+
+// Per-worker integrator for replicas of one study.
+class ReplicaPropagator {
+public:
+    ReplicaPropagator(const SimulationConfig &cfg, const DwellOptions &dwell,
+                      std::size_t checkpoint_interval)
+        : stepper_(cfg), steps_per_frame_(cfg.steps_per_frame),
+          inflow_rate_(cfg.inflow_rate), inflow_noise_(dwell.inflow_noise),
+          final_frame_(cfg.n_frames - 1), interval_(checkpoint_interval) {}
+
+    std::size_t final_frame() const { return final_frame_; }
+    std::size_t frames_integrated() const { return frames_; }
+
+    // Starts `replica` from `state` at `frame` with a fresh noise stream.
+    void start(Replica &replica, const double *state, std::size_t frame,
+               std::uint64_t seed) const {
+        const std::size_t size = stepper_.state_size();
+        replica.frame = frame;
+        replica.score = frame;
+        replica.rng = seed;
+        replica.state.assign(state, state + size);
+        replica.saved_frames.clear();
+        replica.saved_rngs.clear();
+        replica.saved_states.clear();
+        save(replica);
+    }
+
+    // Runs `replica` until it reverses or reaches the final frame.
+    void run(Replica &replica, double direction) {
+        while (replica.score == replica.frame && replica.frame < final_frame_) {
+            advance_frame(replica.state.data(), replica.rng);
+            ++replica.frame;
+            if (replica.state[1] * direction < 0.0) {
+                break;
+            }
+            replica.score = replica.frame;
+            if (replica.frame % interval_ == 0) {
+                save(replica);
+            }
+        }
+    }
+
+    // Writes parent's state at `frame` (at most its score) into `out` by
+    // replaying from the nearest saved state.
+    void state_at(const Replica &parent, std::size_t frame, double *out) {
+        const std::size_t size = stepper_.state_size();
+        const auto after = std::upper_bound(parent.saved_frames.begin(),
+                                            parent.saved_frames.end(), frame);
+        const auto index =
+            static_cast<std::size_t>(after - parent.saved_frames.begin()) - 1;
+        std::copy_n(parent.saved_states.data() + index * size, size, out);
+        std::uint64_t rng = parent.saved_rngs[index];
+        for (std::size_t at = parent.saved_frames[index]; at < frame; ++at) {
+            advance_frame(out, rng);
+        }
+    }
+
+private:
+    void save(Replica &replica) const {
+        replica.saved_frames.push_back(replica.frame);
+        replica.saved_rngs.push_back(replica.rng);
+        replica.saved_states.insert(replica.saved_states.end(),
+                                    replica.state.begin(), replica.state.end());
+    }
+
+    void advance_frame(double *state, std::uint64_t &rng) {
+        const double factor = 1.0 + inflow_noise_ * splitting_normal(rng);
+        const ControlInput input{std::max(0.0, inflow_rate_ * factor), 0.0};
+        for (std::size_t step = 0; step < steps_per_frame_; ++step) {
+            stepper_.step(state, input);
+        }
+        ++frames_;
+    }
+
+    ControlledStepper stepper_;
+    std::size_t steps_per_frame_;
+    double inflow_rate_;
+    double inflow_noise_;
+    std::size_t final_frame_;
+    std::size_t interval_;
+    std::size_t frames_ = 0;
+};
+
+std::vector<double> initial_dwell_state(const SimulationConfig &cfg,
+                                        const DwellOptions &dwell) {
+    validate_config(cfg);
+    if (!(dwell.inflow_noise >= 0.0)) {
+        throw std::invalid_argument("inflow_noise must be non-negative");
+    }
+    std::vector<double> state = dwell.initial_state;
+    if (state.empty()) {
+        state.assign(cfg.n_cups + 2, 0.0);
+        state[1] = cfg.omega0;
+    } else if (state.size() != cfg.n_cups + 2) {
+        throw std::invalid_argument("initial_state must hold n_cups + 2 values");
+    }
+    if (state[1] == 0.0) {
+        throw std::invalid_argument(
+            "initial omega must be non-zero to fix a direction");
+    }
+    return state;
+}
+
+std::vector<ReplicaPropagator> make_propagators(const SimulationConfig &cfg,
+                                                const DwellOptions &dwell,
+                                                std::size_t checkpoint_interval,
+                                                std::size_t count) {
+    std::vector<ReplicaPropagator> propagators;
+    propagators.reserve(count);
+    for (std::size_t worker = 0; worker < count; ++worker) {
+        propagators.emplace_back(cfg, dwell, checkpoint_interval);
+    }
+    return propagators;
+}
+
+// Starts and runs replicas[i] from the initial state, seeded from the
+// study's stream, which it advances.
+void run_initial_replicas(std::vector<Replica> &replicas,
+                          const std::vector<double> &initial,
+                          std::uint64_t &stream,
+                          std::vector<ReplicaPropagator> &propagators,
+                          BatchExecutor &executor) {
+    std::vector<std::uint64_t> seeds(replicas.size());
+    for (std::uint64_t &seed : seeds) {
+        seed = splitmix64(stream);
+    }
+    const double direction = initial[1] > 0.0 ? 1.0 : -1.0;
+    executor.parallel_for(replicas.size(), [&](std::size_t worker, std::size_t i) {
+        propagators[worker].start(replicas[i], initial.data(), 0, seeds[i]);
+        propagators[worker].run(replicas[i], direction);
+    });
+}
+
+}  // namespace
+
+std::vector<double> sample_dwell_times(const SimulationConfig &cfg,
+                                       const DwellOptions &dwell,
+                                       std::size_t n_runs,
+                                       BatchExecutor &executor) {
+    const std::vector<double> initial = initial_dwell_state(cfg, dwell);
+    // Nothing is cloned, so no state needs saving past the first.
+    std::vector<ReplicaPropagator> propagators =
+        make_propagators(cfg, dwell, cfg.n_frames, executor.size());
+    std::vector<Replica> replicas(n_runs);
+    std::uint64_t stream = dwell.seed;
+    run_initial_replicas(replicas, initial, stream, propagators, executor);
+
+    const double frame_dt =
+        (cfg.t_end - cfg.t_start) / static_cast<double>(cfg.n_frames - 1);
+    std::vector<double> dwell_times(n_runs);
+    for (std::size_t i = 0; i < n_runs; ++i) {
+        dwell_times[i] = static_cast<double>(replicas[i].score) * frame_dt;
+    }
+    return dwell_times;
+}
+
+std::vector<double> sample_dwell_times(const SimulationConfig &cfg,
+                                       const DwellOptions &dwell,
+                                       std::size_t n_runs,
+                                       const BatchOptions &batch) {
+    return sample_dwell_times(cfg, dwell, n_runs, default_executor(batch));
+}
+
+SplittingResult adaptive_multilevel_splitting(const SimulationConfig &cfg,
+                                              const DwellOptions &dwell,
+                                              const SplittingOptions &options,
+                                              BatchExecutor &executor) {
+    const std::vector<double> initial = initial_dwell_state(cfg, dwell);
+    const std::size_t n = options.replicas;
+    if (n < 2) {
+        throw std::invalid_argument("replicas must be at least 2");
+    }
+    if (options.kill_count < 1 || options.kill_count >= n) {
+        throw std::invalid_argument("kill_count must lie in [1, replicas)");
+    }
+    if (options.checkpoint_interval < 1) {
+        throw std::invalid_argument("checkpoint_interval must be positive");
+    }
+
+    std::vector<ReplicaPropagator> propagators =
+        make_propagators(cfg, dwell, options.checkpoint_interval, executor.size());
+    const std::size_t final_frame = propagators.front().final_frame();
+    const double frame_dt =
+        (cfg.t_end - cfg.t_start) / static_cast<double>(final_frame);
+    const double direction = initial[1] > 0.0 ? 1.0 : -1.0;
+
+    std::vector<Replica> replicas(n);
+    std::uint64_t stream = dwell.seed;
+    run_initial_replicas(replicas, initial, stream, propagators, executor);
+
+    SplittingResult result;
+    double probability = 1.0;
+    std::vector<std::size_t> scores(n);
+    std::vector<std::size_t> killed;
+    std::vector<std::size_t> survivors;
+    std::vector<std::size_t> parents;
+    std::vector<std::uint64_t> seeds;
+    for (;;) {
+        for (std::size_t i = 0; i < n; ++i) {
+            scores[i] = replicas[i].score;
+        }
+        std::nth_element(scores.begin(), scores.begin() + (options.kill_count - 1),
+                         scores.end());
+        const std::size_t level = scores[options.kill_count - 1];
+        if (level >= final_frame) {
+            break;
+        }
+
+        killed.clear();
+        survivors.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            (replicas[i].score <= level ? killed : survivors).push_back(i);
+        }
+        probability *= static_cast<double>(survivors.size()) /
+                       static_cast<double>(n);
+        ++result.iterations;
+        result.dwell_times.push_back(static_cast<double>(level + 1) * frame_dt);
+        result.tail_probabilities.push_back(probability);
+        if (survivors.empty()) {
+            break;
+        }
+
+        parents.resize(killed.size());
+        seeds.resize(killed.size());
+        for (std::size_t j = 0; j < killed.size(); ++j) {
+            parents[j] = survivors[static_cast<std::size_t>(
+                splitmix64(stream) % survivors.size())];
+            seeds[j] = splitmix64(stream);
+        }
+        // Clones only read survivors and only write discarded replicas.
+        executor.parallel_for(killed.size(), [&](std::size_t worker, std::size_t j) {
+            ReplicaPropagator &propagator = propagators[worker];
+            Replica &clone = replicas[killed[j]];
+            std::vector<double> branch(initial.size());
+            propagator.state_at(replicas[parents[j]], level + 1, branch.data());
+            propagator.start(clone, branch.data(), level + 1, seeds[j]);
+            propagator.run(clone, direction);
+        });
+    }
+
+    for (const Replica &replica : replicas) {
+        result.survivors += replica.score >= final_frame ? 1 : 0;
+    }
+    result.probability =
+        probability * static_cast<double>(result.survivors) / static_cast<double>(n);
+    for (const ReplicaPropagator &propagator : propagators) {
+        result.frames_integrated += propagator.frames_integrated();
+    }
+    return result;
+}
+
+SplittingResult adaptive_multilevel_splitting(const SimulationConfig &cfg,
+                                              const DwellOptions &dwell,
+                                              const SplittingOptions &options,
+                                              const BatchOptions &batch) {
+    return adaptive_multilevel_splitting(cfg, dwell, options, default_executor(batch));
+}
+
+}  // namespace wheely
@@ -0,0 +1,96 @@
+#ifndef WHEELY_SPLITTING_H
+#define WHEELY_SPLITTING_H
+
+#include "wheely_batch.h"
+#include "wheely_executor.h"
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wheely {
+
+// The noisy wheel whose dwell times are sampled. Splitting needs trajectories
+// that part ways after being cloned, so the inflow of every output frame is
+// cfg.inflow_rate * (1 + inflow_noise * xi), xi standard normal, clipped at
+// zero and held through the frame. A dwell starts at t_start and lasts until
+// the first frame at which omega has the opposite sign to the initial omega.
+struct DwellOptions {
+    double inflow_noise = 0.1;
+    // [theta, omega, m_0 .. m_{n_cups-1}] at t_start; empty uses simulate()'s
+    // initial state. Its omega must not be zero.
+    std::vector<double> initial_state;
+    std::uint64_t seed = 0;
+};
+
+// Brute-force reference: the dwell time of each of n_runs independent noisy
+// runs, measured in whole frames and capped at t_end - t_start. These are
+// the trajectories adaptive_multilevel_splitting() starts from when
+// replicas == n_runs.
+std::vector<double> sample_dwell_times(const SimulationConfig &cfg,
+                                       const DwellOptions &dwell,
+                                       std::size_t n_runs,
+                                       BatchExecutor &executor);
+
+std::vector<double> sample_dwell_times(const SimulationConfig &cfg,
+                                       const DwellOptions &dwell,
+                                       std::size_t n_runs,
+                                       const BatchOptions &batch = BatchOptions());
+
+struct SplittingOptions {
+    std::size_t replicas = 200;
+    // Replicas discarded per iteration, at least; they are cloned in
+    // parallel, so this bounds the parallelism. Ties add to it.
+    std::size_t kill_count = 20;
+    // Frames between the saved states of a replica. A clone replays at
+    // most this many frames from its parent's nearest saved state.
+    std::size_t checkpoint_interval = 16;
+};
+
+struct SplittingResult {
+    // Estimate of the probability that the wheel keeps turning the initial
+    // way at every output frame up to t_end.
+    double probability = 0.0;
+    // The tail on the way there: tail_probabilities[j] estimates the
+    // probability of a dwell of at least dwell_times[j].
+    std::vector<double> dwell_times;
+    std::vector<double> tail_probabilities;
+    std::size_t iterations = 0;
+    // Replicas that reached t_end; 0 means the population died out and
+    // the estimate is 0.
+    std::size_t survivors = 0;
+    // Frames integrated, replays included. Brute force needs about
+    // (mean dwell / frame time) / probability for one hit.
+    std::size_t frames_integrated = 0;
+};
+
+// Estimates the tail of the dwell time distribution by adaptive multilevel
+// splitting (Cerou and Guyader 2007; Brehier et al. 2016), with the dwell
+// so far as the score. Each iteration discards the kill_count replicas
+// that reversed earliest, ties included, and multiplies the estimate by the
+// fraction kept. Every discarded replica is replaced by a clone of a random
+// survivor, taken one frame past the discarded level, which then goes on
+// with a noise stream of its own. The estimate is unbiased, and its relative
+// error grows like sqrt(log(1 / probability) / replicas), so tails far too
+// thin for brute force stay within reach.
+//
+// Parents and noise seeds are drawn serially, so the result does not
+// depend on the thread count, nor on checkpoint_interval.
+//
+// Throws std::invalid_argument for an invalid cfg, fewer than 2 replicas, a
+// kill_count outside [1, replicas), a zero checkpoint_interval, a negative
+// inflow_noise, or an initial state of the wrong size or with zero omega.
+SplittingResult adaptive_multilevel_splitting(const SimulationConfig &cfg,
+                                              const DwellOptions &dwell,
+                                              const SplittingOptions &options,
+                                              BatchExecutor &executor);
+
+SplittingResult adaptive_multilevel_splitting(
+    const SimulationConfig &cfg, const DwellOptions &dwell = DwellOptions(),
+    const SplittingOptions &options = SplittingOptions(),
+    const BatchOptions &batch = BatchOptions());
+
+}  // namespace wheely
+
+#endif  // WHEELY_SPLITTING_H
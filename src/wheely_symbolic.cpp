@@ -0,0 +1,154 @@
+#include "wheely_symbolic.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+std::uint64_t low_bits(std::size_t length) {
+    return length >= 64 ? ~std::uint64_t{0}
+                        : (std::uint64_t{1} << length) - 1u;
+}
+
+double entropy_bits(std::uint64_t count, double total) {
+    const double p = static_cast<double>(count) / total;
+    return -p * std::log2(p);
+}
+
+}  // namespace
+
+void PackedSymbols::push_back(bool symbol) {
+    if (size_ % 64 == 0) {
+        words_.push_back(0);
+    }
+    if (symbol) {
+        words_.back() |= std::uint64_t{1} << (size_ % 64);
+    }
+    ++size_;
+}
+
+BlockEntropyCounter::BlockEntropyCounter(std::size_t max_block_length)
+    : max_block_length_(max_block_length) {
+    if (max_block_length < 1 || max_block_length > 64) {
+        throw std::invalid_argument("max_block_length must be in 1..64");
+    }
+    for (std::size_t length = 1;
+         length <= max_block_length && length <= DENSE_MAX_BLOCK; ++length) {
+        dense_.emplace_back(std::size_t{1} << length, 0);
+    }
+    if (max_block_length > DENSE_MAX_BLOCK) {
+        sparse_.resize(max_block_length - DENSE_MAX_BLOCK);
+    }
+}
+
+void BlockEntropyCounter::push(bool symbol) {
+    window_ = (window_ << 1) | (symbol ? 1u : 0u);
+    ++symbol_count_;
+    const std::size_t complete =
+        symbol_count_ < max_block_length_
+            ? static_cast<std::size_t>(symbol_count_)
+            : max_block_length_;
+    for (std::size_t length = 1; length <= complete; ++length) {
+        const std::uint64_t word = window_ & low_bits(length);
+        if (length <= DENSE_MAX_BLOCK) {
+            ++dense_[length - 1][word];
+        } else {
+            ++sparse_[length - DENSE_MAX_BLOCK - 1][word];
+        }
+    }
+}
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>>
+BlockEntropyCounter::word_counts(std::size_t length) const {
+    if (length < 1 || length > max_block_length_) {
+        throw std::invalid_argument("length must be in 1..max_block_length");
+    }
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> counts;
+    if (length <= DENSE_MAX_BLOCK) {
+        const auto &table = dense_[length - 1];
+        for (std::uint64_t word = 0; word < table.size(); ++word) {
+            if (table[word] != 0) {
+                counts.emplace_back(word, table[word]);
+            }
+        }
+    } else {
+        const auto &table = sparse_[length - DENSE_MAX_BLOCK - 1];
+        counts.assign(table.begin(), table.end());
+    }
+    return counts;
+}
+
+std::vector<double> BlockEntropyCounter::block_entropies() const {
+    std::vector<double> entropies(max_block_length_, 0.0);
+    for (std::size_t length = 1; length <= max_block_length_; ++length) {
+        if (symbol_count_ < length) {
+            break;
+        }
+        const double total = static_cast<double>(symbol_count_ - length + 1);
+        double entropy = 0.0;
+        if (length <= DENSE_MAX_BLOCK) {
+            for (const std::uint64_t count : dense_[length - 1]) {
+                if (count != 0) {
+                    entropy += entropy_bits(count, total);
+                }
+            }
+        } else {
+            for (const auto &entry : sparse_[length - DENSE_MAX_BLOCK - 1]) {
+                entropy += entropy_bits(entry.second, total);
+            }
+        }
+        entropies[length - 1] = entropy;
+    }
+    return entropies;
+}
+
+double entropy_rate_estimate(const std::vector<double> &block_entropies) {
+    if (block_entropies.empty()) {
+        return 0.0;
+    }
+    const std::size_t last = block_entropies.size() - 1;
+    return last == 0 ? block_entropies[0]
+                     : block_entropies[last] - block_entropies[last - 1];
+}
+
+SymbolicAnalysis analyze_symbolic_dynamics(const SimulationConfig &cfg,
+                                           const SymbolicOptions &options) {
+    BlockEntropyCounter counter(options.max_block_length);
+    SymbolicAnalysis analysis;
+    const auto emit = [&](bool symbol) {
+        counter.push(symbol);
+        if (options.keep_symbols) {
+            analysis.symbols.push_back(symbol);
+        }
+    };
+
+    if (options.encoding == SymbolEncoding::omega_extrema) {
+        EventOptions events;
+        events.omega_reversals = false;
+        events.omega_maxima = true;
+        events.omega_minima = true;
+        events.inflow_crossings = false;
+        simulate_events_streaming(cfg, events, [&](const SimulationEvent &event) {
+            // A maximum while turning backwards (or a minimum while turning
+            // forwards) is a slowdown within one swing, not a new swing.
+            if (event.kind == EventKind::omega_maximum && event.omega > 0.0) {
+                emit(true);
+            } else if (event.kind == EventKind::omega_minimum &&
+                       event.omega < 0.0) {
+                emit(false);
+            }
+        });
+    } else {
+        simulate_streaming(cfg, [&](std::size_t, double, const double *state) {
+            emit(state[1] > 0.0);
+        });
+    }
+
+    analysis.symbol_count = counter.symbol_count();
+    analysis.block_entropies = counter.block_entropies();
+    analysis.entropy_rate = entropy_rate_estimate(analysis.block_entropies);
+    return analysis;
+}
+
+}  // namespace wheely
@@ -0,0 +1,102 @@
+#ifndef WHEELY_SYMBOLIC_H
+#define WHEELY_SYMBOLIC_H
+
+#include "wheely_simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace wheely {
+
+// Binary symbols packed 64 to a word, least significant bit first.
+class PackedSymbols {
+public:
+    void push_back(bool symbol);
+
+    bool operator[](std::size_t index) const {
+        return (words_[index / 64] >> (index % 64)) & 1u;
+    }
+    std::size_t size() const { return size_; }
+    const std::vector<std::uint64_t> &words() const { return words_; }
+
+private:
+    std::vector<std::uint64_t> words_;
+    std::size_t size_ = 0;
+};
+
+// Streaming word counts for every block length 1..max_block_length (at most
+// 64) over a binary symbol sequence. The last 64 symbols are kept in one
+// register, and each new symbol rolls it forward, so the key of the
+// length-L word ending at the current symbol is the register's low L bits.
+// Lengths up to DENSE_MAX_BLOCK are counted in flat tables, and longer ones
+// in hash maps keyed by that rolling word. Memory depends on the number of
+// distinct words, not on how many symbols are pushed.
+class BlockEntropyCounter {
+public:
+    static constexpr std::size_t DENSE_MAX_BLOCK = 20;
+
+    // Throws std::invalid_argument unless 1 <= max_block_length <= 64.
+    explicit BlockEntropyCounter(std::size_t max_block_length);
+
+    void push(bool symbol);
+
+    std::size_t max_block_length() const { return max_block_length_; }
+    std::uint64_t symbol_count() const { return symbol_count_; }
+
+    // (word, count) for every word of the given length seen so far, with the
+    // oldest symbol in the most significant bit.
+    std::vector<std::pair<std::uint64_t, std::uint64_t>>
+    word_counts(std::size_t length) const;
+
+    // Shannon entropy in bits of the length-L words, for L = 1..max; H_L is
+    // element L - 1. Lengths with no complete word yet are 0.
+    std::vector<double> block_entropies() const;
+
+private:
+    std::size_t max_block_length_;
+    std::uint64_t window_ = 0;
+    std::uint64_t symbol_count_ = 0;
+    std::vector<std::vector<std::uint64_t>> dense_;
+    std::vector<std::unordered_map<std::uint64_t, std::uint64_t>> sparse_;
+};
+
+enum class SymbolEncoding {
+    // One symbol per swing: 1 at each local maximum of omega while it is
+    // positive, 0 at each local minimum while it is negative. Since omega
+    // is proportional to the Lorenz x coordinate, this is the usual
+    // left/right lobe sequence.
+    omega_extrema,
+    // The sign of omega at every output frame (1 if positive).
+    omega_sign_per_frame,
+};
+
+struct SymbolicOptions {
+    SymbolEncoding encoding = SymbolEncoding::omega_extrema;
+    std::size_t max_block_length = 12;
+    // Keep the packed symbol string; off, memory use is only the counts.
+    bool keep_symbols = true;
+};
+
+struct SymbolicAnalysis {
+    PackedSymbols symbols;
+    std::uint64_t symbol_count = 0;
+    // H_L in bits for L = 1..max_block_length.
+    std::vector<double> block_entropies;
+    // h = H_L - H_{L-1} at the longest block length, in bits per symbol.
+    double entropy_rate = 0.0;
+};
+
+// Entropy-rate estimate H_L - H_{L-1} from block entropies H_1..H_L.
+double entropy_rate_estimate(const std::vector<double> &block_entropies);
+
+// Runs cfg and encodes it into symbols while it integrates, feeding each one
+// to a BlockEntropyCounter. The trajectory is never stored.
+SymbolicAnalysis analyze_symbolic_dynamics(const SimulationConfig &cfg,
+                                           const SymbolicOptions &options = {});
+
+}  // namespace wheely
+
+#endif  // WHEELY_SYMBOLIC_H
@@ -0,0 +1,334 @@
+#include "wheely_ulam.h"
+#include "wheely_control.h"
+
+#include "wheely_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace wheely {
+namespace {
+
+std::uint64_t transition_key(std::uint32_t from, std::uint32_t to) {
+    return (static_cast<std::uint64_t>(from) << 32) | to;
+}
+
+// y = P x with P the row-normalized counts; rows with no counts give 0.
+void multiply_right(const SparseTransitionCounts &counts,
+                    const std::vector<double> &row_totals,
+                    const std::vector<double> &x, std::vector<double> &y) {
+    for (std::size_t row = 0; row < counts.n_cells; ++row) {
+        double sum = 0.0;
+        for (std::uint64_t k = counts.row_offsets[row];
+             k < counts.row_offsets[row + 1]; ++k) {
+            sum += static_cast<double>(counts.counts[k]) * x[counts.columns[k]];
+        }
+        y[row] = row_totals[row] > 0.0 ? sum / row_totals[row] : 0.0;
+    }
+}
+
+// y = x P, i.e. y_j = sum_i x_i P_ij.
+void multiply_left(const SparseTransitionCounts &counts,
+                   const std::vector<double> &row_totals,
+                   const std::vector<double> &x, std::vector<double> &y) {
+    std::fill(y.begin(), y.end(), 0.0);
+    for (std::size_t row = 0; row < counts.n_cells; ++row) {
+        if (row_totals[row] == 0.0 || x[row] == 0.0) {
+            continue;
+        }
+        const double weight = x[row] / row_totals[row];
+        for (std::uint64_t k = counts.row_offsets[row];
+             k < counts.row_offsets[row + 1]; ++k) {
+            y[counts.columns[k]] += weight * static_cast<double>(counts.counts[k]);
+        }
+    }
+}
+
+}  // namespace
+
+LorenzPoint lorenz_coordinates(const double *state, std::size_t n_cups) {
+    const double cup_angle_step = TWO_PI / static_cast<double>(n_cups);
+    LorenzPoint point;
+    point.omega = state[1];
+    for (std::size_t cup = 0; cup < n_cups; ++cup) {
+        double s = 0.0;
+        double c = 0.0;
+        sincos(state[0] + cup_angle_step * static_cast<double>(cup), s, c);
+        point.y += state[2 + cup] * s;
+        point.z += state[2 + cup] * c;
+    }
+    return point;
+}
+
+std::size_t LorenzGrid::cell_of(const LorenzPoint &point) const {
+    const double values[3] = {point.omega, point.y, point.z};
+    std::size_t cell = 0;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        const double value = values[axis];
+        // Written so that NaN also lands outside.
+        if (!(value >= lower[axis] && value < upper[axis])) {
+            return cell_count();
+        }
+        const double scaled = (value - lower[axis]) /
+                              (upper[axis] - lower[axis]) *
+                              static_cast<double>(bins[axis]);
+        const std::size_t index =
+            std::min(bins[axis] - 1, static_cast<std::size_t>(scaled));
+        cell = cell * bins[axis] + index;
+    }
+    return cell;
+}
+
+void LorenzGrid::validate() const {
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        if (bins[axis] < 1) {
+            throw std::invalid_argument("grid bins must be positive");
+        }
+        if (!(upper[axis] > lower[axis])) {
+            throw std::invalid_argument("grid upper must exceed lower");
+        }
+    }
+    if (static_cast<double>(bins[0]) * static_cast<double>(bins[1]) *
+            static_cast<double>(bins[2]) >= 4294967295.0) {
+        throw std::invalid_argument("grid has too many cells");
+    }
+}
+
+void TransitionCounter::add(std::uint32_t from, std::uint32_t to,
+                            std::uint64_t count) {
+    counts_[transition_key(from, to)] += count;
+}
+
+void TransitionCounter::merge(const TransitionCounter &other) {
+    for (const auto &entry : other.counts_) {
+        counts_[entry.first] += entry.second;
+    }
+    outside += other.outside;
+}
+
+SparseTransitionCounts TransitionCounter::to_csr(std::size_t n_cells) const {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> entries(
+        counts_.begin(), counts_.end());
+    std::sort(entries.begin(), entries.end());
+
+    SparseTransitionCounts csr;
+    csr.n_cells = n_cells;
+    csr.outside = outside;
+    csr.row_offsets.assign(n_cells + 1, 0);
+    csr.columns.reserve(entries.size());
+    csr.counts.reserve(entries.size());
+    for (const auto &entry : entries) {
+        const auto from = static_cast<std::size_t>(entry.first >> 32);
+        if (from >= n_cells) {
+            throw std::invalid_argument("transition outside n_cells");
+        }
+        ++csr.row_offsets[from + 1];
+        csr.columns.push_back(static_cast<std::uint32_t>(entry.first));
+        csr.counts.push_back(entry.second);
+    }
+    for (std::size_t row = 0; row < n_cells; ++row) {
+        csr.row_offsets[row + 1] += csr.row_offsets[row];
+    }
+    return csr;
+}
+
+std::vector<double> sample_trajectory_states(const SimulationConfig &cfg,
+                                             std::size_t burn_in_frames) {
+    const std::size_t state_size = cfg.n_cups + 2;
+    std::vector<double> states;
+    if (burn_in_frames < cfg.n_frames) {
+        states.reserve((cfg.n_frames - burn_in_frames) * state_size);
+    }
+    simulate_streaming(cfg, [&](std::size_t frame, double, const double *state) {
+        if (frame >= burn_in_frames) {
+            states.insert(states.end(), state, state + state_size);
+        }
+    });
+    return states;
+}
+
+SparseTransitionCounts count_transitions(const SimulationConfig &cfg,
+                                         const LorenzGrid &grid,
+                                         const std::vector<double> &initial_states,
+                                         double flight_time,
+                                         std::size_t flight_steps,
+                                         BatchExecutor &executor) {
+    grid.validate();
+    // One frame interval of flight_steps steps covering flight_time.
+    SimulationConfig flight = cfg;
+    flight.t_start = 0.0;
+    flight.t_end = flight_time;
+    flight.n_frames = 2;
+    flight.steps_per_frame = flight_steps;
+    validate_config(flight);
+
+    const std::size_t state_size = cfg.n_cups + 2;
+    if (initial_states.size() % state_size != 0) {
+        throw std::invalid_argument(
+            "initial_states must hold whole states of n_cups + 2 values");
+    }
+    const std::size_t n_trajectories = initial_states.size() / state_size;
+    const std::size_t outside = grid.cell_count();
+
+    // Each worker reuses one stepper and one state buffer for all of its
+    // trajectories, so a flight allocates nothing.
+    const ControlInput input{flight.inflow_rate, 0.0};
+    std::vector<ControlledStepper> steppers;
+    steppers.reserve(executor.size());
+    for (std::size_t worker = 0; worker < executor.size(); ++worker) {
+        steppers.emplace_back(flight);
+    }
+    std::vector<double> worker_states(executor.size() * state_size);
+    std::vector<TransitionCounter> per_worker(executor.size());
+    executor.parallel_for(n_trajectories, [&](std::size_t worker,
+                                              std::size_t index) {
+        TransitionCounter &counter = per_worker[worker];
+        const double *start = initial_states.data() + index * state_size;
+        const std::size_t from =
+            grid.cell_of(lorenz_coordinates(start, cfg.n_cups));
+        if (from == outside) {
+            ++counter.outside;
+            return;
+        }
+        double *state = worker_states.data() + worker * state_size;
+        std::copy(start, start + state_size, state);
+        for (std::size_t step = 0; step < flight_steps; ++step) {
+            steppers[worker].step(state, input);
+        }
+        const std::size_t to =
+            grid.cell_of(lorenz_coordinates(state, cfg.n_cups));
+        if (to == outside) {
+            ++counter.outside;
+            return;
+        }
+        counter.add(static_cast<std::uint32_t>(from),
+                    static_cast<std::uint32_t>(to));
+    });
+
+    TransitionCounter merged;
+    for (const TransitionCounter &counter : per_worker) {
+        merged.merge(counter);
+    }
+    return merged.to_csr(grid.cell_count());
+}
+
+SparseTransitionCounts count_transitions(const SimulationConfig &cfg,
+                                         const LorenzGrid &grid,
+                                         const std::vector<double> &initial_states,
+                                         double flight_time,
+                                         std::size_t flight_steps,
+                                         const BatchOptions &options) {
+    return count_transitions(cfg, grid, initial_states, flight_time,
+                             flight_steps, default_executor(options));
+}
+
+TransferAnalysis analyze_transfer_operator(const SparseTransitionCounts &counts,
+                                           std::size_t max_iterations,
+                                           double tolerance) {
+    const std::size_t n = counts.n_cells;
+    std::vector<double> row_totals(n, 0.0);
+    std::size_t active = 0;
+    for (std::size_t row = 0; row < n; ++row) {
+        for (std::uint64_t k = counts.row_offsets[row];
+             k < counts.row_offsets[row + 1]; ++k) {
+            row_totals[row] += static_cast<double>(counts.counts[k]);
+        }
+        if (row_totals[row] > 0.0) {
+            ++active;
+        }
+    }
+
+    TransferAnalysis analysis;
+    analysis.invariant_density.assign(n, 0.0);
+    analysis.second_eigenvector.assign(n, 0.0);
+    if (active == 0) {
+        return analysis;
+    }
+
+    // Invariant density: pi <- (pi + pi P) / 2. The lazy step has the same
+    // fixed point and also converges for periodic chains. Mass sent to
+    // cells without outgoing counts is dropped by renormalizing.
+    std::vector<double> &pi = analysis.invariant_density;
+    for (std::size_t row = 0; row < n; ++row) {
+        pi[row] = row_totals[row] > 0.0 ? 1.0 / static_cast<double>(active) : 0.0;
+    }
+    std::vector<double> next(n, 0.0);
+    for (std::size_t iteration = 0; iteration < max_iterations; ++iteration) {
+        multiply_left(counts, row_totals, pi, next);
+        double total = 0.0;
+        for (std::size_t row = 0; row < n; ++row) {
+            next[row] = row_totals[row] > 0.0 ? 0.5 * (pi[row] + next[row]) : 0.0;
+            total += next[row];
+        }
+        double change = 0.0;
+        for (std::size_t row = 0; row < n; ++row) {
+            next[row] /= total;
+            change += std::abs(next[row] - pi[row]);
+        }
+        pi.swap(next);
+        if (change < tolerance) {
+            break;
+        }
+    }
+
+    // Second eigenvector of R = (P + P^)/2 with P^_ij = pi_j P_ji / pi_i,
+    // which is self-adjoint in the pi-weighted inner product, so its
+    // spectrum is real. Iterating (I + R)/2 moves that spectrum into
+    // [0, 1], and removing the component along the constant vector (the
+    // eigenvalue 1) after each step leaves the second eigenvalue dominant.
+    std::vector<double> &v = analysis.second_eigenvector;
+    for (std::size_t row = 0; row < n; ++row) {
+        v[row] = pi[row] > 0.0 ? std::sin(1.0 + static_cast<double>(row)) : 0.0;
+    }
+    std::vector<double> forward(n, 0.0);
+    std::vector<double> weighted(n, 0.0);
+    std::vector<double> backward(n, 0.0);
+    const auto project_and_normalize = [&](std::vector<double> &x) {
+        double mean = 0.0;
+        for (std::size_t row = 0; row < n; ++row) {
+            mean += pi[row] * x[row];
+        }
+        double norm = 0.0;
+        for (std::size_t row = 0; row < n; ++row) {
+            x[row] = pi[row] > 0.0 ? x[row] - mean : 0.0;
+            norm += pi[row] * x[row] * x[row];
+        }
+        norm = std::sqrt(norm);
+        if (norm > 0.0) {
+            for (double &value : x) {
+                value /= norm;
+            }
+        }
+    };
+    project_and_normalize(v);
+    double lambda = 0.0;
+    for (std::size_t iteration = 0; iteration < max_iterations; ++iteration) {
+        multiply_right(counts, row_totals, v, forward);
+        for (std::size_t row = 0; row < n; ++row) {
+            weighted[row] = pi[row] * v[row];
+        }
+        multiply_left(counts, row_totals, weighted, backward);
+        double change = 0.0;
+        double rayleigh = 0.0;
+        for (std::size_t row = 0; row < n; ++row) {
+            const double reversed = pi[row] > 0.0 ? backward[row] / pi[row] : 0.0;
+            const double rv = 0.5 * (forward[row] + reversed);
+            rayleigh += pi[row] * v[row] * rv;
+            next[row] = 0.5 * (v[row] + rv);
+        }
+        project_and_normalize(next);
+        for (std::size_t row = 0; row < n; ++row) {
+            change += pi[row] * std::abs(next[row] - v[row]);
+        }
+        v.swap(next);
+        lambda = rayleigh;
+        if (change < tolerance) {
+            break;
+        }
+    }
+    analysis.second_eigenvalue = lambda;
+    return analysis;
+}
+
+}  // namespace wheely
@@ -0,0 +1,114 @@
+#ifndef WHEELY_ULAM_H
+#define WHEELY_ULAM_H
+
+#include "wheely_batch.h"
+#include "wheely_executor.h"
+#include "wheely_simulation.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace wheely {
+
+// Lorenz coordinates of a wheel state [theta, omega, m_0 ..]: omega and the
+// first Fourier moments of the mass distribution about the top,
+// y = sum m_k sin(phi_k) and z = sum m_k cos(phi_k), with phi_k the lab
+// angle of cup k.
+struct LorenzPoint {
+    double omega = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+};
+
+LorenzPoint lorenz_coordinates(const double *state, std::size_t n_cups);
+
+// Regular box partition of (omega, y, z). Cells are numbered with omega
+// varying slowest: (i_omega * bins[1] + i_y) * bins[2] + i_z.
+struct LorenzGrid {
+    std::array<double, 3> lower{};
+    std::array<double, 3> upper{};
+    std::array<std::size_t, 3> bins{};
+
+    std::size_t cell_count() const { return bins[0] * bins[1] * bins[2]; }
+
+    // Cell containing point, or cell_count() if it lies outside the box.
+    std::size_t cell_of(const LorenzPoint &point) const;
+
+    // Throws std::invalid_argument for empty bins or lower >= upper.
+    void validate() const;
+};
+
+// Row-compressed transition counts between grid cells:
+// counts[k] transitions from row r to columns[k] for k in
+// [row_offsets[r], row_offsets[r + 1]), columns ascending within a row.
+struct SparseTransitionCounts {
+    std::size_t n_cells = 0;
+    std::vector<std::uint64_t> row_offsets;
+    std::vector<std::uint32_t> columns;
+    std::vector<std::uint64_t> counts;
+    // Trajectories that started or ended outside the grid.
+    std::uint64_t outside = 0;
+};
+
+// Sparse accumulator of (from, to) cell transitions. Each worker fills its
+// own and they are merged once at the end, so counting needs no locks.
+class TransitionCounter {
+public:
+    void add(std::uint32_t from, std::uint32_t to, std::uint64_t count = 1);
+    void merge(const TransitionCounter &other);
+    SparseTransitionCounts to_csr(std::size_t n_cells) const;
+
+    std::uint64_t outside = 0;
+
+private:
+    std::unordered_map<std::uint64_t, std::uint64_t> counts_;
+};
+
+// The wheel states [theta, omega, masses] of every frame of cfg from
+// burn_in_frames on, back to back; seeds on the attractor for
+// count_transitions().
+std::vector<double> sample_trajectory_states(const SimulationConfig &cfg,
+                                             std::size_t burn_in_frames);
+
+// Integrates each of the (n_cups + 2)-value states in initial_states for
+// flight_time, in flight_steps RK4 steps with cfg's physical parameters, and
+// counts the grid transition from its start to its end. Trajectories run in
+// parallel on executor with one TransitionCounter per worker. Counts are
+// integers, so the result does not depend on scheduling.
+SparseTransitionCounts count_transitions(const SimulationConfig &cfg,
+                                         const LorenzGrid &grid,
+                                         const std::vector<double> &initial_states,
+                                         double flight_time,
+                                         std::size_t flight_steps,
+                                         BatchExecutor &executor);
+
+SparseTransitionCounts count_transitions(const SimulationConfig &cfg,
+                                         const LorenzGrid &grid,
+                                         const std::vector<double> &initial_states,
+                                         double flight_time,
+                                         std::size_t flight_steps,
+                                         const BatchOptions &options = BatchOptions());
+
+struct TransferAnalysis {
+    // Stationary distribution of the row-normalized counts (sums to 1).
+    std::vector<double> invariant_density;
+    // Second eigenpair of the chain reversibilized with respect to the
+    // invariant density. The sign of the eigenvector splits the cells into
+    // two almost-invariant sets; the closer the eigenvalue is to 1, the
+    // more rarely the dynamics crosses between them.
+    std::vector<double> second_eigenvector;
+    double second_eigenvalue = 0.0;
+};
+
+// Power iteration on the Ulam matrix P = row-normalized counts. Cells
+// without outgoing transitions get zero density.
+TransferAnalysis analyze_transfer_operator(const SparseTransitionCounts &counts,
+                                           std::size_t max_iterations = 100000,
+                                           double tolerance = 1e-12);
+
+}  // namespace wheely
+
+#endif  // WHEELY_ULAM_H
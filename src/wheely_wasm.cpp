@@ -1,20 +1,236 @@
+#include "wheely_arena.h"
+#include "wheely_session.h"
 #include "wheely_simulation.h"
 
 #include <emscripten/bind.h>
+#include <emscripten/heap.h>
+#include <emscripten/val.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
 
 namespace {
 
+// Sizes and indices cross the JS boundary as double, never size_t. Under
+// MEMORY64 embind hands a 64-bit size_t to JS as a BigInt, which cannot be
+// mixed with the client's Number arithmetic. A double holds every size below
+// 2^53 exactly, and the wasm32 build sees the same Numbers it always did.
+std::size_t to_size(double value) {
+    // 2^53 on wasm64, SIZE_MAX (exact as a double) on wasm32.
+    const double limit =
+        std::min(9007199254740992.0,
+                 static_cast<double>(std::numeric_limits<std::size_t>::max()));
+    if (!(value > 0.0)) {
+        return 0;
+    }
+    return static_cast<std::size_t>(std::min(value, limit));
+}
+
+// The register_vector() interface (size, get, set, push_back, resize) with
+// double sizes and indices.
+template <typename T>
+double vector_size(const std::vector<T> &values) {
+    return static_cast<double>(values.size());
+}
+
+template <typename T>
+emscripten::val vector_get(const std::vector<T> &values, double index) {
+    const std::size_t i = to_size(index);
+    return i < values.size() ? emscripten::val(values[i])
+                             : emscripten::val::undefined();
+}
+
+template <typename T>
+bool vector_set(std::vector<T> &values, double index, const T &value) {
+    const std::size_t i = to_size(index);
+    if (i >= values.size()) {
+        return false;
+    }
+    values[i] = value;
+    return true;
+}
+
+template <typename T>
+void vector_push_back(std::vector<T> &values, const T &value) {
+    values.push_back(value);
+}
+
+template <typename T>
+void vector_resize(std::vector<T> &values, double size, const T &value) {
+    values.resize(to_size(size), value);
+}
+
+template <typename T>
+void register_sized_vector(const char *name) {
+    emscripten::class_<std::vector<T>>(name)
+        .template constructor<>()
+        .function("size", &vector_size<T>)
+        .function("get", &vector_get<T>)
+        .function("set", &vector_set<T>)
+        .function("push_back", &vector_push_back<T>)
+        .function("resize", &vector_resize<T>);
+}
+
+template <std::size_t wheely::SimulationConfig::*Field>
+double get_size_field(const wheely::SimulationConfig &cfg) {
+    return static_cast<double>(cfg.*Field);
+}
+
+template <std::size_t wheely::SimulationConfig::*Field>
+void set_size_field(wheely::SimulationConfig &cfg, double value) {
+    cfg.*Field = to_size(value);
+}
+
+// Grows linear memory once so that `bytes` more can be allocated without
+// further growth. Each growth copies the heap and detaches every
+// HEAP*/typed_memory_view on the JS side, so large runs size the heap up
+// front instead of growing step by step inside malloc. The top of the sbrk
+// area is used as the baseline, which ignores free blocks inside the heap
+// and so errs towards growing a little too much. Returns false if the
+// request is beyond the module's maximum memory.
+bool reserve_heap(double bytes) {
+    const double in_use =
+        static_cast<double>(reinterpret_cast<std::uintptr_t>(sbrk(0)));
+    const double target = in_use + bytes;
+    if (target <= static_cast<double>(emscripten_get_heap_size())) {
+        return true;
+    }
+    if (target > static_cast<double>(emscripten_get_heap_max())) {
+        return false;
+    }
+    return emscripten_resize_heap(static_cast<std::size_t>(target));
+}
+
 wheely::SimulationResult run_simulation(const wheely::SimulationConfig &cfg) {
+    reserve_heap(wheely::estimate_peak_bytes(cfg));
     return wheely::simulate(cfg);
 }
 
+int run_in_arena(wheely::SimulationArena &arena,
+                 const wheely::SimulationConfig &cfg) {
+    // The arena owns the result storage, so only its growth and the
+    // integrator scratch are new allocations.
+    const double result_bytes = (static_cast<double>(cfg.n_cups) + 2.0) *
+                                static_cast<double>(cfg.n_frames) *
+                                sizeof(double);
+    reserve_heap(arena.growth_bytes(cfg) + wheely::estimate_peak_bytes(cfg) -
+                 result_bytes);
+    return static_cast<int>(arena.run(cfg));
+}
+
+// Zero-copy Float64Array views onto the arena. They stay valid until the
+// arena grows or the heap does; reading them right after run() is safe.
+emscripten::val arena_times(const wheely::SimulationArena &arena) {
+    return emscripten::val(
+        emscripten::typed_memory_view(arena.frame_count(), arena.times()));
+}
+
+emscripten::val arena_theta(const wheely::SimulationArena &arena) {
+    return emscripten::val(
+        emscripten::typed_memory_view(arena.frame_count(), arena.theta()));
+}
+
+emscripten::val arena_masses(const wheely::SimulationArena &arena) {
+    return emscripten::val(emscripten::typed_memory_view(
+        arena.cup_count() * arena.frame_count(), arena.masses()));
+}
+
+// Minimal entry point for tiny runs: scalar arguments instead of a
+// value_object, no result vectors and no exceptions. `out` is a heap address
+// with room for (n_cups + 2) * n_frames doubles, filled with times, theta
+// and then the cup-major masses. Returns the SimulationStatus as an int.
+int simulate_into_heap(double n_cups, double radius, double g,
+                       double damping, double leak_rate, double inflow_rate,
+                       double inertia, double omega0, double t_start,
+                       double t_end, double n_frames, double steps_per_frame,
+                       double out) {
+    wheely::SimulationConfig cfg;
+    cfg.n_cups = to_size(n_cups);
+    cfg.radius = radius;
+    cfg.g = g;
+    cfg.damping = damping;
+    cfg.leak_rate = leak_rate;
+    cfg.inflow_rate = inflow_rate;
+    cfg.inertia = inertia;
+    cfg.omega0 = omega0;
+    cfg.t_start = t_start;
+    cfg.t_end = t_end;
+    cfg.n_frames = to_size(n_frames);
+    cfg.steps_per_frame = to_size(steps_per_frame);
+
+    double *times = reinterpret_cast<double *>(to_size(out));
+    double *theta = times + cfg.n_frames;
+    double *masses = theta + cfg.n_frames;
+    return static_cast<int>(wheely::simulate_into(cfg, times, theta, masses));
+}
+
+// Message for a SimulationStatus returned as an int by run() or
+// simulate_into_heap(), so JS does not keep its own copy of the table.
+std::string status_message(int status) {
+    return wheely::status_message(
+        static_cast<wheely::SimulationStatus>(status));
+}
+
+std::string simulate_fingerprint(const wheely::SimulationConfig &cfg) {
+    return wheely::result_fingerprint(wheely::simulate(cfg));
+}
+
+double estimate_session_bytes(const wheely::SimulationConfig &cfg,
+                              double checkpoint_interval) {
+    return wheely::estimate_session_bytes(cfg, to_size(checkpoint_interval));
+}
+
+wheely::LabBinnedResult simulate_lab_bins(const wheely::SimulationConfig &cfg,
+                                          double n_bins) {
+    return wheely::simulate_lab_bins(cfg, to_size(n_bins));
+}
+
+wheely::CupPositions cup_positions(const std::vector<double> &theta,
+                                   double n_cups, double radius) {
+    return wheely::cup_positions(theta, to_size(n_cups), radius);
+}
+
+wheely::SimulationSession *make_session(const wheely::SimulationConfig &cfg,
+                                        double checkpoint_interval) {
+    return new wheely::SimulationSession(cfg, to_size(checkpoint_interval));
+}
+
+double session_frame_count(const wheely::SimulationSession &session) {
+    return static_cast<double>(session.frame_count());
+}
+
+wheely::SimulationResult session_frames(const wheely::SimulationSession &session,
+                                        double first, double count) {
+    return session.frames(to_size(first), to_size(count));
+}
+
+wheely::DecimatedSeries session_theta_decimated(
+    const wheely::SimulationSession &session, double t_min, double t_max,
+    double pixel_width) {
+    return session.theta_decimated(t_min, t_max, to_size(pixel_width));
+}
+
+double arena_frame_count(const wheely::SimulationArena &arena) {
+    return static_cast<double>(arena.frame_count());
+}
+
+double arena_cup_count(const wheely::SimulationArena &arena) {
+    return static_cast<double>(arena.cup_count());
+}
+
 }  // namespace
 
 EMSCRIPTEN_BINDINGS(wheely_wasm_module) {
-    emscripten::register_vector<double>("VectorDouble");
+    register_sized_vector<double>("VectorDouble");
 
     emscripten::value_object<wheely::SimulationConfig>("SimulationConfig")
-        .field("n_cups", &wheely::SimulationConfig::n_cups)
+        .field("n_cups",
+               &get_size_field<&wheely::SimulationConfig::n_cups>,
+               &set_size_field<&wheely::SimulationConfig::n_cups>)
         .field("radius", &wheely::SimulationConfig::radius)
         .field("g", &wheely::SimulationConfig::g)
         .field("damping", &wheely::SimulationConfig::damping)
@@ -24,13 +240,82 @@ EMSCRIPTEN_BINDINGS(wheely_wasm_module) {
         .field("omega0", &wheely::SimulationConfig::omega0)
         .field("t_start", &wheely::SimulationConfig::t_start)
         .field("t_end", &wheely::SimulationConfig::t_end)
-        .field("n_frames", &wheely::SimulationConfig::n_frames)
-        .field("steps_per_frame", &wheely::SimulationConfig::steps_per_frame);
+        .field("n_frames",
+               &get_size_field<&wheely::SimulationConfig::n_frames>,
+               &set_size_field<&wheely::SimulationConfig::n_frames>)
+        .field("steps_per_frame",
+               &get_size_field<&wheely::SimulationConfig::steps_per_frame>,
+               &set_size_field<&wheely::SimulationConfig::steps_per_frame>);
 
     emscripten::value_object<wheely::SimulationResult>("SimulationResult")
         .field("times", &wheely::SimulationResult::times)
         .field("theta", &wheely::SimulationResult::theta)
         .field("masses", &wheely::SimulationResult::masses);
 
+    emscripten::value_object<wheely::LabBinnedResult>("LabBinnedResult")
+        .field("times", &wheely::LabBinnedResult::times)
+        .field("theta", &wheely::LabBinnedResult::theta)
+        .field("bins", &wheely::LabBinnedResult::bins);
+
+    emscripten::enum_<wheely::EventKind>("EventKind")
+        .value("omega_reversal", wheely::EventKind::omega_reversal)
+        .value("omega_maximum", wheely::EventKind::omega_maximum)
+        .value("omega_minimum", wheely::EventKind::omega_minimum)
+        .value("inflow_entry", wheely::EventKind::inflow_entry)
+        .value("inflow_exit", wheely::EventKind::inflow_exit);
+
+    emscripten::value_object<wheely::SimulationEvent>("SimulationEvent")
+        .field("time", &wheely::SimulationEvent::time)
+        .field("theta", &wheely::SimulationEvent::theta)
+        .field("omega", &wheely::SimulationEvent::omega)
+        .field("cup", &wheely::SimulationEvent::cup)
+        .field("kind", &wheely::SimulationEvent::kind)
+        .field("direction", &wheely::SimulationEvent::direction);
+    register_sized_vector<wheely::SimulationEvent>("VectorEvent");
+
+    emscripten::value_object<wheely::EventOptions>("EventOptions")
+        .field("omega_reversals", &wheely::EventOptions::omega_reversals)
+        .field("omega_maxima", &wheely::EventOptions::omega_maxima)
+        .field("omega_minima", &wheely::EventOptions::omega_minima)
+        .field("inflow_crossings", &wheely::EventOptions::inflow_crossings);
+
+    emscripten::value_object<wheely::DecimatedSeries>("DecimatedSeries")
+        .field("x", &wheely::DecimatedSeries::x)
+        .field("y", &wheely::DecimatedSeries::y);
+
+    emscripten::value_object<wheely::CupPositions>("CupPositions")
+        .field("x", &wheely::CupPositions::x)
+        .field("y", &wheely::CupPositions::y);
+
     emscripten::function("simulate", &run_simulation);
+    emscripten::function("reserve_heap", &reserve_heap);
+    emscripten::function("estimate_peak_bytes", &wheely::estimate_peak_bytes);
+    emscripten::function("estimate_session_bytes", &estimate_session_bytes);
+    emscripten::function("simulate_into_heap", &simulate_into_heap);
+    emscripten::function("simulate_fingerprint", &simulate_fingerprint);
+    emscripten::function("status_message", &status_message);
+    emscripten::function("simulate_lab_bins", &simulate_lab_bins);
+    emscripten::function("simulate_events", &wheely::simulate_events);
+    emscripten::function("cup_positions", &cup_positions);
+
+    emscripten::class_<wheely::SimulationSession>("SimulationSession")
+        .constructor(&make_session, emscripten::allow_raw_pointers())
+        .function("frame_count", &session_frame_count)
+        .function("t_start", &wheely::SimulationSession::t_start)
+        .function("t_end", &wheely::SimulationSession::t_end)
+        .function("times", &wheely::SimulationSession::times)
+        .function("theta", &wheely::SimulationSession::theta)
+        .function("mass_min", &wheely::SimulationSession::mass_min)
+        .function("mass_max", &wheely::SimulationSession::mass_max)
+        .function("frames", &session_frames)
+        .function("theta_decimated", &session_theta_decimated);
+
+    emscripten::class_<wheely::SimulationArena>("SimulationArena")
+        .constructor<>()
+        .function("run", &run_in_arena)
+        .function("frame_count", &arena_frame_count)
+        .function("cup_count", &arena_cup_count)
+        .function("times", &arena_times)
+        .function("theta", &arena_theta)
+        .function("masses", &arena_masses);
 }
@@ -0,0 +1,232 @@
+#include "wheely_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wheely {
+namespace {
+
+// Alignment and length granularity O_DIRECT needs on common filesystems.
+constexpr std::size_t IO_BLOCK = 4096;
+
+std::size_t round_up(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+unsigned char *allocate_block_aligned(std::size_t bytes) {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, IO_BLOCK, bytes) != 0) {
+        throw std::bad_alloc();
+    }
+    return static_cast<unsigned char *>(ptr);
+}
+
+[[noreturn]] void throw_errno(const char *what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+}  // namespace
+
+FrameWriter::FrameWriter(const std::string &path, std::size_t record_doubles,
+                         const FrameWriterOptions &options)
+    : record_bytes_(record_doubles * sizeof(double)),
+      capacity_(round_up(std::max(options.buffer_bytes, record_bytes_),
+                         IO_BLOCK)) {
+    if (record_doubles == 0) {
+        throw std::invalid_argument("record_doubles must be positive");
+    }
+
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (options.direct_io) {
+        fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        direct_io_ = fd_ >= 0;
+    }
+#endif
+    if (fd_ < 0) {
+        fd_ = ::open(path.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+        throw_errno("open");
+    }
+
+    try {
+        buffers_[0].data = allocate_block_aligned(capacity_);
+        buffers_[1].data = allocate_block_aligned(capacity_);
+    } catch (...) {
+        std::free(buffers_[0].data);
+        ::close(fd_);
+        throw;
+    }
+    active_ = &buffers_[0];
+    flusher_ = std::thread([this] { run_flusher(); });
+}
+
+FrameWriter::~FrameWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+    std::free(buffers_[0].data);
+    std::free(buffers_[1].data);
+}
+
+void FrameWriter::write(const double *record) {
+    if (fd_ < 0) {
+        throw std::logic_error("FrameWriter is closed");
+    }
+    // Records may straddle the buffer boundary; split them byte-wise.
+    const auto *bytes = reinterpret_cast<const unsigned char *>(record);
+    std::size_t remaining = record_bytes_;
+    while (remaining > 0) {
+        const std::size_t chunk = std::min(remaining, capacity_ - active_->used);
+        std::memcpy(active_->data + active_->used, bytes, chunk);
+        active_->used += chunk;
+        bytes += chunk;
+        remaining -= chunk;
+        if (active_->used == capacity_) {
+            hand_off();
+        }
+    }
+    logical_size_ += record_bytes_;
+}
+
+void FrameWriter::hand_off() {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_ == nullptr || failure_; });
+    stall_seconds_ += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    if (failure_) {
+        std::rethrow_exception(failure_);
+    }
+
+    pending_ = active_;
+    pending_offset_ = file_offset_;
+    file_offset_ += active_->used;
+    active_ = active_ == &buffers_[0] ? &buffers_[1] : &buffers_[0];
+    active_->used = 0;
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void FrameWriter::run_flusher() {
+    for (;;) {
+        Buffer *buffer = nullptr;
+        std::uint64_t offset = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return pending_ != nullptr || stopping_; });
+            if (pending_ == nullptr) {
+                return;
+            }
+            buffer = pending_;
+            offset = pending_offset_;
+        }
+
+        try {
+            write_fully(buffer->data, buffer->used, offset);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            failure_ = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = nullptr;
+        }
+        cv_.notify_all();
+    }
+}
+
+void FrameWriter::write_fully(const unsigned char *data, std::size_t length,
+                              std::uint64_t offset) {
+    while (length > 0) {
+        const ssize_t written =
+            ::pwrite(fd_, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("pwrite");
+        }
+        data += written;
+        length -= static_cast<std::size_t>(written);
+        offset += static_cast<std::uint64_t>(written);
+    }
+}
+
+void FrameWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    std::exception_ptr failure;
+    try {
+        // O_DIRECT writes must cover whole blocks: pad the tail and trim the
+        // file back to its logical size afterwards.
+        if (direct_io_ && active_->used % IO_BLOCK != 0) {
+            const std::size_t padded = round_up(active_->used, IO_BLOCK);
+            std::memset(active_->data + active_->used, 0, padded - active_->used);
+            active_->used = padded;
+        }
+        if (active_->used > 0) {
+            hand_off();
+        }
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    flusher_.join();
+    if (!failure) {
+        failure = failure_;
+    }
+
+    if (!failure && direct_io_ &&
+        ::ftruncate(fd_, static_cast<off_t>(logical_size_)) != 0) {
+        failure = std::make_exception_ptr(std::system_error(
+            errno, std::generic_category(), "ftruncate"));
+    }
+    if (::close(fd_) != 0 && !failure) {
+        failure = std::make_exception_ptr(
+            std::system_error(errno, std::generic_category(), "close"));
+    }
+    fd_ = -1;
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+std::uint64_t simulate_to_file(const SimulationConfig &cfg,
+                               const std::string &path,
+                               const FrameWriterOptions &options) {
+    validate_config(cfg);
+
+    FrameWriter writer(path, cfg.n_cups + 2, options);
+    std::vector<double> record(cfg.n_cups + 2);
+    simulate_streaming(cfg, [&](std::size_t, double time, const double *state) {
+        record[0] = time;
+        record[1] = state[0];
+        std::memcpy(record.data() + 2, state + 2, cfg.n_cups * sizeof(double));
+        writer.write(record.data());
+    });
+    writer.close();
+    return writer.bytes_written();
+}
+
+}  // namespace wheely
@@ -0,0 +1,91 @@
+#ifndef WHEELY_WRITER_H
+#define WHEELY_WRITER_H
+
+#include "wheely_simulation.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace wheely {
+
+struct FrameWriterOptions {
+    // Size of each of the two staging buffers, rounded up to a multiple of
+    // the 4 KiB direct-I/O block size.
+    std::size_t buffer_bytes = std::size_t{8} << 20;
+    // Open with O_DIRECT to bypass the page cache. Falls back to buffered
+    // writes where the platform or filesystem refuses it.
+    bool direct_io = false;
+};
+
+// Appends fixed-size records of doubles to a file without making the caller
+// wait for the disk. The caller fills one buffer while a background thread
+// pwrite()s the other; write() only blocks when both buffers are full, i.e.
+// when the disk is slower than the producer.
+class FrameWriter {
+public:
+    FrameWriter(const std::string &path, std::size_t record_doubles,
+                const FrameWriterOptions &options = FrameWriterOptions());
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    // Copies record_doubles values from record into the active buffer.
+    // Rethrows any I/O error raised by the background thread.
+    void write(const double *record);
+
+    // Flushes everything, stops the background thread and closes the file.
+    // Throws std::system_error on I/O failure. Called by the destructor,
+    // which swallows errors; call it explicitly to observe them.
+    void close();
+
+    std::uint64_t bytes_written() const { return logical_size_; }
+    bool direct_io() const { return direct_io_; }
+    // Total time write() spent waiting for the background thread.
+    double stall_seconds() const { return stall_seconds_; }
+
+private:
+    struct Buffer {
+        unsigned char *data = nullptr;
+        std::size_t used = 0;
+    };
+
+    void hand_off();
+    void run_flusher();
+    void write_fully(const unsigned char *data, std::size_t length,
+                     std::uint64_t offset);
+
+    int fd_ = -1;
+    bool direct_io_ = false;
+    std::size_t record_bytes_;
+    std::size_t capacity_;
+    Buffer buffers_[2];
+    Buffer *active_;
+    std::uint64_t logical_size_ = 0;
+    std::uint64_t file_offset_ = 0;
+    double stall_seconds_ = 0.0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Buffer *pending_ = nullptr;
+    std::uint64_t pending_offset_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr failure_;
+    std::thread flusher_;
+};
+
+// Runs cfg and streams every frame to `path` as one record of n_cups + 2
+// native-endian doubles: [time, theta, m_0 .. m_{n_cups-1}]. Read back with
+// numpy.fromfile(path).reshape(-1, n_cups + 2). Returns the bytes written.
+std::uint64_t simulate_to_file(
+    const SimulationConfig &cfg, const std::string &path,
+    const FrameWriterOptions &options = FrameWriterOptions());
+
+}  // namespace wheely
+
+#endif  // WHEELY_WRITER_H
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_adjoint.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include "wheely_test_config.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_adjoint_config() {
+    SimulationConfig cfg = make_chaotic_config(7, 6.0, 61, 5);
+    cfg.omega0 = 0.3;
+    return cfg;
+}
+
+// sum over frames of omega^2 + 0.5 * m_3^2 + 0.1 * sin(theta).
+double frame_loss(std::size_t, double, const double *state, double *gradient) {
+    gradient[0] = 0.1 * std::cos(state[0]);
+    gradient[1] = 2.0 * state[1];
+    gradient[2 + 3] = state[2 + 3];
+    return state[1] * state[1] + 0.5 * state[5] * state[5] +
+           0.1 * std::sin(state[0]);
+}
+
+double loss_only(const SimulationConfig &cfg, const CupParameters &cups) {
+    return adjoint_gradient(cfg, cups, frame_loss).loss;
+}
+
+CupParameters make_cups() {
+    CupParameters cups;
+    cups.leak_rates = {0.20, 0.25, 0.15, 0.30, 0.22, 0.18, 0.21};
+    cups.initial_masses = {0.5, 0.0, 0.2, 0.1, 0.0, 0.3, 0.4};
+    return cups;
+}
+
+}  // namespace
+
+TEST(WheelyAdjointTest, ForwardSweepReproducesSimulate) {
+    // 7 cups take the generic kernel, 12 a table-driven one. The run is long
+    // enough for any difference in rounding to surface.
+    for (std::size_t n_cups : {std::size_t{7}, std::size_t{12}}) {
+        SimulationConfig cfg = make_adjoint_config();
+        cfg.n_cups = n_cups;
+        cfg.t_end = 30.0;
+        cfg.n_frames = 301;
+        const SimulationResult result = simulate(cfg);
+        std::vector<bool> seen(cfg.n_frames, false);
+        AdjointOptions options;
+        options.snapshots = 3;
+        adjoint_gradient(
+            cfg, CupParameters(),
+            [&](std::size_t frame, double, const double *state, double *) {
+                seen[frame] = true;
+                EXPECT_EQ(state[0], result.theta[frame]) << "frame " << frame;
+                for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+                    EXPECT_EQ(state[2 + cup],
+                              result.masses[cup * cfg.n_frames + frame])
+                        << "frame " << frame << " cup " << cup;
+                }
+                return 0.0;
+            },
+            options);
+        EXPECT_EQ(std::count(seen.begin(), seen.end(), true),
+                  static_cast<std::ptrdiff_t>(cfg.n_frames));
+    }
+}
+
+TEST(WheelyAdjointTest, LossMatchesSimulate) {
+    const SimulationConfig cfg = make_adjoint_config();
+    const SimulationResult result = simulate(cfg);
+    double expected = 0.0;
+    std::vector<std::size_t> frames;
+    const double loss =
+        adjoint_gradient(cfg, CupParameters(),
+                         [&](std::size_t frame, double time, const double *state,
+                             double *gradient) {
+                             frames.push_back(frame);
+                             EXPECT_NEAR(time, result.times[frame], 1e-12);
+                             return frame_loss(frame, time, state, gradient);
+                         })
+            .loss;
+    for (std::size_t frame = 0; frame < cfg.n_frames; ++frame) {
+        double state[9] = {result.theta[frame], 0.0};
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            state[2 + cup] = result.masses[cup * cfg.n_frames + frame];
+        }
+        double unused[9] = {};
+        expected += frame_loss(frame, 0.0, state, unused);
+    }
+    // omega is not stored by simulate(); the other terms must agree.
+    ASSERT_EQ(frames.size(), cfg.n_frames);
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(frames[i], cfg.n_frames - 1 - i);
+    }
+    const double omega_terms =
+        adjoint_gradient(cfg, CupParameters(),
+                         [](std::size_t, double, const double *state, double *) {
+                             return state[1] * state[1];
+                         })
+            .loss;
+    EXPECT_NEAR(loss - omega_terms, expected, 1e-10 * std::abs(expected));
+}
+
+TEST(WheelyAdjointTest, MatchesFiniteDifferences) {
+    const SimulationConfig cfg = make_adjoint_config();
+    const CupParameters cups = make_cups();
+    const AdjointGradient gradient = adjoint_gradient(cfg, cups, frame_loss);
+
+    const double h = 1e-6;
+    auto central = [&](auto &&perturb) {
+        SimulationConfig plus_cfg = cfg;
+        SimulationConfig minus_cfg = cfg;
+        CupParameters plus_cups = cups;
+        CupParameters minus_cups = cups;
+        perturb(plus_cfg, plus_cups, h);
+        perturb(minus_cfg, minus_cups, -h);
+        return (loss_only(plus_cfg, plus_cups) - loss_only(minus_cfg, minus_cups)) /
+               (2.0 * h);
+    };
+    auto expect_close = [](double adjoint, double fd, const char *what) {
+        EXPECT_NEAR(adjoint, fd, 1e-5 * std::max(1.0, std::abs(fd))) << what;
+    };
+
+    for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+        expect_close(gradient.leak_rates[cup],
+                     central([cup](SimulationConfig &, CupParameters &c, double d) {
+                         c.leak_rates[cup] += d;
+                     }),
+                     "leak_rates");
+        expect_close(gradient.initial_masses[cup],
+                     central([cup](SimulationConfig &, CupParameters &c, double d) {
+                         c.initial_masses[cup] += d;
+                     }),
+                     "initial_masses");
+    }
+    expect_close(gradient.omega0,
+                 central([](SimulationConfig &c, CupParameters &, double d) {
+                     c.omega0 += d;
+                 }),
+                 "omega0");
+    expect_close(gradient.damping,
+                 central([](SimulationConfig &c, CupParameters &, double d) {
+                     c.damping += d;
+                 }),
+                 "damping");
+    expect_close(gradient.inflow_rate,
+                 central([](SimulationConfig &c, CupParameters &, double d) {
+                     c.inflow_rate += d;
+                 }),
+                 "inflow_rate");
+    expect_close(gradient.inertia,
+                 central([](SimulationConfig &c, CupParameters &, double d) {
+                     c.inertia += d;
+                 }),
+                 "inertia");
+    EXPECT_NE(gradient.inflow_rate, 0.0);
+}
+
+TEST(WheelyAdjointTest, CheckpointBudgetTradesMemoryForRecomputation) {
+    const SimulationConfig cfg = make_adjoint_config();
+    const CupParameters cups = make_cups();
+    const std::size_t n_steps = (cfg.n_frames - 1) * cfg.steps_per_frame;
+
+    AdjointOptions options;
+    options.snapshots = n_steps;
+    const AdjointGradient stored = adjoint_gradient(cfg, cups, frame_loss, options);
+    // Enough snapshots for every step: each is integrated twice at most.
+    EXPECT_LE(stored.forward_steps, 2 * n_steps);
+
+    std::size_t previous_steps = 0;
+    for (std::size_t snapshots : {std::size_t{8}, std::size_t{4}, std::size_t{2}}) {
+        options.snapshots = snapshots;
+        const AdjointGradient g = adjoint_gradient(cfg, cups, frame_loss, options);
+        EXPECT_LE(g.peak_snapshots, snapshots);
+        EXPECT_GT(g.forward_steps, previous_steps);
+        previous_steps = g.forward_steps;
+        // The same steps are reversed in the same order, whatever the schedule.
+        EXPECT_EQ(g.loss, stored.loss);
+        EXPECT_EQ(g.omega0, stored.omega0);
+        EXPECT_EQ(g.leak_rates, stored.leak_rates);
+        EXPECT_EQ(g.initial_masses, stored.initial_masses);
+    }
+
+    const AdjointGradient automatic = adjoint_gradient(cfg, cups, frame_loss);
+    // 300 steps: 4 * ceil(log2(300)) = 36 snapshots, and C(36 + 2, 2) =
+    // 703 >= 300, so no step is recomputed more than twice.
+    EXPECT_LE(automatic.peak_snapshots, 36u);
+    EXPECT_LE(automatic.forward_steps, 3 * n_steps);
+    EXPECT_EQ(automatic.initial_masses, stored.initial_masses);
+
+    CupParameters wrong;
+    wrong.leak_rates = {0.1, 0.2};
+    EXPECT_THROW(adjoint_gradient(cfg, wrong, frame_loss), std::invalid_argument);
+}
+
+}  // namespace wheely
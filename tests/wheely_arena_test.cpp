@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_arena.cpp"
+#include "../src/wheely_memory.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include "wheely_test_config.h"
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_arena_config(std::size_t n_cups, std::size_t n_frames) {
+    return make_damped_config(n_cups, 10.0, n_frames, 2);
+}
+
+}  // namespace
+
+TEST(WheelyArenaTest, MatchesSimulateBitForBit) {
+    SimulationArena arena;
+    const auto cfg = make_arena_config(12, 80);
+    ASSERT_EQ(arena.run(cfg), SimulationStatus::ok);
+    ASSERT_EQ(arena.frame_count(), cfg.n_frames);
+    ASSERT_EQ(arena.cup_count(), cfg.n_cups);
+
+    const auto expected = simulate(cfg);
+    EXPECT_TRUE(std::equal(expected.times.begin(), expected.times.end(),
+                           arena.times()));
+    EXPECT_TRUE(std::equal(expected.theta.begin(), expected.theta.end(),
+                           arena.theta()));
+    EXPECT_TRUE(std::equal(expected.masses.begin(), expected.masses.end(),
+                           arena.masses()));
+}
+
+TEST(WheelyArenaTest, GrowsOnlyForLargerRuns) {
+    SimulationArena arena;
+    const auto large = make_arena_config(16, 200);
+    const auto small = make_arena_config(8, 50);
+
+    EXPECT_DOUBLE_EQ(arena.growth_bytes(large),
+                     18.0 * 200.0 * sizeof(double));
+    ASSERT_EQ(arena.run(large), SimulationStatus::ok);
+    const double *storage = arena.times();
+    const std::size_t capacity = arena.capacity();
+
+    EXPECT_EQ(arena.growth_bytes(small), 0.0);
+    ASSERT_EQ(arena.run(small), SimulationStatus::ok);
+    ASSERT_EQ(arena.run(large), SimulationStatus::ok);
+    EXPECT_EQ(arena.times(), storage);
+    EXPECT_EQ(arena.capacity(), capacity);
+}
+
+TEST(WheelyArenaTest, ReportsFailuresWithoutThrowing) {
+    SimulationArena arena;
+    ASSERT_EQ(arena.run(make_arena_config(4, 10)), SimulationStatus::ok);
+
+    auto invalid = make_arena_config(4, 10);
+    invalid.n_frames = 1;
+    EXPECT_EQ(arena.run(invalid), SimulationStatus::invalid_n_frames);
+    EXPECT_EQ(arena.frame_count(), 0u);
+
+    const std::size_t too_many = std::size_t{1} << 40;
+    const auto huge = make_arena_config(too_many, too_many);
+    EXPECT_EQ(arena.reserve(huge), SimulationStatus::out_of_memory);
+}
+
+TEST(WheelyArenaTest, EstimatesPeakBytesOfSimulate) {
+    const auto small = make_arena_config(8, 100);
+    EXPECT_DOUBLE_EQ(estimate_peak_bytes(small), 10.0 * 100.0 * sizeof(double));
+
+    const auto wide = make_arena_config(100, 100);
+    EXPECT_DOUBLE_EQ(estimate_peak_bytes(wide),
+                     (102.0 * 100.0 + 6.0 * 102.0) * sizeof(double));
+}
+
+}  // namespace wheely
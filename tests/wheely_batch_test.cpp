@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_batch.cpp"
+#include "../src/wheely_executor.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include <cstring>
+
+namespace wheely {
+namespace {
+
+std::vector<SimulationConfig> make_batch_configs() {
+    std::vector<SimulationConfig> configs;
+    // Cup counts cover every remainder of the torque lane width.
+    for (std::size_t n_cups : {1u, 2u, 3u, 5u, 8u, 13u, 64u}) {
+        for (double omega0 : {-0.5, 1.0}) {
+            SimulationConfig cfg;
+            cfg.n_cups = n_cups;
+            cfg.radius = 1.0;
+            cfg.g = 9.81;
+            cfg.damping = 1.5;
+            cfg.leak_rate = 0.1;
+            cfg.inflow_rate = 0.9;
+            cfg.inertia = 4.0;
+            cfg.omega0 = omega0;
+            cfg.t_start = 0.0;
+            cfg.t_end = 15.0;
+            cfg.n_frames = 60;
+            cfg.steps_per_frame = 4;
+            configs.push_back(cfg);
+        }
+    }
+    return configs;
+}
+
+bool bitwise_equal(const std::vector<double> &a, const std::vector<double> &b) {
+    return a.size() == b.size() &&
+           std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+}
+
+void expect_bitwise_equal(const SimulationResult &actual,
+                          const SimulationResult &expected) {
+    EXPECT_TRUE(bitwise_equal(actual.times, expected.times));
+    EXPECT_TRUE(bitwise_equal(actual.theta, expected.theta));
+    EXPECT_TRUE(bitwise_equal(actual.masses, expected.masses));
+}
+
+}  // namespace
+
+TEST(WheelyBatchTest, ReportsIndexOfInvalidConfig) {
+    auto configs = make_batch_configs();
+    configs[3].n_frames = 1;
+    try {
+        simulate_batch(configs);
+        FAIL() << "expected std::invalid_argument";
+    } catch (const std::invalid_argument &error) {
+        EXPECT_NE(std::string(error.what()).find("config 3"), std::string::npos);
+    }
+}
+
+TEST(WheelyBatchTest, HandlesEmptyBatch) {
+    EXPECT_TRUE(simulate_batch({}).empty());
+}
+
+// Reproducibility matrix: every thread count must reproduce the serial
+// results bit-for-bit, including thread counts that do not divide the batch
+// and more threads than runs.
+TEST(WheelyBatchTest, ResultsAreIndependentOfThreadCount) {
+    const auto configs = make_batch_configs();
+    std::vector<SimulationResult> serial;
+    for (const auto &cfg : configs) {
+        serial.push_back(simulate(cfg));
+    }
+
+    for (std::size_t n_threads : {1u, 2u, 3u, 4u, 7u, 16u, 64u}) {
+        BatchOptions options;
+        options.n_threads = n_threads;
+        const auto results = simulate_batch(configs, options);
+        ASSERT_EQ(results.size(), configs.size());
+        for (std::size_t index = 0; index < configs.size(); ++index) {
+            SCOPED_TRACE("threads=" + std::to_string(n_threads) +
+                         " run=" + std::to_string(index));
+            expect_bitwise_equal(results[index], serial[index]);
+        }
+    }
+}
+
+TEST(WheelyBatchTest, RepeatedBatchesAreBitIdentical) {
+    const auto configs = make_batch_configs();
+    BatchOptions options;
+    options.n_threads = 5;
+    const auto first = simulate_batch(configs, options);
+    const auto second = simulate_batch(configs, options);
+    for (std::size_t index = 0; index < configs.size(); ++index) {
+        expect_bitwise_equal(second[index], first[index]);
+    }
+}
+
+TEST(WheelyBatchTest, DefaultExecutorIsSharedPerOptions) {
+    BatchOptions options;
+    options.n_threads = 3;
+    options.pin_threads = false;
+    BatchExecutor &executor = default_executor(options);
+    EXPECT_EQ(executor.size(), 3u);
+    EXPECT_EQ(&default_executor(options), &executor);
+
+    options.n_threads = 2;
+    EXPECT_NE(&default_executor(options), &executor);
+    EXPECT_EQ(default_executor(options).size(), 2u);
+}
+
+}  // namespace wheely
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_simulation.cpp"
+
+#include "wheely_test_config.h"
+
+#include <cmath>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_control_config(std::size_t n_cups) {
+    return make_chaotic_config(n_cups, 20.0, 201, 8);
+}
+
+// Passes the configured inflow through, but not as a NullController, so
+// the controlled loop itself is exercised.
+struct PassThroughController {
+    std::size_t calls = 0;
+    ControlInput operator()(double, const double *,
+                            const SimulationConfig &cfg) {
+        ++calls;
+        return {cfg.inflow_rate, 0.0};
+    }
+};
+
+struct ConstantController {
+    ControlInput input;
+    ControlInput operator()(double, const double *,
+                            const SimulationConfig &) const {
+        return input;
+    }
+};
+
+void expect_identical(const SimulationResult &a, const SimulationResult &b) {
+    EXPECT_EQ(result_fingerprint(a), result_fingerprint(b));
+}
+
+}  // namespace
+
+TEST(WheelyControlTest, UncontrolledRunsMatchSimulate) {
+    // 8 cups takes a table kernel, 10 the generic one.
+    for (std::size_t n_cups : {std::size_t{8}, std::size_t{10}}) {
+        const SimulationConfig cfg = make_control_config(n_cups);
+        const SimulationResult expected = simulate(cfg);
+
+        NullController null;
+        expect_identical(simulate_controlled(cfg, null), expected);
+
+        PassThroughController pass;
+        expect_identical(simulate_controlled(cfg, pass), expected);
+        EXPECT_EQ(pass.calls, (cfg.n_frames - 1) * cfg.steps_per_frame);
+    }
+
+    SimulationConfig invalid = make_control_config(8);
+    invalid.n_frames = 1;
+    PassThroughController pass;
+    EXPECT_THROW(simulate_controlled(invalid, pass), std::invalid_argument);
+}
+
+TEST(WheelyControlTest, BrakeTorqueFollowsTheLinearSolution) {
+    // With no water the wheel obeys I omega' = -c omega - B, so
+    // omega(t) = (omega0 + B / c) exp(-c t / I) - B / c.
+    SimulationConfig cfg = make_control_config(8);
+    cfg.omega0 = 3.0;
+    ConstantController brake{{0.0, 0.4}};
+    const SimulationResult result = simulate_controlled(cfg, brake);
+
+    const double terminal = -0.4 / cfg.damping;
+    const double rate = cfg.damping / cfg.inertia;
+    for (std::size_t frame = 0; frame < cfg.n_frames; frame += 20) {
+        const double t = result.times[frame];
+        // theta is the integral of omega.
+        const double expected = (cfg.omega0 - terminal) / rate *
+                                    (1.0 - std::exp(-rate * t)) +
+                                terminal * t;
+        EXPECT_NEAR(result.theta[frame], expected, 1e-9) << "frame " << frame;
+        EXPECT_EQ(result.masses[frame], 0.0);
+    }
+}
+
+TEST(WheelyControlTest, DelayedFeedbackComparesWithTheDelayedOmega) {
+    const SimulationConfig cfg = make_control_config(8);
+    DelayedFeedbackController controller(2.0, 3, 5.0);
+    const double omegas[] = {1.0, 2.0, 4.0, 7.0, 6.0, 1.0, 20.0};
+    const double expected[] = {0.0, 0.0, 0.0, 12.0, 8.0, -5.0, 5.0};
+    for (std::size_t i = 0; i < 7; ++i) {
+        const double state[3] = {0.0, omegas[i], 0.0};
+        const ControlInput input = controller(0.0, state, cfg);
+        EXPECT_EQ(input.inflow_rate, cfg.inflow_rate);
+        EXPECT_DOUBLE_EQ(input.brake_torque, std::min(5.0, expected[i]))
+            << "call " << i;
+    }
+    EXPECT_THROW(DelayedFeedbackController(1.0, 0), std::invalid_argument);
+
+    // With zero gain it is a pass-through.
+    DelayedFeedbackController idle(0.0, 10);
+    expect_identical(simulate_controlled(cfg, idle), simulate(cfg));
+}
+
+TEST(WheelyControlTest, OgyActsOnlyAtMaximaInsideTheWindow) {
+    const SimulationConfig cfg = make_control_config(8);
+    OgyParameters parameters;
+    parameters.fixed_point = 10.0;
+    parameters.slope = -2.0;
+    parameters.sensitivity = 4.0;
+    parameters.window = 1.0;
+    parameters.max_perturbation = 0.2;
+    OgyController controller(parameters);
+
+    auto feed = [&](double omega) {
+        const double state[3] = {0.0, omega, 0.0};
+        return controller(0.0, state, cfg).inflow_rate - cfg.inflow_rate;
+    };
+    // |omega| peaks at 10.3: delta = 2 * 0.3 / 4 = 0.15, held until the
+    // next peak.
+    EXPECT_EQ(feed(9.0), 0.0);
+    EXPECT_EQ(feed(10.3), 0.0);
+    EXPECT_NEAR(feed(10.0), 0.15, 1e-12);
+    EXPECT_NEAR(feed(-2.0), 0.15, 1e-12);
+    EXPECT_NEAR(feed(-9.0), 0.15, 1e-12);
+    EXPECT_EQ(controller.maxima(), 1u);
+    // A peak of 9.5 would need 0.25, over max_perturbation: skipped.
+    EXPECT_NEAR(feed(-9.5), 0.15, 1e-12);
+    EXPECT_EQ(feed(-9.4), 0.0);
+    // A peak outside the window leaves the inflow alone.
+    EXPECT_EQ(feed(-12.0), 0.0);
+    EXPECT_EQ(feed(-11.0), 0.0);
+    EXPECT_EQ(controller.maxima(), 3u);
+
+    parameters.sensitivity = 0.0;
+    EXPECT_THROW(OgyController{parameters}, std::invalid_argument);
+
+    // Outside the window it never acts, so the run is unchanged.
+    parameters.sensitivity = 4.0;
+    parameters.window = 0.0;
+    OgyController idle(parameters);
+    expect_identical(simulate_controlled(cfg, idle), simulate(cfg));
+    EXPECT_GT(idle.maxima(), 0u);
+}
+
+}  // namespace wheely
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_decimate.cpp"
+
+#include <cmath>
+
+namespace wheely {
+
+TEST(WheelyDecimateTest, RejectsMismatchedLengths) {
+    EXPECT_THROW(decimate_min_max({0.0, 1.0}, {0.0}, 0.0, 1.0, 10),
+                 std::invalid_argument);
+}
+
+TEST(WheelyDecimateTest, ReturnsSmallWindowsUnchanged) {
+    const std::vector<double> x{0.0, 1.0, 2.0, 3.0};
+    const std::vector<double> y{4.0, 3.0, 2.0, 1.0};
+
+    const auto out = decimate_min_max(x, y, 0.0, 3.0, 100);
+
+    EXPECT_EQ(out.x, x);
+    EXPECT_EQ(out.y, y);
+}
+
+TEST(WheelyDecimateTest, KeepsExtremaOfEveryPixelBucket) {
+    const std::size_t n = 1000000;
+    std::vector<double> x(n);
+    std::vector<double> y(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] = static_cast<double>(i) * 1e-3;
+        y[i] = std::sin(x[i]) + ((i % 2000 == 1000) ? 5.0 : 0.0);
+    }
+
+    const std::size_t width = 800;
+    const auto out = decimate_min_max(x, y, 0.0, x.back(), width);
+
+    ASSERT_LE(out.x.size(), 2 * width + 2);
+    EXPECT_TRUE(std::is_sorted(out.x.begin(), out.x.end()));
+    EXPECT_DOUBLE_EQ(*std::max_element(out.y.begin(), out.y.end()),
+                     *std::max_element(y.begin(), y.end()));
+    EXPECT_DOUBLE_EQ(*std::min_element(out.y.begin(), out.y.end()),
+                     *std::min_element(y.begin(), y.end()));
+    const auto spikes = std::count_if(out.y.begin(), out.y.end(),
+                                      [](double value) { return value > 4.0; });
+    EXPECT_EQ(spikes, 500);
+}
+
+TEST(WheelyDecimateTest, KeepsNeighboursOutsideTheVisibleRange) {
+    std::vector<double> x(10000);
+    std::vector<double> y(10000);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        x[i] = static_cast<double>(i);
+        y[i] = static_cast<double>(i % 7);
+    }
+
+    const auto out = decimate_min_max(x, y, 2500.5, 7500.5, 100);
+
+    ASSERT_FALSE(out.x.empty());
+    EXPECT_DOUBLE_EQ(out.x.front(), 2500.0);
+    EXPECT_DOUBLE_EQ(out.x.back(), 7501.0);
+}
+
+}  // namespace wheely
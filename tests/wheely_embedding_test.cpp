@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_batch.cpp"
+#include "../src/wheely_embedding.cpp"
+#include "../src/wheely_executor.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include <random>
+
+namespace wheely {
+namespace {
+
+// The x coordinate of the Lorenz system (sigma 10, rho 28, beta 8/3)
+// sampled every dt after a transient, by RK4.
+std::vector<double> lorenz_x_series(std::size_t n_samples, double dt) {
+    auto derivative = [](const double *s, double *d) {
+        d[0] = 10.0 * (s[1] - s[0]);
+        d[1] = s[0] * (28.0 - s[2]) - s[1];
+        d[2] = s[0] * s[1] - 8.0 / 3.0 * s[2];
+    };
+    double state[3] = {1.0, 1.0, 1.0};
+    std::vector<double> series;
+    series.reserve(n_samples);
+    for (std::size_t step = 0; step < n_samples + 2000; ++step) {
+        double k1[3], k2[3], k3[3], k4[3], tmp[3];
+        derivative(state, k1);
+        for (int i = 0; i < 3; ++i) tmp[i] = state[i] + 0.5 * dt * k1[i];
+        derivative(tmp, k2);
+        for (int i = 0; i < 3; ++i) tmp[i] = state[i] + 0.5 * dt * k2[i];
+        derivative(tmp, k3);
+        for (int i = 0; i < 3; ++i) tmp[i] = state[i] + dt * k3[i];
+        derivative(tmp, k4);
+        for (int i = 0; i < 3; ++i) {
+            state[i] += dt / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+        }
+        if (step >= 2000) {
+            series.push_back(state[0]);
+        }
+    }
+    return series;
+}
+
+BatchExecutor &test_executor() {
+    static BatchExecutor executor([] {
+        ExecutorOptions options;
+        options.n_threads = 3;
+        options.pin_threads = false;
+        return options;
+    }());
+    return executor;
+}
+
+}  // namespace
+
+TEST(WheelyEmbeddingTest, MutualInformationSeparatesMemoryFromNoise) {
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<double> noise(200000);
+    for (double &value : noise) {
+        value = uniform(rng);
+    }
+    // Repeating each draw 10 times makes x[t] and x[t + lag] share a draw
+    // with probability 1 - lag / 10.
+    std::vector<double> held(noise.size());
+    for (std::size_t i = 0; i < held.size(); ++i) {
+        held[i] = noise[i / 10];
+    }
+
+    const std::vector<double> noise_ami =
+        average_mutual_information(noise, 12, 16, test_executor());
+    const std::vector<double> held_ami =
+        average_mutual_information(held, 12, 16, test_executor());
+    ASSERT_EQ(noise_ami.size(), 13u);
+    // Lag 0 gives the entropy of the binned series, 4 bits for 16 even bins.
+    EXPECT_NEAR(noise_ami[0], 4.0, 1e-3);
+    EXPECT_NEAR(held_ami[0], 4.0, 1e-2);
+    for (std::size_t lag = 1; lag <= 12; ++lag) {
+        EXPECT_LT(noise_ami[lag], 2e-3);
+    }
+    EXPECT_GT(held_ami[5], 1.0);
+    EXPECT_LT(held_ami[10], 2e-2);
+
+    EXPECT_EQ(first_minimum_delay({3.0, 2.0, 1.0, 1.5, 0.5}), 2u);
+    EXPECT_EQ(first_minimum_delay({3.0, 2.5, 1.0, 0.5}), 2u);
+    EXPECT_EQ(first_minimum_delay({3.0, 2.5, 2.0}), 2u);
+    EXPECT_THROW(first_minimum_delay({1.0}), std::invalid_argument);
+
+    EXPECT_THROW(average_mutual_information(noise, 12, 1, test_executor()),
+                 std::invalid_argument);
+    EXPECT_THROW(average_mutual_information(std::vector<double>(10, 1.0), 10, 8,
+                                            test_executor()),
+                 std::invalid_argument);
+}
+
+TEST(WheelyEmbeddingTest, KdTreeMatchesBruteForce) {
+    std::mt19937_64 rng(7);
+    std::normal_distribution<double> normal;
+    const std::size_t n = 3000;
+    const std::size_t dim = 3;
+    std::vector<double> points(n * dim);
+    for (double &value : points) {
+        value = normal(rng);
+    }
+    // Ties on one axis exercise the split handling.
+    for (std::size_t i = 0; i < n; i += 3) {
+        points[i * dim] = 0.5;
+    }
+    const KdTree tree(points.data(), n, dim);
+    ASSERT_EQ(tree.size(), n);
+
+    for (std::size_t q = 0; q < n; q += 7) {
+        const double *query = points.data() + q * dim;
+        for (std::size_t exclusion : {std::size_t{0}, std::size_t{25}}) {
+            std::size_t expected = n;
+            double expected_d2 = std::numeric_limits<double>::infinity();
+            for (std::size_t i = 0; i < n; ++i) {
+                if ((i > q ? i - q : q - i) <= exclusion) {
+                    continue;
+                }
+                double d2 = 0.0;
+                for (std::size_t k = 0; k < dim; ++k) {
+                    const double diff = query[k] - points[i * dim + k];
+                    d2 += diff * diff;
+                }
+                if (d2 < expected_d2) {
+                    expected = i;
+                    expected_d2 = d2;
+                }
+            }
+            const KdTree::Neighbor neighbor = tree.nearest(query, q, exclusion);
+            EXPECT_EQ(neighbor.index, expected);
+            EXPECT_DOUBLE_EQ(neighbor.squared_distance, expected_d2);
+        }
+        EXPECT_EQ(tree.nearest(query).index, q);
+        EXPECT_EQ(tree.nearest(query).squared_distance, 0.0);
+    }
+
+    const KdTree empty(points.data(), 0, dim);
+    EXPECT_EQ(empty.nearest(points.data()).index, 0u);
+}
+
+TEST(WheelyEmbeddingTest, FindsThreeDimensionsForTheLorenzX) {
+    const std::vector<double> series = lorenz_x_series(100000, 0.01);
+    EmbeddingOptions options;
+    options.max_lag = 100;
+    options.max_dimension = 6;
+    const EmbeddingAnalysis analysis =
+        analyze_embedding(series, options, test_executor());
+
+    EXPECT_EQ(analysis.mutual_information.size(), 101u);
+    EXPECT_GE(analysis.delay, 8u);
+    EXPECT_LE(analysis.delay, 20u);
+    ASSERT_GE(analysis.false_neighbor_fractions.size(), 3u);
+    EXPECT_GT(analysis.false_neighbor_fractions[0], 0.3);
+    EXPECT_EQ(analysis.dimension, 3u);
+    EXPECT_LE(analysis.false_neighbor_fractions[2], options.fnn_threshold);
+
+    ASSERT_EQ(analysis.n_points, series.size() - 2 * analysis.delay);
+    ASSERT_EQ(analysis.points.size(), analysis.n_points * 3);
+    const std::size_t i = 1234;
+    EXPECT_EQ(analysis.points[i * 3 + 0], series[i]);
+    EXPECT_EQ(analysis.points[i * 3 + 1], series[i + analysis.delay]);
+    EXPECT_EQ(analysis.points[i * 3 + 2], series[i + 2 * analysis.delay]);
+}
+
+TEST(WheelyEmbeddingTest, UsesGivenDelayAndDimension) {
+    std::vector<double> series(50);
+    for (std::size_t i = 0; i < series.size(); ++i) {
+        series[i] = static_cast<double>(i);
+    }
+    EmbeddingOptions options;
+    options.delay = 4;
+    options.dimension = 5;
+    const EmbeddingAnalysis analysis =
+        analyze_embedding(series, options, test_executor());
+    EXPECT_TRUE(analysis.mutual_information.empty());
+    EXPECT_TRUE(analysis.false_neighbor_fractions.empty());
+    EXPECT_EQ(analysis.n_points, 34u);
+    EXPECT_EQ(analysis.points[33 * 5 + 4], 49.0);
+
+    options.dimension = 20;
+    EXPECT_THROW(analyze_embedding(series, options, test_executor()),
+                 std::invalid_argument);
+}
+
+}  // namespace wheely
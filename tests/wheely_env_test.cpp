@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_env.cpp"
+#include "../src/wheely_executor.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include "wheely_test_config.h"
+
+#include <cmath>
+#include <set>
+#include <thread>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_env_config() {
+    return make_chaotic_config(8, 5.0, 51, 4);
+}
+
+VectorEnvOptions make_env_options(std::size_t n_envs, std::size_t n_threads) {
+    VectorEnvOptions options;
+    options.n_envs = n_envs;
+    options.n_threads = n_threads;
+    options.pin_threads = false;
+    return options;
+}
+
+double wrapped(double theta) {
+    double out = std::fmod(theta, TWO_PI);
+    return out < 0.0 ? out + TWO_PI : out;
+}
+
+// Expects row `env` of observations to be frame `frame` of result.
+void expect_frame(const double *observations, std::size_t env,
+                  const SimulationResult &result, const SimulationConfig &cfg,
+                  std::size_t frame) {
+    const double *row = observations + env * (cfg.n_cups + 2);
+    EXPECT_EQ(row[0], wrapped(result.theta[frame])) << "frame " << frame;
+    for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+        EXPECT_EQ(row[2 + cup], result.masses[cup * cfg.n_frames + frame])
+            << "frame " << frame << " cup " << cup;
+    }
+}
+
+}  // namespace
+
+TEST(WheelyEnvTest, NeutralActionsReproduceSimulateAndAutoReset) {
+    const SimulationConfig cfg = make_env_config();
+    const SimulationResult expected = simulate(cfg);
+
+    VectorEnv brake(cfg, make_env_options(100, 2));
+    VectorEnvOptions inflow_options = make_env_options(3, 1);
+    inflow_options.action = EnvAction::inflow_rate;
+    VectorEnv inflow(cfg, inflow_options);
+    ASSERT_EQ(brake.observation_size(), 10u);
+    ASSERT_EQ(brake.episode_steps(), 50u);
+
+    const std::vector<double> zeros(100, 0.0);
+    const std::vector<double> rates(3, cfg.inflow_rate);
+    expect_frame(brake.observations(), 0, expected, cfg, 0);
+    for (std::size_t frame = 1; frame < cfg.n_frames; ++frame) {
+        brake.step(zeros.data());
+        inflow.step(rates.data());
+        const bool last = frame + 1 == cfg.n_frames;
+        for (std::size_t env : {std::size_t{0}, std::size_t{99}}) {
+            EXPECT_EQ(brake.truncated()[env], last ? 1 : 0);
+            if (!last) {
+                expect_frame(brake.observations(), env, expected, cfg, frame);
+                const double omega = brake.observations()[env * 10 + 1];
+                EXPECT_EQ(brake.rewards()[env], -omega * omega);
+            }
+        }
+        if (!last) {
+            expect_frame(inflow.observations(), 2, expected, cfg, frame);
+            EXPECT_EQ(brake.elapsed_steps()[5], frame);
+        }
+    }
+
+    // The finished episode is kept, and every env starts over.
+    expect_frame(brake.final_observations(), 99, expected, cfg, cfg.n_frames - 1);
+    expect_frame(brake.observations(), 99, expected, cfg, 0);
+    EXPECT_EQ(brake.observations()[99 * 10 + 1], cfg.omega0);
+    EXPECT_EQ(brake.elapsed_steps()[99], 0u);
+    brake.step(zeros.data());
+    EXPECT_EQ(brake.truncated()[99], 0);
+    expect_frame(brake.observations(), 99, expected, cfg, 1);
+}
+
+TEST(WheelyEnvTest, ResultsDoNotDependOnThreadCount) {
+    const SimulationConfig cfg = make_env_config();
+    VectorEnvOptions options = make_env_options(300, 1);
+    options.omega0_spread = 0.5;
+    options.max_action = 0.3;
+    options.action_cost = 0.1;
+    options.seed = 42;
+    VectorEnv serial(cfg, options);
+    options.n_threads = 3;
+    VectorEnv parallel(cfg, options);
+
+    std::set<double> omegas;
+    for (std::size_t env = 0; env < 300; ++env) {
+        const double omega = serial.observations()[env * 10 + 1];
+        EXPECT_GE(omega, cfg.omega0 - 0.5);
+        EXPECT_LT(omega, cfg.omega0 + 0.5);
+        omegas.insert(omega);
+    }
+    EXPECT_EQ(omegas.size(), 300u);
+
+    std::vector<double> actions(300);
+    for (std::size_t step = 0; step < 120; ++step) {
+        for (std::size_t env = 0; env < 300; ++env) {
+            actions[env] = std::sin(0.1 * static_cast<double>(step + env));
+        }
+        serial.step(actions.data());
+        parallel.step(actions.data());
+    }
+    for (std::size_t i = 0; i < 300 * 10; ++i) {
+        ASSERT_EQ(serial.observations()[i], parallel.observations()[i]);
+        ASSERT_EQ(serial.final_observations()[i], parallel.final_observations()[i]);
+    }
+    for (std::size_t env = 0; env < 300; ++env) {
+        ASSERT_EQ(serial.rewards()[env], parallel.rewards()[env]);
+    }
+
+    // The action cost sees the clamped action.
+    serial.reset(7);
+    parallel.reset(7);
+    std::fill(actions.begin(), actions.end(), 5.0);
+    serial.step(actions.data());
+    parallel.step(actions.data());
+    const double omega = serial.observations()[1];
+    EXPECT_DOUBLE_EQ(serial.rewards()[0], -omega * omega - 0.1 * 0.3 * 0.3);
+    for (std::size_t i = 0; i < 300 * 10; ++i) {
+        ASSERT_EQ(serial.observations()[i], parallel.observations()[i]);
+    }
+}
+
+TEST(WheelyEnvTest, CallsFromTwoThreadsAreSerialized) {
+    const SimulationConfig cfg = make_env_config();
+    VectorEnvOptions options = make_env_options(2000, 2);
+    options.omega0_spread = 0.5;
+    options.seed = 3;
+    VectorEnv shared(cfg, options);
+
+    // One thread steps while the other resets to the constructor's seed.
+    // With whole calls serialized, the env ends up reset and then stepped
+    // some k times, every env alike.
+    const std::vector<double> actions(2000, 0.2);
+    std::thread stepper([&] {
+        for (int step = 0; step < 40; ++step) {
+            shared.step(actions.data());
+        }
+    });
+    std::thread resetter([&] {
+        for (int reset = 0; reset < 40; ++reset) {
+            shared.reset(options.seed);
+        }
+    });
+    stepper.join();
+    resetter.join();
+
+    const std::uint64_t k = shared.elapsed_steps()[0];
+    VectorEnv reference(cfg, options);
+    for (std::uint64_t step = 0; step < k; ++step) {
+        reference.step(actions.data());
+    }
+    for (std::size_t env = 0; env < 2000; ++env) {
+        ASSERT_EQ(shared.elapsed_steps()[env], k) << env;
+    }
+    for (std::size_t i = 0; i < 2000 * 10; ++i) {
+        ASSERT_EQ(shared.observations()[i], reference.observations()[i]) << i;
+    }
+}
+
+TEST(WheelyEnvTest, RejectsInvalidOptions) {
+    const SimulationConfig cfg = make_env_config();
+    EXPECT_THROW(VectorEnv(cfg, make_env_options(0, 1)), std::invalid_argument);
+    VectorEnvOptions options = make_env_options(4, 1);
+    options.omega0_spread = -1.0;
+    EXPECT_THROW(VectorEnv(cfg, options), std::invalid_argument);
+    SimulationConfig invalid = cfg;
+    invalid.n_frames = 1;
+    EXPECT_THROW(VectorEnv(invalid, make_env_options(4, 1)), std::invalid_argument);
+}
+
+}  // namespace wheely
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_executor.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace wheely {
+
+TEST(WheelyCpuListTest, ParsesRangesAndSingles) {
+    EXPECT_EQ(parse_cpu_list("0-3,8,10-11"),
+              (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(parse_cpu_list("5"), (std::vector<int>{5}));
+    EXPECT_TRUE(parse_cpu_list("").empty());
+    EXPECT_TRUE(parse_cpu_list("a-b").empty());
+}
+
+TEST(WheelyCpuTopologyTest, DetectsAtLeastOneCpu) {
+    const auto topology = CpuTopology::detect();
+    ASSERT_FALSE(topology.node_cpus.empty());
+    EXPECT_GE(topology.cpu_count(), 1u);
+}
+
+TEST(WheelyBatchExecutorTest, SpreadsWorkersAcrossNodes) {
+    CpuTopology topology;
+    topology.node_cpus = {{0, 1}, {2, 3}};
+    ExecutorOptions options;
+    options.n_threads = 4;
+    options.pin_threads = false;
+    BatchExecutor executor(options, topology);
+
+    ASSERT_EQ(executor.size(), 4u);
+    EXPECT_EQ(executor.node_of(0), 0u);
+    EXPECT_EQ(executor.node_of(1), 1u);
+    EXPECT_EQ(executor.node_of(2), 0u);
+    EXPECT_EQ(executor.node_of(3), 1u);
+}
+
+TEST(WheelyBatchExecutorTest, RunsEveryIndexExactlyOnce) {
+    ExecutorOptions options;
+    options.n_threads = 5;
+    BatchExecutor executor(options);
+
+    for (std::size_t n : {1u, 4u, 5u, 97u, 1000u}) {
+        std::vector<std::atomic<int>> hits(n);
+        executor.parallel_for(n, [&](std::size_t worker, std::size_t index) {
+            EXPECT_LT(worker, executor.size());
+            hits[index].fetch_add(1);
+        });
+        for (std::size_t index = 0; index < n; ++index) {
+            EXPECT_EQ(hits[index].load(), 1) << "n=" << n << " index=" << index;
+        }
+    }
+}
+
+TEST(WheelyBatchExecutorTest, StealsFromBusyWorkers) {
+    CpuTopology topology;
+    topology.node_cpus = {{0}, {1}};
+    ExecutorOptions options;
+    options.n_threads = 4;
+    options.pin_threads = false;
+    BatchExecutor executor(options, topology);
+
+    // Worker 0's initial range holds all the slow items; others must steal.
+    std::vector<std::size_t> ran_on(40);
+    executor.parallel_for(ran_on.size(), [&](std::size_t worker, std::size_t index) {
+        if (index < 10) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        ran_on[index] = worker;
+    });
+    std::size_t stolen = 0;
+    for (std::size_t index = 0; index < 10; ++index) {
+        stolen += ran_on[index] != 0 ? 1 : 0;
+    }
+    EXPECT_GT(stolen, 0u);
+}
+
+TEST(WheelyBatchExecutorTest, SerializesCallsFromSeveralThreads) {
+    ExecutorOptions options;
+    options.n_threads = 3;
+    options.pin_threads = false;
+    BatchExecutor executor(options);
+
+    // Overlapping jobs would clobber each other's task and ranges, losing
+    // or repeating indices.
+    std::vector<std::vector<int>> hits(4, std::vector<int>(200, 0));
+    std::vector<std::thread> callers;
+    for (std::size_t caller = 0; caller < hits.size(); ++caller) {
+        callers.emplace_back([&, caller] {
+            for (int round = 0; round < 20; ++round) {
+                executor.parallel_for(10, [&](std::size_t, std::size_t index) {
+                    ++hits[caller][static_cast<std::size_t>(round) * 10 + index];
+                });
+            }
+        });
+    }
+    for (std::thread &caller : callers) {
+        caller.join();
+    }
+
+    for (const std::vector<int> &caller_hits : hits) {
+        for (int count : caller_hits) {
+            EXPECT_EQ(count, 1);
+        }
+    }
+}
+
+TEST(WheelyBatchExecutorTest, RethrowsTaskFailure) {
+    ExecutorOptions options;
+    options.n_threads = 3;
+    BatchExecutor executor(options);
+
+    EXPECT_THROW(executor.parallel_for(50,
+                                       [](std::size_t, std::size_t index) {
+                                           if (index == 17) {
+                                               throw std::runtime_error("boom");
+                                           }
+                                       }),
+                 std::runtime_error);
+
+    std::atomic<std::size_t> count{0};
+    executor.parallel_for(10, [&](std::size_t, std::size_t) { ++count; });
+    EXPECT_EQ(count.load(), 10u);
+}
+
+}  // namespace wheely
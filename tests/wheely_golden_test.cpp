@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_simulation.cpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace wheely {
+namespace {
+
+struct GoldenCase {
+    std::string name;
+    SimulationConfig cfg;
+    std::string fingerprint;
+};
+
+std::string golden_path() {
+    const std::string source = __FILE__;
+    return source.substr(0, source.find_last_of("/\\") + 1) +
+           "golden/simulation_fingerprints.txt";
+}
+
+std::vector<GoldenCase> load_golden_cases() {
+    std::ifstream input(golden_path());
+    std::vector<GoldenCase> cases;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        GoldenCase entry;
+        SimulationConfig &cfg = entry.cfg;
+        fields >> entry.name >> cfg.n_cups >> cfg.radius >> cfg.g >>
+            cfg.damping >> cfg.leak_rate >> cfg.inflow_rate >> cfg.inertia >>
+            cfg.omega0 >> cfg.t_start >> cfg.t_end >> cfg.n_frames >>
+            cfg.steps_per_frame >> entry.fingerprint;
+        if (fields) {
+            cases.push_back(entry);
+        }
+    }
+    return cases;
+}
+
+}  // namespace
+
+TEST(WheelyGoldenTest, FingerprintChangesWithEveryBit) {
+    SimulationResult result;
+    result.times = {0.0, 1.0};
+    result.theta = {0.0, 0.5};
+    result.masses.assign(2, 0.25);
+    const std::string base = result_fingerprint(result);
+    EXPECT_EQ(base.size(), 16u);
+
+    result.masses[1] = std::nextafter(result.masses[1], 1.0);
+    EXPECT_NE(result_fingerprint(result), base);
+}
+
+TEST(WheelyGoldenTest, MatchesCrossTargetGoldenOutputs) {
+    const auto cases = load_golden_cases();
+    ASSERT_FALSE(cases.empty()) << "could not read " << golden_path();
+
+    for (const auto &entry : cases) {
+        EXPECT_EQ(result_fingerprint(simulate(entry.cfg)), entry.fingerprint)
+            << entry.name;
+    }
+}
+
+}  // namespace wheely
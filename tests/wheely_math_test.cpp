@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_math.h"
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace wheely {
+namespace {
+
+constexpr double CONTRACT_RANGE = 524288.0 * 1.5707963267948966;  // 2^19 pi/2
+
+std::int64_t ordered_bits(double value) {
+    std::int64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? std::numeric_limits<std::int64_t>::min() - bits : bits;
+}
+
+std::int64_t ulp_distance(double a, double b) {
+    const std::int64_t diff = ordered_bits(a) - ordered_bits(b);
+    return diff < 0 ? -diff : diff;
+}
+
+std::vector<double> sample_arguments() {
+    std::mt19937_64 rng(12345);
+    std::vector<double> xs;
+    std::uniform_real_distribution<double> small(-4.0, 4.0);
+    std::uniform_real_distribution<double> wide(-CONTRACT_RANGE, CONTRACT_RANGE);
+    for (int i = 0; i < 200000; ++i) {
+        xs.push_back(small(rng));
+        xs.push_back(wide(rng));
+    }
+    // Points next to multiples of pi/2, where the reduction cancels hardest.
+    for (int k = -20000; k <= 20000; k += 7) {
+        const double base = static_cast<double>(k) * 1.5707963267948966;
+        xs.push_back(base);
+        xs.push_back(std::nextafter(base, 1e300));
+        xs.push_back(std::nextafter(base, -1e300));
+    }
+    for (double tiny : {0.0, -0.0, 1e-300, -1e-20, 1e-9, 0.7853981633974483}) {
+        xs.push_back(tiny);
+    }
+    return xs;
+}
+
+template <TrigAccuracy A>
+void measure(double &max_sin_err, double &max_cos_err,
+             std::int64_t &max_sin_ulp, std::int64_t &max_cos_ulp) {
+    max_sin_err = max_cos_err = 0.0;
+    max_sin_ulp = max_cos_ulp = 0;
+    for (double x : sample_arguments()) {
+        double s = 0.0;
+        double c = 0.0;
+        sincos<A>(x, s, c);
+        const double ref_s = std::sin(x);
+        const double ref_c = std::cos(x);
+        max_sin_err = std::max(max_sin_err, std::fabs(s - ref_s));
+        max_cos_err = std::max(max_cos_err, std::fabs(c - ref_c));
+        max_sin_ulp = std::max(max_sin_ulp, ulp_distance(s, ref_s));
+        max_cos_ulp = std::max(max_cos_ulp, ulp_distance(c, ref_c));
+        EXPECT_EQ(s, wheely::sin<A>(x));
+        EXPECT_EQ(c, wheely::cos<A>(x));
+    }
+}
+
+}  // namespace
+
+TEST(WheelyTrigTest, Ulp1MatchesLibmWithinOneUlp) {
+    double sin_err;
+    double cos_err;
+    std::int64_t sin_ulp;
+    std::int64_t cos_ulp;
+    measure<TrigAccuracy::ulp1>(sin_err, cos_err, sin_ulp, cos_ulp);
+    EXPECT_LE(sin_ulp, 1);
+    EXPECT_LE(cos_ulp, 1);
+}
+
+TEST(WheelyTrigTest, Abs1e12MeetsAbsoluteContract) {
+    double sin_err;
+    double cos_err;
+    std::int64_t sin_ulp;
+    std::int64_t cos_ulp;
+    measure<TrigAccuracy::abs1e12>(sin_err, cos_err, sin_ulp, cos_ulp);
+    EXPECT_LE(sin_err, 1e-12);
+    EXPECT_LE(cos_err, 1e-12);
+}
+
+TEST(WheelyTrigTest, Abs1e7MeetsAbsoluteContract) {
+    double sin_err;
+    double cos_err;
+    std::int64_t sin_ulp;
+    std::int64_t cos_ulp;
+    measure<TrigAccuracy::abs1e7>(sin_err, cos_err, sin_ulp, cos_ulp);
+    EXPECT_LE(sin_err, 1e-7);
+    EXPECT_LE(cos_err, 1e-7);
+}
+
+TEST(WheelyTrigTest, DegradesGracefullyBeyondContractRange) {
+    for (double x : {1e7, -3.3e8, 1e12}) {
+        const double tolerance = std::fabs(x) * 4e-16;
+        EXPECT_NEAR(wheely::sin(x), std::sin(x), tolerance) << x;
+        EXPECT_NEAR(wheely::cos(x), std::cos(x), tolerance) << x;
+    }
+}
+
+TEST(WheelyTrigTest, DetectsInflowWindowAroundMultiplesOfTwoPi) {
+    const double two_pi = 6.283185307179586;
+    for (int k = -50; k <= 50; ++k) {
+        const double base = two_pi * static_cast<double>(k);
+        EXPECT_TRUE(near_zero_mod_two_pi(base + 0.05, 0.1));
+        EXPECT_TRUE(near_zero_mod_two_pi(base - 0.09, 0.1));
+        EXPECT_FALSE(near_zero_mod_two_pi(base + 0.11, 0.1));
+        EXPECT_FALSE(near_zero_mod_two_pi(base - 0.2, 0.1));
+        EXPECT_FALSE(near_zero_mod_two_pi(base + 3.1, 0.1));
+    }
+}
+
+TEST(WheelyTrigTest, TurnFractionsAreConstantExpressionsWithinOneUlp) {
+    constexpr double QUARTER_SIN = [] {
+        double s = 0.0;
+        double c = 0.0;
+        sincos_turn_fraction(1, 4, s, c);
+        return s;
+    }();
+    static_assert(QUARTER_SIN == 1.0, "sin(pi/2) must be exact");
+
+    for (std::size_t n = 1; n <= 257; ++n) {
+        for (std::size_t k = 0; k < n; ++k) {
+            double s = 0.0;
+            double c = 0.0;
+            sincos_turn_fraction(k, n, s, c);
+            // Reference in long double so it is not limited by rounding
+            // 2*pi*k/n to a double first.
+            const long double angle =
+                2.0L * 3.141592653589793238462643383279502884L *
+                static_cast<long double>(k) / static_cast<long double>(n);
+            const double ref_s = static_cast<double>(std::sin(angle));
+            const double ref_c = static_cast<double>(std::cos(angle));
+            // Exact zeros (k/n a multiple of 1/4) come out as 0.0, while
+            // the long double reference is off by ~1e-19 there.
+            if (std::fabs(ref_s) > 1e-15) {
+                EXPECT_LE(ulp_distance(s, ref_s), 1) << k << "/" << n;
+            } else {
+                EXPECT_LE(std::fabs(s), 1e-18) << k << "/" << n;
+            }
+            if (std::fabs(ref_c) > 1e-15) {
+                EXPECT_LE(ulp_distance(c, ref_c), 1) << k << "/" << n;
+            } else {
+                EXPECT_LE(std::fabs(c), 1e-18) << k << "/" << n;
+            }
+        }
+    }
+}
+
+}  // namespace wheely
+
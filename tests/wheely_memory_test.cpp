@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_memory.cpp"
+
+#include <cstdint>
+
+namespace wheely {
+namespace {
+
+class HugePageModeGuard {
+public:
+    explicit HugePageModeGuard(HugePageMode mode) : saved_(huge_page_mode()) {
+        set_huge_page_mode(mode);
+    }
+    ~HugePageModeGuard() { set_huge_page_mode(saved_); }
+
+private:
+    HugePageMode saved_;
+};
+
+}  // namespace
+
+TEST(WheelyLargeAllocationTest, DefaultsToPlainAllocation) {
+    EXPECT_EQ(huge_page_mode(), HugePageMode::off);
+    EXPECT_EQ(LargePageAllocator<double>().mode, HugePageMode::off);
+}
+
+TEST(WheelyLargeAllocationTest, MapsHugePageModesOnHugePageBoundaries) {
+    for (HugePageMode mode : {HugePageMode::off, HugePageMode::transparent,
+                              HugePageMode::explicit_pages}) {
+        const std::size_t bytes = 3 * HUGE_PAGE_SIZE + 123;
+        auto *ptr = static_cast<unsigned char *>(allocate_large(bytes, mode));
+        ASSERT_NE(ptr, nullptr);
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+        if (mode != HugePageMode::off) {
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % HUGE_PAGE_SIZE, 0u);
+        }
+#endif
+        ptr[0] = 1;
+        ptr[bytes - 1] = 2;
+        EXPECT_EQ(ptr[0] + ptr[bytes - 1], 3);
+        deallocate_large(ptr, bytes, mode);
+    }
+}
+
+TEST(WheelyLargePageAllocatorTest, BacksSmallAndLargeVectors) {
+    HugePageModeGuard guard(HugePageMode::transparent);
+    LargeBuffer small(16, 1.5);
+    LargeBuffer large(LARGE_ALLOCATION_THRESHOLD / sizeof(double) * 2, 2.5);
+
+    EXPECT_DOUBLE_EQ(small.back(), 1.5);
+    EXPECT_DOUBLE_EQ(large.back(), 2.5);
+
+    large.resize(large.size() * 3, 4.0);
+    EXPECT_DOUBLE_EQ(large.front(), 2.5);
+    EXPECT_DOUBLE_EQ(large.back(), 4.0);
+
+    small.assign(large.begin(), large.end());
+    EXPECT_EQ(small, large);
+}
+
+TEST(WheelyLargePageAllocatorTest, FreesWithTheModeItAllocatedUnder) {
+    HugePageModeGuard guard(HugePageMode::explicit_pages);
+    LargeBuffer mapped(LARGE_ALLOCATION_THRESHOLD / sizeof(double) + 1, 1.0);
+
+    // Buffers created after the switch use operator new; the earlier one
+    // must still be unmapped, including when the two are swapped.
+    set_huge_page_mode(HugePageMode::off);
+    LargeBuffer plain(LARGE_ALLOCATION_THRESHOLD / sizeof(double) + 1, 2.0);
+    EXPECT_EQ(mapped.get_allocator().mode, HugePageMode::explicit_pages);
+    EXPECT_EQ(plain.get_allocator().mode, HugePageMode::off);
+
+    mapped.swap(plain);
+    EXPECT_EQ(mapped.get_allocator().mode, HugePageMode::off);
+    EXPECT_DOUBLE_EQ(mapped.back(), 2.0);
+    EXPECT_DOUBLE_EQ(plain.back(), 1.0);
+}
+
+}  // namespace wheely
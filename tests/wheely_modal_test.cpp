@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_modal.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include <random>
+
+namespace wheely {
+namespace {
+
+// Snapshots x_k = Q a_k in R^dimension, where a_{k+1} = A a_k for a 3x3 A
+// with eigenvalues 0.99 e^{+-0.3i} and 0.95, and Q has orthonormal columns.
+std::vector<double> make_linear_snapshots(std::size_t dimension,
+                                          std::size_t frames) {
+    std::mt19937_64 rng(3);
+    std::normal_distribution<double> normal;
+    std::vector<double> q(3 * dimension);
+    for (double &value : q) {
+        value = normal(rng);
+    }
+    for (std::size_t col = 0; col < 3; ++col) {
+        double *u = q.data() + col * dimension;
+        for (std::size_t prev = 0; prev < col; ++prev) {
+            const double *v = q.data() + prev * dimension;
+            const double c = dot(u, v, dimension);
+            for (std::size_t i = 0; i < dimension; ++i) {
+                u[i] -= c * v[i];
+            }
+        }
+        const double norm = std::sqrt(dot(u, u, dimension));
+        for (std::size_t i = 0; i < dimension; ++i) {
+            u[i] /= norm;
+        }
+    }
+
+    const double rho = 0.99;
+    const double angle = 0.3;
+    double a[3] = {1.0, 0.5, 2.0};
+    std::vector<double> snapshots(frames * dimension);
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+        for (std::size_t i = 0; i < dimension; ++i) {
+            snapshots[frame * dimension + i] = a[0] * q[i] +
+                                               a[1] * q[dimension + i] +
+                                               a[2] * q[2 * dimension + i];
+        }
+        const double x = rho * (std::cos(angle) * a[0] - std::sin(angle) * a[1]);
+        const double y = rho * (std::sin(angle) * a[0] + std::cos(angle) * a[1]);
+        a[0] = x;
+        a[1] = y;
+        a[2] *= 0.95;
+    }
+    return snapshots;
+}
+
+}  // namespace
+
+TEST(WheelyModalTest, EigenvaluesOfCompanionMatrix) {
+    // x^4 - 2x^3 - x^2 + 2x + 0 has roots 0, 1, -1, 2; plus a rotation
+    // block with eigenvalues +-2i.
+    std::vector<double> a = {2.0, 1.0, -2.0, 0.0, 0.0, 0.0,
+                             1.0, 0.0, 0.0,  0.0, 0.0, 0.0,
+                             0.0, 1.0, 0.0,  0.0, 0.0, 0.0,
+                             0.0, 0.0, 1.0,  0.0, 0.0, 0.0,
+                             0.0, 0.0, 0.0,  0.0, 0.0, -2.0,
+                             0.0, 0.0, 0.0,  0.0, 2.0, 0.0};
+    const auto values = eigenvalues(a, 6);
+    const std::complex<double> expected[6] = {
+        {-1.0, 0.0}, {0.0, -2.0}, {0.0, 0.0}, {0.0, 2.0}, {1.0, 0.0}, {2.0, 0.0}};
+    ASSERT_EQ(values.size(), 6u);
+    for (const auto &target : expected) {
+        double nearest = 1e300;
+        for (const auto &value : values) {
+            nearest = std::min(nearest, std::abs(value - target));
+        }
+        EXPECT_LT(nearest, 1e-10) << target;
+    }
+}
+
+TEST(WheelyModalTest, RecoversLowRankLinearDynamicsForAnyBlockSize) {
+    const std::size_t dimension = 50;
+    const std::size_t frames = 200;
+    const auto snapshots = make_linear_snapshots(dimension, frames);
+    double energy = 0.0;
+    for (double value : snapshots) {
+        energy += value * value;
+    }
+
+    for (std::size_t block_size : {1u, 3u, 7u, 64u}) {
+        ModalOptions options;
+        options.rank = 5;
+        options.block_size = block_size;
+        StreamingModalDecomposition decomposition(dimension, options);
+        for (std::size_t frame = 0; frame < frames; ++frame) {
+            decomposition.push(snapshots.data() + frame * dimension);
+        }
+        const auto result = decomposition.result();
+
+        // Exactly rank 3: the extra rank is dropped and no energy is lost.
+        ASSERT_EQ(result.rank, 3u) << block_size;
+        EXPECT_EQ(result.frame_count, frames);
+        double captured = 0.0;
+        for (double sigma : result.singular_values) {
+            captured += sigma * sigma;
+        }
+        EXPECT_NEAR(captured, energy, 1e-9 * energy) << block_size;
+        for (std::size_t x = 0; x < 3; ++x) {
+            for (std::size_t y = 0; y < 3; ++y) {
+                EXPECT_NEAR(dot(result.modes.data() + x * dimension,
+                                result.modes.data() + y * dimension, dimension),
+                            x == y ? 1.0 : 0.0, 1e-10);
+            }
+        }
+
+        auto values = result.dmd_eigenvalues;
+        std::sort(values.begin(), values.end(),
+                  [](std::complex<double> x, std::complex<double> y) {
+                      return x.imag() < y.imag();
+                  });
+        ASSERT_EQ(values.size(), 3u);
+        EXPECT_NEAR(std::abs(values[0] - std::polar(0.99, -0.3)), 0.0, 1e-8)
+            << block_size;
+        EXPECT_NEAR(std::abs(values[1] - 0.95), 0.0, 1e-8) << block_size;
+        EXPECT_NEAR(std::abs(values[2] - std::polar(0.99, 0.3)), 0.0, 1e-8)
+            << block_size;
+    }
+}
+
+TEST(WheelyModalTest, TruncatesCupMassesWithoutStoringThem) {
+    SimulationConfig cfg;
+    cfg.n_cups = 24;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 2.0;
+    cfg.leak_rate = 0.1;
+    cfg.inflow_rate = 0.9;
+    cfg.inertia = 5.0;
+    cfg.omega0 = 0.5;
+    cfg.t_start = 0.0;
+    cfg.t_end = 60.0;
+    cfg.n_frames = 600;
+    cfg.steps_per_frame = 4;
+
+    const auto full = simulate(cfg);
+    double energy = 0.0;
+    for (std::size_t frame = 50; frame < cfg.n_frames; ++frame) {
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            const double mass = full.masses[cup * cfg.n_frames + frame];
+            energy += mass * mass;
+        }
+    }
+
+    ModalOptions exact;
+    exact.rank = cfg.n_cups;
+    exact.burn_in_frames = 50;
+    const auto all = decompose_cup_masses(cfg, exact);
+    EXPECT_EQ(all.frame_count, cfg.n_frames - 50);
+    double captured = 0.0;
+    for (double sigma : all.singular_values) {
+        captured += sigma * sigma;
+    }
+    EXPECT_NEAR(captured, energy, 1e-9 * energy);
+
+    // Each update discards the energy beyond the kept rank, so a few spare
+    // modes keep the leading ones accurate.
+    ModalOptions truncated = exact;
+    truncated.rank = 12;
+    const auto leading = decompose_cup_masses(cfg, truncated);
+    ASSERT_EQ(leading.rank, 12u);
+    ASSERT_EQ(leading.dmd_eigenvalues.size(), 12u);
+    for (std::size_t mode = 0; mode < 4; ++mode) {
+        EXPECT_NEAR(leading.singular_values[mode], all.singular_values[mode],
+                    1e-3 * all.singular_values[0])
+            << mode;
+    }
+    for (std::size_t mode = 1; mode < 4; ++mode) {
+        EXPECT_LE(leading.singular_values[mode],
+                  leading.singular_values[mode - 1]);
+    }
+
+    EXPECT_THROW(StreamingModalDecomposition(0), std::invalid_argument);
+}
+
+}  // namespace wheely
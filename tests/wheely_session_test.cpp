@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_decimate.cpp"
+#include "../src/wheely_session.cpp"
+#include "../src/wheely_simulation.cpp"
+
+#include "wheely_test_config.h"
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_session_config() {
+    return make_damped_config(6, 20.0, 101, 3);
+}
+
+}  // namespace
+
+TEST(WheelySessionTest, RejectsZeroCheckpointInterval) {
+    EXPECT_THROW(SimulationSession(make_session_config(), 0),
+                 std::invalid_argument);
+}
+
+TEST(WheelySessionTest, MatchesFullRunTimesAndAngles) {
+    const auto cfg = make_session_config();
+    const auto full = simulate(cfg);
+    const SimulationSession session(cfg, 16);
+
+    ASSERT_EQ(session.frame_count(), cfg.n_frames);
+    EXPECT_EQ(session.t_start(), full.times.front());
+    EXPECT_NEAR(session.t_end(), full.times.back(), 1e-12);
+    EXPECT_EQ(session.times(), full.times);
+    EXPECT_EQ(session.theta(), full.theta);
+    EXPECT_DOUBLE_EQ(session.mass_min(),
+                     *std::min_element(full.masses.begin(), full.masses.end()));
+    EXPECT_DOUBLE_EQ(session.mass_max(),
+                     *std::max_element(full.masses.begin(), full.masses.end()));
+}
+
+TEST(WheelySessionTest, ServesFrameRangesFromCheckpoints) {
+    const auto cfg = make_session_config();
+    const auto full = simulate(cfg);
+
+    for (std::size_t interval : {1u, 7u, 16u, 200u}) {
+        const SimulationSession session(cfg, interval);
+        const std::size_t first = 37;
+        const std::size_t count = 20;
+        const auto slice = session.frames(first, count);
+
+        ASSERT_EQ(slice.theta.size(), count);
+        ASSERT_EQ(slice.masses.size(), cfg.n_cups * count);
+        for (std::size_t offset = 0; offset < count; ++offset) {
+            EXPECT_EQ(slice.times[offset], full.times[first + offset]);
+            for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+                EXPECT_EQ(slice.masses[cup * count + offset],
+                          full.masses[cup * cfg.n_frames + first + offset]);
+            }
+        }
+    }
+}
+
+TEST(WheelySessionTest, ClampsRangesPastTheEnd) {
+    const auto cfg = make_session_config();
+    const SimulationSession session(cfg, 10);
+
+    EXPECT_EQ(session.frames(95, 50).theta.size(), 6u);
+    EXPECT_TRUE(session.frames(cfg.n_frames, 5).theta.empty());
+}
+
+TEST(WheelySessionTest, EstimatesSessionMemory) {
+    auto cfg = make_session_config();
+    const double dense = estimate_session_bytes(cfg, 1);
+    const double sparse = estimate_session_bytes(cfg, 10);
+    EXPECT_GT(dense, sparse);
+    EXPECT_GE(sparse, 2.0 * cfg.n_frames * sizeof(double) +
+                          10.0 * (cfg.n_cups + 2) * sizeof(double));
+
+    // Large runs must not wrap around even where size_t is 32 bits.
+    cfg.n_cups = 20000;
+    cfg.n_frames = 2000000;
+    EXPECT_GT(estimate_session_bytes(cfg, 32), 8e9);
+    EXPECT_THROW(estimate_session_bytes(cfg, 0), std::invalid_argument);
+}
+
+}  // namespace wheely
+
@@ -2,27 +2,39 @@
 
 #include "../src/wheely_simulation.cpp"
 
-namespace wheely {
+#include "wheely_test_config.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <thread>
+
+// Counts heap allocations so the small-run fast path can be checked to
+// perform none. noinline keeps GCC from pairing the inlined malloc/free
+// against new/delete and warning about a mismatch.
 namespace {
+std::atomic<std::size_t> allocation_count{0};
+}  // namespace
 
-SimulationConfig make_valid_config() {
-    SimulationConfig cfg;
-    cfg.n_cups = 2;
-    cfg.radius = 1.0;
-    cfg.g = 9.81;
-    cfg.damping = 0.05;
-    cfg.leak_rate = 0.02;
-    cfg.inflow_rate = 0.5;
-    cfg.inertia = 1.5;
-    cfg.omega0 = 0.0;
-    cfg.t_start = 0.0;
-    cfg.t_end = 1.0;
-    cfg.n_frames = 5;
-    cfg.steps_per_frame = 2;
-    return cfg;
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    ++allocation_count;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
 }
 
-}  // namespace
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+namespace wheely {
 
 TEST(WheelyValidateConfigTest, AcceptsValidConfiguration) {
     EXPECT_NO_THROW(validate_config(make_valid_config()));
@@ -61,7 +73,8 @@ TEST(WheelyComputeDerivativesTest, ComputesTorqueAndAngularAcceleration) {
     cfg.inflow_rate = 1.0;
 
     std::vector<double> state{0.0, 1.0, 2.0};
-    const auto derivatives = compute_derivatives(state, cfg);
+    std::vector<double> derivatives(state.size());
+    compute_derivatives(state.data(), derivatives.data(), cfg);
 
     ASSERT_EQ(derivatives.size(), state.size());
     EXPECT_DOUBLE_EQ(derivatives[0], 1.0);
@@ -76,7 +89,8 @@ TEST(WheelyComputeDerivativesTest, AppliesLeakOutsideInflowWindow) {
     cfg.inflow_rate = 2.0;
 
     std::vector<double> state{0.2, 0.0, 4.0};
-    const auto derivatives = compute_derivatives(state, cfg);
+    std::vector<double> derivatives(state.size());
+    compute_derivatives(state.data(), derivatives.data(), cfg);
 
     ASSERT_EQ(derivatives.size(), state.size());
     EXPECT_NEAR(derivatives[2], -cfg.leak_rate * state[2], 1e-9);
@@ -93,7 +107,8 @@ TEST(WheelyRk4StepTest, AdvancesAngleWithConstantAngularVelocity) {
     cfg.inertia = 1.0;
 
     std::vector<double> state{0.0, 1.0, 0.0};
-    rk4_step(state, 0.1, cfg);
+    Rk4Workspace work(state.size());
+    rk4_step(state, 0.1, cfg, work);
 
     EXPECT_NEAR(state[0], 0.1, 1e-6);
     EXPECT_NEAR(state[1], 1.0, 1e-9);
@@ -137,4 +152,338 @@ TEST(WheelySimulateTest, ProducesExpectedFramesAndAngles) {
     }
 }
 
+TEST(WheelyCupPositionsTest, PlacesCupsOnCircleCupMajor) {
+    const std::vector<double> theta = {0.0, 0.3, -12.5, 1000.0};
+    const std::size_t n_cups = 6;
+    const double radius = 2.5;
+
+    const auto positions = cup_positions(theta, n_cups, radius);
+
+    ASSERT_EQ(positions.x.size(), n_cups * theta.size());
+    ASSERT_EQ(positions.y.size(), n_cups * theta.size());
+    for (std::size_t cup = 0; cup < n_cups; ++cup) {
+        for (std::size_t frame = 0; frame < theta.size(); ++frame) {
+            const double angle =
+                theta[frame] + TWO_PI * static_cast<double>(cup) / n_cups;
+            const std::size_t index = cup * theta.size() + frame;
+            EXPECT_NEAR(positions.x[index], radius * std::cos(angle), 1e-6);
+            EXPECT_NEAR(positions.y[index], radius * std::sin(angle), 1e-6);
+        }
+    }
+    EXPECT_THROW(cup_positions(theta, 0, radius), std::invalid_argument);
+}
+
+TEST(WheelyComputeDerivativesTest, CupTablesAreBuiltAtCompileTime) {
+    static_assert(CUP_TABLE<4>.cos_offset[0] == 1.0, "");
+    static_assert(CUP_TABLE<4>.sin_offset[1] == 1.0, "");
+    static_assert(CUP_TABLE<8>.cos_offset[4] == -1.0, "");
+    static_assert(alignof(CupTable<12>) == 64, "");
+
+    for (std::size_t cup = 0; cup < 12; ++cup) {
+        const double angle = TWO_PI * static_cast<double>(cup) / 12.0;
+        EXPECT_NEAR(CUP_TABLE<12>.sin_offset[cup], std::sin(angle), 1e-15);
+        EXPECT_NEAR(CUP_TABLE<12>.cos_offset[cup], std::cos(angle), 1e-15);
+    }
+}
+
+TEST(WheelyComputeDerivativesTest, SpecializedKernelsMatchGenericKernel) {
+    for (std::size_t n_cups : {4u, 6u, 8u, 12u, 16u, 24u, 32u, 64u}) {
+        SimulationConfig cfg = make_valid_config();
+        cfg.n_cups = n_cups;
+        cfg.inflow_rate = 1.5;
+        cfg.leak_rate = 0.3;
+        const DerivativeKernel kernel = derivative_kernel(n_cups);
+        ASSERT_NE(kernel, &compute_derivatives) << n_cups;
+
+        std::vector<double> state(n_cups + 2);
+        for (double theta : {0.0, 0.05, -0.05, 1.3, -7.9, 123.456}) {
+            state[0] = theta;
+            state[1] = 0.4;
+            for (std::size_t cup = 0; cup < n_cups; ++cup) {
+                state[2 + cup] = 0.5 + 0.25 * static_cast<double>(cup % 5);
+            }
+            std::vector<double> generic(n_cups + 2);
+            std::vector<double> specialized(n_cups + 2);
+            compute_derivatives(state.data(), generic.data(), cfg);
+            kernel(state.data(), specialized.data(), cfg);
+            for (std::size_t i = 0; i < state.size(); ++i) {
+                EXPECT_NEAR(specialized[i], generic[i], 1e-12)
+                    << "n_cups=" << n_cups << " theta=" << theta << " i=" << i;
+            }
+        }
+    }
+    EXPECT_EQ(derivative_kernel(7), &compute_derivatives);
+}
+
+TEST(WheelySimulateIntoTest, MatchesSimulateBitForBitWithoutAllocating) {
+    for (std::size_t n_cups : {3u, 8u, 64u, 70u}) {
+        SimulationConfig cfg = make_valid_config();
+        cfg.n_cups = n_cups;
+        cfg.n_frames = 50;
+        cfg.steps_per_frame = 4;
+        cfg.inflow_rate = 2.0;
+        cfg.leak_rate = 0.2;
+        cfg.t_end = 5.0;
+
+        const auto expected = simulate(cfg);
+        std::vector<double> times(cfg.n_frames);
+        std::vector<double> theta(cfg.n_frames);
+        std::vector<double> masses(cfg.n_cups * cfg.n_frames);
+
+        const std::size_t before = allocation_count.load();
+        const SimulationStatus status =
+            simulate_into(cfg, times.data(), theta.data(), masses.data());
+        const std::size_t allocations = allocation_count.load() - before;
+
+        // Above SMALL_RUN_MAX_CUPS the scratch was already grown on this
+        // thread by the simulate() call above.
+        ASSERT_EQ(status, SimulationStatus::ok);
+        EXPECT_EQ(allocations, 0u) << n_cups;
+        EXPECT_TRUE(std::equal(times.begin(), times.end(),
+                               expected.times.begin()));
+        EXPECT_TRUE(std::equal(theta.begin(), theta.end(),
+                               expected.theta.begin()));
+        EXPECT_TRUE(std::equal(masses.begin(), masses.end(),
+                               expected.masses.begin()));
+    }
+}
+
+TEST(WheelySimulateIntoTest, ReportsInvalidConfigurationsByStatus) {
+    double times[2] = {-1.0, -1.0};
+    double theta[2] = {-1.0, -1.0};
+    double masses[4] = {-1.0, -1.0, -1.0, -1.0};
+
+    SimulationConfig cfg = make_valid_config();
+    cfg.n_cups = 0;
+    EXPECT_EQ(simulate_into(cfg, times, theta, masses),
+              SimulationStatus::invalid_n_cups);
+
+    cfg = make_valid_config();
+    cfg.n_frames = 1;
+    EXPECT_EQ(simulate_into(cfg, times, theta, masses),
+              SimulationStatus::invalid_n_frames);
+
+    cfg = make_valid_config();
+    cfg.t_end = cfg.t_start;
+    EXPECT_EQ(simulate_into(cfg, times, theta, masses),
+              SimulationStatus::invalid_time_range);
+
+    cfg = make_valid_config();
+    cfg.steps_per_frame = 0;
+    EXPECT_EQ(simulate_into(cfg, times, theta, masses),
+              SimulationStatus::invalid_steps_per_frame);
+    EXPECT_STREQ(status_message(SimulationStatus::invalid_steps_per_frame),
+                 "steps_per_frame must be positive");
+
+    EXPECT_EQ(times[0], -1.0);
+    EXPECT_EQ(masses[3], -1.0);
+}
+
+TEST(WheelyLabBinsTest, MatchesBinningSimulateOutputByLabAngle) {
+    SimulationConfig cfg = make_valid_config();
+    cfg.n_cups = 7;
+    cfg.n_frames = 60;
+    cfg.inflow_rate = 2.0;
+    cfg.omega0 = 1.3;
+    cfg.t_end = 12.0;
+    const std::size_t n_bins = 5;
+
+    const auto expected = simulate(cfg);
+    const auto binned = simulate_lab_bins(cfg, n_bins);
+    ASSERT_EQ(binned.bins.size(), n_bins * cfg.n_frames);
+    EXPECT_EQ(binned.times, expected.times);
+    EXPECT_EQ(binned.theta, expected.theta);
+
+    const double two_pi = 2.0 * M_PI;
+    for (std::size_t frame = 0; frame < cfg.n_frames; ++frame) {
+        std::vector<double> reference(n_bins, 0.0);
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            double angle = std::fmod(expected.theta[frame] +
+                                         two_pi * cup / cfg.n_cups +
+                                         M_PI / n_bins,
+                                     two_pi);
+            if (angle < 0.0) {
+                angle += two_pi;
+            }
+            reference[static_cast<std::size_t>(angle / two_pi * n_bins)] +=
+                expected.masses[cup * cfg.n_frames + frame];
+        }
+        for (std::size_t bin = 0; bin < n_bins; ++bin) {
+            EXPECT_NEAR(binned.bins[bin * cfg.n_frames + frame],
+                        reference[bin], 1e-12)
+                << frame << " " << bin;
+        }
+    }
+}
+
+TEST(WheelyLabBinsTest, CentresBinZeroOnTheTop) {
+    SimulationConfig cfg = make_valid_config();
+    cfg.n_cups = 4;
+    cfg.n_frames = 2;
+    cfg.inflow_rate = 1.0;
+    cfg.leak_rate = 0.0;
+    cfg.omega0 = 0.0;
+    cfg.g = 0.0;
+    cfg.t_end = 0.5;
+
+    // Without gravity the wheel stays put and only the top cup fills.
+    const auto binned = simulate_lab_bins(cfg, 4);
+    EXPECT_NEAR(binned.bins[0 * cfg.n_frames + 1], 0.5, 1e-12);
+    for (std::size_t bin = 1; bin < 4; ++bin) {
+        EXPECT_EQ(binned.bins[bin * cfg.n_frames + 1], 0.0) << bin;
+    }
+
+    EXPECT_THROW(simulate_lab_bins(cfg, 0), std::invalid_argument);
+    EXPECT_THROW(
+        simulate_lab_bins(cfg, std::numeric_limits<std::size_t>::max()),
+        std::invalid_argument);
+
+    cfg.n_cups = 0;
+    EXPECT_THROW(simulate_lab_bins(cfg, 4), std::invalid_argument);
+}
+
+TEST(WheelyEventsTest, ReportsInflowCrossingsAtExactAngles) {
+    // Without gravity, damping or water the wheel turns at a constant rate,
+    // so theta = t and cup k is in the window while t + k * pi / 2 is within
+    // 0.1 of 0 mod 2 * pi.
+    SimulationConfig cfg = make_valid_config();
+    cfg.n_cups = 4;
+    cfg.g = 0.0;
+    cfg.damping = 0.0;
+    cfg.inflow_rate = 0.0;
+    cfg.omega0 = 1.0;
+    cfg.t_end = 7.0;
+    cfg.n_frames = 8;
+    cfg.steps_per_frame = 4;
+
+    const auto events = simulate_events(cfg);
+
+    std::vector<SimulationEvent> expected;
+    for (int j = 0; j <= 4; ++j) {
+        const std::uint32_t cup = static_cast<std::uint32_t>((4 - j % 4) % 4);
+        if (j > 0) {
+            SimulationEvent entry;
+            entry.time = j * M_PI / 2.0 - 0.1;
+            entry.cup = cup;
+            entry.kind = EventKind::inflow_entry;
+            expected.push_back(entry);
+        }
+        SimulationEvent exit;
+        exit.time = j * M_PI / 2.0 + 0.1;
+        exit.cup = cup;
+        exit.kind = EventKind::inflow_exit;
+        expected.push_back(exit);
+    }
+
+    ASSERT_EQ(events.size(), expected.size());
+    for (std::size_t index = 0; index < events.size(); ++index) {
+        EXPECT_EQ(events[index].kind, expected[index].kind) << index;
+        EXPECT_EQ(events[index].cup, expected[index].cup) << index;
+        EXPECT_NEAR(events[index].time, expected[index].time, 1e-12) << index;
+        EXPECT_NEAR(events[index].theta, expected[index].time, 1e-12) << index;
+        EXPECT_EQ(events[index].direction, 1) << index;
+    }
+}
+
+TEST(WheelyEventsTest, LocatesReversalsAndMaximaInsideTheirSteps) {
+    SimulationConfig cfg = make_valid_config();
+    cfg.n_cups = 8;
+    cfg.g = 9.81;
+    cfg.damping = 0.5;
+    cfg.leak_rate = 0.2;
+    cfg.inflow_rate = 2.0;
+    cfg.omega0 = 0.1;
+    cfg.t_end = 40.0;
+    cfg.n_frames = 401;
+    cfg.steps_per_frame = 32;
+
+    EventOptions options;
+    options.inflow_crossings = false;
+    const auto events = simulate_events(cfg, options);
+
+    // The same steps, with every step stored as a frame.
+    SimulationConfig dense = cfg;
+    dense.n_frames = (cfg.n_frames - 1) * cfg.steps_per_frame + 1;
+    dense.steps_per_frame = 1;
+    std::vector<double> omega;
+    simulate_streaming(dense, [&](std::size_t, double, const double *state) {
+        omega.push_back(state[1]);
+    });
+    const double dt = (cfg.t_end - cfg.t_start) / (dense.n_frames - 1);
+
+    std::size_t reversals = 0;
+    for (std::size_t step = 0; step + 1 < omega.size(); ++step) {
+        if ((omega[step] > 0.0) != (omega[step + 1] > 0.0)) {
+            ++reversals;
+        }
+    }
+
+    std::size_t reported_reversals = 0;
+    std::size_t reported_maxima = 0;
+    for (std::size_t index = 0; index < events.size(); ++index) {
+        const SimulationEvent &event = events[index];
+        if (index > 0) {
+            EXPECT_LE(events[index - 1].time, event.time);
+        }
+        const auto step = static_cast<std::size_t>(event.time / dt);
+        ASSERT_LT(step + 1, omega.size());
+        if (event.kind == EventKind::omega_reversal) {
+            ++reported_reversals;
+            EXPECT_NE(omega[step] > 0.0, omega[step + 1] > 0.0) << event.time;
+            EXPECT_EQ(event.direction, omega[step + 1] > 0.0 ? 1 : -1);
+            EXPECT_NEAR(event.omega, 0.0, 1e-12);
+        } else {
+            ASSERT_EQ(event.kind, EventKind::omega_maximum);
+            ++reported_maxima;
+            EXPECT_GE(event.omega + 1e-12,
+                      std::max(omega[step], omega[step + 1]))
+                << event.time;
+        }
+    }
+    EXPECT_GT(reported_reversals, 0u);
+    EXPECT_GT(reported_maxima, 0u);
+    EXPECT_EQ(reported_reversals, reversals);
+}
+
+TEST(WheelySimulateIntoTest, ConcurrentCallersMatchSerialRuns) {
+    constexpr std::size_t THREADS = 8;
+    std::vector<SimulationConfig> configs;
+    std::vector<SimulationResult> expected;
+    for (std::size_t index = 0; index < THREADS; ++index) {
+        SimulationConfig cfg = make_valid_config();
+        cfg.n_cups = index % 2 == 0 ? 12 : 96 + index;
+        cfg.n_frames = 40;
+        cfg.inflow_rate = 2.0;
+        cfg.omega0 = 0.1 * static_cast<double>(index);
+        cfg.t_end = 4.0;
+        configs.push_back(cfg);
+        expected.push_back(simulate(cfg));
+    }
+
+    std::vector<std::vector<double>> masses(THREADS);
+    std::vector<std::thread> threads;
+    for (std::size_t index = 0; index < THREADS; ++index) {
+        threads.emplace_back([&, index] {
+            const SimulationConfig &cfg = configs[index];
+            std::vector<double> times(cfg.n_frames);
+            std::vector<double> theta(cfg.n_frames);
+            masses[index].resize(cfg.n_cups * cfg.n_frames);
+            for (int repeat = 0; repeat < 20; ++repeat) {
+                simulate_into(cfg, times.data(), theta.data(),
+                              masses[index].data());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t index = 0; index < THREADS; ++index) {
+        EXPECT_TRUE(std::equal(masses[index].begin(), masses[index].end(),
+                               expected[index].masses.begin()))
+            << index;
+    }
+}
+
 }  // namespace wheely
+
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_batch.cpp"
+#include "../src/wheely_executor.cpp"
+#include "../src/wheely_simulation.cpp"
+#include "../src/wheely_sobol.cpp"
+
+#include "wheely_test_config.h"
+
+#include <cmath>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_sobol_config() {
+    return make_chaotic_config(8, 40.0, 401, 4);
+}
+
+BatchExecutor &test_executor(std::size_t n_threads) {
+    static BatchExecutor one([] {
+        ExecutorOptions options;
+        options.n_threads = 1;
+        options.pin_threads = false;
+        return options;
+    }());
+    static BatchExecutor three([] {
+        ExecutorOptions options;
+        options.n_threads = 3;
+        options.pin_threads = false;
+        return options;
+    }());
+    return n_threads == 1 ? one : three;
+}
+
+double ishigami(const double *u) {
+    const double x1 = -PI + TWO_PI * u[0];
+    const double x2 = -PI + TWO_PI * u[1];
+    const double x3 = -PI + TWO_PI * u[2];
+    const double s1 = std::sin(x1);
+    const double s2 = std::sin(x2);
+    return s1 + 7.0 * s2 * s2 + 0.1 * x3 * x3 * x3 * x3 * s1;
+}
+
+}  // namespace
+
+TEST(WheelySobolTest, RecoversIshigamiIndices) {
+    const std::size_t n = 1 << 15;
+    const std::size_t d = 3;
+    const SaltelliDesign design = saltelli_design(n, d, 11);
+    std::vector<double> f_a(n);
+    std::vector<double> f_b(n);
+    std::vector<double> f_ab(n * d);
+    for (std::size_t k = 0; k < n; ++k) {
+        f_a[k] = ishigami(design.a.data() + k * d);
+        f_b[k] = ishigami(design.b.data() + k * d);
+        for (std::size_t i = 0; i < d; ++i) {
+            double mixed[3];
+            std::copy_n(design.a.data() + k * d, d, mixed);
+            mixed[i] = design.b[k * d + i];
+            f_ab[i * n + k] = ishigami(mixed);
+        }
+    }
+    const SobolIndices indices =
+        estimate_sobol_indices(f_a, f_b, f_ab, d, 100, 0.95, 5);
+
+    // Analytic values for a = 7, b = 0.1.
+    const double first[3] = {0.3139, 0.4424, 0.0};
+    const double total[3] = {0.5576, 0.4424, 0.2437};
+    for (std::size_t i = 0; i < d; ++i) {
+        EXPECT_NEAR(indices.first_order[i], first[i], 0.03) << i;
+        EXPECT_NEAR(indices.total[i], total[i], 0.03) << i;
+        EXPECT_LE(indices.first_order_lower[i], indices.first_order[i]);
+        EXPECT_GE(indices.first_order_upper[i], indices.first_order[i]);
+        EXPECT_LT(indices.total_upper[i] - indices.total_lower[i], 0.05);
+    }
+    EXPECT_NEAR(indices.mean, 3.5, 0.1);
+    EXPECT_NEAR(indices.variance, 13.845, 0.4);
+
+    EXPECT_THROW(estimate_sobol_indices(f_a, f_b, f_a, d, 0, 0.95, 0),
+                 std::invalid_argument);
+    EXPECT_THROW(estimate_sobol_indices(f_a, f_b, f_ab, d, 0, 1.0, 0),
+                 std::invalid_argument);
+}
+
+TEST(WheelySobolTest, RunStatisticsSummarizeTheTrajectory) {
+    SimulationConfig cfg = make_sobol_config();
+    const SimulationResult result = simulate(cfg);
+    // omega is not stored, so difference theta at a fine frame spacing.
+    const RunStatistics stats = run_statistics(cfg, 10.0);
+    EXPECT_GT(stats.mean_abs_omega, 0.0);
+    EXPECT_GE(stats.reversal_rate, 0.0);
+
+    double mean_abs = 0.0;
+    for (std::size_t frame = 100; frame + 1 < cfg.n_frames; ++frame) {
+        mean_abs += std::abs(result.theta[frame + 1] - result.theta[frame]) / 0.1;
+    }
+    mean_abs /= static_cast<double>(cfg.n_frames - 101);
+    EXPECT_NEAR(stats.mean_abs_omega, mean_abs, 0.1 * mean_abs);
+
+    // A wheel with no water spins down without reversing.
+    cfg.inflow_rate = 0.0;
+    cfg.omega0 = 2.0;
+    const RunStatistics idle = run_statistics(cfg, 0.0);
+    EXPECT_EQ(idle.reversal_rate, 0.0);
+
+    EXPECT_THROW(run_statistics(cfg, 40.0), std::invalid_argument);
+    EXPECT_THROW(run_statistics(cfg, -1.0), std::invalid_argument);
+}
+
+TEST(WheelySobolTest, IndicesOfTheWheelAreReproducible) {
+    const SimulationConfig base = make_sobol_config();
+    std::vector<ParameterRange> ranges(3);
+    ranges[0] = {ConfigParameter::damping, 0.3, 0.8};
+    ranges[1] = {ConfigParameter::inflow_rate, 1.0, 3.0};
+    // A range of zero width cannot matter.
+    ranges[2] = {ConfigParameter::omega0, 0.1, 0.1};
+    SobolOptions options;
+    options.base_samples = 48;
+    options.bootstrap_samples = 50;
+    options.burn_in_time = 10.0;
+    options.seed = 3;
+
+    const SobolAnalysis serial = sobol_indices(base, ranges, options, test_executor(1));
+    const SobolAnalysis parallel =
+        sobol_indices(base, ranges, options, test_executor(3));
+    EXPECT_EQ(serial.evaluations, 48u * 5u);
+    for (const SobolIndices *indices :
+         {&serial.mean_abs_omega, &serial.reversal_rate}) {
+        ASSERT_EQ(indices->first_order.size(), 3u);
+        EXPECT_EQ(indices->first_order[2], 0.0);
+        EXPECT_EQ(indices->total[2], 0.0);
+        EXPECT_GT(indices->variance, 0.0);
+        for (std::size_t i = 0; i < 2; ++i) {
+            EXPECT_TRUE(std::isfinite(indices->first_order[i]));
+            EXPECT_GE(indices->total[i], 0.0);
+            EXPECT_LE(indices->total_lower[i], indices->total_upper[i]);
+        }
+    }
+    EXPECT_EQ(serial.mean_abs_omega.first_order, parallel.mean_abs_omega.first_order);
+    EXPECT_EQ(serial.reversal_rate.total_upper, parallel.reversal_rate.total_upper);
+
+    ranges[0].upper = 0.1;
+    EXPECT_THROW(sobol_indices(base, ranges, options, test_executor(1)),
+                 std::invalid_argument);
+}
+
+}  // namespace wheely
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_batch.cpp"
+#include "../src/wheely_executor.cpp"
+#include "../src/wheely_simulation.cpp"
+#include "../src/wheely_splitting.cpp"
+
+#include "wheely_test_config.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_splitting_config() {
+    return make_chaotic_config(8, 10.0, 101, 4);
+}
+
+BatchExecutor &test_executor(std::size_t n_threads) {
+    static BatchExecutor one([] {
+        ExecutorOptions options;
+        options.n_threads = 1;
+        options.pin_threads = false;
+        return options;
+    }());
+    static BatchExecutor three([] {
+        ExecutorOptions options;
+        options.n_threads = 3;
+        options.pin_threads = false;
+        return options;
+    }());
+    return n_threads == 1 ? one : three;
+}
+
+}  // namespace
+
+TEST(WheelySplittingTest, AgreesWithBruteForce) {
+    const SimulationConfig cfg = make_splitting_config();
+    DwellOptions dwell;
+    dwell.seed = 1;
+    const std::vector<double> brute =
+        sample_dwell_times(cfg, dwell, 8000, test_executor(3));
+    const double target = cfg.t_end - cfg.t_start;
+    const double expected =
+        static_cast<double>(std::count_if(brute.begin(), brute.end(),
+                                          [&](double t) { return t >= target - 1e-9; })) /
+        static_cast<double>(brute.size());
+    ASSERT_GT(expected, 0.02);
+    ASSERT_LT(expected, 0.08);
+
+    SplittingOptions options;
+    options.replicas = 100;
+    options.kill_count = 10;
+    double mean = 0.0;
+    const std::size_t repeats = 16;
+    for (std::size_t repeat = 0; repeat < repeats; ++repeat) {
+        dwell.seed = 100 + repeat;
+        const SplittingResult result =
+            adaptive_multilevel_splitting(cfg, dwell, options, test_executor(3));
+        ASSERT_EQ(result.dwell_times.size(), result.iterations);
+        for (std::size_t j = 1; j < result.iterations; ++j) {
+            EXPECT_GT(result.dwell_times[j], result.dwell_times[j - 1]);
+            EXPECT_LT(result.tail_probabilities[j], result.tail_probabilities[j - 1]);
+        }
+        EXPECT_LE(result.probability, result.tail_probabilities.back());
+        mean += result.probability / static_cast<double>(repeats);
+    }
+    EXPECT_NEAR(mean, expected, 0.25 * expected);
+}
+
+TEST(WheelySplittingTest, StartsFromTheBruteForceSamples) {
+    const SimulationConfig cfg = make_splitting_config();
+    DwellOptions dwell;
+    dwell.seed = 9;
+    SplittingOptions options;
+    options.replicas = 50;
+    options.kill_count = 5;
+    std::vector<double> brute =
+        sample_dwell_times(cfg, dwell, options.replicas, test_executor(1));
+    std::sort(brute.begin(), brute.end());
+    const SplittingResult result =
+        adaptive_multilevel_splitting(cfg, dwell, options, test_executor(1));
+    ASSERT_GE(result.iterations, 1u);
+    EXPECT_NEAR(result.dwell_times[0], brute[options.kill_count - 1] + 0.1, 1e-9);
+    const auto kept = std::count_if(brute.begin(), brute.end(), [&](double t) {
+        return t > brute[options.kill_count - 1];
+    });
+    EXPECT_DOUBLE_EQ(result.tail_probabilities[0], static_cast<double>(kept) / 50.0);
+}
+
+TEST(WheelySplittingTest, ResultsDoNotDependOnThreadsOrCheckpoints) {
+    const SimulationConfig cfg = make_splitting_config();
+    DwellOptions dwell;
+    dwell.seed = 5;
+    SplittingOptions options;
+    options.replicas = 60;
+    options.kill_count = 6;
+    options.checkpoint_interval = 7;
+    const SplittingResult serial =
+        adaptive_multilevel_splitting(cfg, dwell, options, test_executor(1));
+    const SplittingResult parallel =
+        adaptive_multilevel_splitting(cfg, dwell, options, test_executor(3));
+    options.checkpoint_interval = 1;
+    const SplittingResult dense =
+        adaptive_multilevel_splitting(cfg, dwell, options, test_executor(3));
+
+    for (const SplittingResult *other : {&parallel, &dense}) {
+        EXPECT_EQ(serial.probability, other->probability);
+        EXPECT_EQ(serial.iterations, other->iterations);
+        EXPECT_EQ(serial.survivors, other->survivors);
+        EXPECT_EQ(serial.dwell_times, other->dwell_times);
+        EXPECT_EQ(serial.tail_probabilities, other->tail_probabilities);
+    }
+    EXPECT_EQ(serial.frames_integrated, parallel.frames_integrated);
+    // Saving every frame leaves nothing to replay.
+    EXPECT_LT(dense.frames_integrated, serial.frames_integrated);
+}
+
+TEST(WheelySplittingTest, NoiselessReplicasLiveOrDieTogether) {
+    SimulationConfig cfg = make_splitting_config();
+    DwellOptions dwell;
+    dwell.inflow_noise = 0.0;
+    SplittingOptions options;
+    options.replicas = 10;
+    options.kill_count = 1;
+
+    // Every replica reverses on the same frame, so all are discarded.
+    const SplittingResult extinct =
+        adaptive_multilevel_splitting(cfg, dwell, options, test_executor(1));
+    EXPECT_EQ(extinct.iterations, 1u);
+    EXPECT_EQ(extinct.survivors, 0u);
+    EXPECT_EQ(extinct.probability, 0.0);
+    EXPECT_EQ(extinct.tail_probabilities, std::vector<double>{0.0});
+
+    cfg.t_end = 1.0;
+    cfg.n_frames = 11;
+    const SplittingResult certain =
+        adaptive_multilevel_splitting(cfg, dwell, options, test_executor(1));
+    EXPECT_EQ(certain.iterations, 0u);
+    EXPECT_EQ(certain.survivors, 10u);
+    EXPECT_EQ(certain.probability, 1.0);
+    EXPECT_EQ(certain.frames_integrated, 100u);
+}
+
+TEST(WheelySplittingTest, RejectsInvalidOptions) {
+    const SimulationConfig cfg = make_splitting_config();
+    BatchExecutor &executor = test_executor(1);
+    DwellOptions dwell;
+    SplittingOptions options;
+    options.replicas = 1;
+    EXPECT_THROW(adaptive_multilevel_splitting(cfg, dwell, options, executor),
+                 std::invalid_argument);
+    options.replicas = 10;
+    options.kill_count = 10;
+    EXPECT_THROW(adaptive_multilevel_splitting(cfg, dwell, options, executor),
+                 std::invalid_argument);
+    options.kill_count = 1;
+    options.checkpoint_interval = 0;
+    EXPECT_THROW(adaptive_multilevel_splitting(cfg, dwell, options, executor),
+                 std::invalid_argument);
+    options.checkpoint_interval = 4;
+    dwell.inflow_noise = -0.1;
+    EXPECT_THROW(adaptive_multilevel_splitting(cfg, dwell, options, executor),
+                 std::invalid_argument);
+    dwell.inflow_noise = 0.1;
+    dwell.initial_state.assign(cfg.n_cups + 2, 0.0);
+    EXPECT_THROW(sample_dwell_times(cfg, dwell, 4, executor), std::invalid_argument);
+    dwell.initial_state.resize(3, 1.0);
+    EXPECT_THROW(sample_dwell_times(cfg, dwell, 4, executor), std::invalid_argument);
+}
+
+}  // namespace wheely
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_simulation.cpp"
+#include "../src/wheely_symbolic.cpp"
+
+#include "wheely_test_config.h"
+
+#include <random>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_symbolic_config() {
+    return make_chaotic_config(8, 200.0, 2001, 16);
+}
+
+}  // namespace
+
+TEST(WheelyPackedSymbolsTest, RoundTripsAcrossWordBoundaries) {
+    PackedSymbols symbols;
+    for (std::size_t index = 0; index < 200; ++index) {
+        symbols.push_back(index % 3 == 0);
+    }
+    ASSERT_EQ(symbols.size(), 200u);
+    EXPECT_EQ(symbols.words().size(), 4u);
+    for (std::size_t index = 0; index < 200; ++index) {
+        EXPECT_EQ(symbols[index], index % 3 == 0) << index;
+    }
+}
+
+TEST(WheelyBlockEntropyTest, PeriodicSequenceHasZeroEntropyRate) {
+    BlockEntropyCounter counter(6);
+    for (int index = 0; index < 1000; ++index) {
+        counter.push(index % 2 == 0);
+    }
+    const auto entropies = counter.block_entropies();
+    for (double entropy : entropies) {
+        EXPECT_NEAR(entropy, 1.0, 1e-6);
+    }
+    EXPECT_NEAR(entropy_rate_estimate(entropies), 0.0, 1e-6);
+
+    const auto words = counter.word_counts(3);
+    ASSERT_EQ(words.size(), 2u);
+    EXPECT_EQ(words[0].first, 0b010u);
+    EXPECT_EQ(words[1].first, 0b101u);
+    EXPECT_EQ(words[0].second + words[1].second, 998u);
+}
+
+TEST(WheelyBlockEntropyTest, FairCoinHasOneBitPerSymbol) {
+    std::mt19937_64 rng(7);
+    BlockEntropyCounter counter(8);
+    for (int index = 0; index < 1 << 20; ++index) {
+        counter.push(rng() & 1u);
+    }
+    const auto entropies = counter.block_entropies();
+    for (std::size_t length = 1; length <= 8; ++length) {
+        EXPECT_NEAR(entropies[length - 1], static_cast<double>(length), 1e-3);
+    }
+    EXPECT_NEAR(entropy_rate_estimate(entropies), 1.0, 1e-3);
+}
+
+TEST(WheelyBlockEntropyTest, HashedLongBlocksAgreeWithDirectCounts) {
+    const std::size_t length = BlockEntropyCounter::DENSE_MAX_BLOCK + 3;
+    std::mt19937_64 rng(11);
+    std::vector<bool> symbols;
+    BlockEntropyCounter counter(length);
+    for (int index = 0; index < 5000; ++index) {
+        // Biased and correlated so that many long words repeat.
+        const bool symbol = index > 0 && (rng() % 8 != 0) ? symbols.back()
+                                                          : (rng() & 1u);
+        symbols.push_back(symbol);
+        counter.push(symbol);
+    }
+
+    std::unordered_map<std::uint64_t, std::uint64_t> expected;
+    for (std::size_t end = length; end <= symbols.size(); ++end) {
+        std::uint64_t word = 0;
+        for (std::size_t index = end - length; index < end; ++index) {
+            word = (word << 1) | (symbols[index] ? 1u : 0u);
+        }
+        ++expected[word];
+    }
+    const auto counts = counter.word_counts(length);
+    ASSERT_EQ(counts.size(), expected.size());
+    for (const auto &entry : counts) {
+        EXPECT_EQ(entry.second, expected[entry.first]);
+    }
+    EXPECT_GT(counter.block_entropies()[length - 1], 0.0);
+    EXPECT_THROW(BlockEntropyCounter(65), std::invalid_argument);
+}
+
+TEST(WheelySymbolicDynamicsTest, EncodesOneSymbolPerSwing) {
+    const SimulationConfig cfg = make_symbolic_config();
+    SymbolicOptions options;
+    options.max_block_length = 4;
+    const auto analysis = analyze_symbolic_dynamics(cfg, options);
+
+    EventOptions events;
+    events.omega_reversals = false;
+    events.inflow_crossings = false;
+    events.omega_minima = true;
+    std::vector<bool> expected;
+    for (const auto &event : simulate_events(cfg, events)) {
+        if (event.kind == EventKind::omega_maximum && event.omega > 0.0) {
+            expected.push_back(true);
+        } else if (event.kind == EventKind::omega_minimum && event.omega < 0.0) {
+            expected.push_back(false);
+        }
+    }
+
+    ASSERT_GT(expected.size(), 20u);
+    ASSERT_EQ(analysis.symbols.size(), expected.size());
+    EXPECT_EQ(analysis.symbol_count, expected.size());
+    for (std::size_t index = 0; index < expected.size(); ++index) {
+        EXPECT_EQ(analysis.symbols[index], expected[index]) << index;
+    }
+    EXPECT_EQ(analysis.block_entropies.size(), 4u);
+    EXPECT_DOUBLE_EQ(analysis.entropy_rate, analysis.block_entropies[3] -
+                                                analysis.block_entropies[2]);
+}
+
+TEST(WheelySymbolicDynamicsTest, CanDiscardSymbolsAndSampleFrames) {
+    const SimulationConfig cfg = make_symbolic_config();
+    SymbolicOptions options;
+    options.encoding = SymbolEncoding::omega_sign_per_frame;
+    options.keep_symbols = false;
+    const auto analysis = analyze_symbolic_dynamics(cfg, options);
+
+    EXPECT_EQ(analysis.symbols.size(), 0u);
+    EXPECT_EQ(analysis.symbol_count, cfg.n_frames);
+    EXPECT_GE(analysis.entropy_rate, 0.0);
+    EXPECT_LE(analysis.block_entropies[0], 1.0);
+}
+
+}  // namespace wheely
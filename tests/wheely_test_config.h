@@ -0,0 +1,72 @@
+#ifndef WHEELY_TEST_CONFIG_H
+#define WHEELY_TEST_CONFIG_H
+
+#include "../src/wheely_simulation.h"
+
+#include <cstddef>
+
+namespace wheely {
+
+// The smallest config that passes validation; tests break one field at a
+// time.
+inline SimulationConfig make_valid_config() {
+    SimulationConfig cfg;
+    cfg.n_cups = 2;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 0.05;
+    cfg.leak_rate = 0.02;
+    cfg.inflow_rate = 0.5;
+    cfg.inertia = 1.5;
+    cfg.omega0 = 0.0;
+    cfg.t_start = 0.0;
+    cfg.t_end = 1.0;
+    cfg.n_frames = 5;
+    cfg.steps_per_frame = 2;
+    return cfg;
+}
+
+// A heavy, strongly damped wheel under a gentle inflow, starting at omega 1.
+inline SimulationConfig make_damped_config(std::size_t n_cups, double t_end,
+                                           std::size_t n_frames,
+                                           std::size_t steps_per_frame) {
+    SimulationConfig cfg;
+    cfg.n_cups = n_cups;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 2.0;
+    cfg.leak_rate = 0.1;
+    cfg.inflow_rate = 0.9;
+    cfg.inertia = 5.0;
+    cfg.omega0 = 1.0;
+    cfg.t_start = 0.0;
+    cfg.t_end = t_end;
+    cfg.n_frames = n_frames;
+    cfg.steps_per_frame = steps_per_frame;
+    return cfg;
+}
+
+// The Lorenz-like regime: a light wheel under a strong inflow that reverses
+// irregularly, starting from a slight push at omega 0.1.
+inline SimulationConfig make_chaotic_config(std::size_t n_cups, double t_end,
+                                            std::size_t n_frames,
+                                            std::size_t steps_per_frame) {
+    SimulationConfig cfg;
+    cfg.n_cups = n_cups;
+    cfg.radius = 1.0;
+    cfg.g = 9.81;
+    cfg.damping = 0.5;
+    cfg.leak_rate = 0.2;
+    cfg.inflow_rate = 2.0;
+    cfg.inertia = 1.5;
+    cfg.omega0 = 0.1;
+    cfg.t_start = 0.0;
+    cfg.t_end = t_end;
+    cfg.n_frames = n_frames;
+    cfg.steps_per_frame = steps_per_frame;
+    return cfg;
+}
+
+}  // namespace wheely
+
+#endif  // WHEELY_TEST_CONFIG_H
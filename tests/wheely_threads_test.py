@@ -0,0 +1,110 @@
+"""simulate() called from a Python thread pool.
+
+Results must be bit-identical to serial calls on any interpreter. On a
+free-threaded build (sys._is_gil_enabled() is False) the calls must also run
+in parallel: with T threads, at least MIN_EFFICIENCY * T times the serial
+rate.
+
+usage: python -m pytest tests/wheely_threads_test.py
+"""
+
+import os
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import pytest
+
+np = pytest.importorskip("numpy")
+wheely_cpp = pytest.importorskip("wheely_cpp")
+
+STEPS_PER_FRAME = 6
+MAX_THREADS = 4
+MIN_EFFICIENCY = 0.5
+
+
+def make_config(index, n_cups=32, n_frames=2000):
+    return {
+        "N_CUPS": n_cups,
+        "RADIUS": 1.0,
+        "G": 9.81,
+        "DAMPING": 2.0,
+        "LEAK_RATE": 0.1,
+        "INFLOW_RATE": 0.9,
+        "INERTIA": 5.0,
+        "OMEGA0": 0.5 + 0.01 * index,
+        "T_START": 0.0,
+        "T_END": 90.0,
+        "N_FRAMES": n_frames,
+    }
+
+
+def run(config):
+    return wheely_cpp.simulate(config, STEPS_PER_FRAME)
+
+
+def run_threaded(configs, threads):
+    with ThreadPoolExecutor(max_workers=threads) as pool:
+        return list(pool.map(run, configs))
+
+
+def best_seconds(function, repeats=3):
+    best = float("inf")
+    for _ in range(repeats):
+        start = time.perf_counter()
+        function()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def gil_enabled():
+    return getattr(sys, "_is_gil_enabled", lambda: True)()
+
+
+def test_threaded_results_match_serial():
+    configs = [make_config(index) for index in range(16)]
+    serial = [run(config) for config in configs]
+    threaded = run_threaded(configs, MAX_THREADS)
+
+    for expected, actual in zip(serial, threaded):
+        for expected_array, actual_array in zip(expected, actual):
+            assert expected_array.dtype == actual_array.dtype
+            assert np.array_equal(expected_array, actual_array)
+
+
+def test_simulate_into_sees_a_consistent_shared_config():
+    config = wheely_cpp.SimulationConfig(make_config(0, n_cups=8, n_frames=50),
+                                         STEPS_PER_FRAME)
+    expected = run(make_config(0, n_cups=8, n_frames=50))
+
+    def run_into(_):
+        times = np.empty(50)
+        theta = np.empty(50)
+        masses = np.empty((8, 50))
+        wheely_cpp.simulate_into(config, times, theta, masses)
+        return times, theta, masses
+
+    # The writer only ever stores the value the field already holds, so
+    # every run must still match, however the calls interleave.
+    with ThreadPoolExecutor(max_workers=MAX_THREADS) as pool:
+        futures = [pool.submit(run_into, index) for index in range(64)]
+        for _ in range(1000):
+            config.omega0 = 0.5
+        for future in futures:
+            for expected_array, actual_array in zip(expected, future.result()):
+                assert np.array_equal(expected_array, actual_array)
+
+
+@pytest.mark.skipif(gil_enabled(), reason="needs a free-threaded interpreter")
+@pytest.mark.skipif((os.cpu_count() or 1) < 2, reason="needs two or more CPUs")
+def test_threads_speed_up_without_the_gil():
+    threads = min(MAX_THREADS, os.cpu_count() or 1)
+    configs = [make_config(index) for index in range(4 * threads)]
+
+    serial = best_seconds(lambda: [run(config) for config in configs])
+    threaded = best_seconds(lambda: run_threaded(configs, threads))
+
+    speedup = serial / threaded
+    assert speedup >= MIN_EFFICIENCY * threads, (
+        f"{threads} threads ran {speedup:.2f}x faster than serial, expected "
+        f"at least {MIN_EFFICIENCY * threads:.2f}x")
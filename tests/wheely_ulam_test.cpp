@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_batch.cpp"
+#include "../src/wheely_executor.cpp"
+#include "../src/wheely_simulation.cpp"
+#include "../src/wheely_ulam.cpp"
+
+#include "wheely_test_config.h"
+
+#include <numeric>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_ulam_config() {
+    return make_chaotic_config(8, 60.0, 601, 8);
+}
+
+SparseTransitionCounts counts_from_rows(
+    const std::vector<std::vector<std::uint64_t>> &rows) {
+    TransitionCounter counter;
+    for (std::size_t from = 0; from < rows.size(); ++from) {
+        for (std::size_t to = 0; to < rows[from].size(); ++to) {
+            if (rows[from][to] != 0) {
+                counter.add(static_cast<std::uint32_t>(from),
+                            static_cast<std::uint32_t>(to), rows[from][to]);
+            }
+        }
+    }
+    return counter.to_csr(rows.size());
+}
+
+}  // namespace
+
+TEST(WheelyUlamTest, ComputesLorenzCoordinatesAndCells) {
+    // Two cups, theta = 0: cup 0 at the top, cup 1 at the bottom.
+    const double state[4] = {0.0, 1.5, 2.0, 0.5};
+    const LorenzPoint point = lorenz_coordinates(state, 2);
+    EXPECT_DOUBLE_EQ(point.omega, 1.5);
+    EXPECT_NEAR(point.y, 0.0, 1e-15);
+    EXPECT_NEAR(point.z, 1.5, 1e-15);
+
+    LorenzGrid grid;
+    grid.lower = {-2.0, -1.0, 0.0};
+    grid.upper = {2.0, 1.0, 2.0};
+    grid.bins = {4, 2, 2};
+    EXPECT_EQ(grid.cell_count(), 16u);
+    EXPECT_EQ(grid.cell_of(point), (3u * 2u + 1u) * 2u + 1u);
+    EXPECT_EQ(grid.cell_of({-2.0, -1.0, 0.0}), 0u);
+    EXPECT_EQ(grid.cell_of({2.0, 0.0, 1.0}), grid.cell_count());
+    EXPECT_EQ(grid.cell_of({std::nan(""), 0.0, 1.0}), grid.cell_count());
+
+    grid.bins[1] = 0;
+    EXPECT_THROW(grid.validate(), std::invalid_argument);
+}
+
+TEST(WheelyUlamTest, MergesPerWorkerCountsIntoSortedRows) {
+    TransitionCounter a;
+    a.add(2, 1);
+    a.add(0, 3, 4);
+    TransitionCounter b;
+    b.add(2, 1, 2);
+    b.add(2, 0);
+    b.outside = 5;
+    a.merge(b);
+
+    const auto csr = a.to_csr(4);
+    EXPECT_EQ(csr.row_offsets, (std::vector<std::uint64_t>{0, 1, 1, 3, 3}));
+    EXPECT_EQ(csr.columns, (std::vector<std::uint32_t>{3, 0, 1}));
+    EXPECT_EQ(csr.counts, (std::vector<std::uint64_t>{4, 1, 3}));
+    EXPECT_EQ(csr.outside, 5u);
+}
+
+TEST(WheelyUlamTest, FindsInvariantDensityOfSmallChain) {
+    const auto counts = counts_from_rows({{1, 3, 0}, {2, 0, 2}, {0, 5, 5}});
+    const auto analysis = analyze_transfer_operator(counts);
+    const auto &pi = analysis.invariant_density;
+    EXPECT_NEAR(std::accumulate(pi.begin(), pi.end(), 0.0), 1.0, 1e-12);
+
+    // pi P = pi.
+    const double p[3][3] = {{0.25, 0.75, 0.0}, {0.5, 0.0, 0.5}, {0.0, 0.5, 0.5}};
+    for (std::size_t j = 0; j < 3; ++j) {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < 3; ++i) {
+            sum += pi[i] * p[i][j];
+        }
+        EXPECT_NEAR(sum, pi[j], 1e-10) << j;
+    }
+}
+
+TEST(WheelyUlamTest, SecondEigenvectorSplitsAlmostInvariantSets) {
+    // Two blocks {0, 1} and {2, 3} that leak into each other 10% of the
+    // time; the second eigenvalue is 0.8 with eigenvector (1, 1, -1, -1).
+    const auto counts = counts_from_rows(
+        {{45, 45, 10, 0}, {45, 45, 0, 10}, {10, 0, 45, 45}, {0, 10, 45, 45}});
+    const auto analysis = analyze_transfer_operator(counts);
+
+    EXPECT_NEAR(analysis.second_eigenvalue, 0.8, 1e-9);
+    const auto &v = analysis.second_eigenvector;
+    EXPECT_GT(v[0] * v[1], 0.0);
+    EXPECT_GT(v[2] * v[3], 0.0);
+    EXPECT_LT(v[0] * v[2], 0.0);
+    EXPECT_NEAR(v[0], v[1], 1e-9);
+    for (double density : analysis.invariant_density) {
+        EXPECT_NEAR(density, 0.25, 1e-12);
+    }
+}
+
+TEST(WheelyUlamTest, CountsDoNotDependOnThreadCount) {
+    const SimulationConfig cfg = make_ulam_config();
+    const auto seeds = sample_trajectory_states(cfg, 100);
+    const std::size_t n_seeds = seeds.size() / (cfg.n_cups + 2);
+    ASSERT_EQ(n_seeds, cfg.n_frames - 100);
+
+    LorenzGrid grid;
+    grid.lower = {-8.0, -15.0, -5.0};
+    grid.upper = {8.0, 15.0, 25.0};
+    grid.bins = {8, 6, 6};
+
+    ExecutorOptions serial_options;
+    serial_options.n_threads = 1;
+    serial_options.pin_threads = false;
+    BatchExecutor serial(serial_options);
+    ExecutorOptions parallel_options;
+    parallel_options.n_threads = 3;
+    parallel_options.pin_threads = false;
+    BatchExecutor parallel(parallel_options);
+
+    const auto expected = count_transitions(cfg, grid, seeds, 0.5, 20, serial);
+    const auto counts = count_transitions(cfg, grid, seeds, 0.5, 20, parallel);
+    EXPECT_EQ(counts.row_offsets, expected.row_offsets);
+    EXPECT_EQ(counts.columns, expected.columns);
+    EXPECT_EQ(counts.counts, expected.counts);
+    EXPECT_EQ(counts.outside, expected.outside);
+
+    // Same flights integrated by advance_frames().
+    SimulationConfig flight = cfg;
+    flight.t_start = 0.0;
+    flight.t_end = 0.5;
+    flight.n_frames = 2;
+    flight.steps_per_frame = 20;
+    const std::size_t state_size = cfg.n_cups + 2;
+    TransitionCounter reference;
+    for (std::size_t seed = 0; seed < n_seeds; ++seed) {
+        const double *start = seeds.data() + seed * state_size;
+        SimulationCheckpoint checkpoint;
+        checkpoint.state.assign(start, start + state_size);
+        advance_frames(flight, checkpoint, 1);
+        const std::size_t from = grid.cell_of(lorenz_coordinates(start, cfg.n_cups));
+        const std::size_t to =
+            grid.cell_of(lorenz_coordinates(checkpoint.state.data(), cfg.n_cups));
+        if (from == grid.cell_count() || to == grid.cell_count()) {
+            ++reference.outside;
+        } else {
+            reference.add(static_cast<std::uint32_t>(from),
+                          static_cast<std::uint32_t>(to));
+        }
+    }
+    const auto reference_counts = reference.to_csr(grid.cell_count());
+    EXPECT_EQ(counts.columns, reference_counts.columns);
+    EXPECT_EQ(counts.counts, reference_counts.counts);
+    EXPECT_EQ(counts.outside, reference_counts.outside);
+
+    const std::uint64_t inside =
+        std::accumulate(counts.counts.begin(), counts.counts.end(),
+                        std::uint64_t{0});
+    EXPECT_EQ(inside + counts.outside, n_seeds);
+    EXPECT_GT(inside, n_seeds / 2);
+
+    const auto analysis = analyze_transfer_operator(counts);
+    EXPECT_NEAR(std::accumulate(analysis.invariant_density.begin(),
+                                analysis.invariant_density.end(), 0.0),
+                1.0, 1e-9);
+    EXPECT_LE(analysis.second_eigenvalue, 1.0 + 1e-9);
+
+    EXPECT_THROW(count_transitions(cfg, grid, {1.0, 2.0}, 0.5, 20, serial),
+                 std::invalid_argument);
+}
+
+}  // namespace wheely
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "../src/wheely_simulation.cpp"
+#include "../src/wheely_writer.cpp"
+
+#include "wheely_test_config.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace wheely {
+namespace {
+
+SimulationConfig make_writer_config() {
+    return make_damped_config(7, 30.0, 997, 2);
+}
+
+std::string temp_path(const char *name) {
+    return ::testing::TempDir() + name;
+}
+
+std::vector<double> read_doubles(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    std::vector<double> values(bytes.size() / sizeof(double));
+    std::memcpy(values.data(), bytes.data(), values.size() * sizeof(double));
+    EXPECT_EQ(bytes.size() % sizeof(double), 0u);
+    return values;
+}
+
+void expect_matches_simulate(const SimulationConfig &cfg,
+                             const std::string &path) {
+    const auto expected = simulate(cfg);
+    const auto values = read_doubles(path);
+    const std::size_t stride = cfg.n_cups + 2;
+    ASSERT_EQ(values.size(), stride * cfg.n_frames);
+    for (std::size_t frame = 0; frame < cfg.n_frames; ++frame) {
+        EXPECT_EQ(values[frame * stride], expected.times[frame]);
+        EXPECT_EQ(values[frame * stride + 1], expected.theta[frame]);
+        for (std::size_t cup = 0; cup < cfg.n_cups; ++cup) {
+            EXPECT_EQ(values[frame * stride + 2 + cup],
+                      expected.masses[cup * cfg.n_frames + frame]);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(WheelySimulateStreamingTest, VisitsEveryFrameInOrder) {
+    const auto cfg = make_writer_config();
+    const auto expected = simulate(cfg);
+    std::size_t seen = 0;
+    simulate_streaming(cfg, [&](std::size_t frame, double time, const double *state) {
+        EXPECT_EQ(frame, seen++);
+        EXPECT_EQ(time, expected.times[frame]);
+        EXPECT_EQ(state[0], expected.theta[frame]);
+    });
+    EXPECT_EQ(seen, cfg.n_frames);
+}
+
+TEST(WheelyFrameWriterTest, StreamsFramesThroughSmallBuffers) {
+    const auto cfg = make_writer_config();
+    const auto path = temp_path("wheely_writer_small.bin");
+    FrameWriterOptions options;
+    options.buffer_bytes = 1;  // one 4 KiB block; records straddle buffers
+
+    const auto bytes = simulate_to_file(cfg, path, options);
+
+    EXPECT_EQ(bytes, (cfg.n_cups + 2) * cfg.n_frames * sizeof(double));
+    expect_matches_simulate(cfg, path);
+    std::remove(path.c_str());
+}
+
+TEST(WheelyFrameWriterTest, TrimsPaddingAfterDirectIo) {
+    const auto cfg = make_writer_config();
+    const auto path = temp_path("wheely_writer_direct.bin");
+    FrameWriterOptions options;
+    options.direct_io = true;
+
+    simulate_to_file(cfg, path, options);
+
+    expect_matches_simulate(cfg, path);
+    std::remove(path.c_str());
+}
+
+TEST(WheelyFrameWriterTest, ReportsOpenFailure) {
+    EXPECT_THROW(FrameWriter("/nonexistent-dir/wheely.bin", 4),
+                 std::system_error);
+}
+
+}  // namespace wheely
@@ -0,0 +1,70 @@
+// Batch scaling curve for the wasm module on worker_threads. It uses the same
+// configs and prints the same table as bench/wheely_batch_bench.cpp, so the
+// two can be compared directly on one machine.
+//
+// usage: node scripts/bench-wasm-batch.js [runs_per_thread] [n_cups] [n_frames]
+import { availableParallelism } from "node:os";
+import { existsSync } from "node:fs";
+import { WasmBatchPool, defaultModulePath } from "./wasm-pool.js";
+
+const makeBenchConfig = (nCups, nFrames, index) => ({
+  n_cups: nCups,
+  radius: 1.0,
+  g: 9.81,
+  damping: 2.0,
+  leak_rate: 0.1,
+  inflow_rate: 0.9,
+  inertia: 5.0,
+  omega0: 0.5 + 0.01 * index,
+  t_start: 0.0,
+  t_end: 90.0,
+  n_frames: nFrames,
+  steps_per_frame: 6
+});
+
+const [runsPerThread = 4, nCups = 64, nFrames = 2000] = process.argv
+  .slice(2)
+  .map((arg) => Number.parseInt(arg, 10));
+const modulePath = process.env.WHEELY_WASM_MODULE ?? defaultModulePath;
+if (!existsSync(modulePath)) {
+  console.error(`Missing ${modulePath}. Run \`cmake --build . --target wheely_wasm\` from the project root first.`);
+  process.exit(1);
+}
+
+const maxThreads = availableParallelism();
+console.log(`cpus=${maxThreads} cups=${nCups} frames=${nFrames} runs/thread=${runsPerThread}`);
+console.log(
+  `${"threads".padStart(8)} ${"seconds".padStart(10)} ${"runs/s".padStart(12)} ${"speedup".padStart(9)} ${"efficiency".padStart(11)}`
+);
+
+let baseline = 0;
+for (let threads = 1; threads <= maxThreads; threads = threads < 4 ? threads + 1 : Math.min(maxThreads, threads * 2)) {
+  const configs = Array.from({ length: runsPerThread * threads }, (_, index) => makeBenchConfig(nCups, nFrames, index));
+  // Instantiating the workers is not part of the timed region, matching the
+  // native bench, which builds its executor before starting the clock.
+  const pool = await WasmBatchPool.create(modulePath, threads);
+  let completed = 0;
+  const start = performance.now();
+  await pool.run(configs, (_, result) => {
+    if (result.error) {
+      throw new Error(result.error);
+    }
+    completed += 1;
+  });
+  const seconds = (performance.now() - start) / 1000;
+  await pool.close();
+
+  const rate = completed / seconds;
+  if (threads === 1) {
+    baseline = rate;
+  }
+  const speedup = rate / baseline;
+  console.log(
+    `${String(threads).padStart(8)} ${seconds.toFixed(3).padStart(10)} ${rate.toFixed(1).padStart(12)} ${speedup
+      .toFixed(2)
+      .padStart(9)} ${`${((100 * speedup) / threads).toFixed(0)}%`.padStart(11)}`
+  );
+  if (threads === maxThreads) {
+    break;
+  }
+}
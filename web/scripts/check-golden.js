@@ -0,0 +1,38 @@
+// Runs the golden configurations from tests/golden/simulation_fingerprints.txt
+// through the built wasm module and checks the outputs are bit-identical to
+// the native build. Build with -DWHEELY_REPRODUCIBLE=ON first.
+import { existsSync } from "node:fs";
+import path from "node:path";
+import { pathToFileURL } from "node:url";
+import { loadGoldenCases } from "./golden-cases.js";
+
+const projectRoot = path.resolve(process.cwd(), "..");
+const modulePath = path.join(projectRoot, "build", "wasm", "wheely_wasm.js");
+
+if (!existsSync(modulePath)) {
+  console.error(
+    "Missing build/wasm/wheely_wasm.js. Run `cmake --build . --target wheely_wasm` from the project root first."
+  );
+  process.exit(1);
+}
+
+const factory = (await import(pathToFileURL(modulePath).href)).default;
+const wheely = await factory();
+
+const cases = await loadGoldenCases(projectRoot);
+
+let failures = 0;
+for (const { name, config, expected } of cases) {
+  const actual = wheely.simulate_fingerprint(config);
+  if (actual === expected) {
+    console.log(`ok   ${name} ${actual}`);
+  } else {
+    console.error(`FAIL ${name}: wasm ${actual}, native golden ${expected}`);
+    failures += 1;
+  }
+}
+
+if (failures > 0) {
+  process.exit(1);
+}
+console.log(`All ${cases.length} golden outputs match the native build.`);
@@ -0,0 +1,136 @@
+// Runs the golden configurations through SimulationSession on either wasm
+// build and checks the served frames fingerprint the same as the native
+// simulate(). `node --experimental-wasm-memory64 scripts/check-session.js
+// wasm64` exercises the MEMORY64 build, where any size that leaked across
+// the boundary as size_t would arrive as a BigInt.
+import { existsSync } from "node:fs";
+import path from "node:path";
+import { pathToFileURL } from "node:url";
+import { loadGoldenCases } from "./golden-cases.js";
+
+const target = process.argv[2] ?? "wasm32";
+if (target !== "wasm32" && target !== "wasm64") {
+  console.error(`Unknown target ${target}; expected wasm32 or wasm64.`);
+  process.exit(1);
+}
+
+const projectRoot = path.resolve(process.cwd(), "..");
+const moduleName = target === "wasm64" ? "wheely_wasm64" : "wheely_wasm";
+const modulePath = path.join(projectRoot, "build", "wasm", `${moduleName}.js`);
+
+if (!existsSync(modulePath)) {
+  console.error(
+    `Missing build/wasm/${moduleName}.js. Run \`cmake --build . --target ${moduleName}\` from the project root first.`
+  );
+  process.exit(1);
+}
+
+const factory = (await import(pathToFileURL(modulePath).href)).default;
+const wheely = await factory();
+
+// FNV-1a over the little-endian bytes of every double: times, theta, then the
+// cup-major masses. Mirrors result_fingerprint() in src/wheely_simulation.cpp.
+const FNV_OFFSET = 0xcbf29ce484222325n;
+const FNV_PRIME = 0x100000001b3n;
+const MASK = (1n << 64n) - 1n;
+
+function fingerprint(...arrays) {
+  const scratch = new DataView(new ArrayBuffer(8));
+  let hash = FNV_OFFSET;
+  for (const values of arrays) {
+    for (const value of values) {
+      scratch.setFloat64(0, value, true);
+      for (let byte = 0; byte < 8; byte += 1) {
+        hash = ((hash ^ BigInt(scratch.getUint8(byte))) * FNV_PRIME) & MASK;
+      }
+    }
+  }
+  return hash.toString(16).padStart(16, "0");
+}
+
+function vectorToArray(vector) {
+  const size = vector.size();
+  if (typeof size !== "number") {
+    throw new TypeError(`vector.size() returned ${typeof size}`);
+  }
+  const out = new Array(size);
+  for (let i = 0; i < size; i += 1) {
+    out[i] = vector.get(i);
+  }
+  return out;
+}
+
+function releaseResult(result) {
+  result.times.delete();
+  result.theta.delete();
+  result.masses.delete();
+}
+
+function checkSession({ config, expected }) {
+  const errors = [];
+  const session = new wheely.SimulationSession(config, 64);
+  try {
+    const frameCount = session.frame_count();
+    if (typeof frameCount !== "number") {
+      return [`frame_count() returned ${typeof frameCount}`];
+    }
+    if (frameCount !== config.n_frames) {
+      errors.push(`frame_count() ${frameCount}, expected ${config.n_frames}`);
+    }
+
+    const full = session.frames(0, frameCount);
+    const times = vectorToArray(full.times);
+    const theta = vectorToArray(full.theta);
+    const masses = vectorToArray(full.masses);
+    releaseResult(full);
+    const actual = fingerprint(times, theta, masses);
+    if (actual !== expected) {
+      errors.push(`session fingerprint ${actual}, expected ${expected}`);
+    }
+
+    // A window that starts between checkpoints has to replay from the one
+    // before it and land on the same bits as the full fetch.
+    const first = Math.floor(frameCount / 3) + 1;
+    const count = Math.min(100, frameCount - first);
+    const window = session.frames(first, count);
+    const windowTheta = vectorToArray(window.theta);
+    const windowMasses = vectorToArray(window.masses);
+    releaseResult(window);
+    if (windowTheta.length !== count) {
+      errors.push(`window returned ${windowTheta.length} frames, expected ${count}`);
+    }
+    for (let cup = 0; cup < config.n_cups && errors.length === 0; cup += 1) {
+      for (let offset = 0; offset < count; offset += 1) {
+        if (!Object.is(windowMasses[cup * count + offset], masses[cup * frameCount + first + offset])) {
+          errors.push(`window mass of cup ${cup} at frame ${first + offset} differs from the full fetch`);
+          break;
+        }
+      }
+    }
+  } finally {
+    session.delete();
+  }
+  return errors;
+}
+
+const cases = await loadGoldenCases(projectRoot);
+
+let failures = 0;
+for (const golden of cases) {
+  const direct = wheely.simulate_fingerprint(golden.config);
+  const errors = direct === golden.expected ? [] : [`simulate_fingerprint ${direct}, expected ${golden.expected}`];
+  errors.push(...checkSession(golden));
+  if (errors.length === 0) {
+    console.log(`ok   ${golden.name}`);
+  } else {
+    failures += 1;
+    for (const error of errors) {
+      console.error(`FAIL ${golden.name}: ${error}`);
+    }
+  }
+}
+
+if (failures > 0) {
+  process.exit(1);
+}
+console.log(`${cases.length} golden cases served bit-identically by the ${target} session.`);
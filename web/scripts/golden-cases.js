@@ -0,0 +1,18 @@
+// Reads tests/golden/simulation_fingerprints.txt into
+// { name, config, expected } records, shared by the wasm golden checks.
+import { readFile } from "node:fs/promises";
+import path from "node:path";
+import { configFields } from "./wasm-pool.js";
+
+export async function loadGoldenCases(projectRoot) {
+  const goldenPath = path.join(projectRoot, "tests", "golden", "simulation_fingerprints.txt");
+  return (await readFile(goldenPath, "utf8"))
+    .split("\n")
+    .map((line) => line.trim())
+    .filter((line) => line && !line.startsWith("#"))
+    .map((line) => {
+      const [name, ...values] = line.split(/\s+/);
+      const config = Object.fromEntries(configFields.map((field, index) => [field, Number(values[index])]));
+      return { name, config, expected: values[configFields.length] };
+    });
+}
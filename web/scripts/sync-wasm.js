@@ -1,4 +1,4 @@
-import { copyFile, mkdir } from "node:fs/promises";
+import { copyFile, mkdir, writeFile } from "node:fs/promises";
 import { existsSync } from "node:fs";
 import path from "node:path";
 
@@ -7,6 +7,14 @@ const sourceDir = path.join(projectRoot, "build", "wasm");
 const targetDir = path.resolve(process.cwd(), "src", "wasm", "generated");
 
 const artifacts = ["wheely_wasm.js", "wheely_wasm.wasm"];
+const memory64Artifacts = ["wheely_wasm64.js", "wheely_wasm64.wasm"];
+
+// Stand-in for a missing memory64 build so the bundle still resolves; the
+// client treats the rejection as "memory64 unavailable" and stays on wasm32.
+const memory64Stub = `export default function wheelyWasmModule() {
+  return Promise.reject(new Error("wheely_wasm64 was not built"));
+}
+`;
 
 if (!existsSync(sourceDir)) {
   console.error(
@@ -27,6 +35,14 @@ try {
     const destination = path.join(targetDir, artifact);
     await copyFile(source, destination);
   }
+  if (memory64Artifacts.every((artifact) => existsSync(path.join(sourceDir, artifact)))) {
+    for (const artifact of memory64Artifacts) {
+      await copyFile(path.join(sourceDir, artifact), path.join(targetDir, artifact));
+    }
+  } else {
+    console.warn("No wheely_wasm64 build found; large runs will use sparser checkpoints instead.");
+    await writeFile(path.join(targetDir, "wheely_wasm64.js"), memory64Stub);
+  }
   console.log(`Copied WASM artifacts to ${path.relative(process.cwd(), targetDir)}.`);
 } catch (error) {
   console.error("Failed to copy WASM artifacts:", error);
@@ -0,0 +1,27 @@
+// Worker side of wasm-pool.js: one wasm instance and one SimulationArena per
+// thread, so runs after the largest one so far allocate nothing in wasm.
+import { parentPort, workerData } from "node:worker_threads";
+import { pathToFileURL } from "node:url";
+
+const factory = (await import(pathToFileURL(workerData.modulePath).href)).default;
+const wheely = await factory();
+const arena = new wheely.SimulationArena();
+
+parentPort.on("message", ({ index, config }) => {
+  const status = arena.run(config);
+  if (status !== 0) {
+    parentPort.postMessage({ index, error: wheely.status_message(status) });
+    return;
+  }
+  // The arena views point into this worker's wasm heap, which cannot be
+  // shared, so copy once into a fresh buffer and transfer that.
+  const frames = arena.frame_count();
+  const cups = arena.cup_count();
+  const data = new Float64Array((cups + 2) * frames);
+  data.set(arena.times(), 0);
+  data.set(arena.theta(), frames);
+  data.set(arena.masses(), 2 * frames);
+  parentPort.postMessage({ index, frames, cups, data }, [data.buffer]);
+});
+
+parentPort.postMessage({ ready: true });
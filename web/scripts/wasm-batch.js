@@ -0,0 +1,111 @@
+// Runs a JSONL batch of configs on the wasm module across worker threads.
+//
+// usage: node scripts/wasm-batch.js configs.jsonl [--threads N]
+//                                   [--out results.bin] [--module path]
+//
+// Each input line is a JSON object with the web client's config keys
+// (n_cups, radius, g, damping, leak_rate, inflow_rate, inertia, omega0,
+// t_start, t_end, n_frames, steps_per_frame). For each run, in input order,
+// one JSON line goes to stdout:
+// {"index", "n_cups", "n_frames", "offset", "final_theta"} or
+// {"index", "error"}. With --out, each run's float64 values
+// (times | theta | masses, cup-major) are appended to the file at `offset`
+// bytes.
+import { createWriteStream } from "node:fs";
+import { readFile } from "node:fs/promises";
+import { availableParallelism } from "node:os";
+import { existsSync } from "node:fs";
+import { WasmBatchPool, configFields, defaultModulePath } from "./wasm-pool.js";
+
+function parseArgs(argv) {
+  const options = { input: null, threads: availableParallelism(), out: null, module: defaultModulePath };
+  for (let i = 0; i < argv.length; i += 1) {
+    const arg = argv[i];
+    if (arg === "--threads") {
+      options.threads = Number.parseInt(argv[++i], 10);
+    } else if (arg === "--out") {
+      options.out = argv[++i];
+    } else if (arg === "--module") {
+      options.module = argv[++i];
+    } else {
+      options.input = arg;
+    }
+  }
+  return options;
+}
+
+function parseConfigs(text) {
+  const configs = [];
+  text.split("\n").forEach((line, lineIndex) => {
+    if (!line.trim()) {
+      return;
+    }
+    const config = JSON.parse(line);
+    const missing = configFields.filter((field) => typeof config[field] !== "number");
+    if (missing.length > 0) {
+      throw new Error(`line ${lineIndex + 1}: missing numeric ${missing.join(", ")}`);
+    }
+    configs.push(config);
+  });
+  return configs;
+}
+
+const options = parseArgs(process.argv.slice(2));
+if (!options.input || !(options.threads > 0)) {
+  console.error("usage: node scripts/wasm-batch.js configs.jsonl [--threads N] [--out results.bin] [--module path]");
+  process.exit(1);
+}
+if (!existsSync(options.module)) {
+  console.error(`Missing ${options.module}. Run \`cmake --build . --target wheely_wasm\` from the project root first.`);
+  process.exit(1);
+}
+
+const configs = parseConfigs(await readFile(options.input, "utf8"));
+const out = options.out ? createWriteStream(options.out) : null;
+const pool = await WasmBatchPool.create(options.module, options.threads);
+
+// Results arrive in completion order; hold them until every earlier index
+// has been written so the output follows the input order.
+const waiting = new Map();
+let nextToWrite = 0;
+let offset = 0;
+let failures = 0;
+
+const flush = () => {
+  while (waiting.has(nextToWrite)) {
+    const result = waiting.get(nextToWrite);
+    waiting.delete(nextToWrite);
+    if (result.error) {
+      failures += 1;
+      console.log(JSON.stringify({ index: nextToWrite, error: result.error }));
+    } else {
+      const { frames, cups, data } = result;
+      console.log(
+        JSON.stringify({ index: nextToWrite, n_cups: cups, n_frames: frames, offset, final_theta: data[2 * frames - 1] })
+      );
+      if (out) {
+        out.write(new Uint8Array(data.buffer, data.byteOffset, data.byteLength));
+      }
+      offset += data.byteLength;
+    }
+    nextToWrite += 1;
+  }
+};
+
+const start = performance.now();
+try {
+  await pool.run(configs, (index, result) => {
+    waiting.set(index, result);
+    flush();
+  });
+} finally {
+  await pool.close();
+}
+const seconds = (performance.now() - start) / 1000;
+if (out) {
+  await new Promise((resolve, reject) => out.end((error) => (error ? reject(error) : resolve())));
+}
+console.error(
+  `${configs.length} runs on ${options.threads} threads in ${seconds.toFixed(3)} s (${(configs.length / seconds).toFixed(1)} runs/s)`
+);
+process.exit(failures > 0 ? 1 : 0);
@@ -0,0 +1,108 @@
+// A pool of worker_threads, each running its own instance of the wasm
+// module with a persistent SimulationArena. Configs are handed out one at a
+// time as workers become free. Each worker copies its result out of its own
+// wasm heap once and transfers that buffer, so the hop between threads
+// itself copies nothing.
+import { Worker } from "node:worker_threads";
+import { availableParallelism } from "node:os";
+import { fileURLToPath } from "node:url";
+import path from "node:path";
+
+const scriptDir = path.dirname(fileURLToPath(import.meta.url));
+
+export const defaultModulePath = path.resolve(scriptDir, "..", "..", "build", "wasm", "wheely_wasm.js");
+
+export const configFields = [
+  "n_cups",
+  "radius",
+  "g",
+  "damping",
+  "leak_rate",
+  "inflow_rate",
+  "inertia",
+  "omega0",
+  "t_start",
+  "t_end",
+  "n_frames",
+  "steps_per_frame"
+];
+
+export class WasmBatchPool {
+  static async create(modulePath = defaultModulePath, threads = availableParallelism()) {
+    const workerUrl = new URL("./wasm-batch-worker.js", import.meta.url);
+    const workers = Array.from({ length: threads }, () => new Worker(workerUrl, { workerData: { modulePath } }));
+    await Promise.all(
+      workers.map(
+        (worker) =>
+          new Promise((resolve, reject) => {
+            worker.once("message", resolve);
+            worker.once("error", reject);
+          })
+      )
+    );
+    return new WasmBatchPool(workers);
+  }
+
+  constructor(workers) {
+    this.workers = workers;
+  }
+
+  get size() {
+    return this.workers.length;
+  }
+
+  // Runs every config and calls onResult(index, result) in completion order.
+  // result is { frames, cups, data } with data laid out times | theta |
+  // masses (cup-major), or { error } if that config was rejected.
+  run(configs, onResult) {
+    return new Promise((resolve, reject) => {
+      let next = 0;
+      let pending = 0;
+      let failed = false;
+
+      const cleanup = () => {
+        for (const worker of this.workers) {
+          worker.removeAllListeners("message");
+          worker.removeAllListeners("error");
+        }
+      };
+
+      const dispatch = (worker) => {
+        if (next < configs.length) {
+          const index = next++;
+          pending += 1;
+          worker.postMessage({ index, config: configs[index] });
+        } else if (pending === 0 && !failed) {
+          cleanup();
+          resolve();
+        }
+      };
+
+      for (const worker of this.workers) {
+        worker.on("message", (message) => {
+          pending -= 1;
+          const { index, ...result } = message;
+          onResult(index, result);
+          dispatch(worker);
+        });
+        worker.on("error", (error) => {
+          failed = true;
+          cleanup();
+          reject(error);
+        });
+      }
+      if (configs.length === 0) {
+        cleanup();
+        resolve();
+        return;
+      }
+      for (const worker of this.workers) {
+        dispatch(worker);
+      }
+    });
+  }
+
+  close() {
+    return Promise.all(this.workers.map((worker) => worker.terminate()));
+  }
+}
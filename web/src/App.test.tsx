@@ -7,9 +7,16 @@ jest.mock("./plotly", () => ({
   default: () => <div data-testid="plot-mock">Plot</div>,
 }));
 
-jest.mock("./wasm", () => ({
-  loadWheelyModule: jest.fn(),
-}));
+jest.mock("./wasm", () => {
+  const loadWheelyModule = jest.fn();
+  return {
+    loadWheelyModule,
+    loadModuleForRun: jest.fn(async (_config: unknown, checkpointInterval: number) => ({
+      module: await loadWheelyModule(),
+      checkpointInterval
+    }))
+  };
+});
 
 type Deferred<T> = {
   promise: Promise<T>;
@@ -20,6 +27,7 @@ type LoadedModule = Awaited<ReturnType<typeof loadWheelyModule>>;
 type MockModule = jest.Mocked<LoadedModule>;
 type SimulationResult = ReturnType<LoadedModule["simulate"]>;
 type MockVector = SimulationResult["times"];
+type MockSession = InstanceType<LoadedModule["SimulationSession"]>;
 
 const mockLoadWheelyModule = loadWheelyModule as jest.MockedFunction<
   typeof loadWheelyModule
@@ -57,12 +65,56 @@ function createMockModule(): MockModule {
     { length: frameCount * cupCount },
     (_, index) => index / 5
   );
+  const createMockSession = (): MockSession => ({
+    frame_count: () => frameCount,
+    t_start: () => times[0],
+    t_end: () => times[frameCount - 1],
+    times: () => createMockVector(times),
+    theta: () => createMockVector(theta),
+    mass_min: () => Math.min(...masses),
+    mass_max: () => Math.max(...masses),
+    frames: (first: number, count: number) => {
+      const end = Math.min(first + count, frameCount);
+      const sliceMasses: number[] = [];
+      for (let cup = 0; cup < cupCount; cup += 1) {
+        for (let frame = first; frame < end; frame += 1) {
+          sliceMasses.push(masses[cup * frameCount + frame]);
+        }
+      }
+      return {
+        times: createMockVector(times.slice(first, end)),
+        theta: createMockVector(theta.slice(first, end)),
+        masses: createMockVector(sliceMasses)
+      };
+    },
+    theta_decimated: () => ({
+      x: createMockVector(times),
+      y: createMockVector(theta)
+    }),
+    delete: jest.fn()
+  });
   return {
     simulate: jest.fn((_config: Parameters<LoadedModule["simulate"]>[0]) => ({
       times: createMockVector(times),
       theta: createMockVector(theta),
       masses: createMockVector(masses)
     })) as MockModule["simulate"],
+    cup_positions: jest.fn((thetaVector: MockVector, cups: number, radius: number) => {
+      const count = thetaVector.size();
+      const x: number[] = [];
+      const y: number[] = [];
+      for (let cup = 0; cup < cups; cup += 1) {
+        for (let frame = 0; frame < count; frame += 1) {
+          const angle = thetaVector.get(frame) + (2 * Math.PI * cup) / cups;
+          x.push(radius * Math.cos(angle));
+          y.push(radius * Math.sin(angle));
+        }
+      }
+      return { x: createMockVector(x), y: createMockVector(y) };
+    }) as MockModule["cup_positions"],
+    SimulationSession: jest.fn(
+      (_config: Record<string, number>, _checkpointInterval: number) => createMockSession()
+    ) as unknown as MockModule["SimulationSession"],
     vectorToArray: jest.fn((vector: MockVector) => {
       const count = vector.size();
       const output = new Array<number>(count);
@@ -91,7 +143,7 @@ it("renders primary controls with default values", async () => {
   expect(screen.getByLabelText(/number of cups/i)).toHaveValue(8);
 
   await waitFor(() =>
-    expect(screen.getByTestId("plot-mock")).toBeInTheDocument()
+    expect(screen.getAllByTestId("plot-mock")[0]).toBeInTheDocument()
   );
 });
 
@@ -108,8 +160,8 @@ it("shows loading feedback while simulations are running", async () => {
   await waitFor(() =>
     expect(screen.queryByText(/running simulation/i)).not.toBeInTheDocument()
   );
-  expect(screen.getByTestId("plot-mock")).toBeInTheDocument();
-  expect(mockModule.simulate).toHaveBeenCalledTimes(1);
+  expect(screen.getAllByTestId("plot-mock")[0]).toBeInTheDocument();
+  expect(mockModule.SimulationSession).toHaveBeenCalledTimes(1);
 });
 
 it("applies user input before rerunning simulations", async () => {
@@ -118,7 +170,7 @@ it("applies user input before rerunning simulations", async () => {
 
   await renderApp();
   await waitFor(() =>
-    expect(screen.getByTestId("plot-mock")).toBeInTheDocument()
+    expect(screen.getAllByTestId("plot-mock")[0]).toBeInTheDocument()
   );
 
   fireEvent.change(screen.getByLabelText(/wheel radius/i), {
@@ -127,7 +179,8 @@ it("applies user input before rerunning simulations", async () => {
   const runButton = await screen.findByRole("button", { name: /run simulation|running/i });
   fireEvent.click(runButton);
 
-  await waitFor(() => expect(mockModule.simulate).toHaveBeenCalledTimes(2));
-  const latestConfig = mockModule.simulate.mock.calls.at(-1)?.[0];
+  const sessionMock = mockModule.SimulationSession as unknown as jest.Mock;
+  await waitFor(() => expect(sessionMock).toHaveBeenCalledTimes(2));
+  const latestConfig = sessionMock.mock.calls.at(-1)?.[0];
   expect(latestConfig?.radius).toBe(2.5);
 });
@@ -1,5 +1,5 @@
 import { useCallback, useEffect, useRef, useState } from "react";
-import { loadWheelyModule } from "./wasm";
+import { loadModuleForRun, type SessionHandle } from "./wasm";
 import SimulationControls from "./components/SimulationControls";
 import SimulationPlotPanel from "./components/SimulationPlotPanel";
 import { zenburnPalette } from "./theme";
@@ -34,21 +34,33 @@ const runAwayConfig = {
   steps_per_frame: 500
 };
 
+// Frames between stored full-state checkpoints in the wasm session. Fetching
+// a frame window replays at most this many frames before the window starts.
+const checkpointInterval = 32;
+
 export type SimulationConfig = typeof defaultConfig;
 export type SimulationStatus = "idle" | "loading" | "ready";
 
+export type FramePositions = {
+  x: number[];
+  y: number[];
+  masses: number[];
+};
+
+export type FrameWindow = {
+  start: number;
+  frames: FramePositions[];
+};
+
 export type PlotReadyData = {
-  times: number[];
-  theta: number[];
-  massesByFrame: number[][];
+  tStart: number;
+  tEnd: number;
+  frameCount: number;
   cupCount: number;
   radius: number;
   massRange: { min: number; max: number };
-  positionsByFrame: Array<{
-    x: number[];
-    y: number[];
-    masses: number[];
-  }>;
+  fetchFrames: (start: number, count: number) => FrameWindow;
+  decimateTheta: (tMin: number, tMax: number, pixelWidth: number) => { x: number[]; y: number[] };
 };
 
 export default function App() {
@@ -57,6 +69,12 @@ export default function App() {
   const [config, setConfig] = useState<SimulationConfig>(() => ({ ...defaultConfig }));
   const [plotData, setPlotData] = useState<PlotReadyData | null>(null);
   const latestRunRef = useRef(0);
+  const sessionRef = useRef<SessionHandle | null>(null);
+
+  const releaseSession = useCallback(() => {
+    sessionRef.current?.delete();
+    sessionRef.current = null;
+  }, []);
 
   const handleRun = useCallback(async () => {
     const runId = ++latestRunRef.current;
@@ -64,57 +82,64 @@ export default function App() {
     setError(null);
     setPlotData(null);
     try {
-      const module = await loadWheelyModule();
-      const result = module.simulate(config);
-      const times = module.vectorToArray(result.times);
-      const theta = module.vectorToArray(result.theta);
-      const masses = module.vectorToArray(result.masses);
-
-      const frameCount = times.length;
-      const cupCount = config.n_cups;
-      let minMass = Number.POSITIVE_INFINITY;
-      let maxMass = Number.NEGATIVE_INFINITY;
-      const massesByFrame = Array.from({ length: frameCount }, (_, frameIndex) =>
-        Array.from({ length: cupCount }, (_, cupIndex) => {
-          const value = masses[cupIndex * frameCount + frameIndex] ?? 0;
-          if (value < minMass) {
-            minMass = value;
-          }
-          if (value > maxMass) {
-            maxMass = value;
-          }
-          return value;
-        })
+      const { module, checkpointInterval: interval } = await loadModuleForRun(
+        config,
+        checkpointInterval
       );
+      const session = new module.SimulationSession(config, interval);
+      if (latestRunRef.current !== runId) {
+        session.delete();
+        return;
+      }
+      releaseSession();
+      sessionRef.current = session;
+
+      let minMass = session.mass_min();
+      let maxMass = session.mass_max();
       if (!Number.isFinite(minMass) || !Number.isFinite(maxMass)) {
         minMass = 0;
         maxMass = 0;
       }
-      const angleStep = (2 * Math.PI) / cupCount;
+
+      const cupCount = config.n_cups;
       const radius = Math.abs(config.radius);
-      const positionsByFrame = massesByFrame.map((massesForFrame, frameIndex) => {
-        const thetaValue = theta[frameIndex];
-        const x = Array.from({ length: cupCount }, (_, cupIndex) =>
-          radius * Math.cos(thetaValue + angleStep * cupIndex)
-        );
-        const y = Array.from({ length: cupCount }, (_, cupIndex) =>
-          radius * Math.sin(thetaValue + angleStep * cupIndex)
-        );
-        return { x, y, masses: massesForFrame };
-      });
+      const fetchFrames = (start: number, count: number): FrameWindow => {
+        const slice = session.frames(start, count);
+        slice.times.delete?.();
+        const positions = module.cup_positions(slice.theta, cupCount, radius);
+        const sliceCount = slice.theta.size();
+        slice.theta.delete?.();
+        const sliceMasses = module.vectorToArray(slice.masses);
+        const sliceX = module.vectorToArray(positions.x);
+        const sliceY = module.vectorToArray(positions.y);
+        const cupMajor = (values: number[], offset: number) =>
+          Array.from(
+            { length: cupCount },
+            (_, cupIndex) => values[cupIndex * sliceCount + offset] ?? 0
+          );
+        const frames = Array.from({ length: sliceCount }, (_, offset) => ({
+          x: cupMajor(sliceX, offset),
+          y: cupMajor(sliceY, offset),
+          masses: cupMajor(sliceMasses, offset)
+        }));
+        return { start, frames };
+      };
+
+      const decimateTheta = (tMin: number, tMax: number, pixelWidth: number) => {
+        const series = session.theta_decimated(tMin, tMax, pixelWidth);
+        return { x: module.vectorToArray(series.x), y: module.vectorToArray(series.y) };
+      };
 
       const nextPlotData: PlotReadyData = {
-        times,
-        theta,
-        massesByFrame,
+        tStart: session.t_start(),
+        tEnd: session.t_end(),
+        frameCount: session.frame_count(),
         cupCount,
         radius,
         massRange: { min: minMass, max: maxMass },
-        positionsByFrame
+        fetchFrames,
+        decimateTheta
       };
-      if (latestRunRef.current !== runId) {
-        return;
-      }
       setPlotData(nextPlotData);
       setStatus("ready");
     } catch (err) {
@@ -124,7 +149,9 @@ export default function App() {
       setError(err instanceof Error ? err.message : String(err));
       setStatus("idle");
     }
-  }, [config]);
+  }, [config, releaseSession]);
+
+  useEffect(() => releaseSession, [releaseSession]);
 
   const handleChange = useCallback(
     (key: keyof SimulationConfig, rawValue: string) => {
@@ -2,27 +2,40 @@ import { render, screen } from "@testing-library/react";
 import SimulationPlotPanel from "./SimulationPlotPanel";
 import type { PlotReadyData } from "../App";
 
+const mockPlot = jest.fn((_props: { layout?: { sliders?: { steps?: unknown[] }[] } }) => (
+  <div data-testid="plot-mock">Plot</div>
+));
+
 jest.mock("../plotly", () => ({
   __esModule: true,
-  default: () => <div data-testid="plot-mock">Plot</div>
+  default: (props: { layout?: { sliders?: { steps?: unknown[] }[] } }) => mockPlot(props)
+}));
+
+const sampleFetchFrames = jest.fn((start: number, count: number) => ({
+  start,
+  frames: Array.from({ length: Math.min(count, 3 - start) }, () => ({
+    x: [0, 1],
+    y: [0, 1],
+    masses: [1, 2]
+  }))
 }));
 
 const samplePlotData: PlotReadyData = {
-  times: [0],
-  theta: [0],
-  massesByFrame: [[1, 2]],
+  tStart: 0,
+  tEnd: 1,
+  frameCount: 3,
   cupCount: 2,
   radius: 1,
   massRange: { min: 1, max: 2 },
-  positionsByFrame: [
-    {
-      x: [0, 1],
-      y: [0, 1],
-      masses: [1, 2]
-    }
-  ]
+  fetchFrames: sampleFetchFrames,
+  decimateTheta: () => ({ x: [0, 1], y: [0, 0.2] })
 };
 
+beforeEach(() => {
+  sampleFetchFrames.mockClear();
+  mockPlot.mockClear();
+});
+
 it("shows loading state copy while simulation runs", () => {
   render(<SimulationPlotPanel status="loading" plotData={null} />);
   expect(screen.getByText(/running simulation/i)).toBeInTheDocument();
@@ -35,5 +48,25 @@ it("shows empty-state hint when no plot data is available", () => {
 
 it("renders plot once data is available", () => {
   render(<SimulationPlotPanel status="ready" plotData={samplePlotData} />);
-  expect(screen.getByTestId("plot-mock")).toBeInTheDocument();
+  expect(screen.getAllByTestId("plot-mock")).toHaveLength(2);
+});
+
+it("fetches only a window of frames around the slider position", () => {
+  render(<SimulationPlotPanel status="ready" plotData={samplePlotData} />);
+  expect(sampleFetchFrames).toHaveBeenCalledTimes(1);
+  expect(sampleFetchFrames).toHaveBeenCalledWith(0, expect.any(Number));
+});
+
+it("caps the slider at a fixed number of stops for long runs", () => {
+  const fetchFrames = jest.fn((start: number, count: number) => ({
+    start,
+    frames: Array.from({ length: count }, () => ({ x: [0, 1], y: [0, 1], masses: [1, 2] }))
+  }));
+  const longRun: PlotReadyData = { ...samplePlotData, tEnd: 100, frameCount: 10000, fetchFrames };
+  render(<SimulationPlotPanel status="ready" plotData={longRun} />);
+  const sliders = mockPlot.mock.calls
+    .map(([props]) => props.layout?.sliders?.[0])
+    .filter((slider) => slider !== undefined);
+  expect(sliders[sliders.length - 1]?.steps).toHaveLength(200);
+  expect(fetchFrames).toHaveBeenCalledTimes(1);
 });
@@ -1,6 +1,7 @@
-import { useMemo } from "react";
-import type { Data, Frame, SliderStep } from "plotly.js";
+import { useEffect, useMemo, useState } from "react";
+import type { SliderStep } from "plotly.js";
 import Plot from "../plotly";
+import ThetaTimeSeriesPlot from "./ThetaTimeSeriesPlot";
 import { zenburnPalette } from "../theme";
 import type { PlotReadyData, SimulationStatus } from "../App";
 
@@ -9,9 +10,79 @@ type SimulationPlotPanelProps = {
   plotData: PlotReadyData | null;
 };
 
+// Frames are fetched from the wasm session in aligned windows of this size;
+// only the window holding the slider position is kept on the JS heap.
+const frameWindowSize = 120;
+const playbackIntervalMs = 60;
+// The time slider has at most this many stops however long the run is;
+// playback still advances one frame at a time.
+const maxSliderSteps = 200;
+
+function frameTime(plotData: PlotReadyData, frameIndex: number) {
+  if (plotData.frameCount < 2) {
+    return plotData.tStart;
+  }
+  return plotData.tStart + ((plotData.tEnd - plotData.tStart) * frameIndex) / (plotData.frameCount - 1);
+}
+
+// Maps slider stop `step` of `stepCount` to a frame index and back.
+function stepFrame(step: number, stepCount: number, frameCount: number) {
+  return stepCount < 2 ? 0 : Math.round((step * (frameCount - 1)) / (stepCount - 1));
+}
+
+function frameStep(frameIndex: number, stepCount: number, frameCount: number) {
+  return frameCount < 2 ? 0 : Math.round((frameIndex * (stepCount - 1)) / (frameCount - 1));
+}
+
 export default function SimulationPlotPanel({ status, plotData }: SimulationPlotPanelProps) {
+  const [frameIndex, setFrameIndex] = useState(0);
+  const [playing, setPlaying] = useState(false);
+
+  useEffect(() => {
+    setFrameIndex(0);
+    setPlaying(false);
+  }, [plotData]);
+
+  useEffect(() => {
+    if (!playing || !plotData) {
+      return;
+    }
+    if (frameIndex + 1 >= plotData.frameCount) {
+      setPlaying(false);
+      return;
+    }
+    const timer = setTimeout(() => setFrameIndex((index) => index + 1), playbackIntervalMs);
+    return () => clearTimeout(timer);
+  }, [playing, plotData, frameIndex]);
+
+  const frameCount = plotData?.frameCount ?? 0;
+  const clampedIndex = Math.min(frameIndex, Math.max(frameCount - 1, 0));
+  const windowStart = clampedIndex - (clampedIndex % frameWindowSize);
+  const frameWindow = useMemo(
+    () => (plotData && plotData.frameCount > 0 ? plotData.fetchFrames(windowStart, frameWindowSize) : null),
+    [plotData, windowStart]
+  );
+  const currentFrame = frameWindow?.frames[clampedIndex - frameWindow.start] ?? null;
+
+  const sliderStepCount = Math.min(frameCount, maxSliderSteps);
+  const sliderSteps = useMemo(() => {
+    if (!plotData) {
+      return [];
+    }
+    return Array.from({ length: sliderStepCount }, (_, step): Partial<SliderStep> => {
+      const index = stepFrame(step, sliderStepCount, plotData.frameCount);
+      return {
+        label: frameTime(plotData, index).toFixed(2),
+        value: index.toString(),
+        method: "skip",
+        args: []
+      };
+    });
+  }, [plotData, sliderStepCount]);
+  const sliderActive = frameStep(clampedIndex, sliderStepCount, frameCount);
+
   const geometryPlot = useMemo(() => {
-    if (!plotData || plotData.positionsByFrame.length === 0) {
+    if (!plotData || !currentFrame) {
       return null;
     }
 
@@ -27,51 +98,6 @@ export default function SimulationPlotPanel({ status, plotData }: SimulationPlot
       [1, zenburnPalette.accent]
     ];
     const cupLabels = Array.from({ length: plotData.cupCount }, (_, index) => index + 1);
-    const frames: Frame[] = plotData.positionsByFrame.map((frame, frameIndex) => ({
-      name: frameIndex.toString(),
-      group: "geometry",
-      baseframe: "",
-      traces: [0],
-      layout: {},
-      data: [
-        {
-          type: "scatter",
-          x: frame.x,
-          y: frame.y,
-          marker: {
-            size: 50,
-            color: frame.masses,
-            colorscale: massColorscale,
-            cmin: massMin,
-            cmax: colorMax,
-            symbol: "square",
-            line: { color: zenburnPalette.borderSubtle, width: 1 }
-          },
-          text: frame.masses.map((value) => value.toFixed(1)),
-          customdata: cupLabels
-        } as Data
-      ]
-    }));
-
-    const sliderSteps: Partial<SliderStep>[] = frames.map((frame, index): Partial<SliderStep> => ({
-      label: plotData.times[index].toFixed(2),
-      method: "animate",
-      args: [
-        [frame.name],
-        { mode: "immediate", transition: { duration: 0 }, frame: { duration: 0, redraw: false } }
-      ]
-    }));
-
-    const playArgs = [
-      null,
-      {
-        transition: { duration: 0 },
-        frame: { duration: 60, redraw: false },
-        fromcurrent: true
-      }
-    ];
-
-    const initialFrame = plotData.positionsByFrame[0];
     const axisExtent = (plotData.radius || 1) * 1.25;
 
     return (
@@ -80,13 +106,13 @@ export default function SimulationPlotPanel({ status, plotData }: SimulationPlot
           {
             type: "scatter",
             mode: "text+markers",
-            x: initialFrame.x,
-            y: initialFrame.y,
-            text: initialFrame.masses.map((value) => value.toFixed(1)),
+            x: currentFrame.x,
+            y: currentFrame.y,
+            text: currentFrame.masses.map((value) => value.toFixed(1)),
             textposition: "top center",
             marker: {
               size: 50,
-              color: initialFrame.masses,
+              color: currentFrame.masses,
               colorscale: massColorscale,
               cmin: massMin,
               cmax: colorMax,
@@ -115,7 +141,6 @@ export default function SimulationPlotPanel({ status, plotData }: SimulationPlot
             showlegend: false
           }
         ]}
-        frames={frames}
         layout={{
           title: { text: "Wheel Geometry", font: { color: zenburnPalette.textPrimary } },
           paper_bgcolor: zenburnPalette.background,
@@ -148,25 +173,14 @@ export default function SimulationPlotPanel({ status, plotData }: SimulationPlot
               bgcolor: zenburnPalette.surface,
               bordercolor: zenburnPalette.border,
               buttons: [
-                {
-                  label: "Play",
-                  method: "animate",
-                  args: playArgs
-                },
-                {
-                  label: "Pause",
-                  method: "animate",
-                  args: [
-                    [null],
-                    { mode: "immediate", transition: { duration: 0 }, frame: { duration: 0, redraw: false } }
-                  ]
-                }
+                { label: "Play", method: "skip", args: [] },
+                { label: "Pause", method: "skip", args: [] }
               ]
             }
           ],
           sliders: [
             {
-              active: 0,
+              active: sliderActive,
               currentvalue: { prefix: "Time (s): ", font: { color: zenburnPalette.textPrimary } },
               pad: { t: 30 },
               steps: sliderSteps,
@@ -175,11 +189,16 @@ export default function SimulationPlotPanel({ status, plotData }: SimulationPlot
             }
           ]
         }}
+        onSliderChange={(event) => {
+          setPlaying(false);
+          setFrameIndex(Number(event.step.value));
+        }}
+        onButtonClicked={(event) => setPlaying(event.button.label === "Play")}
         config={{ responsive: true, displaylogo: false }}
         style={{ width: "100%", height: "100%", backgroundColor: zenburnPalette.panel, borderRadius: "0.5rem" }}
       />
     );
-  }, [plotData]);
+  }, [plotData, currentFrame, sliderActive, sliderSteps]);
 
   return (
     <section
@@ -219,6 +238,23 @@ export default function SimulationPlotPanel({ status, plotData }: SimulationPlot
           </p>
         )}
       </div>
+      {status !== "loading" && plotData && plotData.frameCount > 0 && (
+        <div
+          style={{
+            flex: "0 0 auto",
+            height: "300px",
+            border: `1px solid ${zenburnPalette.border}`,
+            borderRadius: "0.85rem",
+            padding: "1rem",
+            backgroundColor: zenburnPalette.surface,
+            display: "flex",
+            alignItems: "stretch",
+            justifyContent: "center"
+          }}
+        >
+          <ThetaTimeSeriesPlot plotData={plotData} />
+        </div>
+      )}
     </section>
   );
 }
@@ -0,0 +1,30 @@
+import { render, screen } from "@testing-library/react";
+import ThetaTimeSeriesPlot from "./ThetaTimeSeriesPlot";
+import type { PlotReadyData } from "../App";
+
+jest.mock("../plotly", () => ({
+  __esModule: true,
+  default: () => <div data-testid="plot-mock">Plot</div>
+}));
+
+const decimateTheta = jest.fn((_tMin: number, _tMax: number, _pixelWidth: number) => ({
+  x: [0, 2],
+  y: [0, 1]
+}));
+
+const samplePlotData: PlotReadyData = {
+  tStart: 0,
+  tEnd: 2,
+  frameCount: 3,
+  cupCount: 2,
+  radius: 1,
+  massRange: { min: 0, max: 1 },
+  fetchFrames: (start: number) => ({ start, frames: [] }),
+  decimateTheta
+};
+
+it("requests a decimated series for the full time range", () => {
+  render(<ThetaTimeSeriesPlot plotData={samplePlotData} />);
+  expect(screen.getByTestId("plot-mock")).toBeInTheDocument();
+  expect(decimateTheta).toHaveBeenCalledWith(0, 2, expect.any(Number));
+});
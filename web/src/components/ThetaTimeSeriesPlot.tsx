@@ -0,0 +1,96 @@
+import { useEffect, useMemo, useState } from "react";
+import type { PlotRelayoutEvent } from "plotly.js";
+import Plot from "../plotly";
+import { zenburnPalette } from "../theme";
+import type { PlotReadyData } from "../App";
+
+type ThetaTimeSeriesPlotProps = {
+  plotData: PlotReadyData;
+};
+
+// Used until Plotly reports the rendered width of the plot area.
+const defaultPixelWidth = 800;
+
+export default function ThetaTimeSeriesPlot({ plotData }: ThetaTimeSeriesPlotProps) {
+  const fullRange = useMemo<[number, number]>(
+    () => [plotData.tStart, plotData.tEnd],
+    [plotData]
+  );
+  const [xRange, setXRange] = useState<[number, number]>(fullRange);
+  const [pixelWidth, setPixelWidth] = useState(defaultPixelWidth);
+
+  useEffect(() => {
+    setXRange(fullRange);
+  }, [fullRange]);
+
+  // Re-decimated in wasm whenever the visible range or plot width changes, so
+  // the trace never holds more than ~2 points per horizontal pixel.
+  const series = useMemo(
+    () => plotData.decimateTheta(xRange[0], xRange[1], pixelWidth),
+    [plotData, xRange, pixelWidth]
+  );
+
+  const handleRelayout = (event: Readonly<PlotRelayoutEvent>) => {
+    if (event["xaxis.autorange"]) {
+      setXRange(fullRange);
+      return;
+    }
+    const start = event["xaxis.range[0]"];
+    const end = event["xaxis.range[1]"];
+    if (typeof start === "number" && typeof end === "number" && end > start) {
+      setXRange([start, end]);
+    }
+  };
+
+  const handleResize = (_figure: unknown, graphDiv: HTMLElement) => {
+    const width = Math.round(graphDiv.clientWidth);
+    if (width > 0) {
+      setPixelWidth(width);
+    }
+  };
+
+  return (
+    <Plot
+      data={[
+        {
+          type: "scattergl",
+          mode: "lines",
+          x: series.x,
+          y: series.y,
+          line: { color: zenburnPalette.accentAlt, width: 1.5 },
+          name: "θ(t)",
+          hovertemplate: "t: %{x:.2f} s<br>θ: %{y:.2f} rad<extra></extra>"
+        }
+      ]}
+      layout={{
+        title: { text: "Wheel Angle", font: { color: zenburnPalette.textPrimary } },
+        paper_bgcolor: zenburnPalette.background,
+        plot_bgcolor: zenburnPalette.panel,
+        xaxis: {
+          title: { text: "t (s)", font: { color: zenburnPalette.textPrimary } },
+          range: xRange,
+          gridcolor: zenburnPalette.plotGrid,
+          zerolinecolor: zenburnPalette.borderSubtle,
+          tickfont: { color: zenburnPalette.textPrimary },
+          linecolor: zenburnPalette.borderSubtle
+        },
+        yaxis: {
+          title: { text: "θ (rad)", font: { color: zenburnPalette.textPrimary } },
+          autorange: true,
+          gridcolor: zenburnPalette.plotGrid,
+          zerolinecolor: zenburnPalette.borderSubtle,
+          tickfont: { color: zenburnPalette.textPrimary },
+          linecolor: zenburnPalette.borderSubtle
+        },
+        margin: { t: 40, r: 30, b: 50, l: 60 },
+        showlegend: false,
+        font: { color: zenburnPalette.textPrimary }
+      }}
+      onRelayout={handleRelayout}
+      onInitialized={handleResize}
+      onUpdate={handleResize}
+      config={{ responsive: true, displaylogo: false }}
+      style={{ width: "100%", height: "100%", backgroundColor: zenburnPalette.panel, borderRadius: "0.5rem" }}
+    />
+  );
+}
@@ -4,3 +4,8 @@ declare module "@wasm/wheely_wasm.js" {
   const createModule: () => Promise<unknown>;
   export default createModule;
 }
+
+declare module "@wasm/wheely_wasm64.js" {
+  const createModule: () => Promise<unknown>;
+  export default createModule;
+}
@@ -1,15 +1,103 @@
+import { planSession, supportsMemory64, type WasmVariant } from "./memoryPlan";
+
+// Sizes, counts and indices are plain numbers on both builds: the bindings
+// pass them as double so the memory64 build never hands back a BigInt.
 type VectorHandle = {
   size: () => number;
   get: (index: number) => number;
   delete?: () => void;
 };
 
-type WheelyModule = {
-  simulate: (config: Record<string, number>) => {
-    times: VectorHandle;
-    theta: VectorHandle;
-    masses: VectorHandle;
+type ResultHandle = {
+  times: VectorHandle;
+  theta: VectorHandle;
+  masses: VectorHandle;
+};
+
+export type SessionHandle = {
+  frame_count: () => number;
+  t_start: () => number;
+  t_end: () => number;
+  times: () => VectorHandle;
+  theta: () => VectorHandle;
+  mass_min: () => number;
+  mass_max: () => number;
+  frames: (first: number, count: number) => ResultHandle;
+  theta_decimated: (tMin: number, tMax: number, pixelWidth: number) => {
+    x: VectorHandle;
+    y: VectorHandle;
   };
+  delete: () => void;
+};
+
+export type ArenaHandle = {
+  run: (config: Record<string, number>) => number;
+  frame_count: () => number;
+  cup_count: () => number;
+  // Views into the wasm heap: valid until the next run() or heap growth.
+  times: () => Float64Array;
+  theta: () => Float64Array;
+  masses: () => Float64Array;
+  delete: () => void;
+};
+
+type EventKindHandle = { value: number };
+
+export type EventHandle = {
+  time: number;
+  theta: number;
+  omega: number;
+  cup: number;
+  kind: EventKindHandle;
+  direction: number;
+};
+
+export type WheelyModule = {
+  simulate: (config: Record<string, number>) => ResultHandle;
+  simulate_into_heap: (
+    nCups: number,
+    radius: number,
+    g: number,
+    damping: number,
+    leakRate: number,
+    inflowRate: number,
+    inertia: number,
+    omega0: number,
+    tStart: number,
+    tEnd: number,
+    nFrames: number,
+    stepsPerFrame: number,
+    out: number
+  ) => number;
+  status_message: (status: number) => string;
+  _malloc: (bytes: number) => number;
+  _free: (pointer: number) => void;
+  HEAPF64: Float64Array;
+  // bins is bin-major: bins[bin * frameCount + frame].
+  simulate_lab_bins: (
+    config: Record<string, number>,
+    binCount: number
+  ) => { times: VectorHandle; theta: VectorHandle; bins: VectorHandle };
+  simulate_events: (
+    config: Record<string, number>,
+    options: {
+      omega_reversals: boolean;
+      omega_maxima: boolean;
+      omega_minima: boolean;
+      inflow_crossings: boolean;
+    }
+  ) => { size: () => number; get: (index: number) => EventHandle; delete?: () => void };
+  EventKind: Record<"omega_reversal" | "omega_maximum" | "omega_minimum" | "inflow_entry" | "inflow_exit", EventKindHandle>;
+  cup_positions: (
+    theta: VectorHandle,
+    cupCount: number,
+    radius: number
+  ) => { x: VectorHandle; y: VectorHandle };
+  reserve_heap: (bytes: number) => boolean;
+  estimate_peak_bytes: (config: Record<string, number>) => number;
+  SimulationArena: new () => ArenaHandle;
+  estimate_session_bytes: (config: Record<string, number>, checkpointInterval: number) => number;
+  SimulationSession: new (config: Record<string, number>, checkpointInterval: number) => SessionHandle;
   destroy: (value: unknown) => void;
 };
 
@@ -17,7 +105,7 @@ type ExtendedModule = WheelyModule & {
   vectorToArray: (vector: VectorHandle) => number[];
 };
 
-let cachedModule: Promise<ExtendedModule> | null = null;
+const cachedModules: Partial<Record<WasmVariant, Promise<ExtendedModule>>> = {};
 
 function vectorToArray(vector: VectorHandle): number[] {
   const count = vector.size();
@@ -29,13 +117,114 @@ function vectorToArray(vector: VectorHandle): number[] {
   return output;
 }
 
-export async function loadWheelyModule(): Promise<ExtendedModule> {
-  if (!cachedModule) {
-    cachedModule = (async () => {
-      const factory = await import("@wasm/wheely_wasm.js");
+async function importFactory(variant: WasmVariant) {
+  return variant === "wasm64"
+    ? import("@wasm/wheely_wasm64.js")
+    : import("@wasm/wheely_wasm.js");
+}
+
+export async function loadWheelyModule(
+  variant: WasmVariant = "wasm32"
+): Promise<ExtendedModule> {
+  let cached = cachedModules[variant];
+  if (!cached) {
+    cached = (async () => {
+      const factory = await importFactory(variant);
       const module = (await factory.default()) as WheelyModule;
       return Object.assign(module, { vectorToArray });
     })();
+    cachedModules[variant] = cached;
   }
-  return cachedModule;
+  return cached;
 }
+
+// Picks the module a session for `config` should run in: wasm32 when the
+// estimated session state fits, memory64 when it does not and the runtime
+// supports it, and otherwise wasm32 with sparser checkpoints (see
+// planSession). Also falls back if the memory64 build fails to load, and
+// pre-sizes the chosen module's heap for the session.
+export async function loadModuleForRun(
+  config: Record<string, number>,
+  baseInterval: number
+): Promise<{ module: ExtendedModule; checkpointInterval: number }> {
+  const module32 = await loadWheelyModule();
+  const estimate = (interval: number) => module32.estimate_session_bytes(config, interval);
+  let plan = planSession(estimate, baseInterval, config.n_frames, supportsMemory64());
+  let module = module32;
+  if (plan.variant === "wasm64") {
+    try {
+      module = await loadWheelyModule("wasm64");
+    } catch {
+      plan = planSession(estimate, baseInterval, config.n_frames, false);
+    }
+  }
+  // Grow the heap once for the whole session instead of letting malloc grow
+  // it in steps while the run is under way.
+  module.reserve_heap(plan.estimatedBytes);
+  return { module, checkpointInterval: plan.checkpointInterval };
+}
+
+export type SmallRunOutput = {
+  times: Float64Array;
+  theta: Float64Array;
+  masses: Float64Array;
+};
+
+export type SmallRunner = {
+  run: (config: Record<string, number>) => SmallRunOutput;
+  dispose: () => void;
+};
+
+// Low-overhead runner for many tiny simulations. The output buffer is
+// allocated once in the wasm heap and every run writes into it, so no
+// embind objects are created per call. The returned arrays are views into
+// that buffer: they are overwritten by the next run, so copy them to keep
+// them.
+export function createSmallRunner(
+  module: WheelyModule,
+  maxCups: number,
+  maxFrames: number
+): SmallRunner {
+  const capacity = (maxCups + 2) * maxFrames;
+  const pointer = module._malloc(capacity * Float64Array.BYTES_PER_ELEMENT);
+  if (pointer === 0) {
+    throw new Error("out of memory");
+  }
+  return {
+    run: (config) => {
+      const nCups = config.n_cups;
+      const nFrames = config.n_frames;
+      if (nCups > maxCups || nFrames > maxFrames) {
+        throw new Error(`run exceeds runner capacity (${maxCups} cups, ${maxFrames} frames)`);
+      }
+      const status = module.simulate_into_heap(
+        nCups,
+        config.radius,
+        config.g,
+        config.damping,
+        config.leak_rate,
+        config.inflow_rate,
+        config.inertia,
+        config.omega0,
+        config.t_start,
+        config.t_end,
+        nFrames,
+        config.steps_per_frame,
+        pointer
+      );
+      if (status !== 0) {
+        throw new Error(module.status_message(status));
+      }
+      // Re-read HEAPF64 on every run: growing the heap replaces the buffer.
+      const base = pointer / Float64Array.BYTES_PER_ELEMENT;
+      const heap = module.HEAPF64;
+      return {
+        times: heap.subarray(base, base + nFrames),
+        theta: heap.subarray(base + nFrames, base + 2 * nFrames),
+        masses: heap.subarray(base + 2 * nFrames, base + (nCups + 2) * nFrames)
+      };
+    },
+    dispose: () => module._free(pointer)
+  };
+}
+
@@ -0,0 +1,48 @@
+import {
+  WASM32_BUDGET_BYTES,
+  WASM64_BUDGET_BYTES,
+  planSession,
+  supportsMemory64
+} from "./memoryPlan";
+
+// Same shape as wheely::estimate_session_bytes: two doubles per frame plus
+// one (n_cups + 2)-double checkpoint every `interval` frames.
+function estimator(cups: number, frames: number) {
+  return (interval: number) => 16 * frames + Math.ceil(frames / interval) * (cups + 2) * 8;
+}
+
+it("keeps runs that fit in wasm32 unchanged", () => {
+  const plan = planSession(estimator(8, 500), 32, 500, true);
+  expect(plan).toEqual({
+    variant: "wasm32",
+    checkpointInterval: 32,
+    estimatedBytes: estimator(8, 500)(32)
+  });
+});
+
+it("moves oversized runs to memory64 when supported", () => {
+  const estimate = estimator(40000, 1000000);
+  expect(estimate(32)).toBeGreaterThan(WASM32_BUDGET_BYTES);
+  expect(estimate(32)).toBeLessThan(WASM64_BUDGET_BYTES);
+
+  const plan = planSession(estimate, 32, 1000000, true);
+  expect(plan.variant).toBe("wasm64");
+  expect(plan.checkpointInterval).toBe(32);
+});
+
+it("falls back to sparser checkpoints without memory64", () => {
+  const estimate = estimator(40000, 1000000);
+  const plan = planSession(estimate, 32, 1000000, false);
+  expect(plan.variant).toBe("wasm32");
+  expect(plan.checkpointInterval).toBeGreaterThan(32);
+  expect(plan.estimatedBytes).toBeLessThanOrEqual(WASM32_BUDGET_BYTES);
+});
+
+it("rejects runs whose per-frame data alone exceeds the budget", () => {
+  const estimate = estimator(8, 400000000);
+  expect(() => planSession(estimate, 32, 400000000, false)).toThrow(/GiB/);
+});
+
+it("reports memory64 support as a boolean", () => {
+  expect(typeof supportsMemory64()).toBe("boolean");
+});
@@ -0,0 +1,60 @@
+export type WasmVariant = "wasm32" | "wasm64";
+
+export type SessionPlan = {
+  variant: WasmVariant;
+  checkpointInterval: number;
+  estimatedBytes: number;
+};
+
+const GiB = 1024 ** 3;
+
+// Session state we are willing to place in each build's linear memory. Both
+// leave headroom below the -sMAXIMUM_MEMORY limits in CMakeLists.txt for the
+// module itself and the frame windows fetched while playing back.
+export const WASM32_BUDGET_BYTES = 3 * GiB;
+export const WASM64_BUDGET_BYTES = 12 * GiB;
+
+// Smallest module declaring a 64-bit memory (limits flag 0x04). Runtimes
+// without the memory64 proposal reject it.
+const memory64Probe = new Uint8Array([
+  0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x05, 0x03, 0x01, 0x04, 0x00
+]);
+
+export function supportsMemory64(): boolean {
+  try {
+    return typeof WebAssembly !== "undefined" && WebAssembly.validate(memory64Probe);
+  } catch {
+    return false;
+  }
+}
+
+// Chooses the build and checkpoint interval for a session. Runs that fit in
+// wasm32 stay there; larger ones move to memory64 when the runtime has it.
+// Otherwise checkpoints are thinned out (doubling the interval) until the
+// session fits, which keeps the run possible at the cost of slower seeks.
+export function planSession(
+  estimateBytes: (checkpointInterval: number) => number,
+  baseInterval: number,
+  frameCount: number,
+  memory64: boolean
+): SessionPlan {
+  const baseBytes = estimateBytes(baseInterval);
+  if (baseBytes <= WASM32_BUDGET_BYTES) {
+    return { variant: "wasm32", checkpointInterval: baseInterval, estimatedBytes: baseBytes };
+  }
+
+  const variant: WasmVariant = memory64 ? "wasm64" : "wasm32";
+  const budget = memory64 ? WASM64_BUDGET_BYTES : WASM32_BUDGET_BYTES;
+  let interval = baseInterval;
+  let bytes = baseBytes;
+  while (bytes > budget && interval < frameCount) {
+    interval = Math.min(interval * 2, frameCount);
+    bytes = estimateBytes(interval);
+  }
+  if (bytes > budget) {
+    throw new Error(
+      `Run needs about ${(bytes / GiB).toFixed(1)} GiB, more than this browser can provide.`
+    );
+  }
+  return { variant, checkpointInterval: interval, estimatedBytes: bytes };
+}
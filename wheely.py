@@ -95,6 +95,13 @@ theta_vals = np.asarray(theta_vals)
 cup_masses = np.asarray(cup_masses)
 num_frames = theta_vals.shape[0]
 
+if wheely_cpp is not None:
+    cup_x, cup_y = wheely_cpp.cup_positions(theta_vals, config["N_CUPS"], config["RADIUS"])
+else:
+    cup_angles = theta_vals[np.newaxis, :] + np.linspace(0, 2 * np.pi, config["N_CUPS"], endpoint=False)[:, np.newaxis]
+    cup_x = config["RADIUS"] * np.cos(cup_angles)
+    cup_y = config["RADIUS"] * np.sin(cup_angles)
+
 # -----------------------------
 # 🎞️ Animation Setup
 # -----------------------------
@@ -110,11 +117,9 @@ def init():
     return [cup_dots] + cup_texts
 
 def update(frame):
-    theta = theta_vals[frame]
     masses = cup_masses[:, frame]
-    angles = theta + np.linspace(0, 2 * np.pi, config["N_CUPS"], endpoint=False)
-    x = config["RADIUS"] * np.cos(angles)
-    y = config["RADIUS"] * np.sin(angles)
+    x = cup_x[:, frame]
+    y = cup_y[:, frame]
     cup_dots.set_data(x, y)
 
     for i, txt in enumerate(cup_texts):